@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "JScr.h"
+#include "Runtime/Binding.h"
+#include "Runtime/DifferentialRunner.h"
+#include "Runtime/Interpreter.h"
+using namespace JScr;
+using namespace JScr::Runtime;
+
+// Times host calls from C++, then every script below the directory on each engine, best of the given
+// number of runs, and fails when the engines disagree on a result.
+// Usage: Benchmarks [scripts directory] [repetitions]
+
+namespace
+{
+    std::int32_t Add(std::int32_t a, std::int32_t b) { return a + b; }
+
+    // What a native written by hand against the VM looks like, to compare the generated trampoline with.
+    Value AddNative(NativeHost&, Value* args, int, void*)
+    {
+        return Value::Int(args[0].AsInt() + args[1].AsInt());
+    }
+
+    // One call of `add` from C++ with its arguments already in Values, best of the repetitions.
+    void RunHostCalls(int repetitions)
+    {
+        using Clock = std::chrono::steady_clock;
+        const int calls = 100000000;
+
+        // Volatile so the compiler cannot inline any of them into the loop.
+        std::int32_t (* volatile direct)(std::int32_t, std::int32_t) = &Add;
+        NativeFunction volatile native = &AddNative;
+        auto bound = Binding::Make("add", &Add);
+        NativeFunction volatile trampoline = bound->trampoline;
+
+        Interpreter host;
+        Value args[2];
+        double best[3] = { 1e300, 1e300, 1e300 };
+        std::int32_t sum = 0;
+
+        for (int r = 0; r < repetitions; r++)
+        {
+            auto start = Clock::now();
+            sum = 0;
+            for (int i = 0; i < calls; i++)
+                sum = direct(sum, 1);
+            best[0] = std::min(best[0], std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+
+            start = Clock::now();
+            args[0] = Value::Int(0);
+            for (int i = 0; i < calls; i++)
+            {
+                args[1] = Value::Int(1);
+                args[0] = native(host, args, 2, nullptr);
+            }
+            best[1] = std::min(best[1], std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+
+            start = Clock::now();
+            args[0] = Value::Int(0);
+            for (int i = 0; i < calls; i++)
+            {
+                args[1] = Value::Int(1);
+                args[0] = trampoline(host, args, 2, const_cast<HostFunction*>(bound.get()));
+            }
+            best[2] = std::min(best[2], std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+        }
+
+        std::printf("Host calls from C++, ns per call: direct %.2f, hand-written native %.2f, trampoline %.2f (%d, %d)\n",
+            best[0] / calls, best[1] / calls, best[2] / calls, sum, args[0].AsInt());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string scripts = argc > 1 ? argv[1] : "Scripts";
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    RunHostCalls(repetitions);
+
+    ExternalResource hosts;
+    hosts.Bind("add", &Add);
+
+    DifferentialRunner runner(repetitions, { hosts });
+    auto reports = runner.RunCorpus(scripts);
+    std::fputs(DifferentialRunner::FormatReport(reports).c_str(), stdout);
+
+    if (reports.empty())
+    {
+        std::fprintf(stderr, "No scripts found in \"%s\".\n", scripts.c_str());
+        return 1;
+    }
+
+    for (const auto& report : reports)
+    {
+        if (!report.Matches())
+            return 1;
+    }
+    return 0;
+}
@@ -14,4 +14,7 @@ group "JScrCore"
 	include "JScrCore/Build.lua"
 group ""
 
-include "TestApp/Build.lua"
\ No newline at end of file
+include "TestApp/Build.lua"
+include "JScrC/Build.lua"
+include "Tests/Build.lua"
+include "Benchmarks/Build.lua"
\ No newline at end of file
@@ -0,0 +1,49 @@
+project "jscrc"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+    targetdir "Binaries/%{cfg.buildcfg}"
+    staticruntime "off"
+ 
+    files { "Source/**.h", "Source/**.cpp" }
+ 
+    includedirs
+    {
+       "Source",
+ 
+	   -- Include Core
+	   "../JScrCore/Source"
+    }
+ 
+    links
+    {
+       "JScrCore"
+    }
+ 
+    targetdir ("../Binaries/" .. OutputDir .. "/%{prj.name}")
+    objdir ("../Binaries/Intermediates/" .. OutputDir .. "/%{prj.name}")
+ 
+    filter "system:windows"
+        systemversion "latest"
+        defines { "JSCR_PLATFORM_WINDOWS" }
+ 
+    -- Script::Execute runs scripts on the worker threads of Runtime::Scheduler.
+    filter "system:linux"
+        links { "pthread" }
+
+    filter "configurations:Debug"
+        defines { "DEBUG" }
+        runtime "Debug"
+        symbols "On"
+ 
+    filter "configurations:Release"
+        defines { "RELEASE" }
+        runtime "Release"
+        optimize "On"
+        symbols "On"
+ 
+    filter "configurations:Dist"
+        defines { "DIST" }
+        runtime "Release"
+        optimize "On"
+        symbols "Off"
\ No newline at end of file
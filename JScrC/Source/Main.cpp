@@ -0,0 +1,93 @@
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "Aot/Transpiler.h"
+#include "Frontend/Parser.h"
+#include "Runtime/Compiler.h"
+using namespace JScr::Frontend;
+
+// jscrc <script.jscr> [-o <out.cpp>] [--namespace <name>]
+//
+// Writes <out.cpp> and <out.h>. Compile the source into the host next to JScrCore and run it with
+// JScr::Script::FromCompiled(<name>::Compiled, externals).
+
+static int Usage()
+{
+    std::fprintf(stderr, "Usage: jscrc <script.jscr> [-o <out.cpp>] [--namespace <name>]\n");
+    return 2;
+}
+
+// The file name, made into a C++ identifier.
+static std::string NamespaceFor(const std::filesystem::path& input)
+{
+    std::string name = input.stem().string();
+    for (char& c : name)
+    {
+        if (!std::isalnum((unsigned char) c))
+            c = '_';
+    }
+    if (name.empty() || std::isdigit((unsigned char) name.front()))
+        name = "_" + name;
+    return name;
+}
+
+static bool WriteFile(const std::filesystem::path& path, const std::string& content)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+    return (bool) file;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string input = "";
+    std::string output = "";
+    std::string ns = "";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else if (std::strcmp(argv[i], "--namespace") == 0 && i + 1 < argc)
+            ns = argv[++i];
+        else if (argv[i][0] != '-' && input.empty())
+            input = argv[i];
+        else
+            return Usage();
+    }
+    if (input.empty())
+        return Usage();
+
+    std::filesystem::path source = output.empty() ? std::filesystem::path(input).replace_extension(".cpp") : std::filesystem::path(output);
+    std::filesystem::path header = std::filesystem::path(source).replace_extension(".h");
+
+    JScr::Aot::Transpiler::Options options{};
+    options.ns = ns.empty() ? NamespaceFor(input) : ns;
+    options.headerName = header.filename().string();
+
+    try
+    {
+        Parser parser{};
+        Program program = parser.ProduceAST(input);
+
+        // The same checks a script loaded at run time goes through.
+        JScr::Runtime::Compiler::Compile(program);
+
+        auto result = JScr::Aot::Transpiler::Transpile(program, options);
+        if (!WriteFile(source, result.source) || !WriteFile(header, result.header))
+        {
+            std::fprintf(stderr, "Cannot write '%s'.\n", source.string().c_str());
+            return 1;
+        }
+    }
+    catch (const SyntaxException& e)
+    {
+        std::fprintf(stderr, "%s\n", e.ToString().c_str());
+        return 1;
+    }
+
+    return 0;
+}
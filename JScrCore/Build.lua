@@ -19,6 +19,10 @@ project "JScrCore"
         systemversion "latest"
         defines { "JSCR_PLATFORM_WINDOWS" }
 
+    -- The AVX2 kernels only run after a runtime CPU check. MSVC needs no flag for AVX2 intrinsics.
+    filter { "system:not windows", "files:Source/Runtime/KernelsAvx2.cpp" }
+        buildoptions { "-mavx2" }
+
     filter "configurations:Debug"
         defines { "DEBUG" }
         runtime "Debug"
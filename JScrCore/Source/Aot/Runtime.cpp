@@ -0,0 +1,645 @@
+#include "Runtime.h"
+#include <charconv>
+#include <cmath>
+#include "../JScr.h"
+#include "../Runtime/Async.h"
+#include "../Runtime/Binding.h"
+#include "../Runtime/Heap.h"
+
+namespace JScr::Aot
+{
+    // ----- Objects -----
+
+    void HeapObject::Release(Worklist& children)
+    {
+        thread_local Worklist* t_draining = nullptr;
+        if (t_draining != nullptr)
+        {
+            for (auto& child : children)
+            {
+                if (child)
+                    t_draining->push_back(std::move(child));
+            }
+            return;
+        }
+
+        t_draining = &children;
+        while (!children.empty())
+        {
+            // Taken off the list first, as its destructor may add to the list.
+            std::shared_ptr<HeapObject> child = std::move(children.back());
+            children.pop_back();
+            child.reset();
+        }
+        t_draining = nullptr;
+    }
+
+    ArrayObject::~ArrayObject()
+    {
+        Worklist children;
+        for (auto& item : m_items)
+        {
+            if (item.IsObject())
+                children.push_back(item.TakeObject());
+        }
+        Release(children);
+    }
+
+    InstanceObject::~InstanceObject()
+    {
+        Worklist children;
+        for (auto& field : m_fields)
+        {
+            if (field.second.IsObject())
+                children.push_back(field.second.TakeObject());
+        }
+        Release(children);
+    }
+
+    const char* TypedArrayBase::ElementName(ElementType type)
+    {
+        static constexpr const char* names[] = { "int", "float", "double", "char" };
+        return names[(int) type];
+    }
+
+    const Dynamic* InstanceObject::Find(std::string_view key) const
+    {
+        for (const auto& field : m_fields)
+        {
+            if (field.first == key)
+                return &field.second;
+        }
+        return nullptr;
+    }
+
+    void InstanceObject::Set(std::string_view key, const Dynamic& value)
+    {
+        for (auto& field : m_fields)
+        {
+            if (field.first == key)
+            {
+                field.second = value;
+                return;
+            }
+        }
+        m_fields.emplace_back(std::string(key), value);
+    }
+
+    void StructObject::NoProperty(std::string_view key) const
+    {
+        Error("'" + std::string(m_typeName) + "' has no property '" + std::string(key) + "'.");
+    }
+
+    Dynamic Call(const Dynamic& callee, std::initializer_list<Dynamic> args)
+    {
+        if (!callee.Is(ObjectKind::Function))
+            Error("Value of type '" + TypeName(callee) + "' is not callable.");
+
+        auto* function = static_cast<FunctionObject*>(callee.AsObject());
+        if (function->Arity() >= 0 && (std::size_t) function->Arity() != args.size())
+            Error("Function '" + std::string(function->Name()) + "' expects " + std::to_string(function->Arity()) + " argument(s) but got " + std::to_string(args.size()) + ".");
+
+        return function->Invoke(std::span<const Dynamic>(args.begin(), args.size()));
+    }
+
+    Dynamic NewArray(std::initializer_list<Dynamic> items)
+    {
+        return Dynamic(std::make_shared<ArrayObject>(std::vector<Dynamic>(items)));
+    }
+
+    Dynamic NewObject(std::initializer_list<std::pair<std::string_view, Dynamic>> fields)
+    {
+        auto object = std::make_shared<InstanceObject>();
+        for (const auto& field : fields)
+            object->Set(field.first, field.second);
+        return Dynamic(std::move(object));
+    }
+
+    // ----- Errors -----
+
+    void Error(const std::string& description)
+    {
+        throw RuntimeException(description);
+    }
+
+    void ConversionError(const Dynamic& value, const char* target)
+    {
+        Error("Cannot convert '" + TypeName(value) + "' to '" + target + "'.");
+    }
+
+    void IndexError(int index, std::size_t length)
+    {
+        Error("Index " + std::to_string(index) + " is out of bounds for array of length " + std::to_string(length) + ".");
+    }
+
+    std::string ToString(const Dynamic& value)
+    {
+        switch (value.GetType())
+        {
+        case Dynamic::Type::Null: return "null";
+        case Dynamic::Type::Bool: return value.AsBool() ? "true" : "false";
+        case Dynamic::Type::Int:  return std::to_string(value.AsInt());
+        case Dynamic::Type::Char: return std::string(1, value.AsChar());
+        case Dynamic::Type::Float:
+        case Dynamic::Type::Double:
+        {
+            char buffer[32];
+            auto result = value.IsFloat() ? std::to_chars(buffer, buffer + sizeof(buffer), value.AsFloat()) : std::to_chars(buffer, buffer + sizeof(buffer), value.AsDouble());
+            return std::string(buffer, result.ptr);
+        }
+        default:
+            break;
+        }
+
+        HeapObject* object = value.AsObject();
+        switch (object->Kind())
+        {
+        case ObjectKind::String:
+            return static_cast<StringObject*>(object)->Data();
+        case ObjectKind::Array:
+        {
+            std::string result = "{ ";
+            const auto& items = static_cast<ArrayObject*>(object)->Items();
+            for (std::size_t i = 0; i < items.size(); i++)
+                result += (i > 0 ? ", " : "") + ToString(items[i]);
+            return result + " }";
+        }
+        case ObjectKind::TypedArray:
+        {
+            std::string result = "{ ";
+            auto* array = static_cast<TypedArrayBase*>(object);
+            for (std::size_t i = 0; i < array->Length(); i++)
+                result += (i > 0 ? ", " : "") + ToString(array->Get(i));
+            return result + " }";
+        }
+        case ObjectKind::Instance:
+        {
+            std::string result = "{ ";
+            bool first = true;
+            for (const auto& field : static_cast<InstanceObject*>(object)->Fields())
+            {
+                result += (first ? "" : ", ") + field.first + ": " + ToString(field.second);
+                first = false;
+            }
+            return result + " }";
+        }
+        case ObjectKind::Struct:
+        {
+            auto* instance = static_cast<StructObject*>(object);
+            std::string result = std::string(instance->TypeName()) + " { ";
+            bool first = true;
+            for (const auto& field : instance->Fields())
+            {
+                result += (first ? "" : ", ") + std::string(field.first) + ": " + ToString(field.second);
+                first = false;
+            }
+            return result + " }";
+        }
+        case ObjectKind::Enum:
+            return static_cast<EnumObject*>(object)->Type()->name;
+        case ObjectKind::Function:
+            return "function " + std::string(static_cast<FunctionObject*>(object)->Name());
+        default:
+            return "object";
+        }
+    }
+
+    std::string TypeName(const Dynamic& value)
+    {
+        switch (value.GetType())
+        {
+        case Dynamic::Type::Null:   return "null";
+        case Dynamic::Type::Bool:   return "bool";
+        case Dynamic::Type::Int:    return "int";
+        case Dynamic::Type::Float:  return "float";
+        case Dynamic::Type::Double: return "double";
+        case Dynamic::Type::Char:   return "char";
+        default:
+            break;
+        }
+
+        switch (value.AsObject()->Kind())
+        {
+        case ObjectKind::String:     return "string";
+        case ObjectKind::Array:      return "array";
+        case ObjectKind::TypedArray: return std::string(TypedArrayBase::ElementName(static_cast<TypedArrayBase*>(value.AsObject())->GetElementType())) + "[]";
+        case ObjectKind::Instance:   return "object";
+        case ObjectKind::Struct:     return static_cast<StructObject*>(value.AsObject())->TypeName();
+        case ObjectKind::Enum:       return static_cast<EnumObject*>(value.AsObject())->Type()->name;
+        case ObjectKind::Function:   return "function";
+        default:                     return "object";
+        }
+    }
+
+    // ----- Arithmetic -----
+
+    enum class ArithOp
+    {
+        Add, Sub, Mul, Div, Mod
+    };
+
+    static Dynamic Arith(ArithOp op, const Dynamic& a, const Dynamic& b)
+    {
+        static const char* symbols[] = { "+", "-", "*", "/", "%" };
+
+        if (a.IsNumber() && b.IsNumber())
+        {
+            if (a.IsDouble() || b.IsDouble())
+            {
+                double l = a.ToDouble(), r = b.ToDouble();
+                switch (op)
+                {
+                case ArithOp::Add: return l + r;
+                case ArithOp::Sub: return l - r;
+                case ArithOp::Mul: return l * r;
+                case ArithOp::Div: return l / r;
+                default:           return std::fmod(l, r);
+                }
+            }
+
+            if (a.IsFloat() || b.IsFloat())
+            {
+                float l = (float) a.ToDouble(), r = (float) b.ToDouble();
+                switch (op)
+                {
+                case ArithOp::Add: return l + r;
+                case ArithOp::Sub: return l - r;
+                case ArithOp::Mul: return l * r;
+                case ArithOp::Div: return l / r;
+                default:           return std::fmod(l, r);
+                }
+            }
+
+            int l = a.ToInt(), r = b.ToInt();
+            switch (op)
+            {
+            case ArithOp::Add: return AddInt(l, r);
+            case ArithOp::Sub: return SubInt(l, r);
+            case ArithOp::Mul: return MulInt(l, r);
+            case ArithOp::Div: return DivInt(l, r);
+            default:           return ModInt(l, r);
+            }
+        }
+
+        if (op == ArithOp::Add && (a.Is(ObjectKind::String) || b.Is(ObjectKind::String)))
+            return Dynamic::String(ToString(a) + ToString(b));
+
+        Error(std::string("Operator '") + symbols[(int) op] + "' cannot be applied to '" + TypeName(a) + "' and '" + TypeName(b) + "'.");
+    }
+
+    Dynamic Add(const Dynamic& a, const Dynamic& b) { return Arith(ArithOp::Add, a, b); }
+    Dynamic Sub(const Dynamic& a, const Dynamic& b) { return Arith(ArithOp::Sub, a, b); }
+    Dynamic Mul(const Dynamic& a, const Dynamic& b) { return Arith(ArithOp::Mul, a, b); }
+    Dynamic Div(const Dynamic& a, const Dynamic& b) { return Arith(ArithOp::Div, a, b); }
+    Dynamic Mod(const Dynamic& a, const Dynamic& b) { return Arith(ArithOp::Mod, a, b); }
+
+    Dynamic Negate(const Dynamic& a)
+    {
+        switch (a.GetType())
+        {
+        case Dynamic::Type::Int:    return NegInt(a.AsInt());
+        case Dynamic::Type::Char:   return -(int) a.AsChar();
+        case Dynamic::Type::Float:  return -a.AsFloat();
+        case Dynamic::Type::Double: return -a.AsDouble();
+        default:
+            Error("Operator '-' cannot be applied to '" + TypeName(a) + "'.");
+        }
+    }
+
+    bool Equals(const Dynamic& a, const Dynamic& b)
+    {
+        if (a.IsNumber() && b.IsNumber())
+        {
+            if (a.IsInt() && b.IsInt())
+                return a.AsInt() == b.AsInt();
+            return a.ToDouble() == b.ToDouble();
+        }
+
+        if (a.Is(ObjectKind::String) && b.Is(ObjectKind::String))
+            return static_cast<StringObject*>(a.AsObject())->Data() == static_cast<StringObject*>(b.AsObject())->Data();
+
+        if (a.GetType() != b.GetType())
+            return false;
+        switch (a.GetType())
+        {
+        case Dynamic::Type::Null: return true;
+        case Dynamic::Type::Bool: return a.AsBool() == b.AsBool();
+        default:                  return a.AsObject() == b.AsObject();
+        }
+    }
+
+    // -1, 0 or 1, or 2 when a NaN makes the operands unordered.
+    static int Order(const Dynamic& a, const Dynamic& b)
+    {
+        if (a.IsNumber() && b.IsNumber())
+        {
+            double l = a.ToDouble(), r = b.ToDouble();
+            if (std::isnan(l) || std::isnan(r))
+                return 2;
+            return l < r ? -1 : l > r ? 1 : 0;
+        }
+
+        if (a.Is(ObjectKind::String) && b.Is(ObjectKind::String))
+        {
+            int order = static_cast<StringObject*>(a.AsObject())->Data().compare(static_cast<StringObject*>(b.AsObject())->Data());
+            return order < 0 ? -1 : order > 0 ? 1 : 0;
+        }
+
+        Error("Cannot compare '" + TypeName(a) + "' with '" + TypeName(b) + "'.");
+    }
+
+    bool Less(const Dynamic& a, const Dynamic& b)         { int order = Order(a, b); return order == -1; }
+    bool LessEqual(const Dynamic& a, const Dynamic& b)    { int order = Order(a, b); return order == -1 || order == 0; }
+    bool Greater(const Dynamic& a, const Dynamic& b)      { int order = Order(a, b); return order == 1; }
+    bool GreaterEqual(const Dynamic& a, const Dynamic& b) { int order = Order(a, b); return order == 1 || order == 0; }
+
+    // ----- Properties and indexing -----
+
+    Dynamic GetField(const Dynamic& object, std::string_view key)
+    {
+        if (!object.IsObject())
+            Error("Cannot read property '" + std::string(key) + "' of '" + TypeName(object) + "'.");
+
+        HeapObject* heapObject = object.AsObject();
+        switch (heapObject->Kind())
+        {
+        case ObjectKind::Instance:
+            if (const Dynamic* value = static_cast<InstanceObject*>(heapObject)->Find(key))
+                return *value;
+            break;
+        case ObjectKind::Struct:
+            return static_cast<StructObject*>(heapObject)->Get(key);
+        case ObjectKind::Enum:
+        {
+            const auto& entries = static_cast<EnumObject*>(heapObject)->Type()->entries;
+            for (std::size_t i = 0; i < entries.size(); i++)
+            {
+                if (entries[i] == key)
+                    return (int) i;
+            }
+            break;
+        }
+        case ObjectKind::Array:
+            if (key == "length")
+                return (int) static_cast<ArrayObject*>(heapObject)->Items().size();
+            break;
+        case ObjectKind::TypedArray:
+            if (key == "length")
+                return (int) static_cast<TypedArrayBase*>(heapObject)->Length();
+            break;
+        case ObjectKind::String:
+            if (key == "length")
+                return (int) static_cast<StringObject*>(heapObject)->Data().size();
+            break;
+        default:
+            break;
+        }
+
+        Error("'" + TypeName(object) + "' has no property '" + std::string(key) + "'.");
+    }
+
+    Dynamic SetField(const Dynamic& object, std::string_view key, const Dynamic& value)
+    {
+        if (object.Is(ObjectKind::Struct))
+            static_cast<StructObject*>(object.AsObject())->Set(key, value);
+        else if (object.Is(ObjectKind::Instance))
+            static_cast<InstanceObject*>(object.AsObject())->Set(key, value);
+        else
+            Error("Cannot assign property '" + std::string(key) + "' of '" + TypeName(object) + "'.");
+        return value;
+    }
+
+    Dynamic GetIndex(const Dynamic& object, const Dynamic& index)
+    {
+        if (!index.IsInt())
+            Error("Index must be of type 'int', got '" + TypeName(index) + "'.");
+
+        int i = index.AsInt();
+        if (object.Is(ObjectKind::Array))
+        {
+            const auto& items = static_cast<ArrayObject*>(object.AsObject())->Items();
+            if (i < 0 || (std::size_t) i >= items.size())
+                IndexError(i, items.size());
+            return items[i];
+        }
+
+        if (object.Is(ObjectKind::TypedArray))
+        {
+            auto* array = static_cast<TypedArrayBase*>(object.AsObject());
+            if (i < 0 || (std::size_t) i >= array->Length())
+                IndexError(i, array->Length());
+            return array->Get(i);
+        }
+
+        if (object.Is(ObjectKind::String))
+        {
+            const auto& data = static_cast<StringObject*>(object.AsObject())->Data();
+            if (i < 0 || (std::size_t) i >= data.size())
+                Error("Index " + std::to_string(i) + " is out of bounds for string of length " + std::to_string(data.size()) + ".");
+            return data[i];
+        }
+
+        Error("Cannot index into '" + TypeName(object) + "'.");
+    }
+
+    Dynamic SetIndex(const Dynamic& object, const Dynamic& index, const Dynamic& value)
+    {
+        if (!object.Is(ObjectKind::Array) && !object.Is(ObjectKind::TypedArray))
+            Error("Cannot assign index of '" + TypeName(object) + "'.");
+        if (!index.IsInt())
+            Error("Index must be of type 'int', got '" + TypeName(index) + "'.");
+
+        int i = index.AsInt();
+        if (object.Is(ObjectKind::TypedArray))
+        {
+            auto* array = static_cast<TypedArrayBase*>(object.AsObject());
+            if (i < 0 || (std::size_t) i >= array->Length())
+                IndexError(i, array->Length());
+            array->Set(i, value);
+            return value;
+        }
+
+        auto& items = static_cast<ArrayObject*>(object.AsObject())->Items();
+        if (i < 0 || (std::size_t) i >= items.size())
+            IndexError(i, items.size());
+        items[i] = value;
+        return value;
+    }
+
+    // ----- Calls -----
+
+    thread_local std::size_t StackGuard::s_depth = 0;
+    thread_local const char* StackGuard::s_base = nullptr;
+
+    // The entry itself lives in the frame that runs the script, above everything the script calls.
+    StackGuard::Entry::Entry() : m_previous(s_base)
+    {
+        if (s_base == nullptr)
+            s_base = reinterpret_cast<const char*>(this);
+    }
+
+    StackGuard::Entry::~Entry()
+    {
+        s_base = m_previous;
+    }
+
+    // ----- Host functions -----
+
+    // The host the trampolines see. Its heap only holds the strings and array views of one call at a time.
+    class HostCalls final : public Runtime::NativeHost, private Runtime::RootSource
+    {
+    public:
+        explicit HostCalls(const std::vector<ExternalResource>& resources) : m_resources(resources) {}
+
+        const std::vector<ExternalResource>& Resources() const { return m_resources; }
+
+        Runtime::Heap& GetHeap() override { return m_heap; }
+
+        Runtime::Value Call(const Runtime::Value&, const std::vector<Runtime::Value>&) override
+        {
+            Error("Host functions cannot call back into a script compiled ahead of time.");
+        }
+
+        Runtime::Deferred Defer() override
+        {
+            Error("Host functions cannot return a task to a script compiled ahead of time.");
+        }
+
+        // Nothing a finished call allocated is reachable any more.
+        void Collect()
+        {
+            if (m_heap.WantsCollection())
+                m_heap.Step(*this);
+        }
+    private:
+        void TraceRoots(Runtime::Tracer&) override {}
+
+        const std::vector<ExternalResource>& m_resources;
+        Runtime::Heap m_heap;
+    };
+
+    namespace
+    {
+        thread_local HostCalls* t_hosts = nullptr;
+
+        const void* TypedData(const TypedArrayBase& array)
+        {
+            switch (array.GetElementType())
+            {
+            case ElementType::Int:    return static_cast<const TypedArrayObject<int>&>(array).Data();
+            case ElementType::Float:  return static_cast<const TypedArrayObject<float>&>(array).Data();
+            case ElementType::Double: return static_cast<const TypedArrayObject<double>&>(array).Data();
+            default:                  return static_cast<const TypedArrayObject<char>&>(array).Data();
+            }
+        }
+
+        Runtime::Value ToHost(Runtime::Heap& heap, const HostFunction& function, const Dynamic& value)
+        {
+            switch (value.GetType())
+            {
+            case Dynamic::Type::Null:   return Runtime::Value::Null();
+            case Dynamic::Type::Bool:   return Runtime::Value::Bool(value.AsBool());
+            case Dynamic::Type::Int:    return Runtime::Value::Int(value.AsInt());
+            case Dynamic::Type::Float:  return Runtime::Value::Float(value.AsFloat());
+            case Dynamic::Type::Double: return Runtime::Value::Double(value.AsDouble());
+            case Dynamic::Type::Char:   return Runtime::Value::Char(value.AsChar());
+            default:                    break;
+            }
+
+            if (value.Is(ObjectKind::String))
+            {
+                const std::string& data = static_cast<StringObject*>(value.AsObject())->Data();
+                return Runtime::Value::Object(heap.Allocate<Runtime::StringObject>(Runtime::String(data)));
+            }
+
+            // Both element type enums list the same types in the same order.
+            if (value.Is(ObjectKind::TypedArray))
+            {
+                auto* array = static_cast<TypedArrayBase*>(value.AsObject());
+                void* data = const_cast<void*>(TypedData(*array));
+                return Runtime::Value::Object(heap.Allocate<Runtime::TypedArrayObject>((Runtime::ElementType) array->GetElementType(), data, array->Length(), false));
+            }
+
+            Error("Function '" + function.name + "' cannot take a '" + TypeName(value) + "' from a script compiled ahead of time.");
+        }
+
+        // A typed array the function hands back can only be one it was given.
+        Dynamic FromHost(const HostFunction& function, const Runtime::Value& value, std::initializer_list<Dynamic> args)
+        {
+            if (value.IsNull())   return Dynamic();
+            if (value.IsBool())   return Dynamic(value.AsBool());
+            if (value.IsInt())    return Dynamic((int) value.AsInt());
+            if (value.IsFloat())  return Dynamic(value.AsFloat());
+            if (value.IsDouble()) return Dynamic(value.AsDouble());
+            if (value.IsChar())   return Dynamic(value.AsChar());
+
+            if (value.AsObject()->Kind() == Runtime::ObjectKind::String)
+                return Dynamic::String(std::string(static_cast<Runtime::StringObject*>(value.AsObject())->Data()));
+
+            if (value.AsObject()->Kind() == Runtime::ObjectKind::TypedArray)
+            {
+                const void* data = static_cast<Runtime::TypedArrayObject*>(value.AsObject())->Bytes();
+                for (const Dynamic& arg : args)
+                {
+                    if (arg.Is(ObjectKind::TypedArray) && TypedData(*static_cast<TypedArrayBase*>(arg.AsObject())) == data)
+                        return arg;
+                }
+            }
+
+            Error("Function '" + function.name + "' returned a value a script compiled ahead of time cannot take.");
+        }
+    }
+
+    HostScope::HostScope(const std::vector<ExternalResource>& resources) : m_calls(std::make_unique<HostCalls>(resources)), m_previous(t_hosts)
+    {
+        t_hosts = m_calls.get();
+    }
+
+    HostScope::~HostScope()
+    {
+        t_hosts = m_previous;
+    }
+
+    const HostFunction& FindHost(const char* name)
+    {
+        if (t_hosts != nullptr)
+        {
+            for (const ExternalResource& resource : t_hosts->Resources())
+            {
+                for (const auto& function : resource.GetFunctions())
+                {
+                    if (function->name == name)
+                        return *function;
+                }
+            }
+        }
+        Error("Undeclared identifier '" + std::string(name) + "'.");
+    }
+
+    Dynamic CallHost(const HostFunction& function, std::initializer_list<Dynamic> args)
+    {
+        if (function.arity >= 0 && (std::size_t) function.arity != args.size())
+            Error("Function '" + function.name + "' expects " + std::to_string(function.arity) + " argument(s) but got " + std::to_string(args.size()) + ".");
+
+        // Calls with few arguments, nearly all of them, need no allocation for the window.
+        constexpr std::size_t InlineArgs = 8;
+        Runtime::Value inlineWindow[InlineArgs];
+        std::vector<Runtime::Value> window;
+        Runtime::Value* argv = inlineWindow;
+        if (args.size() > InlineArgs)
+        {
+            window.resize(args.size());
+            argv = window.data();
+        }
+
+        HostCalls& hosts = *t_hosts;
+        std::size_t i = 0;
+        for (const Dynamic& arg : args)
+            argv[i++] = ToHost(hosts.GetHeap(), function, arg);
+
+        Runtime::Value result = function.trampoline(hosts, argv, (int) args.size(), const_cast<HostFunction*>(&function));
+        Dynamic converted = FromHost(function, result, args);
+        hosts.Collect();
+        return converted;
+    }
+}
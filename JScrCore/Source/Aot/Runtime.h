@@ -0,0 +1,607 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../Runtime/RuntimeException.h"
+
+namespace JScr
+{
+    class ExternalResource;
+}
+
+namespace JScr::Runtime
+{
+    struct HostFunction;
+}
+
+namespace JScr::Aot
+{
+    using Runtime::RuntimeException;
+    using Runtime::HostFunction;
+
+    // The runtime that C++ generated by jscrc links against. Values whose declared type is a primitive
+    // live in native variables; everything else is a Dynamic. Objects are reference counted, so unlike
+    // in the VM a cycle of objects that only reference each other is never freed.
+
+    static_assert(sizeof(int) == 4, "Scripts' int maps to a 32 bit int.");
+
+    enum class ObjectKind : std::uint8_t
+    {
+        String, Array, TypedArray, Instance, Struct, Enum, Function
+    };
+
+    class HeapObject
+    {
+    public:
+        explicit HeapObject(ObjectKind kind) : m_kind(kind) {}
+        virtual ~HeapObject() = default;
+
+        ObjectKind Kind() const { return m_kind; }
+
+    protected:
+        using Worklist = std::vector<std::shared_ptr<HeapObject>>;
+
+        // Destructors of objects that hold other objects move those references here instead of letting
+        // them go one inside the other, so dropping a million element `next` chain doesn't recurse a
+        // million destructors deep. Objects released while a Release is running are dropped by that one.
+        static void Release(Worklist& children);
+    private:
+        ObjectKind m_kind;
+    };
+
+    class Dynamic
+    {
+    public:
+        enum class Type : std::uint8_t
+        {
+            Null, Bool, Int, Float, Double, Char, Object
+        };
+
+        Dynamic() : m_type(Type::Null), m_double(0.0) {}
+        Dynamic(std::nullptr_t) : Dynamic() {}
+        Dynamic(bool value) : m_type(Type::Bool), m_bool(value) {}
+        Dynamic(int value) : m_type(Type::Int), m_int(value) {}
+        Dynamic(float value) : m_type(Type::Float), m_float(value) {}
+        Dynamic(double value) : m_type(Type::Double), m_double(value) {}
+        Dynamic(char value) : m_type(Type::Char), m_char(value) {}
+        Dynamic(const char*) = delete;
+
+        // Enum entries are ints once they are dynamic, the same as in the VM.
+        template <typename E> requires std::is_enum_v<E>
+        Dynamic(E value) : Dynamic(static_cast<int>(value)) {}
+
+        template <typename T> requires std::is_base_of_v<HeapObject, T>
+        Dynamic(std::shared_ptr<T> object) : m_type(object ? Type::Object : Type::Null), m_double(0.0), m_object(std::move(object)) {}
+
+        static Dynamic String(std::string value);
+
+    public:
+        Type GetType() const { return m_type; }
+
+        bool IsNull() const   { return m_type == Type::Null; }
+        bool IsBool() const   { return m_type == Type::Bool; }
+        bool IsInt() const    { return m_type == Type::Int; }
+        bool IsFloat() const  { return m_type == Type::Float; }
+        bool IsDouble() const { return m_type == Type::Double; }
+        bool IsChar() const   { return m_type == Type::Char; }
+        bool IsObject() const { return m_type == Type::Object; }
+        bool Is(ObjectKind kind) const { return m_type == Type::Object && m_object->Kind() == kind; }
+
+        // Chars take part in arithmetic as small integers.
+        bool IsNumber() const { return m_type >= Type::Int && m_type <= Type::Char; }
+
+        bool AsBool() const     { return m_bool; }
+        int AsInt() const       { return m_int; }
+        float AsFloat() const   { return m_float; }
+        double AsDouble() const { return m_double; }
+        char AsChar() const     { return m_char; }
+        HeapObject* AsObject() const { return m_object.get(); }
+        const std::shared_ptr<HeapObject>& Object() const { return m_object; }
+        // Leaves the value null.
+        std::shared_ptr<HeapObject> TakeObject() { m_type = Type::Null; return std::move(m_object); }
+
+        int ToInt() const
+        {
+            switch (m_type)
+            {
+            case Type::Int:    return m_int;
+            case Type::Char:   return (int) m_char;
+            case Type::Float:  return (int) m_float;
+            case Type::Double: return (int) m_double;
+            default:           return 0;
+            }
+        }
+
+        double ToDouble() const
+        {
+            switch (m_type)
+            {
+            case Type::Int:    return (double) m_int;
+            case Type::Char:   return (double) m_char;
+            case Type::Float:  return (double) m_float;
+            case Type::Double: return m_double;
+            default:           return 0.0;
+            }
+        }
+
+        bool IsTruthy() const
+        {
+            switch (m_type)
+            {
+            case Type::Null:   return false;
+            case Type::Bool:   return m_bool;
+            case Type::Object: return true;
+            default:           return ToDouble() != 0.0;
+            }
+        }
+
+    private:
+        Type m_type;
+        union
+        {
+            bool m_bool;
+            int m_int;
+            float m_float;
+            double m_double;
+            char m_char;
+        };
+        std::shared_ptr<HeapObject> m_object;
+    };
+
+    // ----- Objects -----
+
+    class StringObject : public HeapObject
+    {
+    public:
+        explicit StringObject(std::string data) : HeapObject(ObjectKind::String), m_data(std::move(data)) {}
+
+        const std::string& Data() const { return m_data; }
+    private:
+        std::string m_data;
+    };
+
+    inline Dynamic Dynamic::String(std::string value)
+    {
+        return Dynamic(std::make_shared<StringObject>(std::move(value)));
+    }
+
+    class ArrayObject : public HeapObject
+    {
+    public:
+        explicit ArrayObject(std::vector<Dynamic> items) : HeapObject(ObjectKind::Array), m_items(std::move(items)) {}
+        ~ArrayObject() override;
+
+        std::vector<Dynamic>& Items() { return m_items; }
+        const std::vector<Dynamic>& Items() const { return m_items; }
+    private:
+        std::vector<Dynamic> m_items;
+    };
+
+    enum class ElementType : std::uint8_t
+    {
+        Int, Float, Double, Char
+    };
+
+    template <typename T> constexpr ElementType ElementTypeOf();
+    template <> constexpr ElementType ElementTypeOf<int>()    { return ElementType::Int; }
+    template <> constexpr ElementType ElementTypeOf<float>()  { return ElementType::Float; }
+    template <> constexpr ElementType ElementTypeOf<double>() { return ElementType::Double; }
+    template <> constexpr ElementType ElementTypeOf<char>()   { return ElementType::Char; }
+
+    // Element access for code that only knows the array dynamically.
+    class TypedArrayBase : public HeapObject
+    {
+    public:
+        explicit TypedArrayBase(ElementType type) : HeapObject(ObjectKind::TypedArray), m_type(type) {}
+
+        ElementType GetElementType() const { return m_type; }
+        virtual std::size_t Length() const = 0;
+        virtual Dynamic Get(std::size_t index) const = 0;
+        // Converts like a store into a declared variable of the element type would.
+        virtual void Set(std::size_t index, const Dynamic& value) = 0;
+
+        static const char* ElementName(ElementType type);
+    private:
+        ElementType m_type;
+    };
+
+    template <typename T>
+    class TypedArrayObject final : public TypedArrayBase
+    {
+    public:
+        explicit TypedArrayObject(std::size_t length) : TypedArrayBase(ElementTypeOf<T>()), m_data(length) {}
+
+        T* Data() { return m_data.data(); }
+        const T* Data() const { return m_data.data(); }
+        std::size_t Length() const override { return m_data.size(); }
+        T& operator[](std::size_t index) { return m_data[index]; }
+
+        Dynamic Get(std::size_t index) const override { return Dynamic(m_data[index]); }
+        void Set(std::size_t index, const Dynamic& value) override;
+    private:
+        std::vector<T> m_data;
+    };
+
+    template <typename T>
+    using TypedArray = std::shared_ptr<TypedArrayObject<T>>;
+
+    // Objects built without a declared type. Properties keep the order they were added in.
+    class InstanceObject : public HeapObject
+    {
+    public:
+        InstanceObject() : HeapObject(ObjectKind::Instance) {}
+        ~InstanceObject() override;
+
+        const std::vector<std::pair<std::string, Dynamic>>& Fields() const { return m_fields; }
+        // Null when there is no such property.
+        const Dynamic* Find(std::string_view key) const;
+        void Set(std::string_view key, const Dynamic& value);
+    private:
+        std::vector<std::pair<std::string, Dynamic>> m_fields;
+    };
+
+    // Base of the structs generated for declared object types. Generated code uses their fields
+    // directly; these are for code that only has a Dynamic.
+    class StructObject : public HeapObject
+    {
+    public:
+        explicit StructObject(const char* typeName) : HeapObject(ObjectKind::Struct), m_typeName(typeName) {}
+
+        const char* TypeName() const { return m_typeName; }
+        virtual Dynamic Get(std::string_view key) const = 0;
+        virtual void Set(std::string_view key, const Dynamic& value) = 0;
+        // Every property in declaration order.
+        virtual std::vector<std::pair<const char*, Dynamic>> Fields() const = 0;
+
+    protected:
+        [[noreturn]] void NoProperty(std::string_view key) const;
+    private:
+        const char* m_typeName;
+    };
+
+    struct EnumType
+    {
+        const char* name;
+        std::vector<const char*> entries;
+    };
+
+    // An enum used as a value. `Enum.Entry` never needs one, generated code uses the enum class for that.
+    class EnumObject : public HeapObject
+    {
+    public:
+        explicit EnumObject(const EnumType* type) : HeapObject(ObjectKind::Enum), m_type(type) {}
+
+        const EnumType* Type() const { return m_type; }
+    private:
+        const EnumType* m_type;
+    };
+
+    inline Dynamic EnumValue(const EnumType& type)
+    {
+        return Dynamic(std::make_shared<EnumObject>(&type));
+    }
+
+    class FunctionObject : public HeapObject
+    {
+    public:
+        FunctionObject(const char* name, int arity) : HeapObject(ObjectKind::Function), m_name(name), m_arity(arity) {}
+
+        const char* Name() const { return m_name; }
+        int Arity() const { return m_arity; }
+        virtual Dynamic Invoke(std::span<const Dynamic> args) const = 0;
+    private:
+        const char* m_name;
+        int m_arity;
+    };
+
+    template <typename F>
+    class LambdaObject final : public FunctionObject
+    {
+    public:
+        LambdaObject(const char* name, int arity, F function) : FunctionObject(name, arity), m_function(std::move(function)) {}
+
+        Dynamic Invoke(std::span<const Dynamic> args) const override { return m_function(args); }
+    private:
+        F m_function;
+    };
+
+    // Wraps a callable taking std::span<const Dynamic> so scripts can pass it around and call it.
+    template <typename F>
+    Dynamic MakeFunction(const char* name, int arity, F function)
+    {
+        return Dynamic(std::make_shared<LambdaObject<F>>(name, arity, std::move(function)));
+    }
+
+    Dynamic Call(const Dynamic& callee, std::initializer_list<Dynamic> args);
+
+    Dynamic NewArray(std::initializer_list<Dynamic> items);
+    Dynamic NewObject(std::initializer_list<std::pair<std::string_view, Dynamic>> fields);
+
+    // Runs `init` on a fresh instance of a generated struct before handing it out.
+    template <typename T, typename F>
+    std::shared_ptr<T> New(F&& init)
+    {
+        auto object = std::make_shared<T>();
+        init(*object);
+        return object;
+    }
+
+    // ----- String literals -----
+
+    template <std::size_t N>
+    struct Literal
+    {
+        char data[N];
+
+        constexpr Literal(const char (&value)[N])
+        {
+            for (std::size_t i = 0; i < N; i++)
+                data[i] = value[i];
+        }
+    };
+
+    // "text"_jscr is a string value created once per literal.
+    template <Literal S>
+    const Dynamic& operator""_jscr()
+    {
+        static const Dynamic value = Dynamic::String(std::string(S.data, sizeof(S.data) - 1));
+        return value;
+    }
+
+    // ----- Errors -----
+
+    [[noreturn]] void Error(const std::string& description);
+    [[noreturn]] void ConversionError(const Dynamic& value, const char* target);
+
+    std::string ToString(const Dynamic& value);
+    std::string TypeName(const Dynamic& value);
+
+    // ----- Arithmetic -----
+
+    // Integer arithmetic wraps around instead of being undefined.
+    inline int AddInt(int a, int b) { return (int) ((std::uint32_t) a + (std::uint32_t) b); }
+    inline int SubInt(int a, int b) { return (int) ((std::uint32_t) a - (std::uint32_t) b); }
+    inline int MulInt(int a, int b) { return (int) ((std::uint32_t) a * (std::uint32_t) b); }
+    inline int NegInt(int a)        { return (int) (0u - (std::uint32_t) a); }
+
+    inline int DivInt(int a, int b)
+    {
+        if (b == 0)
+            Error("Integer division by zero.");
+        return b == -1 ? NegInt(a) : a / b;
+    }
+
+    inline int ModInt(int a, int b)
+    {
+        if (b == 0)
+            Error("Integer division by zero.");
+        return b == -1 ? 0 : a % b;
+    }
+
+    Dynamic Add(const Dynamic& a, const Dynamic& b);
+    Dynamic Sub(const Dynamic& a, const Dynamic& b);
+    Dynamic Mul(const Dynamic& a, const Dynamic& b);
+    Dynamic Div(const Dynamic& a, const Dynamic& b);
+    Dynamic Mod(const Dynamic& a, const Dynamic& b);
+    Dynamic Negate(const Dynamic& a);
+
+    bool Equals(const Dynamic& a, const Dynamic& b);
+    bool Less(const Dynamic& a, const Dynamic& b);
+    bool LessEqual(const Dynamic& a, const Dynamic& b);
+    bool Greater(const Dynamic& a, const Dynamic& b);
+    bool GreaterEqual(const Dynamic& a, const Dynamic& b);
+
+    inline bool Truthy(const Dynamic& value) { return value.IsTruthy(); }
+
+    // ----- Conversions to declared types -----
+
+    template <typename T> struct IsTypedArray : std::false_type {};
+    template <typename T> struct IsTypedArray<TypedArray<T>> : std::true_type { using Element = T; };
+
+    template <typename T> struct IsStruct : std::false_type {};
+    template <typename T> requires std::is_base_of_v<StructObject, T>
+    struct IsStruct<std::shared_ptr<T>> : std::true_type { using Type = T; };
+
+    // Arrays are copied into an unboxed array, converting every element. Typed arrays of the right
+    // element type pass through as they are.
+    template <typename T>
+    TypedArray<T> ConvertTypedArray(const Dynamic& value);
+
+    template <typename T>
+    T Convert(const Dynamic& value)
+    {
+        if constexpr (std::is_same_v<T, Dynamic>)
+            return value;
+        else if constexpr (std::is_same_v<T, int>)
+        {
+            if (!value.IsNumber()) ConversionError(value, "int");
+            return value.ToInt();
+        }
+        else if constexpr (std::is_same_v<T, float>)
+        {
+            if (!value.IsNumber()) ConversionError(value, "float");
+            return value.IsFloat() ? value.AsFloat() : (float) value.ToDouble();
+        }
+        else if constexpr (std::is_same_v<T, double>)
+        {
+            if (!value.IsNumber()) ConversionError(value, "double");
+            return value.ToDouble();
+        }
+        else if constexpr (std::is_same_v<T, char>)
+        {
+            if (value.IsChar()) return value.AsChar();
+            if (!value.IsInt()) ConversionError(value, "char");
+            return (char) value.AsInt();
+        }
+        else if constexpr (std::is_same_v<T, bool>)
+        {
+            if (!value.IsBool()) ConversionError(value, "bool");
+            return value.AsBool();
+        }
+        else if constexpr (std::is_enum_v<T>)
+        {
+            if (!value.IsInt()) ConversionError(value, "enum");
+            return static_cast<T>(value.AsInt());
+        }
+        else if constexpr (IsTypedArray<T>::value)
+            return ConvertTypedArray<typename IsTypedArray<T>::Element>(value);
+        else if constexpr (IsStruct<T>::value)
+        {
+            using S = typename IsStruct<T>::Type;
+            if (value.IsNull())
+                return nullptr;
+            auto object = value.Is(ObjectKind::Struct) ? std::dynamic_pointer_cast<S>(value.Object()) : nullptr;
+            if (object == nullptr)
+                ConversionError(value, S::Name);
+            return object;
+        }
+        else
+            static_assert(sizeof(T) == 0, "No conversion to this type.");
+    }
+
+    // Declared strings stay dynamic, they only have to hold a string or null.
+    inline const Dynamic& ExpectString(const Dynamic& value)
+    {
+        if (!value.IsNull() && !value.Is(ObjectKind::String))
+            ConversionError(value, "string");
+        return value;
+    }
+
+    template <typename T>
+    void TypedArrayObject<T>::Set(std::size_t index, const Dynamic& value)
+    {
+        m_data[index] = Convert<T>(value);
+    }
+
+    template <typename T>
+    TypedArray<T> ConvertTypedArray(const Dynamic& value)
+    {
+        if (value.IsNull())
+            return nullptr;
+        if (value.Is(ObjectKind::TypedArray) && static_cast<TypedArrayBase*>(value.AsObject())->GetElementType() == ElementTypeOf<T>())
+            return std::static_pointer_cast<TypedArrayObject<T>>(value.Object());
+        if (!value.Is(ObjectKind::Array))
+            ConversionError(value, (std::string(TypedArrayBase::ElementName(ElementTypeOf<T>())) + "[]").c_str());
+
+        const auto& items = static_cast<ArrayObject*>(value.AsObject())->Items();
+        auto array = std::make_shared<TypedArrayObject<T>>(items.size());
+        for (std::size_t i = 0; i < items.size(); i++)
+            (*array)[i] = Convert<T>(items[i]);
+        return array;
+    }
+
+    // ----- Properties and indexing -----
+
+    Dynamic GetField(const Dynamic& object, std::string_view key);
+    // Returns `value`, the result of the assignment expression.
+    Dynamic SetField(const Dynamic& object, std::string_view key, const Dynamic& value);
+    Dynamic GetIndex(const Dynamic& object, const Dynamic& index);
+    Dynamic SetIndex(const Dynamic& object, const Dynamic& index, const Dynamic& value);
+
+    [[noreturn]] void IndexError(int index, std::size_t length);
+
+    // A declared struct's fields are read and written in place once it is known not to be null.
+    template <typename T>
+    T* Deref(const std::shared_ptr<T>& object, const char* key)
+    {
+        if (object == nullptr)
+            Error("Cannot read property '" + std::string(key) + "' of 'null'.");
+        return object.get();
+    }
+
+    template <typename T>
+    T& At(const TypedArray<T>& array, int index)
+    {
+        if (array == nullptr)
+            Error("Cannot index into 'null'.");
+        if (index < 0 || (std::size_t) index >= array->Length())
+            IndexError(index, array->Length());
+        return (*array)[(std::size_t) index];
+    }
+
+    template <typename T>
+    int Length(const TypedArray<T>& array)
+    {
+        if (array == nullptr)
+            Error("Cannot read property 'length' of 'null'.");
+        return (int) array->Length();
+    }
+
+    // ----- Calls -----
+
+    // Compiled functions call each other on the native stack, so call depth is capped the same way the
+    // VM caps it, and on the stack space actually used so that small thread stacks are safe too.
+    class StackGuard
+    {
+    public:
+        static constexpr std::size_t MaxDepth = 1 << 14;
+        static constexpr std::size_t MaxBytes = 768 * 1024; // <-- Below the 1MB default stack of Windows threads.
+
+        StackGuard()
+        {
+            char marker;
+            if (++s_depth > MaxDepth || (s_base != nullptr && s_base - &marker > (std::ptrdiff_t) MaxBytes))
+            {
+                --s_depth;
+                Error("Stack overflow.");
+            }
+        }
+        ~StackGuard() { --s_depth; }
+
+        StackGuard(const StackGuard&) = delete;
+        StackGuard& operator=(const StackGuard&) = delete;
+
+        // Marks where the script's stack starts. Entries nest, only the outermost one counts.
+        class Entry
+        {
+        public:
+            Entry();
+            ~Entry();
+        private:
+            const char* m_previous;
+        };
+
+    private:
+        static thread_local std::size_t s_depth;
+        static thread_local const char* s_base;
+    };
+
+    // ----- Host functions -----
+
+    class HostCalls;
+
+    // Makes the functions bound by `resources` callable from generated code on this thread for as long as
+    // the scope lives. Arguments cross over as they do in the VM: primitives and strings by value, typed
+    // arrays without copying. A host function cannot call back into the script or return a task.
+    class HostScope
+    {
+    public:
+        explicit HostScope(const std::vector<ExternalResource>& resources);
+        ~HostScope();
+
+        HostScope(const HostScope&) = delete;
+        HostScope& operator=(const HostScope&) = delete;
+    private:
+        std::unique_ptr<HostCalls> m_calls;
+        HostCalls* m_previous;
+    };
+
+    // The first function of that name the resources of the current scope bind. Generated code looks
+    // each one up once per run, where the VM does it once per compilation.
+    const HostFunction& FindHost(const char* name);
+    Dynamic CallHost(const HostFunction& function, std::initializer_list<Dynamic> args);
+
+    // What jscrc generates for a script. Hosts hand it to Script::FromCompiled.
+    struct CompiledScript
+    {
+        const char* fileDir;
+        Dynamic (*run)(const std::vector<ExternalResource>& externals);
+    };
+}
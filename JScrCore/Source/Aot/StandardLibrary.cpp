@@ -0,0 +1,137 @@
+#include "StandardLibrary.h"
+
+namespace JScr::Aot::Std
+{
+    void ExpectedTypedArray(const char* function, int index, const Dynamic& value)
+    {
+        Error("Function '" + std::string(function) + "' expects a typed array as argument " + std::to_string(index + 1) + ", got '" + TypeName(value) + "'.");
+    }
+
+    void LengthMismatch(const char* function, std::size_t a, std::size_t b)
+    {
+        Error("Function '" + std::string(function) + "' expects arrays of equal length, got " + std::to_string(a) + " and " + std::to_string(b) + ".");
+    }
+
+    template <typename T>
+    static TypedArray<T> NewTypedArray(const Dynamic& length)
+    {
+        if (!length.IsInt() || length.AsInt() < 0)
+            Error("Typed array length must be a non-negative 'int', got '" + ToString(length) + "'.");
+        return std::make_shared<TypedArrayObject<T>>((std::size_t) length.AsInt());
+    }
+
+    TypedArray<int> intArray(const Dynamic& length)       { return NewTypedArray<int>(length); }
+    TypedArray<float> floatArray(const Dynamic& length)   { return NewTypedArray<float>(length); }
+    TypedArray<double> doubleArray(const Dynamic& length) { return NewTypedArray<double>(length); }
+    TypedArray<char> charArray(const Dynamic& length)     { return NewTypedArray<char>(length); }
+
+    // Calls f with the array cast to its element type.
+    template <typename F>
+    static Dynamic Visit(const char* function, int index, const Dynamic& value, F&& f)
+    {
+        if (!value.Is(ObjectKind::TypedArray))
+            ExpectedTypedArray(function, index, value);
+
+        const auto& object = value.Object();
+        switch (static_cast<TypedArrayBase*>(object.get())->GetElementType())
+        {
+        case ElementType::Int:    return f(std::static_pointer_cast<TypedArrayObject<int>>(object));
+        case ElementType::Float:  return f(std::static_pointer_cast<TypedArrayObject<float>>(object));
+        case ElementType::Double: return f(std::static_pointer_cast<TypedArrayObject<double>>(object));
+        default:                  return f(std::static_pointer_cast<TypedArrayObject<char>>(object));
+        }
+    }
+
+    // The other arrays a function combines with the first must have its element type.
+    template <typename T>
+    static TypedArray<T> Same(const char* function, int index, const TypedArray<T>& first, const Dynamic& value)
+    {
+        if (!value.Is(ObjectKind::TypedArray))
+            ExpectedTypedArray(function, index, value);
+
+        auto* array = static_cast<TypedArrayBase*>(value.AsObject());
+        if (array->GetElementType() != first->GetElementType())
+        {
+            Error("Function '" + std::string(function) + "' cannot combine '" + TypedArrayBase::ElementName(first->GetElementType())
+                + "[]' with '" + TypedArrayBase::ElementName(array->GetElementType()) + "[]'.");
+        }
+        return std::static_pointer_cast<TypedArrayObject<T>>(value.Object());
+    }
+
+    Dynamic fill(const Dynamic& array, const Dynamic& value)
+    {
+        return Visit("fill", 0, array, [&](const auto& typed) { return Dynamic(fill(typed, value)); });
+    }
+
+    Dynamic copy(const Dynamic& dst, const Dynamic& src)
+    {
+        return Visit("copy", 0, dst, [&](const auto& typed) { return Dynamic(copy(typed, Same("copy", 1, typed, src))); });
+    }
+
+    Dynamic sum(const Dynamic& array)
+    {
+        return Visit("sum", 0, array, [&](const auto& typed) { return Dynamic(sum(typed)); });
+    }
+
+    Dynamic min(const Dynamic& array)
+    {
+        return Visit("min", 0, array, [&](const auto& typed) { return Dynamic(min(typed)); });
+    }
+
+    Dynamic max(const Dynamic& array)
+    {
+        return Visit("max", 0, array, [&](const auto& typed) { return Dynamic(max(typed)); });
+    }
+
+    Dynamic dot(const Dynamic& a, const Dynamic& b)
+    {
+        return Visit("dot", 0, a, [&](const auto& typed) { return Dynamic(dot(typed, Same("dot", 1, typed, b))); });
+    }
+
+    template <Runtime::Kernels::Op Op>
+    static Dynamic ApplyDynamic(const char* name, const Dynamic& dst, const Dynamic& a, const Dynamic& b)
+    {
+        return Visit(name, 0, dst, [&](const auto& typed) { return Dynamic(Apply<Op>(name, typed, Same(name, 1, typed, a), Same(name, 2, typed, b))); });
+    }
+
+    Dynamic add(const Dynamic& dst, const Dynamic& a, const Dynamic& b) { return ApplyDynamic<Runtime::Kernels::Op::Add>("add", dst, a, b); }
+    Dynamic sub(const Dynamic& dst, const Dynamic& a, const Dynamic& b) { return ApplyDynamic<Runtime::Kernels::Op::Sub>("sub", dst, a, b); }
+    Dynamic mul(const Dynamic& dst, const Dynamic& a, const Dynamic& b) { return ApplyDynamic<Runtime::Kernels::Op::Mul>("mul", dst, a, b); }
+    Dynamic div(const Dynamic& dst, const Dynamic& a, const Dynamic& b) { return ApplyDynamic<Runtime::Kernels::Op::Div>("div", dst, a, b); }
+
+    Dynamic Function(const std::string& name)
+    {
+        using Args = std::span<const Dynamic>;
+        struct Entry
+        {
+            const char* name;
+            int arity;
+            Dynamic (*function)(Args args);
+        };
+
+        static const Entry functions[] =
+        {
+            { "intArray",    1, [](Args args) { return Dynamic(intArray(args[0])); } },
+            { "floatArray",  1, [](Args args) { return Dynamic(floatArray(args[0])); } },
+            { "doubleArray", 1, [](Args args) { return Dynamic(doubleArray(args[0])); } },
+            { "charArray",   1, [](Args args) { return Dynamic(charArray(args[0])); } },
+            { "fill",        2, [](Args args) { return fill(args[0], args[1]); } },
+            { "copy",        2, [](Args args) { return copy(args[0], args[1]); } },
+            { "sum",         1, [](Args args) { return sum(args[0]); } },
+            { "min",         1, [](Args args) { return min(args[0]); } },
+            { "max",         1, [](Args args) { return max(args[0]); } },
+            { "dot",         2, [](Args args) { return dot(args[0], args[1]); } },
+            { "add",         3, [](Args args) { return add(args[0], args[1], args[2]); } },
+            { "sub",         3, [](Args args) { return sub(args[0], args[1], args[2]); } },
+            { "mul",         3, [](Args args) { return mul(args[0], args[1], args[2]); } },
+            { "div",         3, [](Args args) { return div(args[0], args[1], args[2]); } },
+        };
+
+        for (const auto& entry : functions)
+        {
+            if (name == entry.name)
+                return MakeFunction(entry.name, entry.arity, entry.function);
+        }
+        return Dynamic();
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <string>
+#include "../Runtime/Kernels.h"
+#include "Runtime.h"
+
+namespace JScr::Aot::Std
+{
+    // The standard library for generated code, under the names scripts call it by. Typed arrays whose
+    // element type is known at compile time go straight to the kernels; everything else takes the
+    // Dynamic overloads, which check their arguments the way the VM's natives do.
+
+    [[noreturn]] void ExpectedTypedArray(const char* function, int index, const Dynamic& value);
+    [[noreturn]] void LengthMismatch(const char* function, std::size_t a, std::size_t b);
+
+    template <typename T>
+    TypedArrayObject<T>& Expect(const char* function, int index, const TypedArray<T>& array)
+    {
+        if (array == nullptr)
+            ExpectedTypedArray(function, index, Dynamic());
+        return *array;
+    }
+
+    template <typename T>
+    void ExpectMatching(const char* function, const TypedArrayObject<T>& a, const TypedArrayObject<T>& b)
+    {
+        if (a.Length() != b.Length())
+            LengthMismatch(function, a.Length(), b.Length());
+    }
+
+    TypedArray<int> intArray(const Dynamic& length);
+    TypedArray<float> floatArray(const Dynamic& length);
+    TypedArray<double> doubleArray(const Dynamic& length);
+    TypedArray<char> charArray(const Dynamic& length);
+
+    template <typename T>
+    const TypedArray<T>& fill(const TypedArray<T>& array, const Dynamic& value)
+    {
+        auto& data = Expect("fill", 0, array);
+        Runtime::Kernels::Fill(data.Data(), data.Length(), Convert<T>(value));
+        return array;
+    }
+
+    // Copies all of src to the start of dst.
+    template <typename T>
+    const TypedArray<T>& copy(const TypedArray<T>& dst, const TypedArray<T>& src)
+    {
+        auto& to = Expect("copy", 0, dst);
+        auto& from = Expect("copy", 1, src);
+        if (from.Length() > to.Length())
+            Error("Function 'copy' cannot copy " + std::to_string(from.Length()) + " elements into an array of length " + std::to_string(to.Length()) + ".");
+        Runtime::Kernels::Copy(to.Data(), from.Data(), from.Length() * sizeof(T));
+        return dst;
+    }
+
+    // Chars are summed up as ints.
+    template <typename T>
+    auto sum(const TypedArray<T>& array)
+    {
+        auto& data = Expect("sum", 0, array);
+        return Runtime::Kernels::Sum(data.Data(), data.Length());
+    }
+
+    template <typename T>
+    T min(const TypedArray<T>& array)
+    {
+        auto& data = Expect("min", 0, array);
+        if (data.Length() == 0)
+            Error("Function 'min' expects a non-empty array.");
+        return Runtime::Kernels::Min(data.Data(), data.Length());
+    }
+
+    template <typename T>
+    T max(const TypedArray<T>& array)
+    {
+        auto& data = Expect("max", 0, array);
+        if (data.Length() == 0)
+            Error("Function 'max' expects a non-empty array.");
+        return Runtime::Kernels::Max(data.Data(), data.Length());
+    }
+
+    template <typename T>
+    auto dot(const TypedArray<T>& a, const TypedArray<T>& b)
+    {
+        auto& left = Expect("dot", 0, a);
+        auto& right = Expect("dot", 1, b);
+        ExpectMatching("dot", left, right);
+        return Runtime::Kernels::Dot(left.Data(), right.Data(), left.Length());
+    }
+
+    // dst = a op b, element by element. Returns dst.
+    template <Runtime::Kernels::Op Op, typename T>
+    const TypedArray<T>& Apply(const char* name, const TypedArray<T>& dst, const TypedArray<T>& a, const TypedArray<T>& b)
+    {
+        auto& to = Expect(name, 0, dst);
+        auto& left = Expect(name, 1, a);
+        auto& right = Expect(name, 2, b);
+        ExpectMatching(name, to, left);
+        ExpectMatching(name, left, right);
+
+        if constexpr (Op == Runtime::Kernels::Op::Div && (std::is_same_v<T, int> || std::is_same_v<T, char>))
+        {
+            for (std::size_t i = 0; i < right.Length(); i++)
+            {
+                if (right[i] == 0)
+                    Error("Integer division by zero.");
+            }
+        }
+        Runtime::Kernels::Apply(Op, to.Data(), left.Data(), right.Data(), to.Length());
+        return dst;
+    }
+
+    template <typename T>
+    const TypedArray<T>& add(const TypedArray<T>& dst, const TypedArray<T>& a, const TypedArray<T>& b) { return Apply<Runtime::Kernels::Op::Add>("add", dst, a, b); }
+    template <typename T>
+    const TypedArray<T>& sub(const TypedArray<T>& dst, const TypedArray<T>& a, const TypedArray<T>& b) { return Apply<Runtime::Kernels::Op::Sub>("sub", dst, a, b); }
+    template <typename T>
+    const TypedArray<T>& mul(const TypedArray<T>& dst, const TypedArray<T>& a, const TypedArray<T>& b) { return Apply<Runtime::Kernels::Op::Mul>("mul", dst, a, b); }
+    template <typename T>
+    const TypedArray<T>& div(const TypedArray<T>& dst, const TypedArray<T>& a, const TypedArray<T>& b) { return Apply<Runtime::Kernels::Op::Div>("div", dst, a, b); }
+
+    Dynamic fill(const Dynamic& array, const Dynamic& value);
+    Dynamic copy(const Dynamic& dst, const Dynamic& src);
+    Dynamic sum(const Dynamic& array);
+    Dynamic min(const Dynamic& array);
+    Dynamic max(const Dynamic& array);
+    Dynamic dot(const Dynamic& a, const Dynamic& b);
+    Dynamic add(const Dynamic& dst, const Dynamic& a, const Dynamic& b);
+    Dynamic sub(const Dynamic& dst, const Dynamic& a, const Dynamic& b);
+    Dynamic mul(const Dynamic& dst, const Dynamic& a, const Dynamic& b);
+    Dynamic div(const Dynamic& dst, const Dynamic& a, const Dynamic& b);
+
+    // A standard library function used as a value rather than called by name. Null when there is none.
+    Dynamic Function(const std::string& name);
+}
@@ -0,0 +1,1705 @@
+#include "Transpiler.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cmath>
+#include <limits>
+#include "../Runtime/StandardLibrary.h"
+using namespace JScr::Utils;
+
+namespace JScr::Aot
+{
+    // C++ keywords and the runtime names generated code uses unqualified. Script identifiers that collide
+    // get an underscore appended.
+    static const std::unordered_set<std::string> ReservedNames =
+    {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch", "char",
+        "char8_t", "char16_t", "char32_t", "class", "compl", "concept", "const", "consteval", "constexpr", "constinit",
+        "const_cast", "continue", "co_await", "co_return", "co_yield", "decltype", "default", "delete", "do", "double",
+        "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if",
+        "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or",
+        "or_eq", "private", "protected", "public", "register", "reinterpret_cast", "requires", "return", "short", "signed",
+        "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw",
+        "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+        "wchar_t", "while", "xor", "xor_eq", "NULL", "assert", "errno", "std", "main",
+
+        "args", "guard", "self_", "entry", "script", "Script", "Main", "Run", "Compiled", "Enums", "Std", "JScr",
+        "Dynamic", "TypedArray", "Convert", "ExpectString", "Truthy", "Add", "Sub", "Mul", "Div", "Mod", "Negate",
+        "AddInt", "SubInt", "MulInt", "DivInt", "ModInt", "NegInt", "Equals", "Less", "LessEqual", "Greater",
+        "GreaterEqual", "GetField", "SetField", "GetIndex", "SetIndex", "At", "Length", "Deref", "Call", "MakeFunction",
+        "NewArray", "NewObject", "New", "EnumValue", "EnumType", "StackGuard", "StructObject", "Error", "CompiledScript",
+    };
+
+    // Members every generated struct has besides its properties, and the names its member functions use.
+    static const std::unordered_set<std::string> StructMembers = { "Name", "Get", "Set", "Fields", "TypeName", "NoProperty", "Kind", "Release", "Worklist", "key", "value", "children" };
+
+    static std::string Quote(const std::string& text)
+    {
+        std::string out = "\"";
+        for (unsigned char c : text)
+        {
+            switch (c)
+            {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            default:
+                if (c < 0x20 || c >= 0x7F)
+                {
+                    // Octal escapes never run into the next character the way hex escapes do.
+                    char escape[5];
+                    std::snprintf(escape, sizeof(escape), "\\%03o", c);
+                    out += escape;
+                }
+                else
+                    out += (char) c;
+            }
+        }
+        return out + "\"";
+    }
+
+    static std::string CharText(char value)
+    {
+        unsigned char c = (unsigned char) value;
+        switch (c)
+        {
+        case '\'': return "'\\''";
+        case '\\': return "'\\\\'";
+        case '\n': return "'\\n'";
+        case '\t': return "'\\t'";
+        case '\r': return "'\\r'";
+        case '\0': return "'\\0'";
+        default:
+            if (c < 0x20 || c >= 0x7F)
+            {
+                char escape[8];
+                std::snprintf(escape, sizeof(escape), "'\\%03o'", c);
+                return escape;
+            }
+            return std::string("'") + (char) c + "'";
+        }
+    }
+
+    static std::string Braced(const std::string& items)
+    {
+        return items.empty() ? "{}" : "{ " + items + " }";
+    }
+
+    // Drops the parentheses around a whole expression where the context already delimits it.
+    static std::string Bare(const std::string& text)
+    {
+        if (text.size() < 2 || text.front() != '(' || text.back() != ')')
+            return text;
+
+        int depth = 0;
+        for (std::size_t i = 0; i + 1 < text.size(); i++)
+        {
+            if (text[i] == '"' || text[i] == '\'')
+            {
+                char quote = text[i];
+                for (i++; i < text.size() && text[i] != quote; i++)
+                {
+                    if (text[i] == '\\')
+                        i++;
+                }
+            }
+            else if (text[i] == '(')
+                depth++;
+            else if (text[i] == ')' && --depth == 0)
+                return text;
+        }
+        return text.substr(1, text.size() - 2);
+    }
+
+    static std::string IntText(int value)
+    {
+        if (value == std::numeric_limits<int>::min())
+            return "(-2147483647 - 1)";
+        return value < 0 ? "(" + std::to_string(value) + ")" : std::to_string(value);
+    }
+
+    // The shortest text that reads back as the same value, always recognisable as floating point.
+    template <typename T>
+    static std::string FloatingText(T value, const char* type, const char* suffix)
+    {
+        if (std::isnan(value))
+            return "std::numeric_limits<" + std::string(type) + ">::quiet_NaN()";
+        if (std::isinf(value))
+            return std::string(value < 0 ? "(-" : "(") + "std::numeric_limits<" + type + ">::infinity())";
+
+        char buffer[64];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        std::string text(buffer, result.ptr);
+        if (text.find_first_of(".e") == std::string::npos)
+            text += ".0";
+        text += suffix;
+        return value < 0 ? "(" + text + ")" : text;
+    }
+
+    // Whether a return can be reached anywhere in `body` outside of nested functions.
+    static bool ContainsReturn(const std::vector<std::unique_ptr<Stmt>>& body)
+    {
+        for (const auto& stmt : body)
+        {
+            switch (stmt->Kind())
+            {
+            case NodeType::RETURN_DECLARATION:
+                return true;
+            case NodeType::IF_ELSE_DECLARATION:
+            {
+                const auto& ifElse = static_cast<const IfElseDeclaration&>(*stmt);
+                for (const auto& block : ifElse.Blocks())
+                {
+                    if (ContainsReturn(block.Body()))
+                        return true;
+                }
+                if (ContainsReturn(ifElse.ElseBody()))
+                    return true;
+                break;
+            }
+            case NodeType::WHILE_DECLARATION:
+                if (ContainsReturn(static_cast<const WhileDeclaration&>(*stmt).Body()))
+                    return true;
+                break;
+            case NodeType::FOR_DECLARATION:
+                if (ContainsReturn(static_cast<const ForDeclaration&>(*stmt).Body()))
+                    return true;
+                break;
+            default:
+                break;
+            }
+        }
+        return false;
+    }
+
+    // Whether control can never run off the end of `body`.
+    static bool EndsWithReturn(const std::vector<std::unique_ptr<Stmt>>& body)
+    {
+        if (body.empty())
+            return false;
+
+        const Stmt& last = *body.back();
+        if (last.Kind() == NodeType::RETURN_DECLARATION)
+            return true;
+        if (last.Kind() != NodeType::IF_ELSE_DECLARATION)
+            return false;
+
+        const auto& ifElse = static_cast<const IfElseDeclaration&>(last);
+        for (const auto& block : ifElse.Blocks())
+        {
+            if (!EndsWithReturn(block.Body()))
+                return false;
+        }
+        return EndsWithReturn(ifElse.ElseBody());
+    }
+
+    static bool IsLiteralConstant(const Frontend::Expr& expr)
+    {
+        switch (expr.Kind())
+        {
+        case NodeType::NUMERIC_LITERAL:
+        case NodeType::FLOAT_LITERAL:
+        case NodeType::DOUBLE_LITERAL:
+        case NodeType::CHAR_LITERAL:
+        case NodeType::STRING_LITERAL:
+            return true;
+        case NodeType::IDENTIFIER:
+        {
+            const std::string& name = static_cast<const Identifier&>(expr).Symbol();
+            return name == "true" || name == "false" || name == "null";
+        }
+        default:
+            return false;
+        }
+    }
+
+    Transpiler::Output Transpiler::Transpile(Program& program, const Options& options)
+    {
+        Transpiler transpiler(program, options);
+        transpiler.Collect();
+
+        transpiler.m_analysis = true;
+        transpiler.EmitAll();
+        transpiler.m_analysis = false;
+
+        Output output{};
+        output.source = transpiler.EmitAll();
+        output.header =
+            "// Generated by jscrc from \"" + program.FileDir() + "\". Do not edit.\n"
+            "#pragma once\n"
+            "#include \"Aot/Runtime.h\"\n"
+            "\n"
+            "namespace " + options.ns + "\n"
+            "{\n"
+            "    // Hand to JScr::Script::FromCompiled.\n"
+            "    extern const JScr::Aot::CompiledScript Compiled;\n"
+            "}\n";
+        return output;
+    }
+
+    Transpiler::Transpiler(Program& program, const Options& options) : m_program(program), m_options(options)
+    {}
+
+    // ----- Top level -----
+
+    void Transpiler::Collect()
+    {
+        for (const auto& stmt : m_program.Body())
+        {
+            if (stmt->Kind() == NodeType::OBJECT_DECLARATION)
+            {
+                const auto& decl = static_cast<const ObjectDeclaration&>(*stmt);
+                if (m_structs.count(decl.Identifier()) || m_enums.count(decl.Identifier()))
+                    Error("Object type '" + decl.Identifier() + "' is already declared.");
+
+                m_structs.emplace(decl.Identifier(), StructInfo{ &decl, Escape(decl.Identifier()), {}, {} });
+                m_structOrder.push_back(decl.Identifier());
+                m_typeNames.insert(Escape(decl.Identifier()));
+            }
+            else if (stmt->Kind() == NodeType::ENUM_DECLARATION)
+            {
+                const auto& decl = static_cast<const EnumDeclaration&>(*stmt);
+                if (m_structs.count(decl.Identifier()) || m_enums.count(decl.Identifier()))
+                    Error("Enum '" + decl.Identifier() + "' is already declared.");
+
+                m_enums.emplace(decl.Identifier(), &decl);
+                m_enumOrder.push_back(decl.Identifier());
+                m_typeNames.insert(Escape(decl.Identifier()));
+            }
+        }
+
+        for (const auto& name : m_structOrder)
+        {
+            auto& info = m_structs.at(name);
+            for (const auto& property : info.decl->Properties())
+            {
+                info.fields.push_back(FromDeclared(property.Type()));
+                std::string field = Escape(property.Key());
+                while (StructMembers.count(field))
+                    field += "_";
+                info.fieldNames.push_back(field);
+            }
+        }
+
+        auto Global = [&](const std::string& name, const CType& type, Variable::Scope scope)
+        {
+            if (m_globals.count(name))
+                Error("Identifier '" + name + "' is already declared.");
+
+            std::string cpp = Escape(name);
+            while (m_typeNames.count(cpp))
+                cpp += "_";
+            m_globals.emplace(name, Variable{ name, cpp, type, scope, false, nullptr });
+            m_memberNames.insert(cpp);
+        };
+
+        for (const auto& name : m_enumOrder)
+        {
+            m_globals.emplace(name, Variable{ name, Escape(name), CType{ Kind::Enum, name }, Variable::ENUM, false, nullptr });
+        }
+
+        for (const auto& stmt : m_program.Body())
+        {
+            if (stmt->Kind() == NodeType::FUNCTION_DECLARATION)
+            {
+                const auto& fn = static_cast<const FunctionDeclaration&>(*stmt);
+                if (fn.Async())
+                    Error("Async functions are not supported by jscrc.");
+                Global(fn.Identifier(), CType{ Kind::Dynamic }, Variable::FUNCTION);
+
+                FunctionInfo info{ &fn, {}, {} };
+                for (const auto& param : fn.Parameters())
+                    info.params.push_back(FromDeclared(param.Type()));
+
+                // A void function that returns a value anyway gives the caller that value.
+                info.result = FromDeclared(fn.Type());
+                if (info.result.kind == Kind::Void && (fn.InstantReturn() || ContainsReturn(fn.Body())))
+                    info.result = CType{ Kind::Dynamic };
+                m_functions.emplace(fn.Identifier(), std::move(info));
+            }
+            else if (stmt->Kind() == NodeType::VAR_DECLARATION)
+            {
+                const auto& decl = static_cast<const VarDeclaration&>(*stmt);
+                CType type = FromDeclared(decl.Type());
+                Global(decl.Identifier(), type.kind == Kind::Void ? CType{ Kind::Dynamic } : type, Variable::GLOBAL);
+                m_globalOrder.push_back(decl.Identifier());
+            }
+        }
+    }
+
+    std::string Transpiler::EmitAll()
+    {
+        std::string out;
+        m_out = &out;
+        m_indent = 0;
+
+        Line("// Generated by jscrc from \"" + m_program.FileDir() + "\". Do not edit.");
+        Line("#include " + Quote(m_options.headerName));
+        Line("#include <cmath>");
+        Line("#include <limits>");
+        Line("#include \"Aot/StandardLibrary.h\"");
+        Line("");
+        Line("namespace " + m_options.ns);
+        Line("{");
+        m_indent++;
+        Line("using namespace JScr::Aot;");
+        Line("");
+
+        if (!m_enumOrder.empty())
+        {
+            for (const auto& name : m_enumOrder)
+            {
+                std::string entries = "";
+                for (const auto& entry : m_enums.at(name)->Entries())
+                    entries += (entries.empty() ? "" : ", ") + Escape(entry);
+
+                Line("enum class " + Escape(name) + " : int");
+                Line("{");
+                Line(Indent(1) + entries);
+                Line("};");
+                Line("");
+            }
+
+            // Only needed where an enum is used as a value.
+            Line("namespace Enums");
+            Line("{");
+            for (const auto& name : m_enumOrder)
+            {
+                std::string entries = "";
+                for (const auto& entry : m_enums.at(name)->Entries())
+                    entries += (entries.empty() ? "" : ", ") + Quote(entry);
+                Line(Indent(1) + "const EnumType " + Escape(name) + "{ " + Quote(name) + ", { " + entries + " } };");
+            }
+            Line("}");
+            Line("");
+        }
+
+        if (!m_structOrder.empty())
+        {
+            for (const auto& name : m_structOrder)
+                Line("struct " + m_structs.at(name).cpp + ";");
+            Line("");
+
+            for (const auto& name : m_structOrder)
+                EmitStruct(m_structs.at(name));
+            for (const auto& name : m_structOrder)
+                EmitStructMembers(m_structs.at(name));
+        }
+
+        Line("struct Script");
+        Line("{");
+        m_indent++;
+        for (const auto& name : m_globalOrder)
+        {
+            const Variable& global = m_globals.at(name);
+            std::string init = DefaultValue(global.type);
+            bool trivial = global.type.kind == Kind::Dynamic || global.type.kind == Kind::String || global.type.kind == Kind::Struct || global.type.kind == Kind::TypedArray;
+            Line(CppType(global.type) + " " + global.cpp + (trivial ? "" : " = " + init) + ";");
+        }
+        if (!m_globalOrder.empty())
+            Line("");
+
+        for (const auto& stmt : m_program.Body())
+        {
+            if (stmt->Kind() != NodeType::FUNCTION_DECLARATION)
+                continue;
+
+            EmitFunction(m_functions.at(static_cast<const FunctionDeclaration&>(*stmt).Identifier()));
+            Line("");
+        }
+        EmitMain();
+        if (!m_hostOrder.empty())
+        {
+            Line("");
+            for (const auto& name : m_hostOrder)
+                Line("const HostFunction& " + m_hosts.at(name) + " = FindHost(" + Quote(name) + ");");
+        }
+        m_indent--;
+        Line("};");
+        Line("");
+
+        Line(std::string("static Dynamic Run(const std::vector<JScr::ExternalResource>&") + (m_hostOrder.empty() ? ")" : " externals)"));
+        Line("{");
+        Line(Indent(1) + "StackGuard::Entry entry;");
+        if (!m_hostOrder.empty())
+            Line(Indent(1) + "HostScope hosts(externals);");
+        Line(Indent(1) + "Script script;");
+        Line(Indent(1) + "return script.Main();");
+        Line("}");
+        Line("");
+        Line("const CompiledScript Compiled{ " + Quote(m_program.FileDir()) + ", &Run };");
+
+        m_indent--;
+        Line("}");
+
+        m_out = nullptr;
+        return out;
+    }
+
+    void Transpiler::EmitStruct(const StructInfo& info)
+    {
+        const auto& properties = info.decl->Properties();
+
+        Line("struct " + info.cpp + " final : StructObject");
+        Line("{");
+        m_indent++;
+        Line("static constexpr const char* Name = " + Quote(info.decl->Identifier()) + ";");
+        Line("");
+
+        for (std::size_t i = 0; i < properties.size(); i++)
+        {
+            const CType& type = info.fields[i];
+            std::string declaration = CppType(type) + " " + info.fieldNames[i];
+
+            // Literal defaults are part of every instance, the rest is evaluated where the object is built.
+            const auto& value = properties[i].Value();
+            if (value.has_value() && value.value() && IsLiteralConstant(*value.value()))
+            {
+                Code code = Literal(*value.value());
+                if (IsStaticConversion(code, type))
+                {
+                    Line(declaration + " = " + Coerce(code, type) + ";");
+                    continue;
+                }
+            }
+
+            bool trivial = type.kind == Kind::Dynamic || type.kind == Kind::String || type.kind == Kind::Struct || type.kind == Kind::TypedArray;
+            Line(declaration + (trivial ? "" : " = " + DefaultValue(type)) + ";");
+        }
+        if (!properties.empty())
+            Line("");
+
+        Line(info.cpp + "() : StructObject(Name) {}");
+        if (HoldsObjects(info))
+            Line("~" + info.cpp + "() override;");
+        Line("");
+        Line("Dynamic Get(std::string_view key) const override;");
+        Line("void Set(std::string_view key, const Dynamic& value) override;");
+        Line("std::vector<std::pair<const char*, Dynamic>> Fields() const override;");
+        m_indent--;
+        Line("};");
+        Line("");
+    }
+
+    // Defined once every struct is complete, as fields may hold any of them.
+    void Transpiler::EmitStructMembers(const StructInfo& info)
+    {
+        const auto& properties = info.decl->Properties();
+
+        Line("inline Dynamic " + info.cpp + "::Get(std::string_view key) const");
+        Line("{");
+        for (std::size_t i = 0; i < properties.size(); i++)
+        {
+            Line(Indent(1) + "if (key == " + Quote(properties[i].Key()) + ")");
+            Line(Indent(2) + "return " + info.fieldNames[i] + ";");
+        }
+        Line(Indent(1) + "NoProperty(key);");
+        Line("}");
+        Line("");
+
+        Line("inline void " + info.cpp + "::Set(std::string_view key, const Dynamic& value)");
+        Line("{");
+        for (std::size_t i = 0; i < properties.size(); i++)
+        {
+            Line(Indent(1) + (i == 0 ? "if (key == " : "else if (key == ") + Quote(properties[i].Key()) + ")");
+            Line(Indent(2) + info.fieldNames[i] + " = " + Coerce(Code{ "value", CType{ Kind::Dynamic } }, info.fields[i]) + ";");
+        }
+        Line(Indent(1) + (properties.empty() ? "NoProperty(key);" : "else"));
+        if (!properties.empty())
+            Line(Indent(2) + "NoProperty(key);");
+        Line("}");
+        Line("");
+
+        std::string fields = "";
+        for (std::size_t i = 0; i < properties.size(); i++)
+            fields += (fields.empty() ? "" : ", ") + std::string("{ ") + Quote(properties[i].Key()) + ", " + info.fieldNames[i] + " }";
+
+        Line("inline std::vector<std::pair<const char*, Dynamic>> " + info.cpp + "::Fields() const");
+        Line("{");
+        Line(Indent(1) + "return " + Braced(fields) + ";");
+        Line("}");
+        Line("");
+
+        if (!HoldsObjects(info))
+            return;
+
+        Line("inline " + info.cpp + "::~" + info.cpp + "()");
+        Line("{");
+        Line(Indent(1) + "Worklist children;");
+        for (std::size_t i = 0; i < properties.size(); i++)
+        {
+            const std::string& field = info.fieldNames[i];
+            if (info.fields[i].kind == Kind::Struct)
+                Line(Indent(1) + "if (" + field + ") children.push_back(std::move(" + field + "));");
+            else if (CppType(info.fields[i]) == "Dynamic")
+                Line(Indent(1) + "if (" + field + ".IsObject()) children.push_back(" + field + ".TakeObject());");
+        }
+        Line(Indent(1) + "Release(children);");
+        Line("}");
+        Line("");
+    }
+
+    // Typed arrays hold no objects, and every other field is a native value.
+    bool Transpiler::HoldsObjects(const StructInfo& info) const
+    {
+        for (const CType& type : info.fields)
+        {
+            if (type.kind == Kind::Struct || CppType(type) == "Dynamic")
+                return true;
+        }
+        return false;
+    }
+
+    void Transpiler::EmitFunction(const FunctionInfo& info)
+    {
+        const FunctionDeclaration& fn = *info.decl;
+
+        Context context{};
+        context.scopes.emplace_back();
+        context.returnType = info.result;
+        m_context = &context;
+
+        std::string params = "";
+        std::vector<std::string> boxes;
+        for (std::size_t i = 0; i < fn.Parameters().size(); i++)
+        {
+            const VarDeclaration& param = fn.Parameters()[i];
+            Variable& variable = Declare(param.Identifier(), info.params[i], &param);
+
+            std::string name = variable.cpp;
+            if (variable.boxed)
+            {
+                name = Fresh(param.Identifier());
+                m_context->used.insert(name);
+                boxes.push_back("auto " + variable.cpp + " = std::make_shared<" + CppType(info.params[i]) + ">(" + name + ");");
+            }
+            params += (params.empty() ? "" : ", ") + CppType(info.params[i]) + " " + name;
+        }
+
+        Line(CppType(info.result) + " " + m_globals.at(fn.Identifier()).cpp + "(" + params + ")");
+        Line("{");
+        m_indent++;
+        Line("StackGuard guard;");
+        for (const auto& box : boxes)
+            Line(box);
+        EmitBody(fn.Body(), fn.InstantReturn());
+        m_indent--;
+        Line("}");
+
+        m_context = nullptr;
+    }
+
+    void Transpiler::EmitMain()
+    {
+        Context context{};
+        context.scopes.emplace_back();
+        context.returnType = CType{ Kind::Dynamic };
+        context.main = true;
+        m_context = &context;
+
+        Line("Dynamic Main()");
+        Line("{");
+        m_indent++;
+        for (const auto& stmt : m_program.Body())
+        {
+            switch (stmt->Kind())
+            {
+            case NodeType::FUNCTION_DECLARATION:
+            case NodeType::OBJECT_DECLARATION:
+            case NodeType::ENUM_DECLARATION:
+                continue;
+            default:
+                EmitStmt(*stmt);
+            }
+        }
+        EmitFallOff(m_program.Body());
+        m_indent--;
+        Line("}");
+
+        m_context = nullptr;
+    }
+
+    // ----- Statements -----
+
+    void Transpiler::EmitStmt(const Stmt& stmt)
+    {
+        switch (stmt.Kind())
+        {
+        case NodeType::IMPORT_STMT:
+        {
+            std::string path = "";
+            for (const auto& part : static_cast<const ImportStmt&>(stmt).Target())
+                path += (path.empty() ? "" : ".") + part;
+            Error("Cannot resolve import '" + path + "'.");
+        }
+        case NodeType::VAR_DECLARATION:
+            EmitVarDeclaration(static_cast<const VarDeclaration&>(stmt));
+            break;
+        case NodeType::FUNCTION_DECLARATION:
+            EmitLocalFunction(static_cast<const FunctionDeclaration&>(stmt));
+            break;
+        case NodeType::OBJECT_DECLARATION:
+            Error("Object declarations are only allowed at the top level of a script.");
+        case NodeType::ENUM_DECLARATION:
+            Error("Enum declarations are only allowed at the top level of a script.");
+        case NodeType::RETURN_DECLARATION:
+        {
+            Code value = Expr(static_cast<const ReturnDeclaration&>(stmt).Value());
+            Line("return " + Coerce(value, m_context->returnType) + ";");
+            break;
+        }
+        case NodeType::DELETE_DECLARATION:
+        {
+            const std::string& name = static_cast<const DeleteDeclaration&>(stmt).Value();
+            auto variable = Resolve(name);
+            if (!variable.has_value())
+                Error("Cannot delete undeclared identifier '" + name + "'.");
+            if (variable->scope == Variable::FUNCTION || variable->scope == Variable::ENUM)
+                Error("Cannot delete constant '" + name + "'.");
+
+            Line(Access(*variable) + " = {};");
+
+            // A local of this function loses its name, like in the VM. Captured ones keep it.
+            for (auto scope = m_context->scopes.rbegin(); scope != m_context->scopes.rend(); ++scope)
+            {
+                for (auto it = scope->rbegin(); it != scope->rend(); ++it)
+                {
+                    if (it->name == name)
+                    {
+                        it->name = "";
+                        return;
+                    }
+                }
+            }
+            break;
+        }
+        case NodeType::IF_ELSE_DECLARATION:
+            EmitIfElse(static_cast<const IfElseDeclaration&>(stmt));
+            break;
+        case NodeType::WHILE_DECLARATION:
+        {
+            const auto& loop = static_cast<const WhileDeclaration&>(stmt);
+            Line("while (" + Bare(Truthy(Expr(loop.Condition()))) + ")");
+            EmitBlock(loop.Body());
+            break;
+        }
+        case NodeType::FOR_DECLARATION:
+            EmitFor(static_cast<const ForDeclaration&>(stmt));
+            break;
+        default:
+        {
+            const auto* expr = dynamic_cast<const Frontend::Expr*>(&stmt);
+            if (expr == nullptr)
+                Error("Unsupported statement.");
+
+            Line(Effect(*expr) + ";");
+        }
+        }
+    }
+
+    void Transpiler::EmitBlock(const std::vector<std::unique_ptr<Stmt>>& body)
+    {
+        Line("{");
+        m_indent++;
+        BeginScope();
+        for (const auto& stmt : body)
+            EmitStmt(*stmt);
+        EndScope();
+        m_indent--;
+        Line("}");
+    }
+
+    void Transpiler::EmitBody(const std::vector<std::unique_ptr<Stmt>>& body, bool instantReturn)
+    {
+        const auto* instantValue = instantReturn && body.size() == 1 ? dynamic_cast<const Frontend::Expr*>(body[0].get()) : nullptr;
+        if (instantValue != nullptr)
+        {
+            Code value = Expr(*instantValue);
+            if (m_context->returnType.kind == Kind::Void)
+                Line(value.text + ";");
+            else
+                Line("return " + Coerce(value, m_context->returnType) + ";");
+            return;
+        }
+
+        for (const auto& stmt : body)
+            EmitStmt(*stmt);
+        EmitFallOff(body);
+    }
+
+    // Running off the end returns null, converted to the declared return type.
+    void Transpiler::EmitFallOff(const std::vector<std::unique_ptr<Stmt>>& body)
+    {
+        if (m_context->returnType.kind == Kind::Void || EndsWithReturn(body))
+            return;
+
+        Line("return " + Coerce(Code{ "Dynamic()", CType{ Kind::Dynamic }, false, true }, m_context->returnType) + ";");
+    }
+
+    std::string Transpiler::VarDeclarationText(const VarDeclaration& decl)
+    {
+        CType type = FromDeclared(decl.Type());
+        if (type.kind == Kind::Void)
+            type = CType{ Kind::Dynamic };
+
+        // The initial value is evaluated before the name exists, so it sees what the name meant before.
+        std::string init = DefaultValue(type);
+        if (decl.Value().has_value() && decl.Value().value())
+            init = Coerce(Expr(*decl.Value().value(), &type), type);
+
+        if (IsTopLevel())
+            return m_globals.at(decl.Identifier()).cpp + " = " + init;
+
+        Variable& variable = Declare(decl.Identifier(), type, &decl);
+        if (variable.boxed)
+            return "auto " + variable.cpp + " = std::make_shared<" + CppType(type) + ">(" + init + ")";
+        return CppType(type) + " " + variable.cpp + " = " + init;
+    }
+
+    void Transpiler::EmitVarDeclaration(const VarDeclaration& decl)
+    {
+        // Globals start out at their default already.
+        if (IsTopLevel() && (!decl.Value().has_value() || !decl.Value().value()))
+            return;
+
+        Line(VarDeclarationText(decl) + ";");
+    }
+
+    void Transpiler::EmitLocalFunction(const FunctionDeclaration& fn)
+    {
+        if (fn.Async())
+            Error("Async functions are not supported by jscrc.");
+
+        // Declared first so the body may recurse.
+        Variable& variable = Declare(fn.Identifier(), CType{ Kind::Dynamic }, &fn);
+        std::string access = Access(variable);
+        bool boxed = variable.boxed;
+        std::string cpp = variable.cpp;
+
+        std::vector<std::pair<std::string, const void*>> params;
+        std::vector<CType> types;
+        for (const auto& param : fn.Parameters())
+        {
+            params.emplace_back(param.Identifier(), &param);
+            types.push_back(FromDeclared(param.Type()));
+        }
+
+        CType result = FromDeclared(fn.Type());
+        if (result.kind == Kind::Void)
+            result = CType{ Kind::Dynamic };
+
+        if (boxed)
+        {
+            Line("auto " + cpp + " = std::make_shared<Dynamic>();");
+            Line(access + " = " + Lambda(fn.Identifier(), params, types, fn.Body(), fn.InstantReturn(), result).text + ";");
+        }
+        else
+            Line("Dynamic " + cpp + " = " + Lambda(fn.Identifier(), params, types, fn.Body(), fn.InstantReturn(), result).text + ";");
+    }
+
+    void Transpiler::EmitIfElse(const IfElseDeclaration& ifElse)
+    {
+        const auto& blocks = ifElse.Blocks();
+        for (std::size_t i = 0; i < blocks.size(); i++)
+        {
+            Line((i == 0 ? "if (" : "else if (") + Bare(Truthy(Expr(blocks[i].Condition()))) + ")");
+            EmitBlock(blocks[i].Body());
+        }
+
+        if (!ifElse.ElseBody().empty())
+        {
+            Line("else");
+            EmitBlock(ifElse.ElseBody());
+        }
+    }
+
+    void Transpiler::EmitFor(const ForDeclaration& loop)
+    {
+        BeginScope();
+
+        // Anything but a variable or an expression is run ahead of the loop in a block of its own.
+        const Stmt& declaration = loop.Declaration();
+        std::string init = "";
+        bool wrapped = false;
+        if (declaration.Kind() == NodeType::VAR_DECLARATION)
+            init = VarDeclarationText(static_cast<const VarDeclaration&>(declaration));
+        else if (const auto* expr = dynamic_cast<const Frontend::Expr*>(&declaration); expr != nullptr)
+            init = Effect(*expr);
+        else
+        {
+            wrapped = true;
+            Line("{");
+            m_indent++;
+            EmitStmt(declaration);
+        }
+
+        std::string condition = Bare(Truthy(Expr(loop.Condition())));
+        std::string action = Effect(loop.Action());
+        Line("for (" + init + "; " + condition + "; " + action + ")");
+        EmitBlock(loop.Body());
+
+        if (wrapped)
+        {
+            m_indent--;
+            Line("}");
+        }
+        EndScope();
+    }
+
+    // An expression whose value is thrown away.
+    std::string Transpiler::Effect(const Frontend::Expr& expr)
+    {
+        if (expr.Kind() == NodeType::ASSIGNMENT_EXPR)
+            return Assignment(static_cast<const AssignmentExpr&>(expr), true).text;
+
+        Code code = Expr(expr);
+        if (expr.Kind() == NodeType::CALL_EXPR || code.type.kind == Kind::Void)
+            return code.text;
+        return "static_cast<void>(" + code.text + ")";
+    }
+
+    // ----- Expressions -----
+
+    Transpiler::Code Transpiler::Expr(const Frontend::Expr& expr, const CType* hint)
+    {
+        switch (expr.Kind())
+        {
+        case NodeType::NUMERIC_LITERAL:
+        case NodeType::FLOAT_LITERAL:
+        case NodeType::DOUBLE_LITERAL:
+        case NodeType::CHAR_LITERAL:
+        case NodeType::STRING_LITERAL:
+            return Literal(expr);
+        case NodeType::IDENTIFIER:
+            return IdentifierValue(static_cast<const Identifier&>(expr).Symbol());
+        case NodeType::BINARY_EXPR:
+            return Binary(static_cast<const BinaryExpr&>(expr));
+        case NodeType::EQUALITY_CHECK_EXPR:
+            return Check(static_cast<const EqualityCheckExpr&>(expr));
+        case NodeType::UNARY_EXPR:
+            return Unary(static_cast<const UnaryExpr&>(expr));
+        case NodeType::ASSIGNMENT_EXPR:
+            return Assignment(static_cast<const AssignmentExpr&>(expr), false);
+        case NodeType::MEMBER_EXPR:
+            return Member(static_cast<const MemberExpr&>(expr));
+        case NodeType::INDEX_EXPR:
+            return Index(static_cast<const IndexExpr&>(expr));
+        case NodeType::CALL_EXPR:
+            return CallExpr(static_cast<const Frontend::CallExpr&>(expr));
+        case NodeType::AWAIT_EXPR:
+            Error("Await is not supported by jscrc.");
+        case NodeType::OBJECT_CONSTRUCTOR_EXPR:
+            return Constructor(static_cast<const ObjectConstructorExpr&>(expr), hint);
+        case NodeType::LAMBDA_EXPR:
+        {
+            const auto& lambda = static_cast<const LambdaExpr&>(expr);
+            std::vector<std::pair<std::string, const void*>> params;
+            for (const auto& ident : lambda.ParamIdents())
+                params.emplace_back(ident.Symbol(), &ident);
+
+            std::vector<CType> types(params.size(), CType{ Kind::Dynamic });
+            return Lambda("lambda", params, types, lambda.Body(), lambda.InstantReturn(), CType{ Kind::Dynamic });
+        }
+        case NodeType::ARRAY_LITERAL:
+        {
+            std::string items = "";
+            for (const auto& item : static_cast<const ArrayLiteral&>(expr).Value())
+                items += (items.empty() ? "" : ", ") + Coerce(Expr(*item), CType{ Kind::Dynamic });
+            return Code{ "NewArray(" + Braced(items) + ")", CType{ Kind::Dynamic } };
+        }
+        default:
+            Error("Unsupported expression.");
+        }
+    }
+
+    Transpiler::Code Transpiler::Literal(const Frontend::Expr& expr)
+    {
+        switch (expr.Kind())
+        {
+        case NodeType::NUMERIC_LITERAL:
+            return Code{ IntText(static_cast<const NumericLiteral&>(expr).Value()), CType{ Kind::Int }, true };
+        case NodeType::FLOAT_LITERAL:
+            return Code{ FloatingText(static_cast<const FloatLiteral&>(expr).Value(), "float", "f"), CType{ Kind::Float }, true };
+        case NodeType::DOUBLE_LITERAL:
+            return Code{ FloatingText(static_cast<const DoubleLiteral&>(expr).Value(), "double", ""), CType{ Kind::Double }, true };
+        case NodeType::CHAR_LITERAL:
+            return Code{ CharText(static_cast<const CharLiteral&>(expr).Value()), CType{ Kind::Char }, true };
+        case NodeType::STRING_LITERAL:
+            return Code{ Quote(static_cast<const StringLiteral&>(expr).Value()) + "_jscr", CType{ Kind::String }, true };
+        case NodeType::IDENTIFIER:
+        {
+            const std::string& name = static_cast<const Identifier&>(expr).Symbol();
+            if (name == "null")
+                return Code{ "Dynamic()", CType{ Kind::Dynamic }, true, true };
+            return Code{ name, CType{ Kind::Bool }, true };
+        }
+        default:
+            Error("Unsupported expression.");
+        }
+    }
+
+    Transpiler::Code Transpiler::IdentifierValue(const std::string& name)
+    {
+        auto variable = Resolve(name);
+        if (!variable.has_value())
+        {
+            if (name == "true" || name == "false")
+                return Code{ name, CType{ Kind::Bool }, true };
+            if (name == "null")
+                return Code{ "Dynamic()", CType{ Kind::Dynamic }, true, true };
+            if (Runtime::StandardLibrary::Find(name) != nullptr)
+                return Code{ "Std::Function(" + Quote(name) + ")", CType{ Kind::Dynamic } };
+            Error("Undeclared identifier '" + name + "'.");
+        }
+
+        switch (variable->scope)
+        {
+        case Variable::ENUM:
+            return Code{ "EnumValue(Enums::" + variable->cpp + ")", CType{ Kind::Dynamic } };
+        case Variable::FUNCTION:
+        {
+            // A top level function used as a value, rather than called directly.
+            const FunctionInfo& info = m_functions.at(name);
+            std::string args = "";
+            for (std::size_t i = 0; i < info.params.size(); i++)
+                args += (i == 0 ? "" : ", ") + Coerce(Code{ "args[" + std::to_string(i) + "]", CType{ Kind::Dynamic } }, info.params[i]);
+
+            std::string call = variable->cpp + "(" + args + ")";
+            std::string body = info.result.kind == Kind::Void ? call + "; return Dynamic();" : "return " + call + ";";
+            return Code{ "MakeFunction(" + Quote(name) + ", " + std::to_string(info.params.size()) + ", [this](std::span<const Dynamic>"
+                + (info.params.empty() ? "" : " args") + ") -> Dynamic { " + body + " })", CType{ Kind::Dynamic } };
+        }
+        default:
+            return Code{ Access(*variable), variable->type };
+        }
+    }
+
+    Transpiler::Code Transpiler::Binary(const BinaryExpr& binary)
+    {
+        char op = binary.Operator();
+        if (op != '+' && op != '-' && op != '*' && op != '/' && op != '%')
+            Error(std::string("Unknown binary operator '") + op + "'.");
+
+        Code left = Expr(binary.Left());
+        Code right = Expr(binary.Right());
+
+        if (IsNumeric(left.type.kind) && IsNumeric(right.type.kind))
+        {
+            auto Either = [&](Kind kind) { return left.type.kind == kind || right.type.kind == kind; };
+
+            if (!Either(Kind::Double) && !Either(Kind::Float))
+            {
+                const char* function = op == '+' ? "AddInt" : op == '-' ? "SubInt" : op == '*' ? "MulInt" : op == '/' ? "DivInt" : "ModInt";
+                return Code{ std::string(function) + "(" + AsInt(left) + ", " + AsInt(right) + ")", CType{ Kind::Int } };
+            }
+
+            Kind kind = Either(Kind::Double) ? Kind::Double : Kind::Float;
+            std::string l = left.type.kind == Kind::Enum ? AsInt(left) : left.text;
+            std::string r = right.type.kind == Kind::Enum ? AsInt(right) : right.text;
+            if (op == '%')
+            {
+                std::string text = "std::fmod(" + l + ", " + r + ")";
+                return Code{ kind == Kind::Float ? "static_cast<float>(" + text + ")" : text, CType{ kind } };
+            }
+            return Code{ "(" + l + " " + op + " " + r + ")", CType{ kind } };
+        }
+
+        const char* function = op == '+' ? "Add" : op == '-' ? "Sub" : op == '*' ? "Mul" : op == '/' ? "Div" : "Mod";
+        CType type{ Kind::Dynamic };
+        if (op == '+' && (left.type.kind == Kind::String || right.type.kind == Kind::String))
+            type = CType{ Kind::String };
+        return Code{ std::string(function) + "(" + Coerce(left, CType{ Kind::Dynamic }) + ", " + Coerce(right, CType{ Kind::Dynamic }) + ")", type };
+    }
+
+    Transpiler::Code Transpiler::Check(const EqualityCheckExpr& check)
+    {
+        Code left = Expr(check.Left());
+        Code right = Expr(check.Right());
+
+        using Type = EqualityCheckExpr::Type;
+        if (check.Operator() == Type::AND || check.Operator() == Type::OR)
+            return Code{ "(" + Truthy(left) + (check.Operator() == Type::AND ? " && " : " || ") + Truthy(right) + ")", CType{ Kind::Bool } };
+
+        const char* op = "";
+        const char* function = "";
+        switch (check.Operator())
+        {
+        case Type::EQUALS:              op = "==", function = "Equals"; break;
+        case Type::NOT_EQUALS:          op = "!=", function = "!Equals"; break;
+        case Type::LESS_THAN:           op = "<",  function = "Less"; break;
+        case Type::LESS_THAN_OR_EQUALS: op = "<=", function = "LessEqual"; break;
+        case Type::MORE_THAN:           op = ">",  function = "Greater"; break;
+        case Type::MORE_THAN_OR_EQUALS: op = ">=", function = "GreaterEqual"; break;
+        default: Error("Unknown comparison operator.");
+        }
+
+        bool equality = check.Operator() == Type::EQUALS || check.Operator() == Type::NOT_EQUALS;
+        if (IsNumeric(left.type.kind) && IsNumeric(right.type.kind))
+        {
+            if (left.type.kind == Kind::Enum && left.type == right.type)
+                return Code{ "(" + left.text + " " + op + " " + right.text + ")", CType{ Kind::Bool } };
+
+            // Mixed with floating point, both sides compare as doubles like in the VM.
+            std::string l = AsInt(left);
+            std::string r = AsInt(right);
+            bool floating = left.type.kind == Kind::Float || left.type.kind == Kind::Double || right.type.kind == Kind::Float || right.type.kind == Kind::Double;
+            if (floating && left.type.kind != right.type.kind)
+            {
+                l = left.type.kind == Kind::Double ? l : "static_cast<double>(" + l + ")";
+                r = right.type.kind == Kind::Double ? r : "static_cast<double>(" + r + ")";
+            }
+            return Code{ "(" + l + " " + op + " " + r + ")", CType{ Kind::Bool } };
+        }
+        if (equality && left.type.kind == Kind::Bool && right.type.kind == Kind::Bool)
+            return Code{ "(" + left.text + " " + op + " " + right.text + ")", CType{ Kind::Bool } };
+
+        return Code{ std::string(function) + "(" + Coerce(left, CType{ Kind::Dynamic }) + ", " + Coerce(right, CType{ Kind::Dynamic }) + ")", CType{ Kind::Bool } };
+    }
+
+    Transpiler::Code Transpiler::Unary(const UnaryExpr& unary)
+    {
+        Code operand = Expr(unary.Object());
+        if (unary.Operator() == "+")
+            return operand;
+
+        if (unary.Operator() == "-")
+        {
+            switch (operand.type.kind)
+            {
+            case Kind::Int:
+            case Kind::Char:
+            case Kind::Enum:
+                return Code{ "NegInt(" + AsInt(operand) + ")", CType{ Kind::Int } };
+            case Kind::Float:
+            case Kind::Double:
+                return Code{ "(-" + operand.text + ")", operand.type };
+            default:
+                return Code{ "Negate(" + Coerce(operand, CType{ Kind::Dynamic }) + ")", CType{ Kind::Dynamic } };
+            }
+        }
+
+        if (unary.Operator() == "!")
+        {
+            switch (operand.type.kind)
+            {
+            case Kind::Bool:
+                return Code{ "(!" + operand.text + ")", CType{ Kind::Bool } };
+            case Kind::Int:
+            case Kind::Float:
+            case Kind::Double:
+            case Kind::Char:
+            case Kind::Enum:
+                return Code{ "(" + AsInt(operand) + " == 0)", CType{ Kind::Bool } };
+            case Kind::Struct:
+            case Kind::TypedArray:
+                return Code{ "(" + operand.text + " == nullptr)", CType{ Kind::Bool } };
+            default:
+                return Code{ "(!Truthy(" + Coerce(operand, CType{ Kind::Dynamic }) + "))", CType{ Kind::Bool } };
+            }
+        }
+
+        Error("Unknown unary operator '" + unary.Operator() + "'.");
+    }
+
+    // `statement` leaves off the parentheses a subexpression needs.
+    Transpiler::Code Transpiler::Assignment(const AssignmentExpr& assignment, bool statement)
+    {
+        const Frontend::Expr& target = assignment.Assigne();
+        const Frontend::Expr& value = assignment.Value();
+
+        auto Wrap = [&](const std::string& text, const CType& type)
+        {
+            return Code{ statement ? text : "(" + text + ")", type };
+        };
+
+        switch (target.Kind())
+        {
+        case NodeType::IDENTIFIER:
+        {
+            const std::string& name = static_cast<const Identifier&>(target).Symbol();
+            auto variable = Resolve(name);
+            if (!variable.has_value())
+                Error("Cannot assign to undeclared identifier '" + name + "'.");
+            if (variable->scope == Variable::FUNCTION || variable->scope == Variable::ENUM)
+                Error("Cannot assign to constant '" + name + "'.");
+
+            Code code = Expr(value, &variable->type);
+            return Wrap(Access(*variable) + " = " + Coerce(code, variable->type), variable->type);
+        }
+        case NodeType::MEMBER_EXPR:
+        {
+            const auto& member = static_cast<const MemberExpr&>(target);
+            if (member.Property().Kind() != NodeType::IDENTIFIER)
+                Error("Member assignment requires an identifier after the dot.");
+
+            const std::string& key = static_cast<const Identifier&>(member.Property()).Symbol();
+            Code object = Expr(member.Object());
+            if (object.type.kind == Kind::Struct)
+            {
+                const StructInfo& info = m_structs.at(object.type.name);
+                for (std::size_t i = 0; i < info.fields.size(); i++)
+                {
+                    if (info.decl->Properties()[i].Key() != key)
+                        continue;
+
+                    Code code = Expr(value, &info.fields[i]);
+                    return Wrap("Deref(" + object.text + ", " + Quote(key) + ")->" + info.fieldNames[i] + " = " + Coerce(code, info.fields[i]), info.fields[i]);
+                }
+            }
+
+            Code code = Expr(value);
+            return Code{ "SetField(" + Coerce(object, CType{ Kind::Dynamic }) + ", " + Quote(key) + ", " + Coerce(code, CType{ Kind::Dynamic }) + ")", CType{ Kind::Dynamic } };
+        }
+        case NodeType::INDEX_EXPR:
+        {
+            const auto& index = static_cast<const IndexExpr&>(target);
+            Code object = Expr(index.Caller());
+            Code key = Expr(index.Arg());
+            Code code = Expr(value);
+            if (object.type.kind == Kind::TypedArray && key.type.kind == Kind::Int)
+            {
+                CType element{ object.type.element };
+                return Wrap("At(" + object.text + ", " + key.text + ") = " + Coerce(code, element), element);
+            }
+            return Code{ "SetIndex(" + Coerce(object, CType{ Kind::Dynamic }) + ", " + Coerce(key, CType{ Kind::Dynamic }) + ", " + Coerce(code, CType{ Kind::Dynamic }) + ")", CType{ Kind::Dynamic } };
+        }
+        default:
+            Error("Invalid assignment target.");
+        }
+    }
+
+    Transpiler::Code Transpiler::Member(const MemberExpr& member)
+    {
+        if (member.Property().Kind() != NodeType::IDENTIFIER)
+            Error("Member access requires an identifier after the dot.");
+
+        if (auto entry = EnumEntry(member); entry.has_value())
+            return entry.value();
+
+        const std::string& key = static_cast<const Identifier&>(member.Property()).Symbol();
+        Code object = Expr(member.Object());
+
+        if (object.type.kind == Kind::Struct)
+        {
+            const StructInfo& info = m_structs.at(object.type.name);
+            for (std::size_t i = 0; i < info.fields.size(); i++)
+            {
+                if (info.decl->Properties()[i].Key() == key)
+                    return Code{ "Deref(" + object.text + ", " + Quote(key) + ")->" + info.fieldNames[i], info.fields[i] };
+            }
+        }
+        if (object.type.kind == Kind::TypedArray && key == "length")
+            return Code{ "Length(" + object.text + ")", CType{ Kind::Int } };
+
+        return Code{ "GetField(" + Coerce(object, CType{ Kind::Dynamic }) + ", " + Quote(key) + ")", CType{ Kind::Dynamic } };
+    }
+
+    Transpiler::Code Transpiler::Index(const IndexExpr& index)
+    {
+        Code object = Expr(index.Caller());
+        Code key = Expr(index.Arg());
+        if (object.type.kind == Kind::TypedArray && key.type.kind == Kind::Int)
+            return Code{ "At(" + object.text + ", " + key.text + ")", CType{ object.type.element } };
+
+        return Code{ "GetIndex(" + Coerce(object, CType{ Kind::Dynamic }) + ", " + Coerce(key, CType{ Kind::Dynamic }) + ")", CType{ Kind::Dynamic } };
+    }
+
+    Transpiler::Code Transpiler::CallExpr(const Frontend::CallExpr& call)
+    {
+        if (call.Caller().Kind() == NodeType::IDENTIFIER)
+        {
+            const std::string& name = static_cast<const Identifier&>(call.Caller()).Symbol();
+            auto variable = Resolve(name);
+
+            // Top level functions are constants, so calls to them can go straight to the C++ function.
+            if (variable.has_value() && variable->scope == Variable::FUNCTION)
+            {
+                const FunctionInfo& info = m_functions.at(name);
+                if (call.Args().size() != info.params.size())
+                {
+                    Error("Function '" + name + "' expects " + std::to_string(info.params.size()) + " arguments, got "
+                        + std::to_string(call.Args().size()) + ".");
+                }
+
+                std::string args = "";
+                for (std::size_t i = 0; i < info.params.size(); i++)
+                    args += (i == 0 ? "" : ", ") + Coerce(Expr(*call.Args()[i]), info.params[i]);
+                return Code{ variable->cpp + "(" + args + ")", info.result };
+            }
+
+            if (!variable.has_value() && Runtime::StandardLibrary::Find(name) != nullptr)
+                return StandardCall(name, call);
+
+            // Anything else has to be bound by an ExternalResource, which the run looks up as it starts.
+            if (!variable.has_value())
+            {
+                std::string args = "";
+                for (const auto& arg : call.Args())
+                    args += (args.empty() ? "" : ", ") + Coerce(Expr(*arg), CType{ Kind::Dynamic });
+                return Code{ "CallHost(" + Host(name) + ", " + Braced(args) + ")", CType{ Kind::Dynamic } };
+            }
+        }
+
+        Code callee = Expr(call.Caller());
+        std::string args = "";
+        for (const auto& arg : call.Args())
+            args += (args.empty() ? "" : ", ") + Coerce(Expr(*arg), CType{ Kind::Dynamic });
+        return Code{ "Call(" + Coerce(callee, CType{ Kind::Dynamic }) + ", " + Braced(args) + ")", CType{ Kind::Dynamic } };
+    }
+
+    // Typed arrays of a known element type take the typed overloads, which return typed results.
+    Transpiler::Code Transpiler::StandardCall(const std::string& name, const Frontend::CallExpr& call)
+    {
+        int arity = Runtime::StandardLibrary::Find(name)->arity;
+        if (arity >= 0 && (std::size_t) arity != call.Args().size())
+            Error("Function '" + name + "' expects " + std::to_string(arity) + " arguments, got " + std::to_string(call.Args().size()) + ".");
+
+        std::vector<Code> args;
+        for (const auto& arg : call.Args())
+            args.push_back(Expr(*arg));
+
+        std::string text = "Std::" + name + "(";
+        for (std::size_t i = 0; i < args.size(); i++)
+        {
+            const Code& arg = args[i];
+            text += (i == 0 ? "" : ", ") + (arg.type.kind == Kind::TypedArray ? arg.text : Coerce(arg, CType{ Kind::Dynamic }));
+        }
+        text += ")";
+
+        if (name == "intArray" || name == "floatArray" || name == "doubleArray" || name == "charArray")
+        {
+            Kind element = name == "intArray" ? Kind::Int : name == "floatArray" ? Kind::Float : name == "doubleArray" ? Kind::Double : Kind::Char;
+            return Code{ text, CType{ Kind::TypedArray, "", element } };
+        }
+
+        // Every argument that has to be an array must be one of the same element type.
+        std::size_t arrays = name == "fill" ? 1 : args.size();
+        std::optional<Kind> element = std::nullopt;
+        for (std::size_t i = 0; i < arrays; i++)
+        {
+            if (args[i].type.kind != Kind::TypedArray || (element.has_value() && element.value() != args[i].type.element))
+                return Code{ text, CType{ Kind::Dynamic } };
+            element = args[i].type.element;
+        }
+        if (!element.has_value())
+            return Code{ text, CType{ Kind::Dynamic } };
+
+        if (name == "sum" || name == "dot")
+            return Code{ text, CType{ element.value() == Kind::Char ? Kind::Int : element.value() } };
+        if (name == "min" || name == "max")
+            return Code{ text, CType{ element.value() } };
+        return Code{ text, CType{ Kind::TypedArray, "", element.value() } };
+    }
+
+    // `hint` is the declared type of what the object is assigned to, for the `name { ... }` form.
+    Transpiler::Code Transpiler::Constructor(const ObjectConstructorExpr& ctor, const CType* hint)
+    {
+        std::string typeName = "";
+        if (ctor.TargetVarIdentAsType())
+        {
+            if (const auto* type = std::any_cast<Types::Type>(&ctor.TargetVarIdent()); type != nullptr && type->Is(Types::Uid::Object))
+                typeName = type->Data();
+        }
+        if (typeName.empty() && hint != nullptr && hint->kind == Kind::Struct)
+            typeName = hint->name;
+
+        if (typeName.empty())
+        {
+            std::string fields = "";
+            for (const auto& property : ctor.Properties())
+            {
+                if (!property.Value().has_value())
+                    Error("Property '" + property.Key() + "' requires a value in object constructor.");
+
+                Code value = Expr(*property.Value().value());
+                fields += (fields.empty() ? "" : ", ") + std::string("{ ") + Quote(property.Key()) + ", " + Coerce(value, CType{ Kind::Dynamic }) + " }";
+            }
+            return Code{ "NewObject(" + Braced(fields) + ")", CType{ Kind::Dynamic } };
+        }
+
+        auto it = m_structs.find(typeName);
+        if (it == m_structs.end())
+            Error("Unknown object type '" + typeName + "'.");
+        const StructInfo& info = it->second;
+        const auto& declared = info.decl->Properties();
+
+        auto FieldIndex = [&](const std::string& key) -> std::size_t
+        {
+            for (std::size_t i = 0; i < declared.size(); i++)
+            {
+                if (declared[i].Key() == key)
+                    return i;
+            }
+            Error("Object type '" + typeName + "' has no property '" + key + "'.");
+        };
+
+        std::string init = "";
+        std::vector<std::string> provided;
+        for (const auto& property : ctor.Properties())
+        {
+            std::size_t i = FieldIndex(property.Key());
+            if (!property.Value().has_value())
+                Error("Property '" + property.Key() + "' requires a value in object constructor.");
+
+            Code value = Expr(*property.Value().value(), &info.fields[i]);
+            init += " self_." + info.fieldNames[i] + " = " + Coerce(value, info.fields[i]) + ";";
+            provided.push_back(property.Key());
+        }
+
+        // Defaults the struct could not initialise itself are evaluated here, like the VM does.
+        for (std::size_t i = 0; i < declared.size(); i++)
+        {
+            const auto& value = declared[i].Value();
+            if (!value.has_value() || !value.value() || std::find(provided.begin(), provided.end(), declared[i].Key()) != provided.end())
+                continue;
+            if (IsLiteralConstant(*value.value()) && IsStaticConversion(Literal(*value.value()), info.fields[i]))
+                continue;
+
+            Code code = Expr(*value.value(), &info.fields[i]);
+            init += " self_." + info.fieldNames[i] + " = " + Coerce(code, info.fields[i]) + ";";
+        }
+
+        CType type{ Kind::Struct, typeName };
+        if (init.empty())
+            return Code{ "std::make_shared<" + info.cpp + ">()", type };
+        return Code{ "New<" + info.cpp + ">([&](" + info.cpp + "& self_) {" + init + " })", type };
+    }
+
+    Transpiler::Code Transpiler::Lambda(const std::string& name, const std::vector<std::pair<std::string, const void*>>& params, const std::vector<CType>& types,
+        const std::vector<std::unique_ptr<Stmt>>& body, bool instantReturn, const CType& returnType)
+    {
+        Context context{};
+        context.parent = m_context;
+        context.scopes.emplace_back();
+        context.returnType = returnType;
+
+        std::string text = "";
+        std::string* out = m_out;
+        int indent = m_indent;
+        m_out = &text;
+        m_indent = indent + 1;
+        m_context = &context;
+
+        Line("StackGuard guard;");
+        for (std::size_t i = 0; i < params.size(); i++)
+        {
+            std::string arg = Coerce(Code{ "args[" + std::to_string(i) + "]", CType{ Kind::Dynamic } }, types[i]);
+            Variable& variable = Declare(params[i].first, types[i], params[i].second);
+            if (variable.boxed)
+                Line("auto " + variable.cpp + " = std::make_shared<" + CppType(types[i]) + ">(" + arg + ");");
+            else
+                Line(CppType(types[i]) + " " + variable.cpp + " = " + arg + ";");
+        }
+        EmitBody(body, instantReturn);
+
+        m_context = context.parent;
+        m_indent = indent;
+        m_out = out;
+
+        return Code{ "MakeFunction(" + Quote(name) + ", " + std::to_string(params.size()) + ", [=, this](std::span<const Dynamic>" + (params.empty() ? "" : " args")
+            + ") -> Dynamic\n" + Indent(m_indent) + "{\n" + text + Indent(m_indent) + "})", CType{ Kind::Dynamic } };
+    }
+
+    // `Enum.Entry` when Enum names a declared enum that is not shadowed.
+    std::optional<Transpiler::Code> Transpiler::EnumEntry(const MemberExpr& member)
+    {
+        if (member.Object().Kind() != NodeType::IDENTIFIER || member.Property().Kind() != NodeType::IDENTIFIER)
+            return std::nullopt;
+
+        const std::string& name = static_cast<const Identifier&>(member.Object()).Symbol();
+        auto variable = Resolve(name);
+        if (!variable.has_value() || variable->scope != Variable::ENUM)
+            return std::nullopt;
+
+        const std::string& key = static_cast<const Identifier&>(member.Property()).Symbol();
+        for (const auto& entry : m_enums.at(name)->Entries())
+        {
+            if (entry == key)
+                return Code{ variable->cpp + "::" + Escape(entry), CType{ Kind::Enum, name } };
+        }
+
+        Error("Enum '" + name + "' has no entry '" + key + "'.");
+    }
+
+    // ----- Types and conversions -----
+
+    Transpiler::CType Transpiler::FromDeclared(const std::optional<Types::Type>& type) const
+    {
+        if (!type.has_value() || !type->LambdaTypes().empty())
+            return CType{ Kind::Dynamic };
+
+        switch ((Types::Uid) type->Uid())
+        {
+        case Types::Uid::Void:   return CType{ Kind::Void };
+        case Types::Uid::Bool:   return CType{ Kind::Bool };
+        case Types::Uid::Int:    return CType{ Kind::Int };
+        case Types::Uid::Float:  return CType{ Kind::Float };
+        case Types::Uid::Double: return CType{ Kind::Double };
+        case Types::Uid::Char:   return CType{ Kind::Char };
+        case Types::Uid::String: return CType{ Kind::String };
+        case Types::Uid::Array:
+        {
+            const auto& element = type->Child();
+            if (element == nullptr || !element->LambdaTypes().empty())
+                return CType{ Kind::Dynamic };
+
+            switch ((Types::Uid) element->Uid())
+            {
+            case Types::Uid::Int:    return CType{ Kind::TypedArray, "", Kind::Int };
+            case Types::Uid::Float:  return CType{ Kind::TypedArray, "", Kind::Float };
+            case Types::Uid::Double: return CType{ Kind::TypedArray, "", Kind::Double };
+            case Types::Uid::Char:   return CType{ Kind::TypedArray, "", Kind::Char };
+            default:                 return CType{ Kind::Dynamic };
+            }
+        }
+        case Types::Uid::Object:
+            if (m_structs.count(type->Data()))
+                return CType{ Kind::Struct, type->Data() };
+            if (m_enums.count(type->Data()))
+                return CType{ Kind::Enum, type->Data() };
+            return CType{ Kind::Dynamic };
+        default:
+            return CType{ Kind::Dynamic };
+        }
+    }
+
+    std::string Transpiler::CppType(const CType& type) const
+    {
+        switch (type.kind)
+        {
+        case Kind::Void:       return "void";
+        case Kind::Bool:       return "bool";
+        case Kind::Int:        return "int";
+        case Kind::Float:      return "float";
+        case Kind::Double:     return "double";
+        case Kind::Char:       return "char";
+        case Kind::Enum:       return Escape(type.name);
+        case Kind::Struct:     return "std::shared_ptr<" + m_structs.at(type.name).cpp + ">";
+        case Kind::TypedArray: return "TypedArray<" + CppType(CType{ type.element }) + ">";
+        default:               return "Dynamic";
+        }
+    }
+
+    bool Transpiler::IsNumeric(Kind kind)
+    {
+        return kind == Kind::Int || kind == Kind::Float || kind == Kind::Double || kind == Kind::Char || kind == Kind::Enum;
+    }
+
+    // Converts like a store into a variable of the declared type does in the VM.
+    std::string Transpiler::Coerce(const Code& code, const CType& target) const
+    {
+        if (code.type.kind == Kind::Void)
+            return Coerce(Code{ "(" + code.text + ", Dynamic())", CType{ Kind::Dynamic }, false, true }, target);
+        if (target.kind == Kind::Dynamic || target.kind == Kind::Void || code.type == target)
+            return code.text;
+
+        if (code.null && (target.kind == Kind::Struct || target.kind == Kind::TypedArray))
+            return "nullptr";
+
+        bool dynamic = code.type.kind == Kind::Dynamic || code.type.kind == Kind::String;
+        std::string value = dynamic ? code.text : "Dynamic(" + code.text + ")";
+        std::string type = CppType(target);
+
+        switch (target.kind)
+        {
+        case Kind::String:
+            return "ExpectString(" + value + ")";
+        case Kind::Int:
+        case Kind::Float:
+        case Kind::Double:
+        case Kind::Char:
+        {
+            if (!IsNumeric(code.type.kind))
+                break;
+            if (target.kind == Kind::Char && (code.type.kind == Kind::Float || code.type.kind == Kind::Double))
+                break;
+
+            if (code.literal && code.type.kind == Kind::Int && code.text.front() != '(')
+            {
+                if (target.kind == Kind::Double)
+                    return code.text + ".0";
+                if (target.kind == Kind::Float)
+                    return code.text + ".0f";
+            }
+            return "static_cast<" + type + ">(" + AsInt(code) + ")";
+        }
+        case Kind::Enum:
+            if (code.type.kind == Kind::Int || code.type.kind == Kind::Char || code.type.kind == Kind::Enum)
+                return "static_cast<" + type + ">(" + AsInt(code) + ")";
+            break;
+        default:
+            break;
+        }
+        return "Convert<" + type + ">(" + value + ")";
+    }
+
+    // Whether Coerce can convert the literal without a check that may fail at run time.
+    bool Transpiler::IsStaticConversion(const Code& code, const CType& target) const
+    {
+        if (target.kind == Kind::Dynamic || code.type == target)
+            return true;
+        if (code.null)
+            return target.kind == Kind::String || target.kind == Kind::Struct || target.kind == Kind::TypedArray;
+
+        switch (target.kind)
+        {
+        case Kind::Int:
+        case Kind::Float:
+        case Kind::Double:
+            return IsNumeric(code.type.kind);
+        case Kind::Char:
+        case Kind::Enum:
+            return code.type.kind == Kind::Int || code.type.kind == Kind::Char;
+        default:
+            return false;
+        }
+    }
+
+    // Enum entries take part in arithmetic as their index.
+    std::string Transpiler::AsInt(const Code& code)
+    {
+        return code.type.kind == Kind::Enum ? "static_cast<int>(" + code.text + ")" : code.text;
+    }
+
+    std::string Transpiler::Truthy(const Code& code)
+    {
+        switch (code.type.kind)
+        {
+        case Kind::Bool:
+            return code.text;
+        case Kind::Int:
+        case Kind::Float:
+        case Kind::Double:
+        case Kind::Char:
+        case Kind::Enum:
+            return "(" + AsInt(code) + " != 0)";
+        case Kind::Struct:
+        case Kind::TypedArray:
+            return "(" + code.text + " != nullptr)";
+        case Kind::Void:
+            return "(" + code.text + ", false)";
+        default:
+            return "Truthy(" + code.text + ")";
+        }
+    }
+
+    std::string Transpiler::DefaultValue(const CType& type) const
+    {
+        switch (type.kind)
+        {
+        case Kind::Bool:       return "false";
+        case Kind::Int:        return "0";
+        case Kind::Float:      return "0.0f";
+        case Kind::Double:     return "0.0";
+        case Kind::Char:       return "'\\0'";
+        case Kind::Enum:       return Escape(type.name) + "{}";
+        case Kind::Struct:
+        case Kind::TypedArray: return "nullptr";
+        default:               return "Dynamic()";
+        }
+    }
+
+    // ----- Names and scopes -----
+
+    std::optional<Transpiler::Variable> Transpiler::Resolve(const std::string& name)
+    {
+        for (Context* context = m_context; context != nullptr; context = context->parent)
+        {
+            for (auto scope = context->scopes.rbegin(); scope != context->scopes.rend(); ++scope)
+            {
+                for (auto it = scope->rbegin(); it != scope->rend(); ++it)
+                {
+                    if (it->name != name)
+                        continue;
+
+                    // Locals of an enclosing function are shared with it through a cell.
+                    if (context != m_context)
+                        m_captured.insert(it->key);
+                    return *it;
+                }
+            }
+        }
+
+        auto global = m_globals.find(name);
+        if (global != m_globals.end())
+            return global->second;
+        return std::nullopt;
+    }
+
+    Transpiler::Variable& Transpiler::Declare(const std::string& name, const CType& type, const void* key)
+    {
+        auto& scope = m_context->scopes.back();
+        for (const auto& variable : scope)
+        {
+            if (variable.name == name)
+                Error("Identifier '" + name + "' is already declared in this scope.");
+        }
+
+        Variable variable{ name, Fresh(name), type, Variable::LOCAL, !m_analysis && m_captured.count(key) > 0, key };
+        m_context->used.insert(variable.cpp);
+        scope.push_back(std::move(variable));
+        return scope.back();
+    }
+
+    // A C++ name for a new local that hides nothing the function can see, so that shadowing in the script
+    // never changes what an initial value or a nested function refers to.
+    std::string Transpiler::Fresh(const std::string& name)
+    {
+        auto Used = [&](const std::string& candidate)
+        {
+            if (m_memberNames.count(candidate) || m_typeNames.count(candidate))
+                return true;
+            for (Context* context = m_context; context != nullptr; context = context->parent)
+            {
+                if (context->used.count(candidate))
+                    return true;
+            }
+            return false;
+        };
+
+        std::string base = Escape(name);
+        std::string candidate = base;
+        for (int i = 2; Used(candidate); i++)
+            candidate = base + "_" + std::to_string(i);
+        return candidate;
+    }
+
+    std::string Transpiler::Escape(const std::string& name)
+    {
+        return ReservedNames.count(name) ? name + "_" : name;
+    }
+
+    std::string Transpiler::Host(const std::string& name)
+    {
+        auto found = m_hosts.find(name);
+        if (found != m_hosts.end())
+            return found->second;
+
+        std::string cpp = "host_" + name;
+        while (m_memberNames.count(cpp))
+            cpp += "_";
+        m_memberNames.insert(cpp);
+        m_hosts.emplace(name, cpp);
+        m_hostOrder.push_back(name);
+        return cpp;
+    }
+
+    std::string Transpiler::Access(const Variable& variable) const
+    {
+        return variable.boxed ? "(*" + variable.cpp + ")" : variable.cpp;
+    }
+
+    void Transpiler::Line(const std::string& text)
+    {
+        if (!text.empty())
+            *m_out += Indent(m_indent) + text;
+        *m_out += "\n";
+    }
+
+    void Transpiler::Error(const std::string& description) const
+    {
+        throw SyntaxException(m_program.FileDir(), Vector2i(0, 0), description);
+    }
+}
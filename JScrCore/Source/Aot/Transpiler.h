@@ -0,0 +1,191 @@
+#pragma once
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../Frontend/Ast.h"
+#include "../Frontend/SyntaxException.h"
+
+using namespace JScr::Frontend;
+
+namespace JScr::Aot
+{
+    // Translates a parsed Program into C++20 built on Aot/Runtime.h, for scripts that are fixed at build
+    // time. Declared primitive types become native variables, object types structs, enums enum classes
+    // and functions C++ functions or lambdas. The Program is expected to have passed Runtime::Compiler
+    // already; only what cannot be expressed in C++ is reported here, as a SyntaxException.
+    class Transpiler
+    {
+    public:
+        struct Options
+        {
+            // Namespace around all generated code.
+            std::string ns = "JScrScript";
+            // Included by the source file, so it can see the declarations of the header.
+            std::string headerName = "Script.h";
+        };
+
+        struct Output
+        {
+            // Declares `<ns>::Compiled` for the host.
+            std::string header;
+            std::string source;
+        };
+
+        static Output Transpile(Program& program, const Options& options);
+
+    private:
+        enum class Kind
+        {
+            Void, Dynamic, String, Bool, Int, Float, Double, Char, Enum, Struct, TypedArray
+        };
+
+        struct CType
+        {
+            Kind kind = Kind::Dynamic;
+            // Enum or struct name.
+            std::string name = "";
+            Kind element = Kind::Int;
+
+            bool operator==(const CType& other) const { return kind == other.kind && name == other.name && (kind != Kind::TypedArray || element == other.element); }
+        };
+
+        struct Code
+        {
+            std::string text;
+            CType type;
+            bool literal = false;
+            bool null = false;
+        };
+
+        struct Variable
+        {
+            enum Scope { LOCAL, GLOBAL, FUNCTION, ENUM };
+
+            std::string name;
+            std::string cpp;
+            CType type;
+            Scope scope = LOCAL;
+            bool boxed = false;
+            // Declaring node; what the capture analysis keys on.
+            const void* key = nullptr;
+        };
+
+        struct StructInfo
+        {
+            const ObjectDeclaration* decl;
+            std::string cpp;
+            std::vector<CType> fields;
+            std::vector<std::string> fieldNames;
+        };
+
+        struct FunctionInfo
+        {
+            const FunctionDeclaration* decl;
+            std::vector<CType> params;
+            CType result;
+        };
+
+        struct Context
+        {
+            Context* parent = nullptr;
+            std::vector<std::vector<Variable>> scopes;
+            std::unordered_set<std::string> used;
+            CType returnType;
+            bool main = false;
+        };
+
+    private:
+        Transpiler(Program& program, const Options& options);
+
+        void Collect();
+        std::string EmitAll();
+        void EmitStruct(const StructInfo& info);
+        void EmitStructMembers(const StructInfo& info);
+        void EmitFunction(const FunctionInfo& info);
+        void EmitMain();
+
+        // Statements
+        void EmitStmt(const Stmt& stmt);
+        void EmitBlock(const std::vector<std::unique_ptr<Stmt>>& body);
+        void EmitBody(const std::vector<std::unique_ptr<Stmt>>& body, bool instantReturn);
+        std::string VarDeclarationText(const VarDeclaration& decl);
+        void EmitVarDeclaration(const VarDeclaration& decl);
+        void EmitLocalFunction(const FunctionDeclaration& fn);
+        void EmitIfElse(const IfElseDeclaration& ifElse);
+        void EmitFor(const ForDeclaration& loop);
+        void EmitFallOff(const std::vector<std::unique_ptr<Stmt>>& body);
+        std::string Effect(const Frontend::Expr& expr);
+
+        // Expressions
+        Code Expr(const Frontend::Expr& expr, const CType* hint = nullptr);
+        Code Literal(const Frontend::Expr& expr);
+        Code IdentifierValue(const std::string& name);
+        Code Binary(const BinaryExpr& binary);
+        Code Check(const EqualityCheckExpr& check);
+        Code Unary(const UnaryExpr& unary);
+        Code Assignment(const AssignmentExpr& assignment, bool statement);
+        Code Member(const MemberExpr& member);
+        Code Index(const IndexExpr& index);
+        Code CallExpr(const Frontend::CallExpr& call);
+        Code StandardCall(const std::string& name, const Frontend::CallExpr& call);
+        Code Constructor(const ObjectConstructorExpr& ctor, const CType* hint);
+        Code Lambda(const std::string& name, const std::vector<std::pair<std::string, const void*>>& params, const std::vector<CType>& types,
+            const std::vector<std::unique_ptr<Stmt>>& body, bool instantReturn, const CType& returnType);
+        std::optional<Code> EnumEntry(const MemberExpr& member);
+
+        // Types and conversions
+        CType FromDeclared(const std::optional<Types::Type>& type) const;
+        std::string CppType(const CType& type) const;
+        bool HoldsObjects(const StructInfo& info) const;
+        static bool IsNumeric(Kind kind);
+        std::string Coerce(const Code& code, const CType& target) const;
+        bool IsStaticConversion(const Code& code, const CType& target) const;
+        static std::string AsInt(const Code& code);
+        static std::string Truthy(const Code& code);
+        std::string DefaultValue(const CType& type) const;
+
+        // Names and scopes
+        std::optional<Variable> Resolve(const std::string& name);
+        Variable& Declare(const std::string& name, const CType& type, const void* key);
+        std::string Fresh(const std::string& name);
+        static std::string Escape(const std::string& name);
+        // The member of the generated Script that holds the host function of that name.
+        std::string Host(const std::string& name);
+        std::string Access(const Variable& variable) const;
+        void BeginScope() { m_context->scopes.emplace_back(); }
+        void EndScope() { m_context->scopes.pop_back(); }
+        bool IsTopLevel() const { return m_context->main && m_context->scopes.size() == 1; }
+
+        void Line(const std::string& text);
+        std::string Indent(int level) const { return std::string(level * 4, ' '); }
+
+        [[noreturn]] void Error(const std::string& description) const;
+
+    private:
+        Program& m_program;
+        Options m_options;
+
+        std::unordered_map<std::string, const EnumDeclaration*> m_enums;
+        std::vector<std::string> m_enumOrder;
+        std::unordered_map<std::string, StructInfo> m_structs;
+        std::vector<std::string> m_structOrder;
+        std::unordered_map<std::string, Variable> m_globals;
+        std::vector<std::string> m_globalOrder;
+        std::unordered_map<std::string, FunctionInfo> m_functions;
+        std::unordered_set<std::string> m_memberNames;
+        std::unordered_set<std::string> m_typeNames;
+        std::unordered_map<std::string, std::string> m_hosts;
+        std::vector<std::string> m_hostOrder;
+
+        // The first pass only finds the variables nested functions capture; those become shared cells.
+        bool m_analysis = false;
+        std::unordered_set<const void*> m_captured;
+
+        Context* m_context = nullptr;
+        std::string* m_out = nullptr;
+        int m_indent = 0;
+    };
+}
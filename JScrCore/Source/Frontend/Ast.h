@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <any>
+#include <memory>
 #include <optional>
 #include "../Runtime/Types.h"
 
@@ -32,6 +33,7 @@ namespace JScr::Frontend
         EQUALITY_CHECK_EXPR,
         MEMBER_EXPR,
         UNARY_EXPR,
+        AWAIT_EXPR,
         LAMBDA_EXPR,
         CALL_EXPR,
         INDEX_EXPR,
@@ -57,11 +59,14 @@ namespace JScr::Frontend
     public:
         virtual void abstract() const = 0;
         Stmt(const NodeType& kind) : m_kind(kind) {}
+        Stmt(const Stmt&) = default;
+        Stmt(Stmt&&) = default;
+        virtual ~Stmt() = default;
 
         const NodeType& Kind() const { return m_kind; }
 
     private:
-        const NodeType& m_kind;
+        NodeType m_kind;
     };
 
     class Program : public Stmt
@@ -73,41 +78,41 @@ namespace JScr::Frontend
         const string& FileDir() const         { return m_fileDir; }
         std::vector<std::unique_ptr<Stmt>>& Body()             { return m_body; }
     private:
-        const string& m_fileDir;
+        string m_fileDir;
         std::vector<std::unique_ptr<Stmt>> m_body;
     };
 
     class ImportStmt : public Stmt
     {
     public:
-        ImportStmt(const std::vector<string>& target, const string& alias) : Stmt(NodeType::IMPORT_STMT), m_target(target), m_alias(alias) {}
+        ImportStmt(std::vector<string> target, string alias) : Stmt(NodeType::IMPORT_STMT), m_target(std::move(target)), m_alias(std::move(alias)) {}
         void abstract() const override {}
 
         const std::vector<string>& Target() const { return m_target; }
         const string& Alias() const               { return m_alias; }
     private:
-        const std::vector<string>& m_target;
-        const string& m_alias;
+        std::vector<string> m_target;
+        string m_alias;
     };
 
     class AnnotationUsageDeclaration : public Stmt
     {
     public:
-        AnnotationUsageDeclaration(const string& ident, const std::vector<std::unique_ptr<Expr>>& args) : Stmt(NodeType::ANNOTATION_USAGE_DECLARATION), m_ident(ident), m_args(args) {}
+        AnnotationUsageDeclaration(string ident, std::vector<std::unique_ptr<Expr>> args) : Stmt(NodeType::ANNOTATION_USAGE_DECLARATION), m_ident(std::move(ident)), m_args(std::move(args)) {}
         void abstract() const override {}
 
         const string& Ident() const { return m_ident; };
         const std::vector<std::unique_ptr<Expr>>& Args() const { return m_args; };
     private:
-        const string& m_ident;
-        const std::vector<std::unique_ptr<Expr>>& m_args;
+        string m_ident;
+        std::vector<std::unique_ptr<Expr>> m_args;
     };
 
     class VarDeclaration : public Stmt
     {
     public:
-        VarDeclaration(const std::vector<AnnotationUsageDeclaration> annotatedWith, const bool& constant, const bool& export_, const Types::Type& type, const string& identifier, const std::optional<std::unique_ptr<Expr>>& value)
-            : Stmt(NodeType::VAR_DECLARATION), m_annotatedWith(annotatedWith), m_constant(constant), m_export(export_), m_type(type), m_identifier(identifier), m_value(value)
+        VarDeclaration(std::vector<AnnotationUsageDeclaration> annotatedWith, bool constant, bool export_, const Types::Type& type, string identifier, std::optional<std::unique_ptr<Expr>> value)
+            : Stmt(NodeType::VAR_DECLARATION), m_annotatedWith(std::move(annotatedWith)), m_constant(constant), m_export(export_), m_type(type), m_identifier(std::move(identifier)), m_value(std::move(value))
         {}
         void abstract() const override {}
 
@@ -118,19 +123,19 @@ namespace JScr::Frontend
         const string& Identifier() const { return m_identifier; }
         const std::optional<std::unique_ptr<Expr>>& Value() const { return m_value; }
     private:
-        const std::vector<AnnotationUsageDeclaration>& m_annotatedWith;
-        const bool& m_constant;
-        const bool& m_export;
-        const Types::Type& m_type;
-        const string& m_identifier;
-        const std::optional<std::unique_ptr<Expr>>& m_value;
+        std::vector<AnnotationUsageDeclaration> m_annotatedWith;
+        bool m_constant;
+        bool m_export;
+        Types::Type m_type;
+        string m_identifier;
+        std::optional<std::unique_ptr<Expr>> m_value;
     };
 
     class FunctionDeclaration : public Stmt
     {
     public:
-        FunctionDeclaration(const std::vector<AnnotationUsageDeclaration>& annotatedWith, const bool& export_, const std::vector<VarDeclaration>& parameters, const string& identifier, const Types::Type& type, const std::vector<std::unique_ptr<Stmt>>& body, const bool& instantReturn)
-            : Stmt(NodeType::FUNCTION_DECLARATION), m_annotatedWith(annotatedWith), m_export(export_), m_parameters(parameters), m_identifier(identifier), m_type(type), m_body(body), m_instantReturn(instantReturn)
+        FunctionDeclaration(std::vector<AnnotationUsageDeclaration> annotatedWith, bool export_, std::vector<VarDeclaration> parameters, string identifier, const Types::Type& type, std::vector<std::unique_ptr<Stmt>> body, bool instantReturn, bool async = false)
+            : Stmt(NodeType::FUNCTION_DECLARATION), m_annotatedWith(std::move(annotatedWith)), m_export(export_), m_parameters(std::move(parameters)), m_identifier(std::move(identifier)), m_type(type), m_body(std::move(body)), m_instantReturn(instantReturn), m_async(async)
         {}
         void abstract() const override {}
 
@@ -141,21 +146,24 @@ namespace JScr::Frontend
         const Types::Type& Type() const { return m_type; }
         const std::vector<std::unique_ptr<Stmt>>& Body() const { return m_body; }
         const bool& InstantReturn() const { return m_instantReturn; }
+        // Calls return a task right away; the body may `await`.
+        bool Async() const { return m_async; }
     private:
-        const std::vector<AnnotationUsageDeclaration>& m_annotatedWith;
-        const bool& m_export;
-        const std::vector<VarDeclaration>& m_parameters;
-        const string& m_identifier;
-        const Types::Type& m_type;
-        const std::vector<std::unique_ptr<Stmt>>& m_body;
-        const bool& m_instantReturn;
+        std::vector<AnnotationUsageDeclaration> m_annotatedWith;
+        bool m_export;
+        std::vector<VarDeclaration> m_parameters;
+        string m_identifier;
+        Types::Type m_type;
+        std::vector<std::unique_ptr<Stmt>> m_body;
+        bool m_instantReturn;
+        bool m_async;
     };
 
     class ObjectDeclaration : public Stmt
     {
     public:
-        ObjectDeclaration(const std::vector<AnnotationUsageDeclaration>& annotatedWith, const bool& export_, const string& identifier, const std::vector<Property>& properties, const bool& isAnnotationDeclaration)
-            : Stmt(NodeType::OBJECT_DECLARATION), m_annotatedWith(annotatedWith), m_export(export_), m_identifier(identifier), m_properties(properties), m_isAnnotationDecl(isAnnotationDeclaration)
+        ObjectDeclaration(std::vector<AnnotationUsageDeclaration> annotatedWith, bool export_, string identifier, std::vector<Property> properties, bool isAnnotationDeclaration)
+            : Stmt(NodeType::OBJECT_DECLARATION), m_annotatedWith(std::move(annotatedWith)), m_export(export_), m_identifier(std::move(identifier)), m_properties(std::move(properties)), m_isAnnotationDecl(isAnnotationDeclaration)
         {}
         void abstract() const override {}
 
@@ -165,18 +173,18 @@ namespace JScr::Frontend
         const std::vector<Property>& Properties() const { return m_properties; }
         const bool& IsAnnotationDecl() const { return m_isAnnotationDecl; }
     private:
-        const std::vector<AnnotationUsageDeclaration>& m_annotatedWith;
-        const bool& m_export;
-        const string& m_identifier;
-        const std::vector<Property>& m_properties;
-        const bool& m_isAnnotationDecl;
+        std::vector<AnnotationUsageDeclaration> m_annotatedWith;
+        bool m_export;
+        string m_identifier;
+        std::vector<Property> m_properties;
+        bool m_isAnnotationDecl;
     };
 
     class EnumDeclaration : public Stmt
     {
     public:
-        EnumDeclaration(const std::vector<AnnotationUsageDeclaration>& annotatedWith, const bool& export_, const string& identifier, const std::vector<string>& entries)
-            : Stmt(NodeType::ENUM_DECLARATION), m_annotatedWith(annotatedWith), m_export(export_), m_identifier(identifier), m_entries(entries)
+        EnumDeclaration(std::vector<AnnotationUsageDeclaration> annotatedWith, bool export_, string identifier, std::vector<string> entries)
+            : Stmt(NodeType::ENUM_DECLARATION), m_annotatedWith(std::move(annotatedWith)), m_export(export_), m_identifier(std::move(identifier)), m_entries(std::move(entries))
         {}
         void abstract() const override {}
 
@@ -185,32 +193,32 @@ namespace JScr::Frontend
         const string& Identifier() const { return m_identifier; } // <-- name
         const std::vector<string>& Entries() const { return m_entries; }
     private:
-        const std::vector<AnnotationUsageDeclaration>& m_annotatedWith;
-        const bool& m_export;
-        const string& m_identifier;
-        const std::vector<string>& m_entries;
+        std::vector<AnnotationUsageDeclaration> m_annotatedWith;
+        bool m_export;
+        string m_identifier;
+        std::vector<string> m_entries;
     };
 
     class ReturnDeclaration : public Stmt
     {
     public:
-        ReturnDeclaration(const Expr& value) : Stmt(NodeType::RETURN_DECLARATION), m_value(value) {}
+        ReturnDeclaration(std::unique_ptr<Expr> value) : Stmt(NodeType::RETURN_DECLARATION), m_value(std::move(value)) {}
         void abstract() const override {}
 
-        const Expr& Value() const { return m_value; }
+        const Expr& Value() const { return *m_value; }
     private:
-        const Expr& m_value;
+        std::unique_ptr<Expr> m_value;
     };
 
     class DeleteDeclaration : public Stmt
     {
     public:
-        DeleteDeclaration(const string& value) : Stmt(NodeType::DELETE_DECLARATION), m_value(value) {}
+        DeleteDeclaration(string value) : Stmt(NodeType::DELETE_DECLARATION), m_value(std::move(value)) {}
         void abstract() const override {}
 
         const string& Value() const { return m_value; }
     private:
-        const string& m_value;
+        string m_value;
     };
 
     class IfElseDeclaration : public Stmt
@@ -219,55 +227,55 @@ namespace JScr::Frontend
         class IfBlock
         {
         public:
-            IfBlock(const Expr& condition, const std::vector<std::unique_ptr<Stmt>>& body) : m_condition(condition), m_body(body) {}
+            IfBlock(std::unique_ptr<Expr> condition, std::vector<std::unique_ptr<Stmt>> body) : m_condition(std::move(condition)), m_body(std::move(body)) {}
 
-            const Expr& Condition() const { return m_condition; }
+            const Expr& Condition() const { return *m_condition; }
             const std::vector<std::unique_ptr<Stmt>>& Body() const { return m_body; }
         private:
-            const Expr& m_condition;
-            const std::vector<std::unique_ptr<Stmt>>& m_body;
+            std::unique_ptr<Expr> m_condition;
+            std::vector<std::unique_ptr<Stmt>> m_body;
         };
 
-        IfElseDeclaration(const std::vector<IfBlock>& blocks, const std::vector<std::unique_ptr<Stmt>>& elseBody) : Stmt(NodeType::IF_ELSE_DECLARATION), m_blocks(blocks), m_elseBody(elseBody) {}
+        IfElseDeclaration(std::vector<IfBlock> blocks, std::vector<std::unique_ptr<Stmt>> elseBody) : Stmt(NodeType::IF_ELSE_DECLARATION), m_blocks(std::move(blocks)), m_elseBody(std::move(elseBody)) {}
         void abstract() const override {}
 
         const std::vector<IfBlock>& Blocks() const { return m_blocks; }
         const std::vector<std::unique_ptr<Stmt>>& ElseBody() const { return m_elseBody; }
     private:
-        const std::vector<IfBlock>& m_blocks;
-        const std::vector<std::unique_ptr<Stmt>>& m_elseBody;
+        std::vector<IfBlock> m_blocks;
+        std::vector<std::unique_ptr<Stmt>> m_elseBody;
     };
 
     class WhileDeclaration : public Stmt
     {
     public:
-        WhileDeclaration(const Expr& condition, const std::vector<std::unique_ptr<Stmt>>& body) : Stmt(NodeType::WHILE_DECLARATION), m_condition(condition), m_body(body) {}
+        WhileDeclaration(std::unique_ptr<Expr> condition, std::vector<std::unique_ptr<Stmt>> body) : Stmt(NodeType::WHILE_DECLARATION), m_condition(std::move(condition)), m_body(std::move(body)) {}
         void abstract() const override {}
 
-        const Expr& Condition() const { return m_condition; }
+        const Expr& Condition() const { return *m_condition; }
         const std::vector<std::unique_ptr<Stmt>>& Body() const { return m_body; }
     private:
-        const Expr& m_condition;
-        const std::vector<std::unique_ptr<Stmt>>& m_body;
+        std::unique_ptr<Expr> m_condition;
+        std::vector<std::unique_ptr<Stmt>> m_body;
     };
 
     class ForDeclaration : public Stmt
     {
     public:
-        ForDeclaration(const Stmt& declaration, const Expr& condition, const Expr& action, const std::vector<std::unique_ptr<Stmt>>& body)
-            : Stmt(NodeType::FOR_DECLARATION), m_declaration(declaration), m_condition(condition), m_action(action), m_body(body)
+        ForDeclaration(std::unique_ptr<Stmt> declaration, std::unique_ptr<Expr> condition, std::unique_ptr<Expr> action, std::vector<std::unique_ptr<Stmt>> body)
+            : Stmt(NodeType::FOR_DECLARATION), m_declaration(std::move(declaration)), m_condition(std::move(condition)), m_action(std::move(action)), m_body(std::move(body))
         {}
         void abstract() const override {}
 
-        const Stmt& Declaration() const { return m_declaration; }
-        const Expr& Condition() const { return m_condition; }
-        const Expr& Action() const { return m_action; }
+        const Stmt& Declaration() const { return *m_declaration; }
+        const Expr& Condition() const { return *m_condition; }
+        const Expr& Action() const { return *m_action; }
         const std::vector<std::unique_ptr<Stmt>>& Body() const { return m_body; }
     private:
-        const Stmt& m_declaration;
-        const Expr& m_condition;
-        const Expr& m_action;
-        const std::vector<std::unique_ptr<Stmt>>& m_body;
+        std::unique_ptr<Stmt> m_declaration;
+        std::unique_ptr<Expr> m_condition;
+        std::unique_ptr<Expr> m_action;
+        std::vector<std::unique_ptr<Stmt>> m_body;
     };
 
     class Expr : public Stmt
@@ -280,14 +288,14 @@ namespace JScr::Frontend
     class AssignmentExpr : public Expr
     {
     public:
-        AssignmentExpr(const Expr& assigne, const Expr& value) : Expr(NodeType::ASSIGNMENT_EXPR), m_assigne(assigne), m_value(value) {}
+        AssignmentExpr(std::unique_ptr<Expr> assigne, std::unique_ptr<Expr> value) : Expr(NodeType::ASSIGNMENT_EXPR), m_assigne(std::move(assigne)), m_value(std::move(value)) {}
         void abstract() const override {}
 
-        const Expr& Assigne() const { return m_assigne; }
-        const Expr& Value() const { return m_value; }
+        const Expr& Assigne() const { return *m_assigne; }
+        const Expr& Value() const { return *m_value; }
     private:
-        const Expr& m_assigne;
-        const Expr& m_value;
+        std::unique_ptr<Expr> m_assigne;
+        std::unique_ptr<Expr> m_value;
     };
 
     class EqualityCheckExpr : public Expr
@@ -298,204 +306,215 @@ namespace JScr::Frontend
             EQUALS, NOT_EQUALS, MORE_THAN, MORE_THAN_OR_EQUALS, LESS_THAN, LESS_THAN_OR_EQUALS, AND, OR
         };
 
-        EqualityCheckExpr(const Expr& left, const Expr& right, const Type& operator_) : Expr(NodeType::EQUALITY_CHECK_EXPR), m_left(left), m_right(right), m_operator_(operator_) {}
+        EqualityCheckExpr(std::unique_ptr<Expr> left, std::unique_ptr<Expr> right, Type operator_) : Expr(NodeType::EQUALITY_CHECK_EXPR), m_left(std::move(left)), m_right(std::move(right)), m_operator_(operator_) {}
         void abstract() const override {}
 
-        const Expr& Left() const { return m_left; }
-        const Expr& Right() const { return m_right; }
+        const Expr& Left() const { return *m_left; }
+        const Expr& Right() const { return *m_right; }
         const Type& Operator() const { return m_operator_; }
     private:
-        const Expr& m_left;
-        const Expr& m_right;
-        const Type& m_operator_;
+        std::unique_ptr<Expr> m_left;
+        std::unique_ptr<Expr> m_right;
+        Type m_operator_;
     };
 
     class BinaryExpr : public Expr
     {
     public:
-        BinaryExpr(const Expr& left, const Expr& right, const char& operator_) : Expr(NodeType::BINARY_EXPR), m_left(left), m_right(right), m_operator_(operator_) {}
+        BinaryExpr(std::unique_ptr<Expr> left, std::unique_ptr<Expr> right, char operator_) : Expr(NodeType::BINARY_EXPR), m_left(std::move(left)), m_right(std::move(right)), m_operator_(operator_) {}
         void abstract() const override {}
 
-        const Expr& Left() const { return m_left; }
-        const Expr& Right() const { return m_right; }
+        const Expr& Left() const { return *m_left; }
+        const Expr& Right() const { return *m_right; }
         const char& Operator() const { return m_operator_; }
     private:
-        const Expr& m_left;
-        const Expr& m_right;
-        const char& m_operator_;
+        std::unique_ptr<Expr> m_left;
+        std::unique_ptr<Expr> m_right;
+        char m_operator_;
     };
 
     class CallExpr : public Expr
     {
     public:
-        CallExpr(const std::vector<std::unique_ptr<Expr>>& args, const Expr& caller) : Expr(NodeType::CALL_EXPR), m_args(args), m_caller(caller) {}
+        CallExpr(std::vector<std::unique_ptr<Expr>> args, std::unique_ptr<Expr> caller) : Expr(NodeType::CALL_EXPR), m_args(std::move(args)), m_caller(std::move(caller)) {}
         void abstract() const override {}
 
         const std::vector<std::unique_ptr<Expr>>& Args() const { return m_args; }
-        const Expr& Caller() const { return m_caller; }
+        const Expr& Caller() const { return *m_caller; }
     private:
-        const std::vector<std::unique_ptr<Expr>>& m_args;
-        const Expr& m_caller;
+        std::vector<std::unique_ptr<Expr>> m_args;
+        std::unique_ptr<Expr> m_caller;
     };
 
     class IndexExpr : public Expr
     {
     public:
-        IndexExpr(const Expr& arg, const Expr& caller) : Expr(NodeType::INDEX_EXPR), m_arg(arg), m_caller(caller) {}
+        IndexExpr(std::unique_ptr<Expr> arg, std::unique_ptr<Expr> caller) : Expr(NodeType::INDEX_EXPR), m_arg(std::move(arg)), m_caller(std::move(caller)) {}
         void abstract() const override {}
 
-        const Expr& Arg() const { return m_arg; }
-        const Expr& Caller() const { return m_caller; }
+        const Expr& Arg() const { return *m_arg; }
+        const Expr& Caller() const { return *m_caller; }
     private:
-        const Expr& m_arg;
-        const Expr& m_caller;
+        std::unique_ptr<Expr> m_arg;
+        std::unique_ptr<Expr> m_caller;
     };
 
     class ObjectConstructorExpr : public Expr
     {
     public:
-        ObjectConstructorExpr(const any& targetVarIdent, const bool& targetVarIdentAsType, const std::vector<Property>& properties) : Expr(NodeType::OBJECT_CONSTRUCTOR_EXPR), m_targetVarIdent(targetVarIdent), m_targetVarIdentAsType(targetVarIdentAsType), m_properties(properties) {}
+        ObjectConstructorExpr(any targetVarIdent, bool targetVarIdentAsType, std::vector<Property> properties) : Expr(NodeType::OBJECT_CONSTRUCTOR_EXPR), m_targetVarIdent(std::move(targetVarIdent)), m_targetVarIdentAsType(targetVarIdentAsType), m_properties(std::move(properties)) {}
         void abstract() const override {}
 
         const any& TargetVarIdent() const { return m_targetVarIdent; }
         const bool& TargetVarIdentAsType() const { return m_targetVarIdentAsType; }
         const std::vector<Property>& Properties() const { return m_properties; }
     private:
-        const any& m_targetVarIdent;
-        const bool& m_targetVarIdentAsType;
-        const std::vector<Property>& m_properties;
+        any m_targetVarIdent;
+        bool m_targetVarIdentAsType;
+        std::vector<Property> m_properties;
     };
 
     class MemberExpr : public Expr
     {
     public:
-        MemberExpr(const Expr& object, const Expr& property) : Expr(NodeType::MEMBER_EXPR), m_object(object), m_property(property) {}
+        MemberExpr(std::unique_ptr<Expr> object, std::unique_ptr<Expr> property) : Expr(NodeType::MEMBER_EXPR), m_object(std::move(object)), m_property(std::move(property)) {}
         void abstract() const override {}
 
-        const Expr& Object() const { return m_object; }
-        const Expr& Property() const { return m_property; }
+        const Expr& Object() const { return *m_object; }
+        const Expr& Property() const { return *m_property; }
     private:
-        const Expr& m_object;
-        const Expr& m_property;
+        std::unique_ptr<Expr> m_object;
+        std::unique_ptr<Expr> m_property;
     };
 
     class UnaryExpr : public Expr
     {
     public:
-        UnaryExpr(const Expr& object, const string& operator_) : Expr(NodeType::UNARY_EXPR), m_object(object), m_operator(operator_) {}
+        UnaryExpr(std::unique_ptr<Expr> object, string operator_) : Expr(NodeType::UNARY_EXPR), m_object(std::move(object)), m_operator(std::move(operator_)) {}
         void abstract() const override {}
 
-        const Expr& Object() const { return m_object; }
+        const Expr& Object() const { return *m_object; }
         const string& Operator() const { return m_operator; }
     private:
-        const Expr& m_object;
-        const string& m_operator;
+        std::unique_ptr<Expr> m_object;
+        string m_operator;
+    };
+
+    class AwaitExpr : public Expr
+    {
+    public:
+        AwaitExpr(std::unique_ptr<Expr> value) : Expr(NodeType::AWAIT_EXPR), m_value(std::move(value)) {}
+        void abstract() const override {}
+
+        const Expr& Value() const { return *m_value; }
+    private:
+        std::unique_ptr<Expr> m_value;
     };
 
     class Identifier : public Expr
     {
     public:
-        Identifier(const string& symbol) : Expr(NodeType::IDENTIFIER), m_symbol(symbol) {}
+        Identifier(string symbol) : Expr(NodeType::IDENTIFIER), m_symbol(std::move(symbol)) {}
         void abstract() const override {}
 
         const string& Symbol() const { return m_symbol; }
     private:
-        const string& m_symbol;
+        string m_symbol;
     };
 
     class LambdaExpr : public Expr
     {
     public:
-        LambdaExpr(const std::vector<Identifier>& paramIdents, const std::vector<std::unique_ptr<Stmt>>& body, const bool& instantReturn) : Expr(NodeType::LAMBDA_EXPR), m_paramIdents(paramIdents), m_body(body), m_instantReturn(instantReturn) {}
+        LambdaExpr(std::vector<Identifier> paramIdents, std::vector<std::unique_ptr<Stmt>> body, bool instantReturn) : Expr(NodeType::LAMBDA_EXPR), m_paramIdents(std::move(paramIdents)), m_body(std::move(body)), m_instantReturn(instantReturn) {}
         void abstract() const override {}
 
         const std::vector<Identifier>& ParamIdents() const { return m_paramIdents; }
         const std::vector<std::unique_ptr<Stmt>>& Body() const { return m_body; }
         const bool& InstantReturn() const { return m_instantReturn; }
     private:
-        const std::vector<Identifier>& m_paramIdents;
-        const std::vector<std::unique_ptr<Stmt>>& m_body;
-        const bool& m_instantReturn;
+        std::vector<Identifier> m_paramIdents;
+        std::vector<std::unique_ptr<Stmt>> m_body;
+        bool m_instantReturn;
     };
 
     class ArrayLiteral : public Expr
     {
     public:
-        ArrayLiteral(const std::vector<std::unique_ptr<Expr>>& value) : Expr(NodeType::ARRAY_LITERAL), m_value(value) {}
+        ArrayLiteral(std::vector<std::unique_ptr<Expr>> value) : Expr(NodeType::ARRAY_LITERAL), m_value(std::move(value)) {}
         void abstract() const override {}
 
         const std::vector<std::unique_ptr<Expr>>& Value() const { return m_value; }
     private:
-        const std::vector<std::unique_ptr<Expr>>& m_value;
+        std::vector<std::unique_ptr<Expr>> m_value;
     };
 
     class NumericLiteral : public Expr
     {
     public:
-        NumericLiteral(const int& value) : Expr(NodeType::NUMERIC_LITERAL), m_value(value) {}
+        NumericLiteral(int value) : Expr(NodeType::NUMERIC_LITERAL), m_value(value) {}
         void abstract() const override {}
 
         const int& Value() const { return m_value; }
     private:
-        const int& m_value;
+        int m_value;
     };
 
     class FloatLiteral : public Expr
     {
     public:
-        FloatLiteral(const float& value) : Expr(NodeType::FLOAT_LITERAL), m_value(value) {}
+        FloatLiteral(float value) : Expr(NodeType::FLOAT_LITERAL), m_value(value) {}
         void abstract() const override {}
 
         const float& Value() const { return m_value; }
     private:
-        const float& m_value;
+        float m_value;
     };
 
     class DoubleLiteral : public Expr
     {
     public:
-        DoubleLiteral(const double& value) : Expr(NodeType::DOUBLE_LITERAL), m_value(value) {}
+        DoubleLiteral(double value) : Expr(NodeType::DOUBLE_LITERAL), m_value(value) {}
         void abstract() const override {}
 
         const double& Value() const { return m_value; }
     private:
-        const double& m_value;
+        double m_value;
     };
 
     class StringLiteral : public Expr
     {
     public:
-        StringLiteral(const string& value) : Expr(NodeType::STRING_LITERAL), m_value(value) {}
+        StringLiteral(string value) : Expr(NodeType::STRING_LITERAL), m_value(std::move(value)) {}
         void abstract() const override {}
 
         const string& Value() const { return m_value; }
     private:
-        const string& m_value;
+        string m_value;
     };
 
     class CharLiteral : public Expr
     {
     public:
-        CharLiteral(const char& value) : Expr(NodeType::CHAR_LITERAL), m_value(value) {}
+        CharLiteral(char value) : Expr(NodeType::CHAR_LITERAL), m_value(value) {}
         void abstract() const override {}
 
         const char& Value() const { return m_value; }
     private:
-        const char& m_value;
+        char m_value;
     };
 
     class Property : public Expr
     {
     public:
-        Property(const string& key, const optional<Types::Type> type, const std::optional<std::unique_ptr<Expr>> value) : Expr(NodeType::PROPERTY), m_key(key), m_type(type), m_value(value) {}
+        Property(string key, std::optional<Types::Type> type, std::optional<std::unique_ptr<Expr>> value) : Expr(NodeType::PROPERTY), m_key(std::move(key)), m_type(std::move(type)), m_value(std::move(value)) {}
         void abstract() const override {}
 
         const string& Key() const { return m_key; }
-        const optional<Types::Type> Type() const { return m_type; }
+        const std::optional<Types::Type> Type() const { return m_type; }
         const std::optional<std::unique_ptr<Expr>>& Value() const { return m_value; }
     private:
-        const string& m_key;
-        const optional<Types::Type> m_type;
-        const std::optional<std::unique_ptr<Expr>>& m_value;
+        string m_key;
+        std::optional<Types::Type> m_type;
+        std::optional<std::unique_ptr<Expr>> m_value;
     };
 }
\ No newline at end of file
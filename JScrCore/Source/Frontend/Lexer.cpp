@@ -22,9 +22,11 @@ namespace JScr::Frontend
 		{ "delete", TokenType::DELETE },
 		{ "import", TokenType::IMPORT },
 		{ "as", TokenType::AS },
+		{ "async", TokenType::ASYNC },
+		{ "await", TokenType::AWAIT },
 	};
 
-	std::map<Lexer::Token, Range>& Lexer::Tokenize(const std::string& filedir)
+	std::vector<std::pair<Lexer::Token, Range>> Lexer::Tokenize(const std::string& filedir)
 	{
 		std::ifstream file(filedir);
 
@@ -33,7 +35,7 @@ namespace JScr::Frontend
 			throw std::runtime_error("Failed to open input file at \"" + filedir + "\".");
 		}
 
-		std::map<Lexer::Token, Range> tokens = {};
+		std::vector<std::pair<Lexer::Token, Range>> tokens = {};
 
 		unsigned int line = 1, col = 0;
 
@@ -65,7 +67,8 @@ namespace JScr::Frontend
 
 		std::function<void(Lexer::Token)> Push = [&](Lexer::Token tk)
 		{
-			tokens.insert({ std::move(tk), Range(Vector2i(line, col), Vector2i(line, col + tk.Value().length())) });
+			Range range(Vector2i(line, col), Vector2i(line, col + tk.Value().length()));
+			tokens.emplace_back(std::move(tk), range);
 		};
 
 		// Will return true if this is the beginning or the end of a comment.
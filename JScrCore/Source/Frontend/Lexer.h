@@ -1,6 +1,6 @@
 #pragma once
 #include <unordered_map>
-#include <map>
+#include <vector>
 #include <string>
 #include <fstream>
 #include <functional>
@@ -33,6 +33,7 @@ namespace JScr::Frontend
             IF, ELSE, WHILE, FOR,
             OBJECT, ANNOTATION_OBJECT, ENUM,
             DELETE, IMPORT, AS,
+            ASYNC, AWAIT,
 
             // Grouping and Operators
             BINARY_OPERATOR,
@@ -80,7 +81,8 @@ namespace JScr::Frontend
             return c >= bounds[0] && c <= bounds[1];
         }
 
-        static std::map<Lexer::Token, Range>& Tokenize(const std::string& filedir);
+        // Tokens in source order, each with its position.
+        static std::vector<std::pair<Lexer::Token, Range>> Tokenize(const std::string& filedir);
 
 	private:
 		Lexer() {}
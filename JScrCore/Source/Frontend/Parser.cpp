@@ -4,9 +4,14 @@ namespace JScr::Frontend
 {
 	Program Parser::ProduceAST(string filedir)
 	{
-		auto& tokenDictionary = Lexer::Tokenize(filedir);
-		m_tokens = MapUtils::KeysOf(tokenDictionary);
-		m_linesAndCols = MapUtils::ValuesOf(tokenDictionary);
+		auto tokens = Lexer::Tokenize(filedir);
+		m_tokens.clear();
+		m_linesAndCols.clear();
+		for (auto& [token, range] : tokens)
+		{
+			m_tokens.push_back(std::move(token));
+			m_linesAndCols.push_back(range);
+		}
 		m_linesAndCols.push_back(m_linesAndCols.back()); // <-- Add duplicate of last item to prevent index out of range exception if syntax error on last token.
 	
 		auto program = Program(filedir, vector<std::unique_ptr<Stmt>>());
@@ -30,6 +35,7 @@ namespace JScr::Frontend
             return ParseImportStmt();
         case Lexer::TokenType::EXPORT:
         case Lexer::TokenType::CONST:
+        case Lexer::TokenType::ASYNC:
         case Lexer::TokenType::ANNOTATION_OBJECT:
         case Lexer::TokenType::OBJECT:
         case Lexer::TokenType::ENUM:
@@ -92,10 +98,13 @@ namespace JScr::Frontend
         }
 
         Expect(Lexer::TokenType::SEMICOLON, "Semicolon expected after import statement.");
-        return std::make_unique<ImportStmt>(ImportStmt(target, alias.value()));
+        if (alias == nullopt)
+            ThrowSyntaxError("Imports must be given a name with `as`.");
+
+        return std::make_unique<ImportStmt>(std::move(target), std::move(alias.value()));
     }
 
-    Parser::ParseTypeCtx& Parser::ParseType()
+    std::unique_ptr<Parser::ParseTypeCtx> Parser::ParseType()
     {
         auto annotations = vector<AnnotationUsageDeclaration>();
         optional<Lexer::Token> enumOrObjTk = nullopt;
@@ -103,6 +112,7 @@ namespace JScr::Frontend
         vector<Lexer::Token> functionTypeListTk = {};
         bool constant = false;
         bool exported = false;
+        bool async = false;
 
         // Annotations
         while (At().Type() == Lexer::TokenType::AT)
@@ -117,7 +127,7 @@ namespace JScr::Frontend
                 args = ParseArgs();
             }
 
-            annotations.push_back(AnnotationUsageDeclaration(identifier.Value(), args));
+            annotations.push_back(AnnotationUsageDeclaration(identifier.Value(), std::move(args)));
         }
 
         function<bool()> IsType = [&]()
@@ -129,6 +139,7 @@ namespace JScr::Frontend
                ((At().Type() == Lexer::TokenType::ANNOTATION_OBJECT || At().Type() == Lexer::TokenType::OBJECT || At().Type() == Lexer::TokenType::ENUM) && enumOrObjTk == nullopt) ||
                (At().Type() == Lexer::TokenType::CONST && !constant) ||
                (At().Type() == Lexer::TokenType::EXPORT && !exported) ||
+               (At().Type() == Lexer::TokenType::ASYNC && !async) ||
                (At().Type() == Lexer::TokenType::FUNCTION && functionTypeListTk.empty())
               )
         {
@@ -145,7 +156,7 @@ namespace JScr::Frontend
                 {
                     Eat();
                     Expect(Lexer::TokenType::CLOSE_BRACKET, "Closing bracket expected after open bracket in array declaration.");
-                    type.emplace(Lexer::Token(type.value().Value(), Lexer::TokenType::TYPE));
+                    type.emplace(Lexer::Token(type.value().Value() + "[]", Lexer::TokenType::TYPE));
                 }
                 continue;
             }
@@ -160,6 +171,12 @@ namespace JScr::Frontend
                 exported = true;
                 continue;
             }
+            else if (At().Type() == Lexer::TokenType::ASYNC)
+            {
+                Eat();
+                async = true;
+                continue;
+            }
             else if (At().Type() == Lexer::TokenType::FUNCTION)
             {
                 Eat();
@@ -174,6 +191,7 @@ namespace JScr::Frontend
 
                 while (At().Type() == Lexer::TokenType::COMMA)
                 {
+                    Eat();
                     functionTypeListTk.push_back(Expect(Lexer::TokenType::TYPE, "Type expected in lambda function declaration keyword."));
                 }
 
@@ -200,53 +218,54 @@ namespace JScr::Frontend
 
         if (enumOrObjTk != nullopt)
         {
-            auto v = ParseTypeCtxObjOrEnum(constant, exported, enumOrObjTk.value(), Types::FromString(type.value().Value()), annotations);
-            return v;
+            if (async)
+                ThrowSyntaxError("Cannot declare enum or object as async.");
+
+            return std::make_unique<ParseTypeCtxObjOrEnum>(constant, exported, enumOrObjTk.value(), Types::FromString(type.value().Value()), std::move(annotations));
         }
-            
-    
-        auto v = ParseTypeCtxVar(constant, exported, Types::FromString(type.value().Value()).CopyWithLambdaTypes(functionTypeList), annotations);
-        return v;
+
+        return std::make_unique<ParseTypeCtxVar>(constant, exported, Types::FromString(type.value().Value()).CopyWithLambdaTypes(functionTypeList), std::move(annotations), async);
     }
 
     std::unique_ptr<Stmt> Parser::ParseTypePost()
     {
-        auto& type = ParseType();
+        auto type = ParseType();
 
-        if (typeid(type) == typeid(ParseTypeCtxObjOrEnum))
+        if (typeid(*type) == typeid(ParseTypeCtxObjOrEnum))
         {
-            const auto* tp = dynamic_cast<const ParseTypeCtxObjOrEnum*>(&type);
+            auto* tp = dynamic_cast<ParseTypeCtxObjOrEnum*>(type.get());
             
             if (tp->IsConstant())
                 ThrowSyntaxError("Cannot declare enum or object as constant.");
 
             if (tp->getType().Type() == Lexer::TokenType::OBJECT)
-                return ParseObjectStmt(tp->GetAnnotations(), tp->getIdentifierT().Data());
+                return ParseObjectStmt(std::move(tp->GetAnnotations()), tp->getIdentifierT().Data());
             if (tp->getType().Type() == Lexer::TokenType::ANNOTATION_OBJECT)
-                return ParseObjectStmt(tp->GetAnnotations(), tp->getIdentifierT().Data(), true);
+                return ParseObjectStmt(std::move(tp->GetAnnotations()), tp->getIdentifierT().Data(), true);
             else if (tp->getType().Type() == Lexer::TokenType::ENUM)
-                return ParseEnumStmt(tp->GetAnnotations(), tp->getIdentifierT().Data());
+                return ParseEnumStmt(std::move(tp->GetAnnotations()), tp->getIdentifierT().Data());
 
             ThrowSyntaxError("Internal Error: Invalid type.");
         }
 
         // Get identifier
         auto identifier = Expect(Lexer::TokenType::IDENTIFIER, "Expected identifier after type for function/variable declarations.");
-        const auto* typeAsVar = dynamic_cast<const ParseTypeCtxVar*>(&type);
+        auto* typeAsVar = dynamic_cast<ParseTypeCtxVar*>(type.get());
 
         // Return: Function
         if (At().Type() == Lexer::TokenType::OPEN_PAREN)
         {
-            if (type.IsConstant()) ThrowSyntaxError("Functions cannot be declared constant.");
-            return ParseFnDeclaration(*typeAsVar, identifier);
+            if (type->IsConstant()) ThrowSyntaxError("Functions cannot be declared constant.");
+            return ParseFnDeclaration(std::move(*typeAsVar), identifier);
         }
 
-        return ParseVarDeclaration(*typeAsVar, identifier);
+        if (typeAsVar->IsAsync()) ThrowSyntaxError("Only functions can be declared async.");
+        return ParseVarDeclaration(std::move(*typeAsVar), identifier);
     }
 
     std::unique_ptr<Stmt> Parser::ParseFnDeclaration(ParseTypeCtxVar type, Lexer::Token name)
     {
-        auto& args = ParseDeclarativeArgs();
+        auto args = ParseDeclarativeArgs();
         for (const auto& arg : args)
         {
             if (arg.Kind() != NodeType::VAR_DECLARATION)
@@ -272,11 +291,10 @@ namespace JScr::Frontend
             body.push_back(ParseStmt());
         }
 
-        auto fn = FunctionDeclaration(type.GetAnnotations(), type.IsExported(), args, name.Value(), type.getType(), body, instaRet);
-        return std::make_unique<FunctionDeclaration>(fn);
+        return std::make_unique<FunctionDeclaration>(std::move(type.GetAnnotations()), type.IsExported(), std::move(args), name.Value(), type.getType(), std::move(body), instaRet, type.IsAsync());
     }
 
-    vector<VarDeclaration>& Parser::ParseDeclarativeArgs()
+    vector<VarDeclaration> Parser::ParseDeclarativeArgs()
     {
         m_outline++;
 
@@ -288,7 +306,7 @@ namespace JScr::Frontend
         return args;
     }
 
-    vector<VarDeclaration>& Parser::ParseDeclarativeArgsList()
+    vector<VarDeclaration> Parser::ParseDeclarativeArgsList()
     {
         auto ParseParamVar = [&]()
         {
@@ -297,13 +315,15 @@ namespace JScr::Frontend
             if (stmt->Kind() != NodeType::VAR_DECLARATION)
                 ThrowSyntaxError("Variable declaration expected inside declarative parameters list.");
 
-            return *(dynamic_cast<const VarDeclaration*>(&*stmt));
+            return std::move(*static_cast<VarDeclaration*>(stmt.get()));
         };
 
-        vector<VarDeclaration> args = { ParseParamVar() };
+        vector<VarDeclaration> args;
+        args.push_back(ParseParamVar());
 
         while (At().Type() == Lexer::TokenType::COMMA)
         {
+            Eat();
             args.push_back(ParseParamVar());
         }
 
@@ -317,7 +337,7 @@ namespace JScr::Frontend
             if (type.IsConstant())
                 ThrowSyntaxError("Must assign value to constant expression. No value provided.");
 
-            return VarDeclaration(type.GetAnnotations(), false, type.IsExported(), type.getType(), name.Value(), nullopt);
+            return VarDeclaration(std::move(type.GetAnnotations()), false, type.IsExported(), type.getType(), name.Value(), nullopt);
         };
 
         if (m_outline == 0 && At().Type() == Lexer::TokenType::SEMICOLON)
@@ -335,16 +355,16 @@ namespace JScr::Frontend
         if (At().Type() == Lexer::TokenType::EQUALS)
         {
             Eat();
-            declaration = std::make_unique<VarDeclaration>(VarDeclaration(type.GetAnnotations(), type.IsConstant(), type.IsExported(), type.getType(), name.Value(), std::make_optional<std::unique_ptr<Expr>>(ParseExpr())));
+            declaration = std::make_unique<VarDeclaration>(std::move(type.GetAnnotations()), type.IsConstant(), type.IsExported(), type.getType(), name.Value(), ParseExpr());
         }
         else
         {
-            declaration = std::make_unique<VarDeclaration>(VarDeclaration(type.GetAnnotations(), type.IsConstant(), type.IsExported(), type.getType(), name.Value(), std::make_optional<std::unique_ptr<Expr>>(ParseObjectConstructorExpr(type.getType(), true))));
+            declaration = std::make_unique<VarDeclaration>(std::move(type.GetAnnotations()), type.IsConstant(), type.IsExported(), type.getType(), name.Value(), ParseObjectConstructorExpr(type.getType(), true));
         }
         if (m_outline <= 1) Expect(Lexer::TokenType::SEMICOLON, "Outline variable declaration statement must end with semicolon.");
         m_outline--;
 
-        return std::move(declaration);
+        return declaration;
     }
 
     std::unique_ptr<Stmt> Parser::ParseObjectStmt(vector<AnnotationUsageDeclaration> annotations, std::string typeIdent, bool annotation)
@@ -359,10 +379,10 @@ namespace JScr::Frontend
             auto type = ParseType();
             auto key = Expect(Lexer::TokenType::IDENTIFIER, "Object declaration key expected.").Value();
 
-            if (typeid(type) == typeid(ParseTypeCtxObjOrEnum))
+            if (typeid(*type) == typeid(ParseTypeCtxObjOrEnum))
                 ThrowSyntaxError("Cannot declare enum or object inside object declaration.");
 
-            const auto* typeAsVar = dynamic_cast<const ParseTypeCtxVar*>(&type);
+            const auto* typeAsVar = dynamic_cast<const ParseTypeCtxVar*>(type.get());
 
             // Allows shorthand key: pair -> { key, }.
             if (At().Type() == Lexer::TokenType::COMMA)
@@ -382,7 +402,7 @@ namespace JScr::Frontend
             Expect(Lexer::TokenType::COLON, "Missing colon following identifier in ObjectExpr.");
             auto value = ParseExpr();
 
-            objectProperties.push_back(Property(key, typeAsVar->getType(), std::optional<std::unique_ptr<Expr>>(std::move(value))));
+            objectProperties.push_back(Property(key, typeAsVar->getType(), std::move(value)));
             if (At().Type() != Lexer::TokenType::CLOSE_BRACE)
             {
                 Expect(Lexer::TokenType::COMMA, "Expected comma or closing bracket following property.");
@@ -391,7 +411,7 @@ namespace JScr::Frontend
         m_outline--;
 
         Expect(Lexer::TokenType::CLOSE_BRACE, "Object declaration missing closing brace.");
-        return std::make_unique<ObjectDeclaration>(ObjectDeclaration(annotations, export_, typeIdent, objectProperties, annotation));
+        return std::make_unique<ObjectDeclaration>(std::move(annotations), export_, typeIdent, std::move(objectProperties), annotation);
     }
 
     std::unique_ptr<Stmt> Parser::ParseEnumStmt(vector<AnnotationUsageDeclaration> annotations, std::string typeIdent)
@@ -426,7 +446,7 @@ namespace JScr::Frontend
         m_outline--;
 
         Expect(Lexer::TokenType::CLOSE_BRACE, "Enum declaration missing closing brace.");
-        return std::make_unique<EnumDeclaration>(EnumDeclaration(annotations, export_, typeIdent, objectProperties));
+        return std::make_unique<EnumDeclaration>(std::move(annotations), export_, typeIdent, std::move(objectProperties));
     }
 
     std::unique_ptr<Stmt> Parser::ParseReturnStmt()
@@ -434,11 +454,11 @@ namespace JScr::Frontend
         Eat();
 
         m_outline++;
-        auto val = ReturnDeclaration(*ParseExpr());
+        auto val = std::make_unique<ReturnDeclaration>(ParseExpr());
         Expect(Lexer::TokenType::SEMICOLON, "Return statement must end with semicolon.");
         m_outline--;
 
-        return std::make_unique<ReturnDeclaration>(val);
+        return val;
     }
 
     std::unique_ptr<Stmt> Parser::ParseDeleteStmt()
@@ -446,11 +466,11 @@ namespace JScr::Frontend
         Eat();
 
         m_outline++;
-        auto val = DeleteDeclaration(Expect(Lexer::TokenType::IDENTIFIER, "Delete identifier expected.").Value());
+        auto val = std::make_unique<DeleteDeclaration>(Expect(Lexer::TokenType::IDENTIFIER, "Delete identifier expected.").Value());
         Expect(Lexer::TokenType::SEMICOLON, "Delete statement must end with semicolon.");
         m_outline--;
 
-        return std::make_unique<DeleteDeclaration>(val);
+        return val;
     }
 
     std::unique_ptr<Stmt> Parser::ParseIfElseStmt()
@@ -482,7 +502,7 @@ namespace JScr::Frontend
                 body.push_back(ParseStmt());
             }
 
-            return IfElseDeclaration::IfBlock(*condition, body);
+            return IfElseDeclaration::IfBlock(std::move(condition), std::move(body));
         };
 
         vector<IfElseDeclaration::IfBlock> blocks = {};
@@ -490,7 +510,8 @@ namespace JScr::Frontend
 
         blocks.push_back(ParseElseIf());
 
-        if (At().Type() == Lexer::TokenType::ELSE)
+        // Any number of `else if` blocks, optionally closed by an `else`.
+        while (At().Type() == Lexer::TokenType::ELSE)
         {
             Eat();
 
@@ -514,10 +535,11 @@ namespace JScr::Frontend
                 {
                     elseBody.push_back(ParseStmt());
                 }
+                break;
             }
         }
 
-        return std::make_unique<IfElseDeclaration>(IfElseDeclaration(blocks, elseBody));
+        return std::make_unique<IfElseDeclaration>(std::move(blocks), std::move(elseBody));
     }
 
     std::unique_ptr<Stmt> Parser::ParseWhileStmt()
@@ -547,7 +569,7 @@ namespace JScr::Frontend
             body.push_back(ParseStmt());
         }
 
-        return std::make_unique<WhileDeclaration>(WhileDeclaration(*condition, body));
+        return std::make_unique<WhileDeclaration>(std::move(condition), std::move(body));
     }
 
     std::unique_ptr<Stmt> Parser::ParseForStmt()
@@ -585,7 +607,7 @@ namespace JScr::Frontend
             body.push_back(ParseStmt());
         }
 
-        return std::make_unique<ForDeclaration>(ForDeclaration(*variableDecl, *condition, *action, body));
+        return std::make_unique<ForDeclaration>(std::move(variableDecl), std::move(condition), std::move(action), std::move(body));
     }
 
     std::unique_ptr<Expr> Parser::ParseExpr()
@@ -604,15 +626,15 @@ namespace JScr::Frontend
             auto value = ParseAssignmentExpr();
             if (m_outline <= 1) Expect(Lexer::TokenType::SEMICOLON, "Semicolon expected after outline assignment expr.");
             m_outline--;
-            return std::make_unique<AssignmentExpr>(AssignmentExpr(*left, *value));
+            return std::make_unique<AssignmentExpr>(std::move(left), std::move(value));
         }
         else if (At().Type() == Lexer::TokenType::OPEN_BRACE)
         {
             m_outline++;
-            auto value = ParseObjectConstructorExpr(&left);
+            auto value = ParseObjectConstructorExpr(static_cast<const Expr*>(left.get()));
             if (m_outline <= 1) Expect(Lexer::TokenType::SEMICOLON, "Semicolon expected after outline assignment expr.");
             m_outline--;
-            return std::make_unique<AssignmentExpr>(AssignmentExpr(*left, *value));
+            return std::make_unique<AssignmentExpr>(std::move(left), std::move(value));
         }
 
         return std::move(left);
@@ -622,26 +644,12 @@ namespace JScr::Frontend
     {
         auto TargetVarIdentIsIdentifier = [&]()
         {
-            try
-            {
-                // Attempt to cast the std::any content to std::unique_ptr<Expr>
-                auto exprPtr = std::any_cast<std::unique_ptr<Expr>>(targetVariableIdent);
-
-                // Check if the object is an Identifier
-                if (typeid(*exprPtr) == typeid(Identifier))
-                {
-                    return true;
-                }
-            }
-            catch (const std::bad_any_cast& e)
-            {
-                return false;
-            }
-
-            return false;
+            // The assignee stays owned by the assignment; the constructor only looks at it.
+            const auto* exprPtr = std::any_cast<const Expr*>(&targetVariableIdent);
+            return exprPtr != nullptr && (*exprPtr)->Kind() == NodeType::IDENTIFIER;
         };
 
-        // targetVariableIdent can be either a Types::Type or Identifier : Expr.
+        // targetVariableIdent can be either a Types::Type or a const Identifier*.
         if (!tviAsType && !TargetVarIdentIsIdentifier())
         {
             ThrowSyntaxError("Object constructor assignment only works for identifiers.");
@@ -658,7 +666,7 @@ namespace JScr::Frontend
             Expect(Lexer::TokenType::COLON, "Missing colon following identifier in ObjectConstructorExpr.");
             auto value = ParseExpr();
 
-            objectProperties.push_back(Property(key, nullopt, std::optional<std::unique_ptr<Expr>>(std::move(value))));
+            objectProperties.push_back(Property(key, nullopt, std::move(value)));
             if (At().Type() != Lexer::TokenType::CLOSE_BRACE)
             {
                 Expect(Lexer::TokenType::COMMA, "Expected comma or closing bracket following property.");
@@ -666,7 +674,7 @@ namespace JScr::Frontend
         }
 
         Expect(Lexer::TokenType::CLOSE_BRACE, "Object constructor missing closing brace.");
-        return std::make_unique<ObjectConstructorExpr>(ObjectConstructorExpr(targetVariableIdent, tviAsType, objectProperties));
+        return std::make_unique<ObjectConstructorExpr>(std::move(targetVariableIdent), tviAsType, std::move(objectProperties));
     }
 
     std::unique_ptr<Expr> Parser::ParseArrayExpr()
@@ -682,7 +690,7 @@ namespace JScr::Frontend
         while (NotEOF() && At().Type() != Lexer::TokenType::CLOSE_BRACE)
         {
             auto value = ParseExpr();
-            arrayElements.push_back(value);
+            arrayElements.push_back(std::move(value));
             if (At().Type() != Lexer::TokenType::CLOSE_BRACE)
             {
                 Expect(Lexer::TokenType::COMMA, "Expected comma or closing bracket following array element.");
@@ -690,7 +698,7 @@ namespace JScr::Frontend
         }
 
         Expect(Lexer::TokenType::CLOSE_BRACE, "Array literal missing closing brace.");
-        return std::make_unique<ArrayLiteral>(ArrayLiteral(arrayElements));
+        return std::make_unique<ArrayLiteral>(std::move(arrayElements));
     }
 
     std::unique_ptr<Expr> Parser::ParseLambdaFuncExpr()
@@ -711,19 +719,24 @@ namespace JScr::Frontend
                     ThrowSyntaxError("Identifier required as a param in lambda expression.");
                 }
 
-                list.push_back(*(dynamic_cast<const Identifier*>(&*e)));
+                list.push_back(std::move(*static_cast<Identifier*>(e.get())));
             };
 
             m_outline++;
             Eat();
             Expect(Lexer::TokenType::OPEN_PAREN, "Open paren expected in lambda expression.");
             if (At().Type() == Lexer::TokenType::CLOSE_PAREN)
+            {
+                Eat();
+                m_outline--;
                 return list;
+            }
 
             Add(ParsePrimaryExpr());
 
             while (At().Type() == Lexer::TokenType::COMMA)
             {
+                Eat();
                 Add(ParsePrimaryExpr());
             }
 
@@ -755,7 +768,7 @@ namespace JScr::Frontend
             body.push_back(ParseStmt());
         }
 
-        return std::make_unique<LambdaExpr>(LambdaExpr(identList, body, instaret));
+        return std::make_unique<LambdaExpr>(std::move(identList), std::move(body), instaret);
     }
 
     std::unique_ptr<Expr> Parser::ParseBoolExpr()
@@ -765,12 +778,12 @@ namespace JScr::Frontend
         if (At().Type() == Lexer::TokenType::OR && m_tokens[1].Type() == Lexer::TokenType::OR)
         {
             Eat(); Eat();
-            return std::make_unique<EqualityCheckExpr>(EqualityCheckExpr(*left, *ParseBoolExpr(), EqualityCheckExpr::Type::OR));
+            return std::make_unique<EqualityCheckExpr>(std::move(left), ParseBoolExpr(), EqualityCheckExpr::Type::OR);
         } 
         else if (At().Type() == Lexer::TokenType::AND && m_tokens[1].Type() == Lexer::TokenType::AND)
         {
             Eat(); Eat();
-            return std::make_unique<EqualityCheckExpr>(EqualityCheckExpr(*left, *ParseBoolExpr(), EqualityCheckExpr::Type::AND));
+            return std::make_unique<EqualityCheckExpr>(std::move(left), ParseBoolExpr(), EqualityCheckExpr::Type::AND);
         }
 
         return left;
@@ -783,32 +796,32 @@ namespace JScr::Frontend
         if (At().Type() == Lexer::TokenType::EQUALS && m_tokens[1].Type() == Lexer::TokenType::EQUALS)
         {
             Eat(); Eat();
-            return std::make_unique<EqualityCheckExpr>(EqualityCheckExpr(*left, *ParseAdditiveExpr(), EqualityCheckExpr::Type::EQUALS));
+            return std::make_unique<EqualityCheckExpr>(std::move(left), ParseAdditiveExpr(), EqualityCheckExpr::Type::EQUALS);
         }
         else if (At().Type() == Lexer::TokenType::NOT && m_tokens[1].Type() == Lexer::TokenType::EQUALS)
         {
             Eat(); Eat();
-            return std::make_unique<EqualityCheckExpr>(EqualityCheckExpr(*left, *ParseAdditiveExpr(), EqualityCheckExpr::Type::NOT_EQUALS));
-        }
-        else if (At().Type() == Lexer::TokenType::LESS_THAN)
-        {
-            Eat();
-            return std::make_unique<EqualityCheckExpr>(EqualityCheckExpr(*left, *ParseAdditiveExpr(), EqualityCheckExpr::Type::LESS_THAN));
+            return std::make_unique<EqualityCheckExpr>(std::move(left), ParseAdditiveExpr(), EqualityCheckExpr::Type::NOT_EQUALS);
         }
         else if (At().Type() == Lexer::TokenType::LESS_THAN && m_tokens[1].Type() == Lexer::TokenType::EQUALS)
         {
             Eat(); Eat();
-            return std::make_unique<EqualityCheckExpr>(EqualityCheckExpr(*left, *ParseAdditiveExpr(), EqualityCheckExpr::Type::LESS_THAN_OR_EQUALS));
+            return std::make_unique<EqualityCheckExpr>(std::move(left), ParseAdditiveExpr(), EqualityCheckExpr::Type::LESS_THAN_OR_EQUALS);
         }
-        else if (At().Type() == Lexer::TokenType::MORE_THAN)
+        else if (At().Type() == Lexer::TokenType::LESS_THAN)
         {
             Eat();
-            return std::make_unique<EqualityCheckExpr>(EqualityCheckExpr(*left, *ParseAdditiveExpr(), EqualityCheckExpr::Type::MORE_THAN));
+            return std::make_unique<EqualityCheckExpr>(std::move(left), ParseAdditiveExpr(), EqualityCheckExpr::Type::LESS_THAN);
         }
         else if (At().Type() == Lexer::TokenType::MORE_THAN && m_tokens[1].Type() == Lexer::TokenType::EQUALS)
         {
             Eat(); Eat();
-            return std::make_unique<EqualityCheckExpr>(EqualityCheckExpr(*left, *ParseAdditiveExpr(), EqualityCheckExpr::Type::MORE_THAN_OR_EQUALS));
+            return std::make_unique<EqualityCheckExpr>(std::move(left), ParseAdditiveExpr(), EqualityCheckExpr::Type::MORE_THAN_OR_EQUALS);
+        }
+        else if (At().Type() == Lexer::TokenType::MORE_THAN)
+        {
+            Eat();
+            return std::make_unique<EqualityCheckExpr>(std::move(left), ParseAdditiveExpr(), EqualityCheckExpr::Type::MORE_THAN);
         }
 
         return left;
@@ -822,7 +835,7 @@ namespace JScr::Frontend
         {
             auto operator_ = Eat().Value();
             auto right = ParseMultiplicitaveExpr();
-            left.reset(new BinaryExpr(*left, *right, operator_[0]));
+            left = std::make_unique<BinaryExpr>(std::move(left), std::move(right), operator_[0]);
         }
 
         return left;
@@ -836,7 +849,7 @@ namespace JScr::Frontend
         {
             auto operator_ = Eat().Value();
             auto right = ParseUnaryExpr();
-            left.reset(new BinaryExpr(*left, *right, operator_[0]));
+            left = std::make_unique<BinaryExpr>(std::move(left), std::move(right), operator_[0]);
         }
 
         return left;
@@ -851,7 +864,21 @@ namespace JScr::Frontend
         {
             operator_ = Eat().Value();
             obj = ParseCallMemberExpr();
-            return std::make_unique<UnaryExpr>(UnaryExpr(*obj, operator_));
+            return std::make_unique<UnaryExpr>(std::move(obj), operator_);
+        }
+
+        if (At().Type() == Lexer::TokenType::NOT)
+        {
+            operator_ = Eat().Value();
+            obj = ParseUnaryExpr();
+            return std::make_unique<UnaryExpr>(std::move(obj), operator_);
+        }
+
+        if (At().Type() == Lexer::TokenType::AWAIT)
+        {
+            Eat();
+            obj = ParseUnaryExpr();
+            return std::make_unique<AwaitExpr>(std::move(obj));
         }
 
         return ParseCallMemberExpr();
@@ -877,7 +904,7 @@ namespace JScr::Frontend
     {
         m_outline++;
         Expect(Lexer::TokenType::OPEN_BRACKET, "Open bracket expected inside index expression.");
-        std::unique_ptr<Expr> callExpr = std::make_unique<IndexExpr>(IndexExpr(*ParseExpr(), *caller));
+        std::unique_ptr<Expr> callExpr = std::make_unique<IndexExpr>(ParseExpr(), std::move(caller));
         Expect(Lexer::TokenType::CLOSE_BRACKET, "Closing bracket expected inside index expression.");
         m_outline--;
 
@@ -894,7 +921,7 @@ namespace JScr::Frontend
         std::unique_ptr<Expr> callExpr = std::make_unique<CallExpr>(ParseArgs([&]()
         {
             if (m_outline <= 1) Expect(Lexer::TokenType::SEMICOLON, "Semicolon expected after outline call expression.");
-        }), *caller);
+        }), std::move(caller));
 
         if (At().Type() == Lexer::TokenType::OPEN_PAREN)
         {
@@ -916,7 +943,8 @@ namespace JScr::Frontend
         auto args = At().Type() == Lexer::TokenType::CLOSE_PAREN ? vector<std::unique_ptr<Expr>>() : ParseArgumentsList();
 
         Expect(Lexer::TokenType::CLOSE_PAREN, "Expected closing parenthesis inside arguments list.");
-        preEnd.value();
+        if (preEnd)
+            preEnd.value()();
 
         m_outline--;
         return std::move(args);
@@ -924,10 +952,12 @@ namespace JScr::Frontend
 
     vector<std::unique_ptr<Expr>> Parser::ParseArgumentsList()
     {
-        vector<std::unique_ptr<Expr>> args = { ParseAssignmentExpr() };
+        vector<std::unique_ptr<Expr>> args;
+        args.push_back(ParseAssignmentExpr());
 
         while (At().Type() == Lexer::TokenType::COMMA)
         {
+            Eat();
             args.push_back(ParseAssignmentExpr());
         }
 
@@ -946,7 +976,7 @@ namespace JScr::Frontend
             // get identifier
             property = ParsePrimaryExpr();
 
-            object.reset(new MemberExpr(*object, *property));
+            object = std::make_unique<MemberExpr>(std::move(object), std::move(property));
         }
 
         return object;
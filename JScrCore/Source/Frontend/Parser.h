@@ -30,7 +30,8 @@ namespace JScr::Frontend
             virtual ~ParseTypeCtx() = default;
             virtual bool IsConstant() const = 0;
             virtual bool IsExported() const = 0;
-            virtual const std::vector<AnnotationUsageDeclaration>& GetAnnotations() const = 0;
+            // Non-const so the declaration being parsed can take the annotations over.
+            virtual std::vector<AnnotationUsageDeclaration>& GetAnnotations() = 0;
         };
 
         class ParseTypeCtxVar : public ParseTypeCtx
@@ -38,12 +39,13 @@ namespace JScr::Frontend
         private:
             bool m_constant;
             bool m_exported;
+            bool m_async;
             std::vector<AnnotationUsageDeclaration> m_annotations;
             Types::Type m_type;
 
         public:
-            ParseTypeCtxVar(bool constant, bool exported, Types::Type type, const std::vector<AnnotationUsageDeclaration>& annotations)
-                : m_constant(constant), m_exported(exported), m_type(type), m_annotations(annotations)
+            ParseTypeCtxVar(bool constant, bool exported, Types::Type type, std::vector<AnnotationUsageDeclaration> annotations, bool async = false)
+                : m_constant(constant), m_exported(exported), m_async(async), m_annotations(std::move(annotations)), m_type(type)
             {}
 
             bool IsConstant() const override
@@ -56,7 +58,7 @@ namespace JScr::Frontend
                 return m_exported;
             }
 
-            const std::vector<AnnotationUsageDeclaration>& GetAnnotations() const override
+            std::vector<AnnotationUsageDeclaration>& GetAnnotations() override
             {
                 return m_annotations;
             }
@@ -65,6 +67,11 @@ namespace JScr::Frontend
             {
                 return m_type;
             }
+
+            bool IsAsync() const
+            {
+                return m_async;
+            }
         };
 
         class ParseTypeCtxObjOrEnum : public ParseTypeCtx
@@ -77,8 +84,8 @@ namespace JScr::Frontend
             Types::Type m_identifierT;
 
         public:
-            ParseTypeCtxObjOrEnum(bool constant, bool exported, Lexer::Token type, Types::Type identifierT, const std::vector<AnnotationUsageDeclaration>& annotations)
-                : m_constant(constant), m_exported(exported), m_type(type), m_identifierT(identifierT), m_annotations(annotations)
+            ParseTypeCtxObjOrEnum(bool constant, bool exported, Lexer::Token type, Types::Type identifierT, std::vector<AnnotationUsageDeclaration> annotations)
+                : m_constant(constant), m_exported(exported), m_annotations(std::move(annotations)), m_type(type), m_identifierT(identifierT)
             {}
 
             bool IsConstant() const override
@@ -91,7 +98,7 @@ namespace JScr::Frontend
                 return m_exported;
             }
 
-            const std::vector<AnnotationUsageDeclaration>& GetAnnotations() const override
+            std::vector<AnnotationUsageDeclaration>& GetAnnotations() override
             {
                 return m_annotations;
             }
@@ -146,11 +153,11 @@ namespace JScr::Frontend
     private:
         std::unique_ptr<Stmt> ParseStmt();
         std::unique_ptr<Stmt> ParseImportStmt();
-        ParseTypeCtx& ParseType();
+        std::unique_ptr<ParseTypeCtx> ParseType();
         std::unique_ptr<Stmt> ParseTypePost();
         std::unique_ptr<Stmt> ParseFnDeclaration(ParseTypeCtxVar type, Lexer::Token name);
-        vector<VarDeclaration>& ParseDeclarativeArgs();
-        vector<VarDeclaration>& ParseDeclarativeArgsList();
+        vector<VarDeclaration> ParseDeclarativeArgs();
+        vector<VarDeclaration> ParseDeclarativeArgsList();
         std::unique_ptr<Stmt> ParseVarDeclaration(ParseTypeCtxVar type, Lexer::Token name);
         std::unique_ptr<Stmt> ParseObjectStmt(vector<AnnotationUsageDeclaration> annotations, string typeIdent, bool annotation = false);
         std::unique_ptr<Stmt> ParseEnumStmt(vector<AnnotationUsageDeclaration> annotations, string typeIdent);
@@ -39,9 +39,9 @@ namespace JScr::Frontend
             return num;
         }
     private:
-        const std::string& m_filedir;
-        const JScr::Utils::Vector2i& m_begin;
-        const std::uint16_t& m_errCode;
-        const std::string& m_description;
+        std::string m_filedir;
+        JScr::Utils::Vector2i m_begin;
+        std::uint16_t m_errCode;
+        std::string m_description;
 	};
 }
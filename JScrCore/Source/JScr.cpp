@@ -1,65 +1,290 @@
 #include "JScr.h"
+#include <cmath>
+#include <cstdio>
 #include "Frontend/Parser.h"
+#include "Runtime/Compiler.h"
+#include "Runtime/Scheduler.h"
+#include "Runtime/VM.h"
 using namespace JScr::Frontend;
+using namespace JScr::Runtime;
 
 namespace JScr
 {
-	Script::Result::Result(Script* script, const std::vector<SyntaxException>& errors) : errors(errors), script(script) {
+	Script::Result::Result(Script* script, const std::vector<SyntaxException>& errors) : script(script), errors(errors) {
         // Check that if script is null, errors must have more than zero items
         if (script == nullptr && (errors.size() == 0))
         {
-            throw new std::invalid_argument("If script is null, errors must have more than zero items");
+            throw std::invalid_argument("If script is null, errors must have more than zero items");
         }
 
         // Check that if script is not null, errors must be empty
         if (script != nullptr && errors.size() > 0)
         {
-            throw new std::invalid_argument("If script is not null, errors must be empty");
+            throw std::invalid_argument("If script is not null, errors must be empty");
         }
 	}
 
     Script::Result Script::FromFile(const std::string& filedir, const std::vector<ExternalResource>& externals = {})
     {
-        Script script{};
+        Script* script = new Script();
         std::vector<SyntaxException> errors = {};
 
-        script.m_filedir = filedir;
-        script.m_resources = externals;
+        script->m_filedir = filedir;
+        *script->m_resources = externals;
 
-        BuildStandardLibraryResources(script);
+        BuildStandardLibraryResources(*script);
 
         try
         {
             Parser parser{};
-            script.m_program.emplace(parser.ProduceAST(script.m_filedir));
+            // Only the compiled module is kept, the syntax tree goes away with the program.
+            Program program = parser.ProduceAST(script->m_filedir);
+            HostFunctions hosts;
+            for (const ExternalResource& resource : *script->m_resources)
+                hosts.insert(hosts.end(), resource.GetFunctions().begin(), resource.GetFunctions().end());
+            script->m_module = Compiler::Compile(program, hosts);
         }
         catch (SyntaxException e)
         {
             errors.push_back(e);
         }
 
-        return Script::Result(errors.size() < 1 ? &script : NULL, errors);
+        if (errors.size() > 0)
+        {
+            delete script;
+            script = NULL;
+        }
+
+        return Script::Result(script, errors);
+    }
+
+    Script::Result Script::FromCompiled(const Aot::CompiledScript& compiled, const std::vector<ExternalResource>& externals = {})
+    {
+        Script* script = new Script();
+
+        script->m_filedir = compiled.fileDir;
+        *script->m_resources = externals;
+        script->m_compiled = &compiled;
+
+        BuildStandardLibraryResources(*script);
+
+        return Script::Result(script, {});
     }
 
-    void Script::Execute(const std::function<void(int)>& endCallback, bool anotherThread = true)
+    std::future<int> Script::Execute(const std::function<void(int)>& endCallback, bool anotherThread = true)
     {
-        if (!m_program.has_value()) throw "Cannot execute script while 'm_program' is null! The script needs to be initialised first.";
-        else if (m_isRunning) throw "Cannot execute script while it already is running.";
+        if (!m_module && m_compiled == nullptr) throw RuntimeException("Cannot execute script while 'm_module' is null! The script needs to be initialised first.");
+        else if (m_isRunning->exchange(true)) throw RuntimeException("Cannot execute script while it already is running.");
+
+        if (!anotherThread)
+        {
+            int exitCode = 0;
+            try
+            {
+                exitCode = ScriptContext(*this).Run();
+            }
+            catch (...)
+            {
+                *m_isRunning = false;
+                throw;
+            }
+
+            *m_isRunning = false;
+            endCallback(exitCode);
+
+            std::promise<int> done;
+            done.set_value(exitCode);
+            return done.get_future();
+        }
+
+        // Built here rather than in the job, so that the run no longer needs the script itself.
+        std::shared_ptr<ScriptContext> context;
+        try
+        {
+            context = std::make_shared<ScriptContext>(*this);
+        }
+        catch (...)
+        {
+            *m_isRunning = false;
+            throw;
+        }
+
+        auto promise = std::make_shared<std::promise<int>>();
+        std::future<int> result = promise->get_future();
+        auto done = [isRunning = m_isRunning, endCallback, promise](std::exception_ptr error, int exitCode)
+        {
+            *isRunning = false;
+            if (error)
+            {
+                promise->set_exception(error);
+                return;
+            }
 
-        m_isRunning = true;
+            try
+            {
+                endCallback(exitCode);
+                promise->set_value(exitCode);
+            }
+            catch (...)
+            {
+                promise->set_exception(std::current_exception());
+            }
+        };
+
+        ScriptContext::Submit(context, Scheduler::Shared(), done);
+        return result;
+    }
 
-        //if (anotherThread)
-        //{
-        //    std::future<void> result = std::async(std::launch::async, []() { Interpreter.EvaluateProgram(m_program, m_resources); });
-        //    result.wait();
-        //} else
-        //    Interpreter.EvaluateProgram(m_program, resources);
+    namespace
+    {
+        void Print(Value value)   { std::fputs(VM::ToString(value).c_str(), stdout); }
+        void PrintLn(Value value) { std::puts(VM::ToString(value).c_str()); }
+        std::string ToString(Value value) { return VM::ToString(value); }
 
-        m_isRunning = false;
+        double Sqrt(double x)            { return std::sqrt(x); }
+        double Pow(double x, double y)   { return std::pow(x, y); }
+        double Floor(double x)           { return std::floor(x); }
+        double Ceil(double x)            { return std::ceil(x); }
+        double Round(double x)           { return std::round(x); }
+        double Abs(double x)             { return std::abs(x); }
+        double Sin(double x)             { return std::sin(x); }
+        double Cos(double x)             { return std::cos(x); }
+        double Tan(double x)             { return std::tan(x); }
+        double Atan2(double y, double x) { return std::atan2(y, x); }
+        double Exp(double x)             { return std::exp(x); }
+        double Log(double x)             { return std::log(x); }
     }
 
+    // After the host's own resources, so a host can replace any of these.
     void Script::BuildStandardLibraryResources(Script& script)
     {
+        ExternalResource standard;
+        standard.Bind("print", &Print).Bind("println", &PrintLn).Bind("toString", &ToString)
+            .Bind("sqrt", &Sqrt).Bind("pow", &Pow).Bind("floor", &Floor).Bind("ceil", &Ceil).Bind("round", &Round).Bind("abs", &Abs)
+            .Bind("sin", &Sin).Bind("cos", &Cos).Bind("tan", &Tan).Bind("atan2", &Atan2).Bind("exp", &Exp).Bind("log", &Log);
+        script.m_resources->push_back(std::move(standard));
+    }
+
+    ScriptContext::ScriptContext(const Script& script) : m_compiled(script.m_compiled), m_resources(script.m_resources)
+    {
+        if (script.m_module)
+        {
+            m_vm = std::make_unique<VM>(script.m_module);
+            m_vm->SetFuel(script.m_fuelSlice, script.m_fuelLimit);
+        }
+    }
+
+    ScriptContext::~ScriptContext() = default;
+
+    int ScriptContext::Run()
+    {
+        if (m_compiled != nullptr)
+        {
+            Start();
+            return m_exitCode;
+        }
+
+        // A top level `return <int>;` becomes the exit code.
+        Value result = m_vm->Run();
+        return result.IsInt() ? result.AsInt() : 0;
+    }
+
+    bool ScriptContext::Start()
+    {
+        if (m_compiled != nullptr)
+        {
+            Aot::Dynamic result = m_compiled->run(*m_resources);
+            m_exitCode = result.IsInt() ? result.AsInt() : 0;
+            return true;
+        }
+
+        return m_vm->Start();
+    }
+
+    bool ScriptContext::Poll()
+    {
+        return m_compiled != nullptr || m_vm->Poll();
+    }
+
+    int ScriptContext::ExitCode() const
+    {
+        if (m_compiled != nullptr)
+            return m_exitCode;
+
+        Value result = m_vm->Result();
+        return result.IsInt() ? result.AsInt() : 0;
+    }
+
+    void ScriptContext::SetWakeHandler(std::function<void()> handler)
+    {
+        if (m_vm)
+            m_vm->SetWakeHandler(std::move(handler));
+    }
+
+    bool ScriptContext::Preempted() const
+    {
+        return m_vm && m_vm->Preempted();
+    }
+
+    void ScriptContext::Submit(std::shared_ptr<ScriptContext> context, Scheduler& scheduler, Done done)
+    {
+        if (context->m_queued.exchange(true))
+            throw RuntimeException("Cannot queue a script context that is queued already.");
+
+        scheduler.Submit([context, &scheduler, done]()
+        {
+            // Keeps the context alive while the script waits, and queues the next step once it can go on.
+            context->SetWakeHandler([context, &scheduler, done]()
+            {
+                scheduler.Submit([context, &scheduler, done]() { Advance(context, scheduler, &ScriptContext::Poll, done); });
+            });
+            Advance(context, scheduler, &ScriptContext::Start, done);
+        });
+    }
+
+    std::future<int> ScriptContext::Submit(std::shared_ptr<ScriptContext> context, Scheduler& scheduler)
+    {
+        auto promise = std::make_shared<std::promise<int>>();
+        std::future<int> result = promise->get_future();
+        Submit(std::move(context), scheduler, [promise](std::exception_ptr error, int exitCode)
+        {
+            if (error)
+                promise->set_exception(error);
+            else
+                promise->set_value(exitCode);
+        });
+        return result;
+    }
 
+    void ScriptContext::Advance(const std::shared_ptr<ScriptContext>& context, Scheduler& scheduler, bool (ScriptContext::*step)(), const Done& done)
+    {
+        int exitCode = 0;
+        try
+        {
+            if (!((*context).*step)())
+            {
+                if (context->Preempted())
+                    scheduler.Yield([context, &scheduler, done]() { Advance(context, scheduler, &ScriptContext::Poll, done); });
+                return;
+            }
+            exitCode = context->ExitCode();
+        }
+        catch (...)
+        {
+            context->SetWakeHandler(nullptr);
+            context->m_queued = false;
+            done(std::current_exception(), 0);
+            return;
+        }
+
+        context->SetWakeHandler(nullptr);
+        context->m_queued = false;
+        done(nullptr, exitCode);
+    }
+
+    void ScriptContext::SetFuel(std::uint64_t slice, std::uint64_t limit)
+    {
+        if (m_vm)
+            m_vm->SetFuel(slice, limit);
     }
 }
\ No newline at end of file
@@ -1,19 +1,54 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <fstream>
+#include <functional>
 #include <future>
-#include <optional>
+#include <memory>
 #include <vector>
 #include "Frontend/SyntaxException.h"
 #include "Frontend/Ast.h"
 #include "Frontend/Lexer.h"
 #include "Frontend/Parser.h"
+#include "Runtime/Binding.h"
+#include "Runtime/Bytecode.h"
+#include "Runtime/RuntimeException.h"
+#include "Aot/Runtime.h"
 using namespace JScr::Frontend;
 
+namespace JScr::Runtime
+{
+	class VM;
+	class Scheduler;
+}
+
 namespace JScr
 {
+	// Compiled code, immutable and safe to share between threads.
+	using CompiledProgram = Runtime::Module;
+
+	// What a host gives its scripts. Bind makes a C++ function callable under `name`; calls go through a
+	// trampoline generated for its signature, which converts the arguments straight from the script's
+	// registers. Parameters and results may be bool, int, float, double, char, std::string,
+	// std::string_view (parameters only) and Runtime::Value; a first parameter Runtime::NativeHost&
+	// receives the host. Names the script declares itself hide bound ones.
+	//
+	//     double Hypot(double x, double y) { return std::sqrt(x * x + y * y); }
+	//
+	//     ExternalResource math;
+	//     math.Bind("hypot", &Hypot);
+	//     auto result = Script::FromFile(path, { math });
 	class ExternalResource {
-	private:
+	public:
 		ExternalResource() {}
+
+		template <typename Function>
+		ExternalResource& Bind(std::string name, Function function) { m_functions.push_back(Runtime::Binding::Make(std::move(name), function)); return *this; };
+
+		const Runtime::HostFunctions& GetFunctions() const { return m_functions; };
+
+	private:
+		Runtime::HostFunctions m_functions;
 	};
 
 	class ExternalResourceFile : public ExternalResource
@@ -22,6 +57,8 @@ namespace JScr
 		ExternalResourceFile(const std::vector<std::string>& location, const std::string& internalFile);
 	};
 
+	class ScriptContext;
+
 	class Script
 	{
 	public:
@@ -29,32 +66,110 @@ namespace JScr
 		{
 		public:
 			Script* script;
-			const std::vector<SyntaxException>& errors;
+			const std::vector<SyntaxException> errors;
 			const bool IsSuccess() const { return script != nullptr; };
 
 			Result(Script* script, const std::vector<SyntaxException>& errors);
 		};
 
 		const std::string fileExtension = ".jscr";
+		// About a millisecond of interpreted loop iterations.
+		static constexpr std::uint64_t DefaultFuelSlice = 1 << 20;
 
 	public:
 		const std::string& GetFileDir() { return m_filedir; };
-		const bool& IsRunning() const { return m_isRunning; };
+		bool IsRunning() const { return *m_isRunning; };
 
 		static Result FromFile(const std::string& filedir, const std::vector<ExternalResource>& externals);
+		// A script transpiled ahead of time by jscrc and compiled into the host.
+		static Result FromCompiled(const Aot::CompiledScript& compiled, const std::vector<ExternalResource>& externals);
+
+		// Runs the script and calls `endCallback` with its exit code. With `anotherThread` the run is queued
+		// on Runtime::Scheduler::Shared() with ScriptContext::Submit and the callback comes from one of its
+		// workers; the future is ready once the callback returned, or holds what the script threw. The run
+		// keeps what it needs, so the script may be destroyed before it ends. Throws a RuntimeException
+		// while the previous run has not ended; use a ScriptContext each to run a script several times at once.
+		std::future<int> Execute(const std::function<void(int)>& endCallback, bool anotherThread);
 
-		void Execute(const std::function<void(int)>& endCallback, bool anotherThread);
+		// Fuel for contexts created from now on, see Runtime::VM::SetFuel. A run that used up its slice
+		// goes to the back of its worker's queue, so a long loop cannot hold a worker others wait for.
+		void SetFuel(std::uint64_t slice, std::uint64_t limit) { m_fuelSlice = slice; m_fuelLimit = limit; };
+
+		// Null for scripts compiled ahead of time.
+		std::shared_ptr<const CompiledProgram> GetProgram() const { return m_module; };
 
 	private:
+		friend class ScriptContext;
+
 		static void BuildStandardLibraryResources(Script& script);
 
 	private:
 		std::string m_filedir;
-		bool m_isRunning = false;
-		std::optional<Program> m_program = std::nullopt;
+		// Shared with a run on another thread, which may outlive the script.
+		std::shared_ptr<std::atomic<bool>> m_isRunning = std::make_shared<std::atomic<bool>>(false);
+		std::shared_ptr<const CompiledProgram> m_module = nullptr;
+		const Aot::CompiledScript* m_compiled = nullptr;
+		std::uint64_t m_fuelSlice = DefaultFuelSlice;
+		std::uint64_t m_fuelLimit = 0;
 
-		std::vector<ExternalResource> m_resources;
+		// Shared with every context, which scripts compiled ahead of time resolve their host calls against.
+		std::shared_ptr<std::vector<ExternalResource>> m_resources = std::make_shared<std::vector<ExternalResource>>();
 
 		Script() {}
 	};
+
+	// The state of one run of a script: its globals, heap and stack. The compiled program is shared, not
+	// copied, so a context is cheap enough to keep one per entity. A context runs on one thread at a time,
+	// but any number of contexts of the same script may run at once on different threads.
+	class ScriptContext
+	{
+	public:
+		explicit ScriptContext(const Script& script);
+		~ScriptContext();
+
+		ScriptContext(const ScriptContext&) = delete;
+		ScriptContext& operator=(const ScriptContext&) = delete;
+
+		// Runs the top level code and returns its exit code. Globals keep their values between runs.
+		int Run();
+
+		// Run in steps, for hosts that keep many scripts waiting for I/O on a few threads: Start runs the
+		// top level code until it is done or awaits host work, Poll continues once that work completed.
+		// Both return true when the script is done and ExitCode is ready.
+		bool Start();
+		bool Poll();
+		int ExitCode() const;
+		// Called on the thread that completes the host work a waiting script needs, which should then
+		// arrange for Poll to be called.
+		void SetWakeHandler(std::function<void()> handler);
+		// Whether the last Start or Poll returned because the script used up its fuel slice; Poll again
+		// once others had their turn. Scripts compiled ahead of time are not metered.
+		bool Preempted() const;
+		void SetFuel(std::uint64_t slice, std::uint64_t limit);
+
+		// Null for scripts compiled ahead of time.
+		Runtime::VM* GetVM() { return m_vm.get(); };
+
+		// What a queued run reports once it ended: what it threw, or else its exit code.
+		using Done = std::function<void(std::exception_ptr, int)>;
+
+		// Queues a run of the context on `scheduler` and calls `done` from one of its workers. The run
+		// holds no worker while it awaits host work, and goes to the back of its worker's queue when it
+		// used up its fuel slice. Queue each context of a script separately to run them side by side.
+		// Throws a RuntimeException when the context is queued already.
+		static void Submit(std::shared_ptr<ScriptContext> context, Runtime::Scheduler& scheduler, Done done);
+		// The same, with the exit code or what the run threw in the future.
+		static std::future<int> Submit(std::shared_ptr<ScriptContext> context, Runtime::Scheduler& scheduler);
+
+	private:
+		// Runs `step` of a queued context, and reports the end of the run to `done` once there is one.
+		static void Advance(const std::shared_ptr<ScriptContext>& context, Runtime::Scheduler& scheduler, bool (ScriptContext::*step)(), const Done& done);
+
+	private:
+		std::unique_ptr<Runtime::VM> m_vm;
+		const Aot::CompiledScript* m_compiled = nullptr;
+		std::shared_ptr<const std::vector<ExternalResource>> m_resources;
+		int m_exitCode = 0;
+		std::atomic<bool> m_queued = false;
+	};
 }
\ No newline at end of file
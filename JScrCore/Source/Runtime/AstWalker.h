@@ -0,0 +1,232 @@
+#pragma once
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../Frontend/Ast.h"
+
+using namespace JScr::Frontend;
+
+namespace JScr::Runtime
+{
+    // Walks statements the way the Compiler scopes them and reports every identifier that refers to a
+    // variable. The analyses over the AST derive from it and override the hooks they need.
+    class AstWalker
+    {
+    public:
+        enum class Use
+        {
+            Read, Call, Write
+        };
+
+        virtual ~AstWalker() = default;
+
+        void Statements(std::span<const std::unique_ptr<Stmt>> statements)
+        {
+            for (const auto& stmt : statements)
+                Statement(*stmt);
+        }
+
+        void Statement(const Stmt& stmt)
+        {
+            switch (stmt.Kind())
+            {
+            case NodeType::VAR_DECLARATION:
+            {
+                const auto& decl = static_cast<const VarDeclaration&>(stmt);
+                if (decl.Value().has_value() && decl.Value().value())
+                    Expression(*decl.Value().value());
+                Declare(decl.Identifier());
+                break;
+            }
+            case NodeType::FUNCTION_DECLARATION:
+            {
+                const auto& fn = static_cast<const FunctionDeclaration&>(stmt);
+                Declare(fn.Identifier());
+
+                std::vector<std::string> params;
+                for (const auto& param : fn.Parameters())
+                    params.push_back(param.Identifier());
+                Function(params, fn.Body());
+                break;
+            }
+            case NodeType::RETURN_DECLARATION:
+                Expression(static_cast<const ReturnDeclaration&>(stmt).Value());
+                break;
+            case NodeType::DELETE_DECLARATION:
+                Reference(static_cast<const DeleteDeclaration&>(stmt).Value(), Use::Write);
+                break;
+            case NodeType::IF_ELSE_DECLARATION:
+            {
+                const auto& ifElse = static_cast<const IfElseDeclaration&>(stmt);
+                for (const auto& block : ifElse.Blocks())
+                {
+                    Expression(block.Condition());
+                    Block(block.Body());
+                }
+                Block(ifElse.ElseBody());
+                break;
+            }
+            case NodeType::WHILE_DECLARATION:
+            {
+                const auto& loop = static_cast<const WhileDeclaration&>(stmt);
+                Expression(loop.Condition());
+                Block(loop.Body());
+                break;
+            }
+            case NodeType::FOR_DECLARATION:
+            {
+                const auto& loop = static_cast<const ForDeclaration&>(stmt);
+                m_scopes.emplace_back();
+                Statement(loop.Declaration());
+                Expression(loop.Condition());
+                Block(loop.Body());
+                Expression(loop.Action());
+                m_scopes.pop_back();
+                break;
+            }
+            default:
+                if (const auto* expr = dynamic_cast<const Expr*>(&stmt))
+                    Expression(*expr);
+                break;
+            }
+        }
+
+        void Expression(const Expr& expr)
+        {
+            Visited(expr);
+            switch (expr.Kind())
+            {
+            case NodeType::IDENTIFIER:
+                Reference(static_cast<const Identifier&>(expr).Symbol(), Use::Read);
+                break;
+            case NodeType::ASSIGNMENT_EXPR:
+            {
+                const auto& assignment = static_cast<const AssignmentExpr&>(expr);
+                if (assignment.Assigne().Kind() == NodeType::IDENTIFIER)
+                    Reference(static_cast<const Identifier&>(assignment.Assigne()).Symbol(), Use::Write);
+                else
+                    Expression(assignment.Assigne());
+                Expression(assignment.Value());
+                break;
+            }
+            case NodeType::EQUALITY_CHECK_EXPR:
+            {
+                const auto& check = static_cast<const EqualityCheckExpr&>(expr);
+                Expression(check.Left());
+                Expression(check.Right());
+                break;
+            }
+            case NodeType::BINARY_EXPR:
+            {
+                const auto& binary = static_cast<const BinaryExpr&>(expr);
+                Expression(binary.Left());
+                Expression(binary.Right());
+                break;
+            }
+            case NodeType::UNARY_EXPR:
+                Expression(static_cast<const UnaryExpr&>(expr).Object());
+                break;
+            case NodeType::AWAIT_EXPR:
+                Expression(static_cast<const AwaitExpr&>(expr).Value());
+                break;
+            case NodeType::MEMBER_EXPR:
+                Expression(static_cast<const MemberExpr&>(expr).Object()); // <-- The property is a name, not a variable.
+                break;
+            case NodeType::INDEX_EXPR:
+            {
+                const auto& index = static_cast<const IndexExpr&>(expr);
+                Expression(index.Caller());
+                Expression(index.Arg());
+                break;
+            }
+            case NodeType::CALL_EXPR:
+            {
+                const auto& call = static_cast<const CallExpr&>(expr);
+                if (call.Caller().Kind() == NodeType::IDENTIFIER)
+                    Reference(static_cast<const Identifier&>(call.Caller()).Symbol(), Use::Call, call.Args().size());
+                else
+                    Expression(call.Caller());
+                for (const auto& arg : call.Args())
+                    Expression(*arg);
+                break;
+            }
+            case NodeType::OBJECT_CONSTRUCTOR_EXPR:
+                for (const auto& property : static_cast<const ObjectConstructorExpr&>(expr).Properties())
+                {
+                    if (property.Value().has_value() && property.Value().value())
+                        Expression(*property.Value().value());
+                }
+                break;
+            case NodeType::LAMBDA_EXPR:
+            {
+                const auto& lambda = static_cast<const LambdaExpr&>(expr);
+                std::vector<std::string> params;
+                for (const auto& ident : lambda.ParamIdents())
+                    params.push_back(ident.Symbol());
+                Function(params, lambda.Body());
+                break;
+            }
+            case NodeType::ARRAY_LITERAL:
+                for (const auto& element : static_cast<const ArrayLiteral&>(expr).Value())
+                    Expression(*element);
+                break;
+            default:
+                break;
+            }
+        }
+
+        void Function(const std::vector<std::string>& params, const std::vector<std::unique_ptr<Stmt>>& body)
+        {
+            m_nesting++;
+            m_scopes.emplace_back(params.begin(), params.end());
+            for (const auto& param : params)
+                Declared(param);
+            Statements(body);
+            m_scopes.pop_back();
+            m_nesting--;
+        }
+
+    protected:
+        // An identifier not declared in the walked code. `argc` is only meaningful for calls.
+        virtual void Free(const std::string&, Use, std::size_t) {}
+        // Every identifier, declared in the walked code or not.
+        virtual void Referenced(const std::string&, Use) {}
+        virtual void Declared(const std::string&) {}
+        // Every expression, before its operands.
+        virtual void Visited(const Expr&) {}
+
+        // Functions entered below the code the walk started on.
+        int Nesting() const { return m_nesting; }
+
+    private:
+        void Declare(const std::string& name)
+        {
+            m_scopes.back().insert(name);
+            Declared(name);
+        }
+
+        void Reference(const std::string& name, Use use, std::size_t argc = 0)
+        {
+            Referenced(name, use);
+            for (const auto& scope : m_scopes)
+            {
+                if (scope.count(name) != 0)
+                    return;
+            }
+            Free(name, use, argc);
+        }
+
+        void Block(const std::vector<std::unique_ptr<Stmt>>& body)
+        {
+            m_scopes.emplace_back();
+            Statements(body);
+            m_scopes.pop_back();
+        }
+
+    private:
+        std::vector<std::unordered_set<std::string>> m_scopes{ 1 };
+        int m_nesting = 0;
+    };
+}
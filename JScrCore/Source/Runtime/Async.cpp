@@ -0,0 +1,137 @@
+#include "Async.h"
+#include "Heap.h"
+
+namespace JScr::Runtime
+{
+    // ----- AsyncInbox -----
+
+    void AsyncInbox::Post(Completion completion)
+    {
+        std::function<void()> wake;
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_closed)
+                return;
+
+            m_completions.push_back(std::move(completion));
+            if (m_armed && m_wake)
+            {
+                m_armed = false;
+                wake = m_wake;
+            }
+        }
+        m_posted.notify_one();
+
+        if (wake)
+            wake();
+    }
+
+    std::vector<AsyncInbox::Completion> AsyncInbox::Take()
+    {
+        std::lock_guard lock(m_mutex);
+        return std::exchange(m_completions, {});
+    }
+
+    void AsyncInbox::Wait()
+    {
+        std::unique_lock lock(m_mutex);
+        m_posted.wait(lock, [&] { return !m_completions.empty(); });
+    }
+
+    bool AsyncInbox::Arm()
+    {
+        std::lock_guard lock(m_mutex);
+        m_armed = m_completions.empty();
+        return m_armed;
+    }
+
+    void AsyncInbox::SetWakeHandler(std::function<void()> handler)
+    {
+        std::lock_guard lock(m_mutex);
+        m_wake = std::move(handler);
+    }
+
+    void AsyncInbox::Close()
+    {
+        std::lock_guard lock(m_mutex);
+        m_closed = true;
+        m_completions.clear();
+        m_wake = nullptr;
+    }
+
+    // ----- Promise -----
+
+    Promise::Promise(std::shared_ptr<AsyncInbox> inbox, TaskObject* task)
+        : m_state(std::make_shared<State>(std::move(inbox), task))
+    {}
+
+    Promise::State::~State()
+    {
+        if (!settled)
+            inbox->Post(AsyncInbox::Completion{ task, true, nullptr, "The host dropped a task without settling it." });
+    }
+
+    void Promise::State::Settle(bool rejected, AsyncValue value, std::string error)
+    {
+        if (!settled.exchange(true))
+            inbox->Post(AsyncInbox::Completion{ task, rejected, std::move(value), std::move(error) });
+    }
+
+    void Promise::Resolve(AsyncValue value)
+    {
+        if (m_state != nullptr)
+            m_state->Settle(false, std::move(value), {});
+    }
+
+    void Promise::Resolve(const Value& value)
+    {
+        if (value.IsObject())
+            throw RuntimeException("Objects cannot cross threads; resolve with an AsyncValue that creates them.");
+        Resolve(AsyncValue([value](NativeHost&) { return value; }));
+    }
+
+    void Promise::Resolve(std::string value)
+    {
+        Resolve(AsyncValue([value = std::move(value)](NativeHost& host)
+        {
+            return Value::Object(host.GetHeap().Allocate<StringObject>(String(value)));
+        }));
+    }
+
+    void Promise::Reject(std::string error)
+    {
+        if (m_state != nullptr)
+            m_state->Settle(true, nullptr, std::move(error));
+    }
+
+    // ----- NativeTask -----
+
+    void NativeTask::promise_type::unhandled_exception()
+    {
+        try
+        {
+            throw;
+        }
+        catch (const RuntimeException& e)
+        {
+            promise.Reject(e.Description());
+        }
+        catch (const std::exception& e)
+        {
+            promise.Reject(e.what());
+        }
+        catch (...)
+        {
+            promise.Reject("Unknown error in a native task.");
+        }
+    }
+
+    Value NativeTask::Start(NativeHost& host)
+    {
+        Deferred deferred = host.Defer();
+        std::coroutine_handle<promise_type> handle = std::exchange(m_handle, {});
+        handle.promise().promise = std::move(deferred.promise);
+        handle.resume();
+        return deferred.task;
+    }
+}
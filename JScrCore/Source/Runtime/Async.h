@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Object.h"
+#include "RuntimeException.h"
+
+namespace JScr::Runtime
+{
+    // Builds the result of host work on the thread that runs the script, so it may allocate.
+    using AsyncValue = std::function<Value(NativeHost&)>;
+
+    // Where promises settled on other threads leave their results until the VM picks them up.
+    class AsyncInbox
+    {
+    public:
+        struct Completion
+        {
+            TaskObject* task;
+            bool rejected;
+            AsyncValue value;
+            std::string error;
+        };
+
+        void Post(Completion completion);
+        std::vector<Completion> Take();
+        // Blocks until something was posted.
+        void Wait();
+        // Lets the next Post call the wake handler, unless something was posted already; then it
+        // returns false and the caller has to Take again.
+        bool Arm();
+
+        // Called on the posting thread, at most once per Arm.
+        void SetWakeHandler(std::function<void()> handler);
+        // Later completions are dropped; their tasks are gone with the VM.
+        void Close();
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_posted;
+        std::vector<Completion> m_completions;
+        std::function<void()> m_wake;
+        bool m_armed = false;
+        bool m_closed = false;
+    };
+
+    // Settles one pending task from any thread, once; later calls are ignored. Copies share the task.
+    // Dropping the last copy without settling rejects it, so a script never waits for nothing.
+    class Promise
+    {
+    public:
+        Promise() = default;
+        Promise(std::shared_ptr<AsyncInbox> inbox, TaskObject* task);
+
+        void Resolve(AsyncValue value);
+        // Only for values that are not objects, those have to be made by an AsyncValue.
+        void Resolve(const Value& value);
+        void Resolve(std::string value);
+        void Reject(std::string error);
+
+    private:
+        struct State
+        {
+            std::shared_ptr<AsyncInbox> inbox;
+            TaskObject* task;
+            std::atomic<bool> settled = false;
+
+            State(std::shared_ptr<AsyncInbox> inbox, TaskObject* task) : inbox(std::move(inbox)), task(task) {}
+            ~State();
+            void Settle(bool rejected, AsyncValue value, std::string error);
+        };
+
+        std::shared_ptr<State> m_state;
+    };
+
+    // See NativeHost::Defer.
+    struct Deferred
+    {
+        Value task;
+        Promise promise;
+    };
+
+    // A native written as a C++ coroutine. It runs up to its first co_await when started, and its
+    // co_return (or the exception it throws) settles the task the native returns:
+    //
+    //     NativeTask Fetch(std::string url) { co_return co_await client.Get(url); }
+    //     Value FetchNative(NativeHost& host, Value* args, int, void*) { return Fetch(...).Start(host); }
+    class NativeTask
+    {
+    public:
+        struct promise_type
+        {
+            Promise promise;
+
+            NativeTask get_return_object() { return NativeTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+
+            template<typename T>
+            void return_value(T&& value) { promise.Resolve(std::forward<T>(value)); }
+            void unhandled_exception();
+        };
+
+        NativeTask(NativeTask&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+        NativeTask& operator=(NativeTask&&) = delete;
+        // A coroutine that was never started is dropped without running.
+        ~NativeTask()
+        {
+            if (m_handle)
+                m_handle.destroy();
+        }
+
+        Value Start(NativeHost& host);
+
+    private:
+        explicit NativeTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+        std::coroutine_handle<promise_type> m_handle;
+    };
+}
@@ -0,0 +1,11 @@
+#include "Binding.h"
+#include "RuntimeException.h"
+#include "VM.h"
+
+namespace JScr::Runtime::Binding
+{
+    void ArgumentError(const HostFunction& bound, std::size_t index, const char* expected, const Value& got)
+    {
+        throw RuntimeException("Function '" + bound.name + "' expects '" + expected + "' as argument " + std::to_string(index + 1) + ", got '" + VM::TypeName(got) + "'.");
+    }
+}
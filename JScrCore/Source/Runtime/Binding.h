@@ -0,0 +1,219 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Heap.h"
+#include "Object.h"
+#include "Value.h"
+
+namespace JScr::Runtime
+{
+    // A C++ function bound to a name scripts can call. The native function object the compiler makes for
+    // it gets this record as userdata; its trampoline casts `function` back to the real signature.
+    struct HostFunction
+    {
+        std::string name;
+        NativeFunction trampoline;
+        int arity;
+        void (*function)();
+    };
+
+    // Searched in order, the first function of a name wins.
+    using HostFunctions = std::vector<std::shared_ptr<const HostFunction>>;
+
+    namespace Binding
+    {
+        // How a C++ type crosses over from and to script values. Accepts is checked before From, so From
+        // converts without checking again.
+        template <typename T>
+        struct Marshal
+        {
+            static_assert(sizeof(T) == 0, "Bound functions take and return bool, int, float, double, char, std::string, std::string_view and std::span (parameters only) and Value.");
+        };
+
+        template <>
+        struct Marshal<Value>
+        {
+            static constexpr const char* name = "dynamic";
+            static bool Accepts(const Value&) { return true; }
+            static Value From(const Value& value) { return value; }
+            static Value To(NativeHost&, const Value& value) { return value; }
+        };
+
+        template <>
+        struct Marshal<bool>
+        {
+            static constexpr const char* name = "bool";
+            static bool Accepts(const Value& value) { return value.IsBool(); }
+            static bool From(const Value& value) { return value.AsBool(); }
+            static Value To(NativeHost&, bool value) { return Value::Bool(value); }
+        };
+
+        template <>
+        struct Marshal<std::int32_t>
+        {
+            static constexpr const char* name = "int";
+            static bool Accepts(const Value& value) { return value.IsInt(); }
+            static std::int32_t From(const Value& value) { return value.AsInt(); }
+            static Value To(NativeHost&, std::int32_t value) { return Value::Int(value); }
+        };
+
+        template <>
+        struct Marshal<float>
+        {
+            static constexpr const char* name = "float";
+            static bool Accepts(const Value& value) { return value.IsNumber(); }
+            static float From(const Value& value) { return value.IsFloat() ? value.AsFloat() : (float) value.ToDouble(); }
+            static Value To(NativeHost&, float value) { return Value::Float(value); }
+        };
+
+        template <>
+        struct Marshal<double>
+        {
+            static constexpr const char* name = "double";
+            static bool Accepts(const Value& value) { return value.IsNumber(); }
+            static double From(const Value& value) { return value.IsDouble() ? value.AsDouble() : value.ToDouble(); }
+            static Value To(NativeHost&, double value) { return Value::Double(value); }
+        };
+
+        template <>
+        struct Marshal<char>
+        {
+            static constexpr const char* name = "char";
+            static bool Accepts(const Value& value) { return value.IsChar(); }
+            static char From(const Value& value) { return value.AsChar(); }
+            static Value To(NativeHost&, char value) { return Value::Char(value); }
+        };
+
+        // Points into the script's string, which stays put until the function returns.
+        template <>
+        struct Marshal<std::string_view>
+        {
+            static constexpr const char* name = "string";
+            static bool Accepts(const Value& value) { return value.IsObject() && value.AsObject()->Kind() == ObjectKind::String; }
+            static std::string_view From(const Value& value) { return static_cast<StringObject*>(value.AsObject())->Data(); }
+        };
+
+        template <>
+        struct Marshal<std::string> : Marshal<std::string_view>
+        {
+            static std::string From(const Value& value) { return std::string(Marshal<std::string_view>::From(value)); }
+            static Value To(NativeHost& host, const std::string& value) { return Value::Object(host.GetHeap().Allocate<StringObject>(String(value))); }
+        };
+
+        // The typed array element type of a C++ type, for sharing host memory with scripts.
+        template <typename T>
+        struct Element
+        {
+            static_assert(sizeof(T) == 0, "Typed arrays hold int32_t, float, double or char.");
+        };
+
+        template <> struct Element<std::int32_t> { static constexpr ElementType type = ElementType::Int;    static constexpr const char* name = "int[]";    static constexpr const char* writable = "writable int[]"; };
+        template <> struct Element<float>        { static constexpr ElementType type = ElementType::Float;  static constexpr const char* name = "float[]";  static constexpr const char* writable = "writable float[]"; };
+        template <> struct Element<double>       { static constexpr ElementType type = ElementType::Double; static constexpr const char* name = "double[]"; static constexpr const char* writable = "writable double[]"; };
+        template <> struct Element<char>         { static constexpr ElementType type = ElementType::Char;   static constexpr const char* name = "char[]";   static constexpr const char* writable = "writable char[]"; };
+
+        // Lends host memory to scripts as a typed array, without copying; indexing it loads and stores
+        // straight to `data`. The array never owns the memory: the host keeps it alive and in place for as
+        // long as the VM can reach the array, which means until the VM is destroyed unless the host knows
+        // no script kept it. Neither side sees a copy, so the host should not write to it while a script that
+        // can reach it runs. A span of const elements gives a read-only array scripts cannot write to.
+        template <typename T>
+        Value Share(Heap& heap, std::span<T> data)
+        {
+            using E = Element<std::remove_const_t<T>>;
+            return Value::Object(heap.Allocate<TypedArrayObject>(E::type, const_cast<std::remove_const_t<T>*>(data.data()), data.size(), std::is_const_v<T>));
+        }
+
+        template <typename T>
+        Value Share(Heap& heap, T* data, std::size_t length) { return Share(heap, std::span<T>(data, length)); }
+
+        // A typed array's elements for the duration of the call, without copying. Spans of mutable
+        // elements refuse read-only arrays.
+        template <typename T>
+        struct Marshal<std::span<T>>
+        {
+            using E = Element<std::remove_const_t<T>>;
+            static constexpr const char* name = std::is_const_v<T> ? E::name : E::writable;
+
+            static bool Accepts(const Value& value)
+            {
+                if (!value.IsObject() || value.AsObject()->Kind() != ObjectKind::TypedArray)
+                    return false;
+                auto* array = static_cast<TypedArrayObject*>(value.AsObject());
+                return array->GetElementType() == E::type && (std::is_const_v<T> || !array->IsReadOnly());
+            }
+
+            static std::span<T> From(const Value& value)
+            {
+                auto* array = static_cast<TypedArrayObject*>(value.AsObject());
+                return std::span<T>(array->Data<std::remove_const_t<T>>(), array->Length());
+            }
+        };
+
+        [[noreturn]] void ArgumentError(const HostFunction& bound, std::size_t index, const char* expected, const Value& got);
+
+        template <typename T>
+        using Plain = std::remove_cvref_t<T>;
+
+        template <typename T, std::size_t Index>
+        decltype(auto) Argument(const HostFunction& bound, const Value* args)
+        {
+            if (!Marshal<Plain<T>>::Accepts(args[Index])) [[unlikely]]
+                ArgumentError(bound, Index, Marshal<Plain<T>>::name, args[Index]);
+            return Marshal<Plain<T>>::From(args[Index]);
+        }
+
+        // The NativeFunction for every C++ signature, `Host` for functions that take the NativeHost first.
+        // Converts the arguments straight out of the caller's registers and calls the function through
+        // the pointer in its HostFunction.
+        template <bool Host, typename R, typename... Args>
+        struct Trampoline
+        {
+            using Pointer = std::conditional_t<Host, R (*)(NativeHost&, Args...), R (*)(Args...)>;
+            static constexpr int Arity = (int) sizeof...(Args);
+
+            static Value Call(NativeHost& host, Value* args, int, void* userdata)
+            {
+                return Invoke(host, *static_cast<const HostFunction*>(userdata), args, std::index_sequence_for<Args...>{});
+            }
+
+            template <std::size_t... Index>
+            static Value Invoke(NativeHost& host, const HostFunction& bound, const Value* args, std::index_sequence<Index...>)
+            {
+                auto function = reinterpret_cast<Pointer>(bound.function);
+                if constexpr (std::is_void_v<R>)
+                {
+                    if constexpr (Host)
+                        function(host, Argument<Args, Index>(bound, args)...);
+                    else
+                        function(Argument<Args, Index>(bound, args)...);
+                    return Value::Null();
+                }
+                else if constexpr (Host)
+                    return Marshal<Plain<R>>::To(host, function(host, Argument<Args, Index>(bound, args)...));
+                else
+                    return Marshal<Plain<R>>::To(host, function(Argument<Args, Index>(bound, args)...));
+            }
+        };
+
+        template <typename R, typename... Args>
+        std::shared_ptr<const HostFunction> Make(std::string name, R (*function)(Args...))
+        {
+            using Thunk = Trampoline<false, R, Args...>;
+            return std::make_shared<const HostFunction>(HostFunction{ std::move(name), &Thunk::Call, Thunk::Arity, reinterpret_cast<void (*)()>(function) });
+        }
+
+        template <typename R, typename... Args>
+        std::shared_ptr<const HostFunction> Make(std::string name, R (*function)(NativeHost&, Args...))
+        {
+            using Thunk = Trampoline<true, R, Args...>;
+            return std::make_shared<const HostFunction>(HostFunction{ std::move(name), &Thunk::Call, Thunk::Arity, reinterpret_cast<void (*)()>(function) });
+        }
+    }
+}
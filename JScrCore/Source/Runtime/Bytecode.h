@@ -0,0 +1,317 @@
+#pragma once
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Types.h"
+#include "Value.h"
+#include "Heap.h"
+
+namespace JScr::Runtime
+{
+    // Register based instruction set. R[x] is a register of the current frame, K[x] a constant of the
+    // current function, G[x] a module global and U[x] an upvalue of the running closure.
+    enum class OpCode : std::uint8_t
+    {
+        MOVE,       // A B      R[A] = R[B]
+        LOADK,      // A Bx     R[A] = K[Bx]
+        LOADNULL,   // A        R[A] = null
+        LOADBOOL,   // A B      R[A] = (bool) B
+        LOADINT,    // A sBx    R[A] = sBx
+        GETGLOBAL,  // A Bx     R[A] = G[Bx]
+        SETGLOBAL,  // A Bx     G[Bx] = R[A]
+        GETUPVAL,   // A B      R[A] = U[B]
+        SETUPVAL,   // A B      U[B] = R[A]
+        GETFIELD,   // A B C    R[A] = R[B].K[C]            (followed by EXTRAARG with the inline cache index)
+        SETFIELD,   // A B C    R[A].K[B] = R[C]            (followed by EXTRAARG with the inline cache index)
+        GETINDEX,   // A B C    R[A] = R[B][R[C]]
+        SETINDEX,   // A B C    R[A][R[B]] = R[C]
+        NEWARRAY,   // A B C    R[A] = { R[B], ..., R[B + C - 1] }
+        APPEND,     // A B C    R[A] += { R[B], ..., R[B + C - 1] }
+        NEWOBJECT,  // A Bx     R[A] = new object of type Bx (0xFFFF for anonymous objects)
+        ADD,        // A B C    R[A] = R[B] + R[C]
+        SUB,        // A B C    R[A] = R[B] - R[C]
+        MUL,        // A B C    R[A] = R[B] * R[C]
+        DIV,        // A B C    R[A] = R[B] / R[C]
+        MOD,        // A B C    R[A] = R[B] % R[C]
+        NEG,        // A B      R[A] = -R[B]
+        NOT,        // A B      R[A] = !R[B]
+        EQ,         // A B C    R[A] = R[B] == R[C]
+        NE,         // A B C    R[A] = R[B] != R[C]
+        LT,         // A B C    R[A] = R[B] < R[C]
+        LE,         // A B C    R[A] = R[B] <= R[C]
+        GT,         // A B C    R[A] = R[B] > R[C]
+        GE,         // A B C    R[A] = R[B] >= R[C]
+        CONVERT,    // A B C    R[A] = R[B] converted to the type with conversion code C (see Conversion)
+        JMP,        // sBx      pc += sBx
+        JMPIF,      // A sBx    if R[A] then pc += sBx
+        JMPIFNOT,   // A sBx    if not R[A] then pc += sBx
+        JMPTABLE,   // A Bx     pc += T[Bx].targets[R[A] - T[Bx].low], or T[Bx].fallback when R[A] is outside
+        CLOSURE,    // A Bx     R[A] = closure of function Bx
+        CALL,       // A B      R[A] = R[A](R[A + 1], ..., R[A + B])
+        TAILCALL,   // A B C    return R[A](R[A + 1], ..., R[A + B]) converted with C in place of this frame
+                    //          (a CALL when that is not possible, with the conversion and RETURN that follow)
+        RETURN,     // A B      return B ? R[A] : null
+        CLOSE,      // A        close all upvalues pointing at R[A] or above
+        GETINBOUNDS,// A B C    GETINDEX where R[C] is an int the compiler proved within bounds should R[B] be an array
+        SETINBOUNDS,// A B C    SETINDEX where R[B] is an int the compiler proved within bounds should R[A] be an array
+        ASYNC,      // A        R[A] = pending task of this call of an async function
+        AWAIT,      // A B C    R[A] = result of task R[B]; while it is pending, the call is saved in task R[C] and returns R[C]
+        RESOLVE,    // A B C    settle task R[A] with C ? R[B] : null
+
+        // Typed arithmetic and comparisons, see Specialization. The compiler emits them when it knows both
+        // operands to be of that type, so they skip the checks of ADD ... LE. GT and GE swap the operands.
+        IADD, ISUB, IMUL, IDIV, IMOD, IEQ, INE, ILT, ILE,   // A B C    int
+        DADD, DSUB, DMUL, DDIV, DMOD, DEQ, DNE, DLT, DLE,   // A B C    double
+        FADD, FSUB, FMUL, FDIV, FMOD, FEQ, FNE, FLT, FLE,   // A B C    float
+        SEQ, SNE, SLT, SLE,                                 // A B C    string or null
+
+        // Superinstructions, see Superinstructions.h. Each replaces the first instruction of a sequence
+        // and runs the instructions after it, which stay in place, in the same dispatch.
+        ADDINT,     // A sBx    LOADINT, then the ADD that follows with R[A] as its C
+        SUBINT,     // A sBx    LOADINT, then the SUB that follows with R[A] as its C
+        EQJMP,      // A B C    EQ, then the JMPIF or JMPIFNOT that follows on R[A]
+        NEJMP,      // A B C    NE, then the JMPIF or JMPIFNOT that follows on R[A]
+        LTJMP,      // A B C    LT, then the JMPIF or JMPIFNOT that follows on R[A]
+        LEJMP,      // A B C    LE, then the JMPIF or JMPIFNOT that follows on R[A]
+        GTJMP,      // A B C    GT, then the JMPIF or JMPIFNOT that follows on R[A]
+        GEJMP,      // A B C    GE, then the JMPIF or JMPIFNOT that follows on R[A]
+        CALLRET,    // A B      CALL, then the RETURN of R[A] that follows
+        IEQJMP,     // A B C    IEQ, then the JMPIF or JMPIFNOT that follows on R[A]
+        INEJMP,     // A B C    INE, then the JMPIF or JMPIFNOT that follows on R[A]
+        ILTJMP,     // A B C    ILT, then the JMPIF or JMPIFNOT that follows on R[A]
+        ILEJMP,     // A B C    ILE, then the JMPIF or JMPIFNOT that follows on R[A]
+        DLTJMP,     // A B C    DLT, then the JMPIF or JMPIFNOT that follows on R[A]
+        DLEJMP,     // A B C    DLE, then the JMPIF or JMPIFNOT that follows on R[A]
+
+        EXTRAARG,   // Bx       operand of the previous instruction, never executed on its own
+    };
+
+    class Instruction
+    {
+    public:
+        static constexpr std::int32_t SBxBias = 0x7FFF;
+
+        Instruction() : m_bits(0) {}
+
+        static Instruction ABC(OpCode op, std::uint8_t a, std::uint8_t b = 0, std::uint8_t c = 0)
+        {
+            return Instruction((std::uint32_t) op | ((std::uint32_t) a << 8) | ((std::uint32_t) b << 16) | ((std::uint32_t) c << 24));
+        }
+
+        static Instruction ABx(OpCode op, std::uint8_t a, std::uint16_t bx)
+        {
+            return Instruction((std::uint32_t) op | ((std::uint32_t) a << 8) | ((std::uint32_t) bx << 16));
+        }
+
+        static Instruction AsBx(OpCode op, std::uint8_t a, std::int32_t sbx)
+        {
+            return ABx(op, a, (std::uint16_t) (sbx + SBxBias));
+        }
+
+    public:
+        OpCode Op() const        { return (OpCode) (m_bits & 0xFF); }
+        std::uint8_t A() const   { return (std::uint8_t) (m_bits >> 8); }
+        std::uint8_t B() const   { return (std::uint8_t) (m_bits >> 16); }
+        std::uint8_t C() const   { return (std::uint8_t) (m_bits >> 24); }
+        std::uint16_t Bx() const { return (std::uint16_t) (m_bits >> 16); }
+        std::int32_t SBx() const { return (std::int32_t) Bx() - SBxBias; }
+
+        // The same operands under another opcode.
+        Instruction WithOp(OpCode op) const { return Instruction((m_bits & ~0xFFu) | (std::uint32_t) op); }
+
+        void SetSBx(std::int32_t sbx) { m_bits = (m_bits & 0xFFFF) | ((std::uint32_t) (std::uint16_t) (sbx + SBxBias) << 16); }
+    private:
+        Instruction(std::uint32_t bits) : m_bits(bits) {}
+
+        std::uint32_t m_bits;
+    };
+
+    // Maps between the generic arithmetic and comparison instructions and their typed forms. Each block
+    // of typed instructions follows the order of Generics.
+    struct Specialization
+    {
+        static constexpr OpCode Generics[] =
+        {
+            OpCode::ADD, OpCode::SUB, OpCode::MUL, OpCode::DIV, OpCode::MOD, OpCode::EQ, OpCode::NE, OpCode::LT, OpCode::LE,
+        };
+
+        static bool Is(OpCode op) { return op >= OpCode::IADD && op <= OpCode::SLE; }
+        static bool IsArith(OpCode op) { return Is(op) && Generic(op) <= OpCode::MOD; }
+
+        // `generic` for operands of type `uid`, if there is such a form.
+        static std::optional<OpCode> For(OpCode generic, Types::Uid uid)
+        {
+            std::size_t index = 0;
+            while (index < std::size(Generics) && Generics[index] != generic)
+                index++;
+            if (index == std::size(Generics))
+                return std::nullopt;
+
+            switch (uid)
+            {
+            case Types::Uid::Int:    return (OpCode) ((std::size_t) OpCode::IADD + index);
+            case Types::Uid::Double: return (OpCode) ((std::size_t) OpCode::DADD + index);
+            case Types::Uid::Float:  return (OpCode) ((std::size_t) OpCode::FADD + index);
+            case Types::Uid::String:
+                if (index < 5)
+                    return std::nullopt;
+                return (OpCode) ((std::size_t) OpCode::SEQ + index - 5);
+            default:
+                return std::nullopt;
+            }
+        }
+
+        static OpCode Generic(OpCode op)
+        {
+            if (op >= OpCode::SEQ)
+                return Generics[5 + (std::size_t) op - (std::size_t) OpCode::SEQ];
+            return Generics[((std::size_t) op - (std::size_t) OpCode::IADD) % std::size(Generics)];
+        }
+
+        static Types::Uid OperandType(OpCode op)
+        {
+            if (op >= OpCode::SEQ)
+                return Types::Uid::String;
+            if (op >= OpCode::FADD)
+                return Types::Uid::Float;
+            return op >= OpCode::DADD ? Types::Uid::Double : Types::Uid::Int;
+        }
+    };
+
+    // Operand C of CONVERT and the conversion of a struct slot: a primitive Types::Uid, or TypedArray
+    // plus the element uid for arrays that are stored unboxed.
+    struct Conversion
+    {
+        static constexpr std::uint8_t TypedArray = 0x80;
+        static constexpr std::uint8_t None = 0xFF;
+
+        // Declared types are enforced by converting on every store; nullopt when there is nothing to enforce.
+        static std::optional<std::uint8_t> For(const std::optional<Types::Type>& type)
+        {
+            if (!type.has_value() || !type->LambdaTypes().empty())
+                return std::nullopt;
+
+            switch ((Types::Uid) type->Uid())
+            {
+            case Types::Uid::Bool:
+            case Types::Uid::Int:
+            case Types::Uid::Float:
+            case Types::Uid::Double:
+            case Types::Uid::String:
+            case Types::Uid::Char:
+                return (std::uint8_t) type->Uid();
+            case Types::Uid::Array:
+            {
+                const auto& element = type->Child();
+                if (element == nullptr || !element->LambdaTypes().empty() || !ElementTypeOf((std::uint8_t) element->Uid()).has_value())
+                    return std::nullopt;
+                return (std::uint8_t) (TypedArray | element->Uid());
+            }
+            default:
+                return std::nullopt;
+            }
+        }
+
+        static std::optional<ElementType> ElementTypeOf(std::uint8_t uid)
+        {
+            switch ((Types::Uid) (uid & ~TypedArray))
+            {
+            case Types::Uid::Int:    return ElementType::Int;
+            case Types::Uid::Float:  return ElementType::Float;
+            case Types::Uid::Double: return ElementType::Double;
+            case Types::Uid::Char:   return ElementType::Char;
+            default:                 return std::nullopt;
+            }
+        }
+
+        static std::uint8_t ElementUid(ElementType type)
+        {
+            static constexpr Types::Uid uids[] = { Types::Uid::Int, Types::Uid::Float, Types::Uid::Double, Types::Uid::Char };
+            return (std::uint8_t) uids[(int) type];
+        }
+    };
+
+    struct UpvalueDesc
+    {
+        // Captures a register of the enclosing frame when true, otherwise one of its upvalues.
+        bool fromParentLocal;
+        std::uint8_t index;
+    };
+
+    // Dense table for JMPTABLE. Offsets are relative to the instruction after the JMPTABLE.
+    struct JumpTable
+    {
+        std::int32_t low = 0;
+        std::int32_t fallback = 0;
+        std::vector<std::int32_t> targets;
+    };
+
+    struct FunctionProto
+    {
+        std::string name;
+        std::uint8_t numParams = 0;
+        std::uint8_t numRegisters = 0;
+        std::uint16_t index = 0;        // <-- position in Module::functions
+        std::uint16_t numCaches = 0;    // <-- inline caches used by GETFIELD and SETFIELD sites
+        std::uint32_t firstCache = 0;   // <-- where those start among all caches of the module
+        bool isAsync = false;           // <-- calls return a task, see ASYNC
+        std::vector<Instruction> code;
+        std::vector<Value> constants;
+        std::vector<UpvalueDesc> upvalues;
+        std::vector<JumpTable> jumpTables;
+    };
+
+    struct ObjectType
+    {
+        std::string name;
+        std::vector<std::string> propertyNames;
+        std::vector<std::optional<Types::Type>> propertyTypes;
+        // Defaults the compiler could evaluate up front, already converted to the property type.
+        // Instances start with them in place, everything else is assigned by the constructor code.
+        std::vector<std::optional<Value>> propertyDefaults;
+    };
+
+    struct EnumType
+    {
+        std::string name;
+        std::vector<std::string> entries;
+    };
+
+    struct HostFunction;
+
+    // A global the compiler bound to a host or StandardLibrary function.
+    struct NativeGlobal
+    {
+        std::uint16_t global;
+        Value function;
+    };
+
+    // The compiled form of a Program. Everything in here is immutable once the compiler hands it out,
+    // so one module can be shared by any number of VMs on any threads; all run state lives in the VM.
+    class Module
+    {
+    public:
+        static constexpr std::uint16_t AnonymousObjectType = 0xFFFF;
+
+        std::string fileDir;
+        std::vector<std::unique_ptr<FunctionProto>> functions; // <-- functions[0] holds the top level code.
+        std::vector<std::string> globalNames;
+        std::vector<ObjectType> objectTypes;
+        std::vector<EnumType> enumTypes;
+        // Copied into the globals of every VM.
+        std::vector<NativeGlobal> nativeGlobals;
+        // The records of host functions among them, which their native function objects point to.
+        std::vector<std::shared_ptr<const HostFunction>> hostFunctions;
+        // Inline caches of all functions together.
+        std::uint32_t numCaches = 0;
+
+        // Owns the string, enum and native function objects referenced from constant pools and native
+        // globals. They live as long as the module and are never written to, so every VM can share them.
+        Heap constantHeap{ Heap::Lifetime::Permanent };
+
+        const FunctionProto& Main() const { return *functions[0]; }
+    };
+}
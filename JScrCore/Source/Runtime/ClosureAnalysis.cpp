@@ -0,0 +1,86 @@
+#include "ClosureAnalysis.h"
+#include <algorithm>
+#include "AstWalker.h"
+
+namespace JScr::Runtime
+{
+    namespace
+    {
+        class FreeVariableWalker : public AstWalker
+        {
+        public:
+            std::vector<ClosureAnalysis::FreeVariable> result;
+
+        protected:
+            void Free(const std::string& name, Use use, std::size_t) override
+            {
+                auto it = std::find_if(result.begin(), result.end(), [&](const auto& variable) { return variable.name == name; });
+                if (it == result.end())
+                    it = result.insert(result.end(), ClosureAnalysis::FreeVariable{ name });
+
+                // The function itself is nesting level 1.
+                if (use == Use::Write || Nesting() > 1)
+                    it->pinned = true;
+            }
+        };
+
+        class AssignmentWalker : public AstWalker
+        {
+        public:
+            std::unordered_set<std::string> result;
+
+        protected:
+            void Referenced(const std::string& name, Use use) override
+            {
+                if (use == Use::Write && Nesting() > 0)
+                    result.insert(name);
+            }
+        };
+
+        class EscapeWalker : public AstWalker
+        {
+        public:
+            EscapeWalker(const std::string& name, std::size_t argc) : m_name(name), m_argc(argc) {}
+
+            bool onlyCalled = true;
+
+        protected:
+            void Free(const std::string& name, Use use, std::size_t argc) override
+            {
+                if (name == m_name && (use != Use::Call || argc != m_argc || Nesting() > 0))
+                    onlyCalled = false;
+            }
+
+            // Conservative: a shadowing declaration anywhere gives up, wherever its scope ends.
+            void Declared(const std::string& name) override
+            {
+                if (name == m_name)
+                    onlyCalled = false;
+            }
+        private:
+            const std::string& m_name;
+            std::size_t m_argc;
+        };
+    }
+
+    std::vector<ClosureAnalysis::FreeVariable> ClosureAnalysis::Find(const std::vector<std::string>& params, const std::vector<std::unique_ptr<Stmt>>& body)
+    {
+        FreeVariableWalker walker{};
+        walker.Function(params, body);
+        return walker.result;
+    }
+
+    std::unordered_set<std::string> ClosureAnalysis::AssignedInNestedFunctions(std::span<const std::unique_ptr<Stmt>> body)
+    {
+        AssignmentWalker walker{};
+        walker.Statements(body);
+        return walker.result;
+    }
+
+    bool ClosureAnalysis::OnlyCalled(const std::string& name, std::size_t argc, std::span<const std::unique_ptr<Stmt>> statements)
+    {
+        EscapeWalker walker{ name, argc };
+        walker.Statements(statements);
+        return walker.onlyCalled;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../Frontend/Ast.h"
+
+using namespace JScr::Frontend;
+
+namespace JScr::Runtime
+{
+    // Free variable and escape analysis over the AST. The Compiler uses it to find functions that
+    // never outlive the frame declaring them and are only called from there; those are lifted, so
+    // their captured variables travel as extra arguments and no closure has to be allocated.
+    class ClosureAnalysis
+    {
+    public:
+        struct FreeVariable
+        {
+            std::string name;
+            // Assigned or deleted by the function, or used by a function nested in it. Passing the value
+            // at each call would change what those see, so a captured local like this rules out lifting.
+            bool pinned = false;
+        };
+
+        // In order of first use. Globals are included, the compiler tells them apart.
+        static std::vector<FreeVariable> Find(const std::vector<std::string>& params, const std::vector<std::unique_ptr<Stmt>>& body);
+
+        // Variables some function nested in `body` assigns or deletes, by name. Lifting reads the
+        // captured ones at the call, so they must not change behind the lifted function's back.
+        static std::unordered_set<std::string> AssignedInNestedFunctions(std::span<const std::unique_ptr<Stmt>> body);
+
+        // Whether every use of `name` in `statements` calls it directly with `argc` arguments, outside
+        // of any nested function, and nothing there assigns, deletes or redeclares it.
+        static bool OnlyCalled(const std::string& name, std::size_t argc, std::span<const std::unique_ptr<Stmt>> statements);
+    };
+}
@@ -0,0 +1,249 @@
+#include "Collections.h"
+#include <bit>
+#include "RuntimeException.h"
+#include "VM.h"
+
+namespace JScr::Runtime
+{
+    namespace
+    {
+        // Spreads keys that differ in a few bits over the whole table. Never 0, which marks empty slots.
+        std::uint32_t Mix(std::uint64_t x)
+        {
+            x ^= x >> 33;
+            x *= 0xFF51AFD7ED558CCDull;
+            x ^= x >> 33;
+            x *= 0xC4CEB9FE1A85EC53ull;
+            x ^= x >> 33;
+            return (std::uint32_t) x != 0 ? (std::uint32_t) x : 1;
+        }
+
+        bool IsString(const Value& value)
+        {
+            return value.IsObject() && value.AsObject()->Kind() == ObjectKind::String;
+        }
+
+        // Clears the flag again however the comparator call ends.
+        class BusyScope
+        {
+        public:
+            BusyScope(bool& flag) : m_flag(flag) { m_flag = true; }
+            ~BusyScope() { m_flag = false; }
+        private:
+            bool& m_flag;
+        };
+    }
+
+    // ----- HashTableObject -----
+
+    std::uint32_t HashTableObject::Hash(const Value& key)
+    {
+        if (key.IsInt())
+            return Mix((std::uint32_t) key.AsInt());
+
+        // Whole numbers hash like the int they equal, so 1, 1.0 and 1.0f are one key.
+        if (key.IsNumber())
+        {
+            double number = key.ToDouble();
+            if (number >= -2147483648.0 && number <= 2147483647.0 && number == (double) (std::int32_t) number)
+                return Mix((std::uint32_t) (std::int32_t) number);
+            return Mix(std::bit_cast<std::uint64_t>(number));
+        }
+
+        if (IsString(key))
+            return Mix(static_cast<StringObject*>(key.AsObject())->Hash());
+        return Mix(key.Bits());
+    }
+
+    bool HashTableObject::SameKey(const Value& a, const Value& b)
+    {
+        // Tables never hold NaN, so an identical NaN never gets here as a stored key.
+        if (a.IsIdentical(b))
+            return true;
+        if (a.IsNumber() && b.IsNumber())
+            return a.ToDouble() == b.ToDouble();
+        if (IsString(a) && IsString(b))
+            return StringObject::Equal(static_cast<StringObject*>(a.AsObject()), static_cast<StringObject*>(b.AsObject()));
+        return false;
+    }
+
+    std::size_t HashTableObject::Probe(const Value& key, std::uint32_t hash) const
+    {
+        std::size_t mask = m_slots.size() - 1;
+        std::size_t index = hash & mask;
+        while (m_slots[index].hash != 0 && (m_slots[index].hash != hash || !(m_slots[index].key.IsIdentical(key) || SameKey(m_slots[index].key, key))))
+            index = (index + 1) & mask;
+        return index;
+    }
+
+    const Value* HashTableObject::Find(const Value& key) const
+    {
+        if (m_size == 0)
+            return nullptr;
+
+        const Slot& slot = m_slots[Probe(key, Hash(key))];
+        if (slot.hash == 0)
+            return nullptr;
+        return IsSet() ? &slot.key : &slot.value;
+    }
+
+    bool HashTableObject::Insert(const Value& key, const Value& value)
+    {
+        // NaN equals nothing, not even itself, so it could never be found again.
+        if (key.IsNumber() && key.ToDouble() != key.ToDouble())
+            throw RuntimeException("NaN cannot be used as a key.");
+
+        // At most three quarters full.
+        if ((m_size + 1) * 4 > m_slots.size() * 3)
+            Grow();
+
+        std::uint32_t hash = Hash(key);
+        Slot& slot = m_slots[Probe(key, hash)];
+        bool added = slot.hash == 0;
+        if (added)
+        {
+            slot.hash = hash;
+            slot.key = key;
+            m_size++;
+        }
+        if (!IsSet())
+            slot.value = value;
+        return added;
+    }
+
+    bool HashTableObject::Erase(const Value& key)
+    {
+        if (m_size == 0)
+            return false;
+
+        std::size_t mask = m_slots.size() - 1;
+        std::size_t hole = Probe(key, Hash(key));
+        if (m_slots[hole].hash == 0)
+            return false;
+
+        // Moves back every following entry of the run that may take the hole: those whose home slot
+        // is not between the hole and where they are.
+        for (std::size_t index = (hole + 1) & mask; m_slots[index].hash != 0; index = (index + 1) & mask)
+        {
+            std::size_t home = m_slots[index].hash & mask;
+            if (((index - home) & mask) < ((index - hole) & mask))
+                continue;
+
+            m_slots[hole] = m_slots[index];
+            hole = index;
+        }
+
+        m_slots[hole] = Slot{};
+        m_size--;
+        return true;
+    }
+
+    void HashTableObject::Clear()
+    {
+        m_slots.clear();
+        m_size = 0;
+    }
+
+    void HashTableObject::Grow()
+    {
+        std::vector<Slot> slots = std::move(m_slots);
+        m_slots.assign(slots.empty() ? 8 : slots.size() * 2, Slot{});
+
+        std::size_t mask = m_slots.size() - 1;
+        for (const Slot& slot : slots)
+        {
+            if (slot.hash == 0)
+                continue;
+
+            std::size_t index = slot.hash & mask;
+            while (m_slots[index].hash != 0)
+                index = (index + 1) & mask;
+            m_slots[index] = slot;
+        }
+    }
+
+    // ----- DequeObject -----
+
+    void DequeObject::Reserve(std::size_t size)
+    {
+        if (size <= m_items.size())
+            return;
+
+        std::vector<Value> items(m_items.empty() ? 8 : m_items.size() * 2);
+        for (std::size_t i = 0; i < m_size; i++)
+            items[i] = At(i);
+        m_items = std::move(items);
+        m_head = 0;
+    }
+
+    // ----- PriorityQueueObject -----
+
+    bool PriorityQueueObject::Less(NativeHost& host, std::size_t a, std::size_t b)
+    {
+        if (m_less.IsNull())
+            return DefaultLess(m_items[a], m_items[b]);
+
+        BusyScope busy(m_busy);
+        return host.Call(m_less, { m_items[a], m_items[b] }).IsTruthy();
+    }
+
+    void PriorityQueueObject::Enter()
+    {
+        if (m_busy)
+            throw RuntimeException("A priority queue cannot be changed by its own comparator.");
+    }
+
+    void PriorityQueueObject::Push(NativeHost& host, const Value& value)
+    {
+        Enter();
+        m_items.push_back(value);
+        for (std::size_t at = m_items.size() - 1; at > 0;)
+        {
+            std::size_t parent = (at - 1) / 2;
+            if (!Less(host, at, parent))
+                break;
+            std::swap(m_items[at], m_items[parent]);
+            at = parent;
+        }
+    }
+
+    Value PriorityQueueObject::Pop(NativeHost& host)
+    {
+        Enter();
+        std::size_t count = m_items.size() - 1;
+        std::swap(m_items.front(), m_items.back());
+        for (std::size_t at = 0;;)
+        {
+            std::size_t least = 2 * at + 1;
+            if (least >= count)
+                break;
+            if (least + 1 < count && Less(host, least + 1, least))
+                least++;
+            if (!Less(host, least, at))
+                break;
+            std::swap(m_items[at], m_items[least]);
+            at = least;
+        }
+
+        Value top = m_items.back();
+        m_items.pop_back();
+        return top;
+    }
+
+    void PriorityQueueObject::Clear()
+    {
+        Enter();
+        m_items.clear();
+    }
+
+    bool DefaultLess(const Value& a, const Value& b)
+    {
+        if (Value::BothInt(a, b))
+            return a.AsInt() < b.AsInt();
+        if (a.IsNumber() && b.IsNumber())
+            return a.ToDouble() < b.ToDouble();
+        if (IsString(a) && IsString(b))
+            return static_cast<StringObject*>(a.AsObject())->Data() < static_cast<StringObject*>(b.AsObject())->Data();
+        throw RuntimeException("Cannot compare '" + VM::TypeName(a) + "' with '" + VM::TypeName(b) + "'.");
+    }
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Object.h"
+
+namespace JScr::Runtime
+{
+    // The std.collections objects. They hold script values in memory of their own, so like arrays
+    // whoever stores into one calls Heap::WriteBarrier for the stored values.
+
+    // Hash map or hash set with open addressing and linear probing. Keys match the way == compares
+    // them: numbers by value whatever their type, strings by content, everything else by identity.
+    // Removing shifts the following entries back instead of leaving tombstones, so lookups never
+    // scan removed entries. Iteration order is unspecified.
+    class HashTableObject : public HeapObject
+    {
+    public:
+        // ObjectKind::Map or ObjectKind::Set; sets leave every value null.
+        explicit HashTableObject(ObjectKind kind) : HeapObject(kind) {}
+
+        static std::uint32_t Hash(const Value& key);
+        static bool SameKey(const Value& a, const Value& b);
+
+        bool IsSet() const { return Kind() == ObjectKind::Set; }
+        std::size_t Size() const { return m_size; }
+
+        // Null when the key is missing. For sets the key itself.
+        const Value* Find(const Value& key) const;
+        // Returns false when the key was there already and only its value was replaced.
+        bool Insert(const Value& key, const Value& value = Value::Null());
+        bool Erase(const Value& key);
+        void Clear();
+
+        template <typename F>
+        void ForEach(F&& f) const
+        {
+            for (const Slot& slot : m_slots)
+            {
+                if (slot.hash != 0)
+                    f(slot.key, IsSet() ? slot.key : slot.value);
+            }
+        }
+
+        void Trace(Tracer& tracer) const override
+        {
+            for (const Slot& slot : m_slots)
+            {
+                tracer.Mark(slot.key);
+                tracer.Mark(slot.value);
+            }
+        }
+    private:
+        // Key, value and hash share a slot so a lookup touches one cache line.
+        struct Slot
+        {
+            Value key;
+            Value value;
+            // 0 marks an empty slot; Hash never returns it.
+            std::uint32_t hash = 0;
+        };
+
+        // Slot of the key, or of the empty slot where it would go.
+        std::size_t Probe(const Value& key, std::uint32_t hash) const;
+        void Grow();
+
+        // Always a power of two in size. Empty slots hold null.
+        std::vector<Slot> m_slots;
+        std::size_t m_size = 0;
+    };
+
+    // Double ended queue in a ring buffer of power of two capacity.
+    class DequeObject : public HeapObject
+    {
+    public:
+        DequeObject() : HeapObject(ObjectKind::Deque) {}
+
+        std::size_t Size() const { return m_size; }
+        Value& At(std::size_t index) { return m_items[(m_head + index) & (m_items.size() - 1)]; }
+        const Value& At(std::size_t index) const { return m_items[(m_head + index) & (m_items.size() - 1)]; }
+
+        void PushBack(const Value& value)
+        {
+            Reserve(m_size + 1);
+            m_items[(m_head + m_size++) & (m_items.size() - 1)] = value;
+        }
+
+        void PushFront(const Value& value)
+        {
+            Reserve(m_size + 1);
+            m_head = (m_head - 1) & (m_items.size() - 1);
+            m_items[m_head] = value;
+            m_size++;
+        }
+
+        // The deque must not be empty.
+        Value PopBack()
+        {
+            Value& slot = At(--m_size);
+            return std::exchange(slot, Value::Null());
+        }
+
+        Value PopFront()
+        {
+            Value value = std::exchange(m_items[m_head], Value::Null());
+            m_head = (m_head + 1) & (m_items.size() - 1);
+            m_size--;
+            return value;
+        }
+
+        void Clear()
+        {
+            m_items.clear();
+            m_head = m_size = 0;
+        }
+
+        void Trace(Tracer& tracer) const override
+        {
+            for (std::size_t i = 0; i < m_size; i++)
+                tracer.Mark(At(i));
+        }
+    private:
+        void Reserve(std::size_t size);
+
+        std::vector<Value> m_items;
+        std::size_t m_head = 0;
+        std::size_t m_size = 0;
+    };
+
+    // Binary heap ordered by a script function `less(a, b)`, or by DefaultLess when there is none; the
+    // least item comes out first. Sifting only ever swaps items, so every item stays in the heap while
+    // the comparator runs, and the comparator may not change the heap it orders. A comparator that throws
+    // leaves all items in the queue, though not necessarily in order.
+    class PriorityQueueObject : public HeapObject
+    {
+    public:
+        explicit PriorityQueueObject(const Value& less) : HeapObject(ObjectKind::PriorityQueue), m_less(less) {}
+
+        std::size_t Size() const { return m_items.size(); }
+        const std::vector<Value>& Items() const { return m_items; }
+        // The queue must not be empty.
+        const Value& Peek() const { return m_items.front(); }
+
+        void Push(NativeHost& host, const Value& value);
+        Value Pop(NativeHost& host);
+        void Clear();
+
+        void Trace(Tracer& tracer) const override
+        {
+            tracer.Mark(m_less);
+            for (const Value& item : m_items)
+                tracer.Mark(item);
+        }
+    private:
+        bool Less(NativeHost& host, std::size_t a, std::size_t b);
+        void Enter();
+
+        Value m_less;
+        std::vector<Value> m_items;
+        bool m_busy = false;
+    };
+
+    // The order < gives numbers and strings. Throws for anything else.
+    bool DefaultLess(const Value& a, const Value& b);
+}
@@ -0,0 +1,1937 @@
+#include "Compiler.h"
+#include <algorithm>
+#include <any>
+#include <functional>
+#include "../Utils/VectorUtils.h"
+#include "StandardLibrary.h"
+#include "AstWalker.h"
+#include "ClosureAnalysis.h"
+#include "Superinstructions.h"
+using namespace JScr::Utils;
+
+namespace JScr::Runtime
+{
+    static constexpr int MaxRegisters = 250;
+    static constexpr std::size_t ArrayBatchSize = 64;
+    static constexpr std::size_t MaxInlineDepth = 4;
+
+    namespace
+    {
+        // Finds an `await` outside of any function, which makes the top level code async.
+        class TopLevelAwait : public AstWalker
+        {
+        public:
+            bool found = false;
+
+        protected:
+            void Visited(const Expr& expr) override
+            {
+                found |= expr.Kind() == NodeType::AWAIT_EXPR && Nesting() == 0;
+            }
+        };
+    }
+
+    std::shared_ptr<Module> Compiler::Compile(Program& program, const HostFunctions& hosts)
+    {
+        Compiler compiler(program, hosts);
+        compiler.CompileProgram();
+
+        Module& module = *compiler.m_module;
+        for (auto& proto : module.functions)
+        {
+            Superinstructions::Fuse(*proto);
+            proto->firstCache = module.numCaches;
+            module.numCaches += proto->numCaches;
+        }
+        return compiler.m_module;
+    }
+
+    Compiler::Compiler(Program& program, const HostFunctions& hosts) : m_program(program), m_hosts(hosts), m_module(std::make_shared<Module>())
+    {
+        m_module->fileDir = program.FileDir();
+    }
+
+    void Compiler::CompileProgram()
+    {
+        auto main = std::make_unique<FunctionProto>();
+        main->name = "main";
+
+        FunctionState fs{};
+        fs.proto = main.get();
+        fs.body = &m_program.Body();
+        m_module->functions.push_back(std::move(main));
+        m_fs = &fs;
+
+        TopLevelAwait await{};
+        await.Statements(m_program.Body());
+        if (await.found)
+            BeginAsync();
+
+        HoistDeclarations();
+
+        for (const auto& stmt : m_program.Body())
+        {
+            switch (stmt->Kind())
+            {
+            case NodeType::FUNCTION_DECLARATION:
+            case NodeType::OBJECT_DECLARATION:
+            case NodeType::ENUM_DECLARATION:
+            case NodeType::IMPORT_STMT:
+                continue; // <-- Already emitted by HoistDeclarations().
+            default:
+                CompileStmt(*stmt);
+            }
+        }
+
+        EmitReturn(std::nullopt);
+        m_fs = nullptr;
+    }
+
+    // Top level functions, enums, object types and imports are usable before the line that declares
+    // them, and top level variables are known up front so function bodies can refer to them.
+    void Compiler::HoistDeclarations()
+    {
+        for (const auto& stmt : m_program.Body())
+        {
+            switch (stmt->Kind())
+            {
+            case NodeType::IMPORT_STMT:
+                DeclareImport(static_cast<const ImportStmt&>(*stmt));
+                break;
+            case NodeType::OBJECT_DECLARATION:
+                DeclareObjectType(static_cast<const ObjectDeclaration&>(*stmt));
+                break;
+            case NodeType::ENUM_DECLARATION:
+                DeclareEnum(static_cast<const EnumDeclaration&>(*stmt));
+                break;
+            case NodeType::FUNCTION_DECLARATION:
+            {
+                const auto& fn = static_cast<const FunctionDeclaration&>(*stmt);
+                DeclareGlobal(fn.Identifier(), std::nullopt, true);
+                if (auto candidate = InlineAnalysis::Analyze(fn); candidate.has_value())
+                    m_inlinable.emplace(fn.Identifier(), std::move(candidate.value()));
+                break;
+            }
+            case NodeType::VAR_DECLARATION:
+            {
+                const auto& decl = static_cast<const VarDeclaration&>(*stmt);
+                DeclareGlobal(decl.Identifier(), decl.Type(), decl.Constant());
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        for (const auto& stmt : m_program.Body())
+        {
+            if (stmt->Kind() != NodeType::FUNCTION_DECLARATION)
+                continue;
+
+            const auto& fn = static_cast<const FunctionDeclaration&>(*stmt);
+            std::vector<Param> params;
+            for (const auto& param : fn.Parameters())
+                params.push_back(Param{ param.Identifier(), param.Type() });
+
+            std::uint16_t index = CompileFunction(fn.Identifier(), params, fn.Body(), fn.InstantReturn(), fn.Type(), fn.Async());
+
+            int mark = m_fs->freeReg;
+            std::uint8_t reg = AllocReg();
+            EmitClosure(reg, index);
+            Emit(Instruction::ABx(OpCode::SETGLOBAL, reg, m_globals.at(fn.Identifier())));
+            FreeRegsTo(mark);
+        }
+    }
+
+    // ----- Statements -----
+
+    void Compiler::CompileStmt(const Stmt& stmt)
+    {
+        switch (stmt.Kind())
+        {
+        case NodeType::IMPORT_STMT:
+            Error("Imports are only allowed at the top level of a script.");
+        case NodeType::VAR_DECLARATION:
+            CompileVarDeclaration(static_cast<const VarDeclaration&>(stmt));
+            break;
+        case NodeType::FUNCTION_DECLARATION:
+            CompileLocalFunction(static_cast<const FunctionDeclaration&>(stmt));
+            break;
+        case NodeType::OBJECT_DECLARATION:
+            Error("Object declarations are only allowed at the top level of a script.");
+        case NodeType::ENUM_DECLARATION:
+            Error("Enum declarations are only allowed at the top level of a script.");
+        case NodeType::RETURN_DECLARATION:
+            CompileReturn(static_cast<const ReturnDeclaration&>(stmt).Value());
+            break;
+        case NodeType::DELETE_DECLARATION:
+            CompileDelete(static_cast<const DeleteDeclaration&>(stmt));
+            break;
+        case NodeType::IF_ELSE_DECLARATION:
+            CompileIfElse(static_cast<const IfElseDeclaration&>(stmt));
+            break;
+        case NodeType::WHILE_DECLARATION:
+            CompileWhile(static_cast<const WhileDeclaration&>(stmt));
+            break;
+        case NodeType::FOR_DECLARATION:
+            CompileFor(static_cast<const ForDeclaration&>(stmt));
+            break;
+        default:
+        {
+            const auto* expr = dynamic_cast<const Expr*>(&stmt);
+            if (expr == nullptr)
+                Error("Unsupported statement.");
+
+            CompileEffect(*expr);
+        }
+        }
+    }
+
+    void Compiler::CompileBlock(const std::vector<std::unique_ptr<Stmt>>& body)
+    {
+        BeginScope();
+        CompileStatements(body);
+        EndScope();
+    }
+
+    void Compiler::CompileStatements(const std::vector<std::unique_ptr<Stmt>>& body)
+    {
+        for (std::size_t i = 0; i < body.size(); i++)
+        {
+            m_fs->statements = &body;
+            m_fs->statement = i;
+            CompileStmt(*body[i]);
+        }
+    }
+
+    void Compiler::CompileVarDeclaration(const VarDeclaration& decl)
+    {
+        auto CompileInitialValue = [&](std::uint8_t dst)
+        {
+            if (!decl.Value().has_value() || !decl.Value().value())
+            {
+                EmitDefaultValue(dst, decl.Type());
+                return;
+            }
+
+            const Expr& value = *decl.Value().value();
+            if (value.Kind() == NodeType::OBJECT_CONSTRUCTOR_EXPR)
+            {
+                std::optional<Types::Type> type = decl.Type();
+                CompileObjectConstructor(static_cast<const ObjectConstructorExpr&>(value), dst, &type);
+            }
+            else
+                ExprTo(value, dst);
+
+            EmitConversion(dst, decl.Type(), value);
+        };
+
+        if (IsTopLevel())
+        {
+            // Globals were declared while hoisting.
+            int mark = m_fs->freeReg;
+            std::uint8_t reg = AllocReg();
+            CompileInitialValue(reg);
+            Emit(Instruction::ABx(OpCode::SETGLOBAL, reg, m_globals.at(decl.Identifier())));
+            FreeRegsTo(mark);
+            return;
+        }
+
+        std::uint8_t reg = AllocReg();
+        const Expr* value = decl.Value().has_value() ? decl.Value().value().get() : nullptr;
+        if (value != nullptr && value->Kind() == NodeType::LAMBDA_EXPR)
+        {
+            const auto& lambda = static_cast<const LambdaExpr&>(*value);
+            std::vector<Param> params;
+            for (const auto& ident : lambda.ParamIdents())
+                params.push_back(Param{ ident.Symbol(), std::nullopt });
+
+            auto captures = LiftedCaptures(decl, decl.Identifier(), params, lambda.Body());
+            if (!captures.empty())
+            {
+                auto liftedArgs = AddLiftedParams(captures, params);
+                EmitClosure(reg, CompileFunction("lambda", params, lambda.Body(), lambda.InstantReturn(), std::nullopt));
+                EmitConversion(reg, decl.Type());
+                DeclareLocal(decl.Identifier(), reg, decl.Type(), decl.Constant());
+                m_fs->locals.back().liftedArgs = std::move(liftedArgs);
+                return;
+            }
+        }
+
+        CompileInitialValue(reg);
+        DeclareLocal(decl.Identifier(), reg, decl.Type(), decl.Constant());
+    }
+
+    void Compiler::CompileLocalFunction(const FunctionDeclaration& fn)
+    {
+        std::uint8_t reg = AllocReg();
+        DeclareLocal(fn.Identifier(), reg, std::nullopt, true); // <-- Declared first so the body may recurse.
+
+        std::vector<Param> params;
+        for (const auto& param : fn.Parameters())
+            params.push_back(Param{ param.Identifier(), param.Type() });
+
+        // A waiting async function would keep the values it was called with instead of seeing later assignments.
+        auto captures = fn.Async() ? std::vector<std::string>{} : LiftedCaptures(fn, fn.Identifier(), params, fn.Body());
+        auto liftedArgs = AddLiftedParams(captures, params);
+
+        std::uint16_t index = CompileFunction(fn.Identifier(), params, fn.Body(), fn.InstantReturn(), fn.Type(), fn.Async());
+        EmitClosure(reg, index);
+        m_fs->locals[FindLocal(*m_fs, fn.Identifier())].liftedArgs = std::move(liftedArgs);
+    }
+
+    std::uint16_t Compiler::CompileFunction(const std::string& name, const std::vector<Param>& params, const std::vector<std::unique_ptr<Stmt>>& body, bool instantReturn, const std::optional<Types::Type>& returnType, bool async)
+    {
+        if (m_module->functions.size() >= 0xFFFF)
+            Error("Too many functions in one script.");
+        if (params.size() > 200)
+            Error("Function '" + name + "' declares too many parameters.");
+
+        auto proto = std::make_unique<FunctionProto>();
+        proto->name = name;
+        proto->numParams = (std::uint8_t) params.size();
+
+        FunctionProto* protoPtr = proto.get();
+        std::uint16_t index = (std::uint16_t) m_module->functions.size();
+        proto->index = index;
+        m_module->functions.push_back(std::move(proto));
+
+        FunctionState fs{};
+        fs.parent = m_fs;
+        fs.proto = protoPtr;
+        fs.depth = 1;
+        fs.body = &body;
+        if (returnType.has_value() && !returnType->Is(Types::Uid::Void))
+            fs.returnType.emplace(returnType.value());
+        m_fs = &fs;
+
+        for (const auto& param : params)
+        {
+            std::uint8_t reg = AllocReg();
+            DeclareLocal(param.name, reg, param.type, false);
+            EmitConversion(reg, param.type);
+        }
+        if (async)
+            BeginAsync();
+
+        const Expr* instantValue = instantReturn && body.size() == 1 ? dynamic_cast<const Expr*>(body[0].get()) : nullptr;
+        if (instantValue != nullptr)
+        {
+            CompileReturn(*instantValue);
+        }
+        else
+        {
+            CompileStatements(body);
+            EmitReturn(std::nullopt);
+        }
+
+        for (const auto& upvalue : fs.upvalues)
+            protoPtr->upvalues.push_back(upvalue.desc);
+
+        m_fs = fs.parent;
+        return index;
+    }
+
+    // A local function that never escapes, that is one only ever called directly by the code after its
+    // declaration, needs no closure: the variables it captures are passed as extra arguments instead
+    // (lambda lifting), which leaves it with a constant closure. Returns those variables, or nothing
+    // when the function has to stay a closure.
+    //
+    // The values are read at each call, which is only the same as capturing them as long as no other
+    // function can assign them in the meantime and nothing inside the lifted function assigns them or
+    // keeps them beyond the call.
+    std::vector<std::string> Compiler::LiftedCaptures(const Stmt& decl, const std::string& name, const std::vector<Param>& params, const std::vector<std::unique_ptr<Stmt>>& body)
+    {
+        auto following = Following(decl);
+        if (!following.has_value() || params.size() > 200 || !ClosureAnalysis::OnlyCalled(name, params.size(), following.value()))
+            return {};
+
+        std::vector<std::string> names;
+        for (const auto& param : params)
+            names.push_back(param.name);
+
+        const auto& nestedAssignments = NestedAssignments(*m_fs);
+
+        std::vector<std::string> captures;
+        for (const auto& variable : ClosureAnalysis::Find(names, body))
+        {
+            if (variable.name == name)
+                return {};
+
+            if (FindLocal(*m_fs, variable.name) < 0)
+            {
+                // Variables of enclosing functions keep the closure; globals are read by the function itself.
+                for (FunctionState* fs = m_fs->parent; fs != nullptr; fs = fs->parent)
+                {
+                    if (FindLocal(*fs, variable.name) >= 0)
+                        return {};
+                }
+                continue;
+            }
+
+            if (variable.pinned || nestedAssignments.count(variable.name) != 0)
+                return {};
+            captures.push_back(variable.name);
+        }
+
+        if (params.size() + captures.size() > 200)
+            return {};
+        return captures;
+    }
+
+    // Registers of the captured variables, in the order they follow the arguments.
+    std::vector<std::uint8_t> Compiler::AddLiftedParams(const std::vector<std::string>& captures, std::vector<Param>& params)
+    {
+        std::vector<std::uint8_t> registers;
+        for (const auto& capture : captures)
+        {
+            registers.push_back(m_fs->locals[FindLocal(*m_fs, capture)].reg);
+            params.push_back(Param{ capture, std::nullopt });
+        }
+        return registers;
+    }
+
+    // The statements after `stmt` in the list being compiled, unless `stmt` is not directly part of it
+    // (the declaration of a for loop, say).
+    std::optional<std::span<const std::unique_ptr<Stmt>>> Compiler::Following(const Stmt& stmt) const
+    {
+        const auto* statements = m_fs->statements;
+        if (statements == nullptr || m_fs->statement >= statements->size() || (*statements)[m_fs->statement].get() != &stmt)
+            return std::nullopt;
+
+        return std::span<const std::unique_ptr<Stmt>>(*statements).subspan(m_fs->statement + 1);
+    }
+
+    void Compiler::CompileReturn(const Expr& value)
+    {
+        int mark = m_fs->freeReg;
+        std::uint8_t reg = ExprAnyReg(value);
+
+        // `return f(x)` and `=> f(x)` replace the frame instead of growing the stack. The conversion and
+        // RETURN below stay for when the VM has to make a regular call.
+        // Not in async functions, whose caller gets the task.
+        auto& code = m_fs->proto->code;
+        if (value.Kind() == NodeType::CALL_EXPR && code.back().Op() == OpCode::CALL && code.back().A() == reg && !m_fs->task.has_value())
+            code.back() = Instruction::ABC(OpCode::TAILCALL, reg, code.back().B(), ConversionFor(m_fs->returnType).value_or(Conversion::None));
+
+        auto conversion = ConversionFor(m_fs->returnType);
+        auto known = StaticType(value);
+        if (conversion.has_value() && (!known.has_value() || conversion != (std::uint8_t) known.value()))
+        {
+            if (IsLocalReg(reg))
+            {
+                std::uint8_t temp = AllocReg();
+                Emit(Instruction::ABC(OpCode::MOVE, temp, reg));
+                reg = temp;
+            }
+            EmitConversion(reg, m_fs->returnType);
+        }
+
+        EmitReturn(reg);
+        FreeRegsTo(mark);
+    }
+
+    void Compiler::CompileDelete(const DeleteDeclaration& del)
+    {
+        auto ref = Resolve(del.Value());
+        if (!ref.has_value())
+            Error("Cannot delete undeclared identifier '" + del.Value() + "'.");
+        if (ref->constant)
+            Error("Cannot delete constant '" + del.Value() + "'.");
+
+        int mark = m_fs->freeReg;
+        switch (ref->kind)
+        {
+        case VarRef::LOCAL:
+        {
+            Emit(Instruction::ABC(OpCode::LOADNULL, (std::uint8_t) ref->index));
+            // The register stays reserved until the scope ends, but the name is gone.
+            m_fs->locals[FindLocal(*m_fs, del.Value())].name = "";
+            break;
+        }
+        case VarRef::UPVALUE:
+        {
+            std::uint8_t reg = AllocReg();
+            Emit(Instruction::ABC(OpCode::LOADNULL, reg));
+            Emit(Instruction::ABC(OpCode::SETUPVAL, reg, (std::uint8_t) ref->index));
+            break;
+        }
+        case VarRef::GLOBAL:
+        {
+            std::uint8_t reg = AllocReg();
+            Emit(Instruction::ABC(OpCode::LOADNULL, reg));
+            Emit(Instruction::ABx(OpCode::SETGLOBAL, reg, ref->index));
+            break;
+        }
+        }
+        FreeRegsTo(mark);
+    }
+
+    void Compiler::CompileIfElse(const IfElseDeclaration& ifElse)
+    {
+        if (CompileEnumSwitch(ifElse))
+            return;
+
+        std::vector<int> exits;
+        const auto& blocks = ifElse.Blocks();
+
+        for (std::size_t i = 0; i < blocks.size(); i++)
+        {
+            int mark = m_fs->freeReg;
+            std::uint8_t condition = ExprAnyReg(blocks[i].Condition());
+            int skip = EmitJump(OpCode::JMPIFNOT, condition);
+            FreeRegsTo(mark);
+
+            CompileBlock(blocks[i].Body());
+
+            if (i + 1 < blocks.size() || !ifElse.ElseBody().empty())
+                exits.push_back(EmitJump(OpCode::JMP, 0));
+            PatchJump(skip);
+        }
+
+        CompileBlock(ifElse.ElseBody());
+
+        for (int exit : exits)
+            PatchJump(exit);
+    }
+
+    // `if (s == State.A) ... else if (s == State.B || s == State.C) ...` where every condition compares the
+    // same variable against entries of one enum becomes a single JMPTABLE on that variable.
+    bool Compiler::CompileEnumSwitch(const IfElseDeclaration& ifElse)
+    {
+        const auto& blocks = ifElse.Blocks();
+        if (blocks.size() < 2)
+            return false;
+
+        const std::string* subject = nullptr;
+        std::optional<std::uint16_t> enumIndex = std::nullopt;
+        std::vector<std::vector<std::int32_t>> cases;
+
+        // Collects the entries a condition matches; false when it is not of the recognised form.
+        std::function<bool(const Expr&, std::vector<std::int32_t>&)> Collect = [&](const Expr& condition, std::vector<std::int32_t>& entries)
+        {
+            if (condition.Kind() != NodeType::EQUALITY_CHECK_EXPR)
+                return false;
+
+            const auto& check = static_cast<const EqualityCheckExpr&>(condition);
+            if (check.Operator() == EqualityCheckExpr::Type::OR)
+                return Collect(check.Left(), entries) && Collect(check.Right(), entries);
+            if (check.Operator() != EqualityCheckExpr::Type::EQUALS)
+                return false;
+
+            auto entry = EnumEntry(check.Right());
+            const Expr* other = &check.Left();
+            if (!entry.has_value())
+            {
+                entry = EnumEntry(check.Left());
+                other = &check.Right();
+            }
+            if (!entry.has_value() || other->Kind() != NodeType::IDENTIFIER)
+                return false;
+
+            const std::string& name = static_cast<const Identifier*>(other)->Symbol();
+            if ((subject != nullptr && *subject != name) || (enumIndex.has_value() && enumIndex.value() != entry->first))
+                return false;
+
+            subject = &name;
+            enumIndex = entry->first;
+            entries.push_back(entry->second);
+            return true;
+        };
+
+        for (const auto& block : blocks)
+        {
+            cases.emplace_back();
+            if (!Collect(block.Condition(), cases.back()))
+                return false;
+        }
+
+        auto ref = Resolve(*subject);
+        if (!ref.has_value())
+            return false;
+
+        const EnumType& type = m_module->enumTypes[enumIndex.value()];
+        JumpTable table{};
+        table.low = 0;
+        table.targets.assign(type.entries.size(), -1);
+
+        int mark = m_fs->freeReg;
+        std::uint8_t reg = ref->kind == VarRef::LOCAL ? (std::uint8_t) ref->index : AllocReg();
+        if (ref->kind != VarRef::LOCAL)
+            LoadVariable(*subject, reg);
+        std::uint16_t tableIndex = (std::uint16_t) m_fs->proto->jumpTables.size();
+        if (tableIndex == 0xFFFF)
+            Error("Function '" + m_fs->proto->name + "' has too many enum switches.");
+        m_fs->proto->jumpTables.emplace_back();
+        Emit(Instruction::ABx(OpCode::JMPTABLE, reg, tableIndex));
+        FreeRegsTo(mark);
+
+        int origin = CurrentPc();
+        std::vector<int> exits;
+        for (std::size_t i = 0; i < blocks.size(); i++)
+        {
+            // The first block naming an entry wins, like it would in the chain.
+            for (std::int32_t entry : cases[i])
+            {
+                if (table.targets[entry] < 0)
+                    table.targets[entry] = CurrentPc() - origin;
+            }
+
+            CompileBlock(blocks[i].Body());
+            exits.push_back(EmitJump(OpCode::JMP, 0));
+        }
+
+        table.fallback = CurrentPc() - origin;
+        for (auto& target : table.targets)
+        {
+            if (target < 0)
+                target = table.fallback;
+        }
+        CompileBlock(ifElse.ElseBody());
+
+        for (int exit : exits)
+            PatchJump(exit);
+
+        m_fs->proto->jumpTables[tableIndex] = std::move(table);
+        return true;
+    }
+
+    void Compiler::CompileWhile(const WhileDeclaration& loop)
+    {
+        BeginScope();
+        auto analysis = AnalyzeLoop(nullptr, loop.Condition(), loop.Body());
+        for (const Expr* invariant : analysis.invariants)
+            Precompute(*invariant);
+
+        int start = CurrentPc();
+
+        int mark = m_fs->freeReg;
+        std::uint8_t condition = ExprAnyReg(loop.Condition());
+        int exit = EmitJump(OpCode::JMPIFNOT, condition);
+        FreeRegsTo(mark);
+
+        CompileBlock(loop.Body());
+        EmitLoop(start);
+        PatchJump(exit);
+        ForgetLoop(analysis);
+        EndScope();
+    }
+
+    void Compiler::CompileFor(const ForDeclaration& loop)
+    {
+        BeginScope();
+        CompileStmt(loop.Declaration());
+
+        auto analysis = AnalyzeLoop(&loop, loop.Condition(), loop.Body());
+        for (const Expr* invariant : analysis.invariants)
+            Precompute(*invariant);
+        for (const auto& product : analysis.products)
+            Precompute(*product.expr);
+        m_fs->inBounds.insert(analysis.inBounds.begin(), analysis.inBounds.end());
+
+        int start = CurrentPc();
+
+        int mark = m_fs->freeReg;
+        std::uint8_t condition = ExprAnyReg(loop.Condition());
+        int exit = EmitJump(OpCode::JMPIFNOT, condition);
+        FreeRegsTo(mark);
+
+        CompileBlock(loop.Body());
+        CompileEffect(loop.Action());
+
+        // Strength reduction: `i * c` follows `i` by adding `step * c`, wrapping like the multiplication.
+        for (const auto& product : analysis.products)
+        {
+            mark = m_fs->freeReg;
+            std::uint8_t reg = m_fs->precomputed.at(product.expr);
+            std::uint8_t increment = AllocReg();
+            EmitLoadInt(increment, (std::int32_t) ((std::uint32_t) analysis.step.value() * (std::uint32_t) product.factor));
+            Emit(Instruction::ABC(OpCode::IADD, reg, reg, increment));
+            FreeRegsTo(mark);
+        }
+
+        EmitLoop(start);
+        PatchJump(exit);
+        ForgetLoop(analysis);
+        EndScope();
+    }
+
+    LoopAnalysis::Result Compiler::AnalyzeLoop(const ForDeclaration* loop, const Expr& condition, const std::vector<std::unique_ptr<Stmt>>& body)
+    {
+        auto stable = [&](const std::string& name)
+        {
+            if (FindLocal(*m_fs, name) < 0)
+                return false;
+            return NestedAssignments(*m_fs).count(name) == 0;
+        };
+
+        // Declared types are converted to on every store, so these always hold a string or typed array.
+        auto fixedLength = [&](const std::string& name)
+        {
+            const std::optional<Types::Type>* type = nullptr;
+            for (FunctionState* fs = m_fs; fs != nullptr && type == nullptr; fs = fs->parent)
+            {
+                if (int local = FindLocal(*fs, name); local >= 0)
+                    type = &fs->locals[local].type;
+            }
+            if (auto global = m_globals.find(name); type == nullptr && global != m_globals.end())
+                type = &m_globalVars[global->second].type;
+
+            auto conversion = type != nullptr ? ConversionFor(*type) : std::nullopt;
+            return conversion.has_value() && (conversion.value() == (std::uint8_t) Types::Uid::String || (conversion.value() & Conversion::TypedArray) != 0);
+        };
+
+        if (loop != nullptr)
+            return LoopAnalysis::Analyze(*loop, stable, fixedLength);
+        return LoopAnalysis::Analyze(condition, body, stable, fixedLength);
+    }
+
+    // Evaluates `expr` once into a register of its own; compiling it again afterwards reads that register.
+    void Compiler::Precompute(const Expr& expr)
+    {
+        std::uint8_t reg = ReserveReg();
+        ExprTo(expr, reg);
+        m_fs->precomputed.emplace(&expr, reg);
+    }
+
+    void Compiler::ForgetLoop(const LoopAnalysis::Result& analysis)
+    {
+        for (const Expr* invariant : analysis.invariants)
+            m_fs->precomputed.erase(invariant);
+        for (const auto& product : analysis.products)
+            m_fs->precomputed.erase(product.expr);
+        for (const IndexExpr* index : analysis.inBounds)
+            m_fs->inBounds.erase(index);
+    }
+
+    // Compiles an expression whose value is thrown away.
+    void Compiler::CompileEffect(const Expr& expr)
+    {
+        int mark = m_fs->freeReg;
+        if (expr.Kind() == NodeType::ASSIGNMENT_EXPR)
+            CompileAssignment(static_cast<const AssignmentExpr&>(expr), std::nullopt);
+        else
+            ExprTo(expr, AllocReg());
+        FreeRegsTo(mark);
+    }
+
+    // ----- Expressions -----
+
+    // Evaluates `expr` into register `dst`. Temporaries used on the way are released again.
+    void Compiler::ExprTo(const Expr& expr, std::uint8_t dst)
+    {
+        if (auto precomputed = m_fs->precomputed.find(&expr); precomputed != m_fs->precomputed.end())
+        {
+            if (precomputed->second != dst)
+                Emit(Instruction::ABC(OpCode::MOVE, dst, precomputed->second));
+            return;
+        }
+
+        int mark = m_fs->freeReg;
+
+        switch (expr.Kind())
+        {
+        case NodeType::NUMERIC_LITERAL:
+            EmitLoadInt(dst, static_cast<const NumericLiteral&>(expr).Value());
+            break;
+        case NodeType::FLOAT_LITERAL:
+            Emit(Instruction::ABx(OpCode::LOADK, dst, AddConstant(Value::Float(static_cast<const FloatLiteral&>(expr).Value()))));
+            break;
+        case NodeType::DOUBLE_LITERAL:
+            Emit(Instruction::ABx(OpCode::LOADK, dst, AddConstant(Value::Double(static_cast<const DoubleLiteral&>(expr).Value()))));
+            break;
+        case NodeType::CHAR_LITERAL:
+            Emit(Instruction::ABx(OpCode::LOADK, dst, AddConstant(Value::Char(static_cast<const CharLiteral&>(expr).Value()))));
+            break;
+        case NodeType::STRING_LITERAL:
+            Emit(Instruction::ABx(OpCode::LOADK, dst, StringConstant(static_cast<const StringLiteral&>(expr).Value())));
+            break;
+        case NodeType::IDENTIFIER:
+            LoadVariable(static_cast<const Identifier&>(expr).Symbol(), dst);
+            break;
+        case NodeType::BINARY_EXPR:
+        {
+            const auto& binary = static_cast<const BinaryExpr&>(expr);
+            OpCode op;
+            switch (binary.Operator())
+            {
+            case '+': op = OpCode::ADD; break;
+            case '-': op = OpCode::SUB; break;
+            case '*': op = OpCode::MUL; break;
+            case '/': op = OpCode::DIV; break;
+            case '%': op = OpCode::MOD; break;
+            default: Error(std::string("Unknown binary operator '") + binary.Operator() + "'.");
+            }
+
+            if (auto type = SpecializedType(op, binary.Left(), binary.Right()); type.has_value())
+            {
+                std::uint8_t left = PromotedOperand(binary.Left(), type.value());
+                std::uint8_t right = PromotedOperand(binary.Right(), type.value());
+                Emit(Instruction::ABC(Specialization::For(op, type.value()).value(), dst, left, right));
+                break;
+            }
+
+            std::uint8_t left = ExprAnyReg(binary.Left());
+            std::uint8_t right = ExprAnyReg(binary.Right());
+            Emit(Instruction::ABC(op, dst, left, right));
+            break;
+        }
+        case NodeType::EQUALITY_CHECK_EXPR:
+        {
+            const auto& check = static_cast<const EqualityCheckExpr&>(expr);
+            OpCode op;
+            switch (check.Operator())
+            {
+            case EqualityCheckExpr::Type::AND:
+            case EqualityCheckExpr::Type::OR:
+                CompileLogical(check, dst);
+                FreeRegsTo(mark);
+                return;
+            case EqualityCheckExpr::Type::EQUALS:              op = OpCode::EQ; break;
+            case EqualityCheckExpr::Type::NOT_EQUALS:          op = OpCode::NE; break;
+            case EqualityCheckExpr::Type::LESS_THAN:           op = OpCode::LT; break;
+            case EqualityCheckExpr::Type::LESS_THAN_OR_EQUALS: op = OpCode::LE; break;
+            case EqualityCheckExpr::Type::MORE_THAN:           op = OpCode::GT; break;
+            case EqualityCheckExpr::Type::MORE_THAN_OR_EQUALS: op = OpCode::GE; break;
+            default: Error("Unknown comparison operator.");
+            }
+
+            if (auto type = SpecializedType(op, check.Left(), check.Right()); type.has_value())
+            {
+                std::uint8_t left = PromotedOperand(check.Left(), type.value());
+                std::uint8_t right = PromotedOperand(check.Right(), type.value());
+                // `a > b` is `b < a`, for NaN as well.
+                if (op == OpCode::GT || op == OpCode::GE)
+                    Emit(Instruction::ABC(Specialization::For(op == OpCode::GT ? OpCode::LT : OpCode::LE, type.value()).value(), dst, right, left));
+                else
+                    Emit(Instruction::ABC(Specialization::For(op, type.value()).value(), dst, left, right));
+                break;
+            }
+
+            std::uint8_t left = ExprAnyReg(check.Left());
+            std::uint8_t right = ExprAnyReg(check.Right());
+            Emit(Instruction::ABC(op, dst, left, right));
+            break;
+        }
+        case NodeType::UNARY_EXPR:
+        {
+            const auto& unary = static_cast<const UnaryExpr&>(expr);
+            if (unary.Operator() == "+")
+            {
+                ExprTo(unary.Object(), dst);
+                break;
+            }
+
+            std::uint8_t operand = ExprAnyReg(unary.Object());
+            if (unary.Operator() == "-")
+                Emit(Instruction::ABC(OpCode::NEG, dst, operand));
+            else if (unary.Operator() == "!")
+                Emit(Instruction::ABC(OpCode::NOT, dst, operand));
+            else
+                Error("Unknown unary operator '" + unary.Operator() + "'.");
+            break;
+        }
+        case NodeType::ASSIGNMENT_EXPR:
+            CompileAssignment(static_cast<const AssignmentExpr&>(expr), dst);
+            break;
+        case NodeType::MEMBER_EXPR:
+        {
+            const auto& member = static_cast<const MemberExpr&>(expr);
+            if (member.Property().Kind() != NodeType::IDENTIFIER)
+                Error("Member access requires an identifier after the dot.");
+
+            if (auto entry = EnumEntry(expr); entry.has_value())
+            {
+                EmitLoadInt(dst, entry->second);
+                break;
+            }
+            if (auto global = ImportedMember(expr); global.has_value())
+            {
+                Emit(Instruction::ABx(OpCode::GETGLOBAL, dst, global.value()));
+                break;
+            }
+
+            std::uint8_t object = ExprAnyReg(member.Object());
+            std::uint8_t key = FieldConstant(static_cast<const Identifier&>(member.Property()).Symbol());
+            EmitField(OpCode::GETFIELD, dst, object, key);
+            break;
+        }
+        case NodeType::INDEX_EXPR:
+        {
+            const auto& index = static_cast<const IndexExpr&>(expr);
+            std::uint8_t object = ExprAnyReg(index.Caller());
+            std::uint8_t key = ExprAnyReg(index.Arg());
+            Emit(Instruction::ABC(m_fs->inBounds.count(&index) != 0 ? OpCode::GETINBOUNDS : OpCode::GETINDEX, dst, object, key));
+            break;
+        }
+        case NodeType::CALL_EXPR:
+            CompileCall(static_cast<const CallExpr&>(expr), dst);
+            break;
+        case NodeType::AWAIT_EXPR:
+        {
+            if (!m_fs->task.has_value())
+                Error("'await' is only allowed in async functions and at the top level.");
+            std::uint8_t value = ExprAnyReg(static_cast<const AwaitExpr&>(expr).Value());
+            Emit(Instruction::ABC(OpCode::AWAIT, dst, value, m_fs->task.value()));
+            break;
+        }
+        case NodeType::OBJECT_CONSTRUCTOR_EXPR:
+            CompileObjectConstructor(static_cast<const ObjectConstructorExpr&>(expr), dst, nullptr);
+            break;
+        case NodeType::LAMBDA_EXPR:
+        {
+            const auto& lambda = static_cast<const LambdaExpr&>(expr);
+            std::vector<Param> params;
+            for (const auto& ident : lambda.ParamIdents())
+                params.push_back(Param{ ident.Symbol(), std::nullopt });
+
+            std::uint16_t index = CompileFunction("lambda", params, lambda.Body(), lambda.InstantReturn(), std::nullopt);
+            EmitClosure(dst, index);
+            break;
+        }
+        case NodeType::ARRAY_LITERAL:
+            CompileArray(static_cast<const ArrayLiteral&>(expr), dst);
+            break;
+        default:
+            Error("Unsupported expression.");
+        }
+
+        FreeRegsTo(mark);
+    }
+
+    // Like ExprTo, but reuses the register of a local variable instead of copying it.
+    std::uint8_t Compiler::ExprAnyReg(const Expr& expr)
+    {
+        if (auto precomputed = m_fs->precomputed.find(&expr); precomputed != m_fs->precomputed.end())
+            return precomputed->second;
+
+        if (expr.Kind() == NodeType::IDENTIFIER)
+        {
+            int local = FindLocal(*m_fs, static_cast<const Identifier&>(expr).Symbol());
+            if (local >= 0)
+                return m_fs->locals[local].reg;
+        }
+
+        std::uint8_t reg = AllocReg();
+        ExprTo(expr, reg);
+        return reg;
+    }
+
+    void Compiler::CompileAssignment(const AssignmentExpr& assignment, std::optional<std::uint8_t> dst)
+    {
+        const Expr& target = assignment.Assigne();
+        const Expr& value = assignment.Value();
+        int mark = m_fs->freeReg;
+
+        switch (target.Kind())
+        {
+        case NodeType::IDENTIFIER:
+        {
+            const std::string& name = static_cast<const Identifier&>(target).Symbol();
+            auto ref = Resolve(name);
+            if (!ref.has_value())
+                Error("Cannot assign to undeclared identifier '" + name + "'.");
+            if (ref->constant)
+                Error("Cannot assign to constant '" + name + "'.");
+
+            std::optional<Types::Type> type = ref->type->has_value() ? std::optional<Types::Type>(ref->type->value()) : std::nullopt;
+            std::uint8_t reg = ref->kind == VarRef::LOCAL ? (std::uint8_t) ref->index : dst.has_value() ? dst.value() : AllocReg();
+
+            if (value.Kind() == NodeType::OBJECT_CONSTRUCTOR_EXPR)
+                CompileObjectConstructor(static_cast<const ObjectConstructorExpr&>(value), reg, &type);
+            else
+                ExprTo(value, reg);
+            EmitConversion(reg, type, value);
+
+            if (ref->kind == VarRef::UPVALUE)
+                Emit(Instruction::ABC(OpCode::SETUPVAL, reg, (std::uint8_t) ref->index));
+            else if (ref->kind == VarRef::GLOBAL)
+                Emit(Instruction::ABx(OpCode::SETGLOBAL, reg, ref->index));
+
+            if (dst.has_value() && dst.value() != reg)
+                Emit(Instruction::ABC(OpCode::MOVE, dst.value(), reg));
+            break;
+        }
+        case NodeType::MEMBER_EXPR:
+        {
+            const auto& member = static_cast<const MemberExpr&>(target);
+            if (member.Property().Kind() != NodeType::IDENTIFIER)
+                Error("Member assignment requires an identifier after the dot.");
+
+            std::uint8_t object = ExprAnyReg(member.Object());
+            std::uint8_t key = FieldConstant(static_cast<const Identifier&>(member.Property()).Symbol());
+            std::uint8_t reg = ExprAnyReg(value);
+            EmitField(OpCode::SETFIELD, object, key, reg);
+
+            if (dst.has_value() && dst.value() != reg)
+                Emit(Instruction::ABC(OpCode::MOVE, dst.value(), reg));
+            break;
+        }
+        case NodeType::INDEX_EXPR:
+        {
+            const auto& index = static_cast<const IndexExpr&>(target);
+            std::uint8_t object = ExprAnyReg(index.Caller());
+            std::uint8_t key = ExprAnyReg(index.Arg());
+            std::uint8_t reg = ExprAnyReg(value);
+            Emit(Instruction::ABC(m_fs->inBounds.count(&index) != 0 ? OpCode::SETINBOUNDS : OpCode::SETINDEX, object, key, reg));
+
+            if (dst.has_value() && dst.value() != reg)
+                Emit(Instruction::ABC(OpCode::MOVE, dst.value(), reg));
+            break;
+        }
+        default:
+            Error("Invalid assignment target.");
+        }
+
+        FreeRegsTo(mark);
+    }
+
+    // `&&` and `||` short-circuit and always produce a bool.
+    void Compiler::CompileLogical(const EqualityCheckExpr& check, std::uint8_t dst)
+    {
+        bool isAnd = check.Operator() == EqualityCheckExpr::Type::AND;
+        OpCode shortCircuit = isAnd ? OpCode::JMPIFNOT : OpCode::JMPIF;
+
+        int mark = m_fs->freeReg;
+        std::uint8_t left = ExprAnyReg(check.Left());
+        int first = EmitJump(shortCircuit, left);
+        FreeRegsTo(mark);
+
+        std::uint8_t right = ExprAnyReg(check.Right());
+        int second = EmitJump(shortCircuit, right);
+        FreeRegsTo(mark);
+
+        Emit(Instruction::ABC(OpCode::LOADBOOL, dst, isAnd ? 1 : 0));
+        int exit = EmitJump(OpCode::JMP, 0);
+        PatchJump(first);
+        PatchJump(second);
+        Emit(Instruction::ABC(OpCode::LOADBOOL, dst, isAnd ? 0 : 1));
+        PatchJump(exit);
+    }
+
+    void Compiler::CompileCall(const CallExpr& call, std::uint8_t dst)
+    {
+        if (call.Args().size() > 200)
+            Error("Too many arguments in function call.");
+        if (CompileInline(call, dst))
+            return;
+
+        int mark = m_fs->freeReg;
+
+        // The callee and its arguments have to sit at the top of the frame. Reuse `dst` if it already is the top.
+        std::uint8_t base = (dst + 1 == m_fs->freeReg && !IsLocalReg(dst)) ? dst : AllocReg();
+        ExprTo(call.Caller(), base);
+
+        for (const auto& arg : call.Args())
+            ExprTo(*arg, AllocReg());
+
+        // A lifted function gets the variables it would have captured after its arguments.
+        std::size_t argc = call.Args().size();
+        if (call.Caller().Kind() == NodeType::IDENTIFIER)
+        {
+            int local = FindLocal(*m_fs, static_cast<const Identifier&>(call.Caller()).Symbol());
+            for (std::uint8_t reg : local >= 0 ? m_fs->locals[local].liftedArgs : std::vector<std::uint8_t>{})
+            {
+                Emit(Instruction::ABC(OpCode::MOVE, AllocReg(), reg));
+                argc++;
+            }
+        }
+
+        Emit(Instruction::ABC(OpCode::CALL, base, (std::uint8_t) argc));
+        if (base != dst)
+            Emit(Instruction::ABC(OpCode::MOVE, dst, base));
+        FreeRegsTo(mark);
+    }
+
+    // Replaces a call to a small top level function with its body. The arguments go into fresh registers
+    // that stand in for the parameters, converted the same way the callee would on entry.
+    bool Compiler::CompileInline(const CallExpr& call, std::uint8_t dst)
+    {
+        if (call.Caller().Kind() != NodeType::IDENTIFIER)
+            return false;
+
+        const std::string& name = static_cast<const Identifier&>(call.Caller()).Symbol();
+        auto candidate = m_inlinable.find(name);
+        if (candidate == m_inlinable.end() || Shadowed(name))
+            return false;
+
+        const FunctionDeclaration& fn = *candidate->second.fn;
+        if (call.Args().size() != fn.Parameters().size() || m_inlining.size() >= MaxInlineDepth
+            || std::find(m_inlining.begin(), m_inlining.end(), &fn) != m_inlining.end())
+            return false;
+        for (const auto& free : candidate->second.free)
+        {
+            if (Shadowed(free))
+                return false;
+        }
+
+        int mark = m_fs->freeReg;
+        std::vector<std::uint8_t> regs;
+        for (const auto& arg : call.Args())
+        {
+            regs.push_back(AllocReg());
+            ExprTo(*arg, regs.back());
+        }
+
+        // Arguments are converted once all of them are evaluated, like on entry to the function.
+        for (std::size_t i = 0; i < regs.size(); i++)
+            EmitConversion(regs[i], fn.Parameters()[i].Type(), *call.Args()[i]);
+
+        BeginScope();
+        for (std::size_t i = 0; i < regs.size(); i++)
+        {
+            const auto& param = fn.Parameters()[i];
+            DeclareLocal(param.Identifier(), regs[i], param.Type(), false);
+        }
+
+        m_inlining.push_back(&fn);
+        ExprTo(*candidate->second.value, dst);
+        if (!fn.Type().Is(Types::Uid::Void))
+            EmitConversion(dst, fn.Type(), *candidate->second.value);
+        m_inlining.pop_back();
+
+        EndScope();
+        FreeRegsTo(mark);
+        return true;
+    }
+
+    void Compiler::CompileArray(const ArrayLiteral& array, std::uint8_t dst)
+    {
+        int mark = m_fs->freeReg;
+        std::uint8_t target = IsLocalReg(dst) ? AllocReg() : dst;
+        int elementsMark = m_fs->freeReg;
+
+        const auto& elements = array.Value();
+        std::size_t i = 0;
+        do
+        {
+            std::size_t count = std::min(ArrayBatchSize, elements.size() - i);
+            std::uint8_t first = (std::uint8_t) m_fs->freeReg;
+            for (std::size_t j = 0; j < count; j++)
+                ExprTo(*elements[i + j], AllocReg());
+
+            Emit(Instruction::ABC(i == 0 ? OpCode::NEWARRAY : OpCode::APPEND, target, first, (std::uint8_t) count));
+            FreeRegsTo(elementsMark);
+            i += count;
+        } while (i < elements.size());
+
+        if (target != dst)
+            Emit(Instruction::ABC(OpCode::MOVE, dst, target));
+        FreeRegsTo(mark);
+    }
+
+    // `hint` carries the declared type of the variable being initialised for `Type name { ... }` and `name { ... }` forms.
+    void Compiler::CompileObjectConstructor(const ObjectConstructorExpr& ctor, std::uint8_t dst, const std::optional<Types::Type>* hint)
+    {
+        std::string typeName = "";
+        if (ctor.TargetVarIdentAsType())
+        {
+            if (const auto* type = std::any_cast<Types::Type>(&ctor.TargetVarIdent()); type != nullptr && type->Is(Types::Uid::Object))
+                typeName = type->Data();
+        }
+        if (typeName.empty() && hint != nullptr && hint->has_value() && (*hint)->Is(Types::Uid::Object))
+            typeName = (*hint)->Data();
+
+        std::uint16_t typeIndex = Module::AnonymousObjectType;
+        const ObjectDeclaration* decl = nullptr;
+        if (!typeName.empty())
+        {
+            auto it = m_objectTypes.find(typeName);
+            if (it == m_objectTypes.end())
+                Error("Unknown object type '" + typeName + "'.");
+            typeIndex = it->second;
+            decl = m_objectDecls[typeIndex];
+        }
+
+        int mark = m_fs->freeReg;
+        std::uint8_t target = IsLocalReg(dst) ? AllocReg() : dst;
+        Emit(Instruction::ABx(OpCode::NEWOBJECT, target, typeIndex));
+
+        std::vector<std::string> provided;
+        for (const auto& property : ctor.Properties())
+        {
+            if (decl != nullptr && !VectorUtils::Contains(m_module->objectTypes[typeIndex].propertyNames, property.Key()))
+                Error("Object type '" + typeName + "' has no property '" + property.Key() + "'.");
+            if (!property.Value().has_value())
+                Error("Property '" + property.Key() + "' requires a value in object constructor.");
+
+            int propertyMark = m_fs->freeReg;
+            std::uint8_t value = ExprAnyReg(*property.Value().value());
+            EmitField(OpCode::SETFIELD, target, FieldConstant(property.Key()), value);
+            FreeRegsTo(propertyMark);
+            provided.push_back(property.Key());
+        }
+
+        // Declared defaults for everything the constructor left out. Constant ones are already part of
+        // the instance template.
+        if (decl != nullptr)
+        {
+            const auto& defaults = m_module->objectTypes[typeIndex].propertyDefaults;
+            for (std::size_t i = 0; i < decl->Properties().size(); i++)
+            {
+                const auto& property = decl->Properties()[i];
+                if (!property.Value().has_value() || defaults[i].has_value() || VectorUtils::Contains(provided, property.Key()))
+                    continue;
+
+                int propertyMark = m_fs->freeReg;
+                std::uint8_t value = ExprAnyReg(*property.Value().value());
+                EmitField(OpCode::SETFIELD, target, FieldConstant(property.Key()), value);
+                FreeRegsTo(propertyMark);
+            }
+        }
+
+        if (target != dst)
+            Emit(Instruction::ABC(OpCode::MOVE, dst, target));
+        FreeRegsTo(mark);
+    }
+
+    void Compiler::LoadVariable(const std::string& name, std::uint8_t dst)
+    {
+        auto ref = Resolve(name);
+        if (!ref.has_value())
+        {
+            if (name == "true" || name == "false")
+                Emit(Instruction::ABC(OpCode::LOADBOOL, dst, name == "true" ? 1 : 0));
+            else if (name == "null")
+                Emit(Instruction::ABC(OpCode::LOADNULL, dst));
+            else if (NativeFunctionObject* native = FindNative(name))
+            {
+                // Bound on first use; the VM puts the native function into the global.
+                std::uint16_t global = DeclareGlobal(name, std::nullopt, true);
+                m_module->nativeGlobals.push_back(NativeGlobal{ global, Value::Object(native) });
+                Emit(Instruction::ABx(OpCode::GETGLOBAL, dst, global));
+            }
+            else
+                Error("Undeclared identifier '" + name + "'.");
+            return;
+        }
+
+        switch (ref->kind)
+        {
+        case VarRef::LOCAL:
+            if (ref->index != dst)
+                Emit(Instruction::ABC(OpCode::MOVE, dst, (std::uint8_t) ref->index));
+            break;
+        case VarRef::UPVALUE:
+            Emit(Instruction::ABC(OpCode::GETUPVAL, dst, (std::uint8_t) ref->index));
+            break;
+        case VarRef::GLOBAL:
+            Emit(Instruction::ABx(OpCode::GETGLOBAL, dst, ref->index));
+            break;
+        }
+    }
+
+    NativeFunctionObject* Compiler::FindNative(const std::string& name)
+    {
+        for (const auto& host : m_hosts)
+        {
+            if (host->name == name)
+            {
+                m_module->hostFunctions.push_back(host);
+                return m_module->constantHeap.Allocate<NativeFunctionObject>(host->name, host->trampoline, host->arity, const_cast<HostFunction*>(host.get()));
+            }
+        }
+
+        for (const StandardLibrary::Module* module : m_imports)
+        {
+            if (const auto* function = module->Find(name))
+                return MakeNative(*m_module, *function);
+        }
+
+        if (const auto* function = StandardLibrary::Find(name))
+            return MakeNative(*m_module, *function);
+        return nullptr;
+    }
+
+    NativeFunctionObject* Compiler::MakeNative(Module& module, const StandardLibrary::Function& function)
+    {
+        return module.constantHeap.Allocate<NativeFunctionObject>(function.name, function.function, function.arity);
+    }
+
+    // ----- Static types -----
+
+    std::optional<Types::Uid> Compiler::StaticType(const Expr& expr)
+    {
+        auto IsNumber = [](Types::Uid uid) { return uid == Types::Uid::Int || uid == Types::Uid::Float || uid == Types::Uid::Double || uid == Types::Uid::Char; };
+
+        switch (expr.Kind())
+        {
+        case NodeType::NUMERIC_LITERAL: return Types::Uid::Int;
+        case NodeType::FLOAT_LITERAL:   return Types::Uid::Float;
+        case NodeType::DOUBLE_LITERAL:  return Types::Uid::Double;
+        case NodeType::CHAR_LITERAL:    return Types::Uid::Char;
+        case NodeType::STRING_LITERAL:  return Types::Uid::String;
+        case NodeType::IDENTIFIER:
+        {
+            const std::string& name = static_cast<const Identifier&>(expr).Symbol();
+            if (!Shadowed(name) && m_globals.count(name) == 0)
+                return name == "true" || name == "false" ? std::optional(Types::Uid::Bool) : std::nullopt;
+
+            auto conversion = TrustedConversion(name);
+            if (!conversion.has_value() || (conversion.value() & Conversion::TypedArray) != 0)
+                return std::nullopt;
+            return (Types::Uid) conversion.value();
+        }
+        case NodeType::BINARY_EXPR:
+        {
+            const auto& binary = static_cast<const BinaryExpr&>(expr);
+            auto left = StaticType(binary.Left()), right = StaticType(binary.Right());
+            // A string on either side concatenates, or fails.
+            if (binary.Operator() == '+' && (left == Types::Uid::String || right == Types::Uid::String))
+                return Types::Uid::String;
+            if (!left.has_value() || !right.has_value() || !IsNumber(left.value()) || !IsNumber(right.value()))
+                return std::nullopt;
+
+            if (left == Types::Uid::Double || right == Types::Uid::Double)
+                return Types::Uid::Double;
+            if (left == Types::Uid::Float || right == Types::Uid::Float)
+                return Types::Uid::Float;
+            return Types::Uid::Int;
+        }
+        case NodeType::EQUALITY_CHECK_EXPR:
+        {
+            const auto& check = static_cast<const EqualityCheckExpr&>(expr);
+            bool logical = check.Operator() == EqualityCheckExpr::Type::AND || check.Operator() == EqualityCheckExpr::Type::OR;
+            if (logical && (StaticType(check.Left()) != Types::Uid::Bool || StaticType(check.Right()) != Types::Uid::Bool))
+                return std::nullopt;
+            return Types::Uid::Bool;
+        }
+        case NodeType::UNARY_EXPR:
+        {
+            const auto& unary = static_cast<const UnaryExpr&>(expr);
+            if (unary.Operator() == "!")
+                return Types::Uid::Bool;
+
+            auto operand = StaticType(unary.Object());
+            if (unary.Operator() == "+")
+                return operand;
+            if (!operand.has_value() || !IsNumber(operand.value()))
+                return std::nullopt;
+            return operand == Types::Uid::Char ? Types::Uid::Int : operand;
+        }
+        case NodeType::MEMBER_EXPR:
+        {
+            if (EnumEntry(expr).has_value())
+                return Types::Uid::Int;
+
+            const auto& member = static_cast<const MemberExpr&>(expr);
+            const Expr& property = member.Property();
+            if (property.Kind() != NodeType::IDENTIFIER || static_cast<const Identifier&>(property).Symbol() != "length" || member.Object().Kind() != NodeType::IDENTIFIER)
+                return std::nullopt;
+
+            auto conversion = TrustedConversion(static_cast<const Identifier&>(member.Object()).Symbol());
+            bool fixedLength = conversion.has_value() && (conversion.value() == (std::uint8_t) Types::Uid::String || (conversion.value() & Conversion::TypedArray) != 0);
+            return fixedLength ? std::optional(Types::Uid::Int) : std::nullopt;
+        }
+        case NodeType::INDEX_EXPR:
+        {
+            const auto& index = static_cast<const IndexExpr&>(expr);
+            if (index.Caller().Kind() != NodeType::IDENTIFIER)
+                return std::nullopt;
+
+            auto conversion = TrustedConversion(static_cast<const Identifier&>(index.Caller()).Symbol());
+            if (conversion == (std::uint8_t) Types::Uid::String)
+                return Types::Uid::Char;
+            if (conversion.has_value() && (conversion.value() & Conversion::TypedArray) != 0)
+                return (Types::Uid) Conversion::ElementUid(Conversion::ElementTypeOf(conversion.value()).value());
+            return std::nullopt;
+        }
+        default:
+            return std::nullopt;
+        }
+    }
+
+    // Globals are left out: they may still be null before their declaration has run.
+    std::optional<std::uint8_t> Compiler::TrustedConversion(const std::string& name)
+    {
+        for (FunctionState* fs = m_fs; fs != nullptr; fs = fs->parent)
+        {
+            int local = FindLocal(*fs, name);
+            if (local < 0)
+                continue;
+
+            // A nested function deleting it leaves null behind.
+            if (NestedAssignments(*fs).count(name) != 0)
+                return std::nullopt;
+            return ConversionFor(fs->locals[local].type);
+        }
+        return std::nullopt;
+    }
+
+    // Arithmetic promotes the way Arith does. Comparisons of mixed numbers go through double, which is
+    // what Compare and Equals do and holds every int and float exactly.
+    std::optional<Types::Uid> Compiler::SpecializedType(OpCode op, const Expr& left, const Expr& right)
+    {
+        auto l = StaticType(left), r = StaticType(right);
+        if (!l.has_value() || !r.has_value())
+            return std::nullopt;
+
+        if (l == Types::Uid::String && r == Types::Uid::String)
+            return op >= OpCode::EQ ? std::optional(Types::Uid::String) : std::nullopt;
+
+        auto IsNumber = [](Types::Uid uid) { return uid == Types::Uid::Int || uid == Types::Uid::Float || uid == Types::Uid::Double; };
+        if (!IsNumber(l.value()) || !IsNumber(r.value()))
+            return std::nullopt;
+
+        if (l == r)
+            return l;
+        if (op >= OpCode::EQ || l == Types::Uid::Double || r == Types::Uid::Double)
+            return Types::Uid::Double;
+        return Types::Uid::Float;
+    }
+
+    // Literals are promoted while compiling, anything else by a CONVERT into a temporary.
+    std::uint8_t Compiler::PromotedOperand(const Expr& expr, Types::Uid uid)
+    {
+        if (StaticType(expr) == uid)
+            return ExprAnyReg(expr);
+
+        std::uint8_t reg;
+        switch (expr.Kind())
+        {
+        case NodeType::NUMERIC_LITERAL:
+        {
+            std::int32_t value = static_cast<const NumericLiteral&>(expr).Value();
+            reg = AllocReg();
+            Emit(Instruction::ABx(OpCode::LOADK, reg, AddConstant(uid == Types::Uid::Double ? Value::Double(value) : Value::Float((float) value))));
+            break;
+        }
+        case NodeType::FLOAT_LITERAL:
+            reg = AllocReg();
+            Emit(Instruction::ABx(OpCode::LOADK, reg, AddConstant(Value::Double(static_cast<const FloatLiteral&>(expr).Value()))));
+            break;
+        default:
+        {
+            std::uint8_t value = ExprAnyReg(expr);
+            reg = AllocReg();
+            Emit(Instruction::ABC(OpCode::CONVERT, reg, value, (std::uint8_t) uid));
+            break;
+        }
+        }
+        return reg;
+    }
+
+    const std::unordered_set<std::string>& Compiler::NestedAssignments(FunctionState& fs)
+    {
+        if (!fs.nestedAssignments.has_value())
+            fs.nestedAssignments = ClosureAnalysis::AssignedInNestedFunctions(*fs.body);
+        return fs.nestedAssignments.value();
+    }
+
+    // ----- Declarations & scopes -----
+
+    std::uint16_t Compiler::DeclareGlobal(const std::string& name, const std::optional<Types::Type>& type, bool constant)
+    {
+        if (m_globals.find(name) != m_globals.end())
+            Error("Identifier '" + name + "' is already declared.");
+        if (m_globalVars.size() >= 0xFFFF)
+            Error("Too many global variables in one script.");
+
+        std::uint16_t index = (std::uint16_t) m_globalVars.size();
+        m_globals.emplace(name, index);
+        m_globalVars.push_back(GlobalVar{ type, constant });
+        m_module->globalNames.push_back(name);
+        return index;
+    }
+
+    void Compiler::DeclareLocal(const std::string& name, std::uint8_t reg, const std::optional<Types::Type>& type, bool constant)
+    {
+        for (auto it = m_fs->locals.rbegin(); it != m_fs->locals.rend() && it->depth == m_fs->depth; ++it)
+        {
+            if (it->name == name)
+                Error("Identifier '" + name + "' is already declared in this scope.");
+        }
+
+        m_fs->locals.push_back(LocalVar{ name, reg, m_fs->depth, type, constant, false });
+    }
+
+    void Compiler::DeclareObjectType(const ObjectDeclaration& decl)
+    {
+        if (m_objectTypes.find(decl.Identifier()) != m_objectTypes.end())
+            Error("Object type '" + decl.Identifier() + "' is already declared.");
+
+        ObjectType type{};
+        type.name = decl.Identifier();
+        for (const auto& property : decl.Properties())
+        {
+            if (VectorUtils::Contains(type.propertyNames, property.Key()))
+                Error("Property '" + property.Key() + "' is declared twice in object type '" + decl.Identifier() + "'.");
+
+            type.propertyNames.push_back(property.Key());
+            type.propertyTypes.push_back(property.Type());
+            type.propertyDefaults.push_back(ConstantDefault(property));
+        }
+
+        m_objectTypes.emplace(decl.Identifier(), (std::uint16_t) m_module->objectTypes.size());
+        m_module->objectTypes.push_back(std::move(type));
+        m_objectDecls.push_back(&decl);
+    }
+
+    // Evaluates literal property defaults at compile time, converted like SETFIELD would. Anything else,
+    // or a literal that would not convert, is left to the constructor code.
+    std::optional<Value> Compiler::ConstantDefault(const Property& property)
+    {
+        if (!property.Value().has_value() || !property.Value().value())
+            return std::nullopt;
+
+        const Expr& expr = *property.Value().value();
+        Value value;
+        switch (expr.Kind())
+        {
+        case NodeType::NUMERIC_LITERAL:
+            value = Value::Int(static_cast<const NumericLiteral&>(expr).Value());
+            break;
+        case NodeType::FLOAT_LITERAL:
+            value = Value::Float(static_cast<const FloatLiteral&>(expr).Value());
+            break;
+        case NodeType::DOUBLE_LITERAL:
+            value = Value::Double(static_cast<const DoubleLiteral&>(expr).Value());
+            break;
+        case NodeType::CHAR_LITERAL:
+            value = Value::Char(static_cast<const CharLiteral&>(expr).Value());
+            break;
+        case NodeType::IDENTIFIER:
+        {
+            const std::string& name = static_cast<const Identifier&>(expr).Symbol();
+            if (Resolve(name).has_value())
+                return std::nullopt;
+            if (name == "true" || name == "false")
+                value = Value::Bool(name == "true");
+            else if (name != "null")
+                return std::nullopt;
+            break;
+        }
+        case NodeType::STRING_LITERAL:
+            if (ConversionFor(property.Type()).value_or((std::uint8_t) Types::Uid::String) != (std::uint8_t) Types::Uid::String)
+                return std::nullopt;
+            return Value::Object(Intern(static_cast<const StringLiteral&>(expr).Value()));
+        default:
+            return std::nullopt;
+        }
+
+        auto conversion = ConversionFor(property.Type());
+        if (!conversion.has_value())
+            return value;
+        if (conversion.value() & Conversion::TypedArray)
+            return value.IsNull() ? std::optional<Value>(value) : std::nullopt;
+
+        switch ((Types::Uid) conversion.value())
+        {
+        case Types::Uid::Int:
+            return value.IsNumber() ? std::optional<Value>(Value::Int(value.ToInt())) : std::nullopt;
+        case Types::Uid::Float:
+            return value.IsNumber() ? std::optional<Value>(Value::Float((float) value.ToDouble())) : std::nullopt;
+        case Types::Uid::Double:
+            return value.IsNumber() ? std::optional<Value>(Value::Double(value.ToDouble())) : std::nullopt;
+        case Types::Uid::Char:
+            if (value.IsInt())
+                return Value::Char((char) value.AsInt());
+            return value.IsChar() ? std::optional<Value>(value) : std::nullopt;
+        case Types::Uid::Bool:
+            return value.IsBool() ? std::optional<Value>(value) : std::nullopt;
+        case Types::Uid::String:
+            return value.IsNull() ? std::optional<Value>(value) : std::nullopt;
+        default:
+            return value;
+        }
+    }
+
+    void Compiler::DeclareEnum(const EnumDeclaration& decl)
+    {
+        if (m_enumTypes.find(decl.Identifier()) != m_enumTypes.end())
+            Error("Enum '" + decl.Identifier() + "' is already declared.");
+
+        m_enumTypes.emplace(decl.Identifier(), (std::uint16_t) m_module->enumTypes.size());
+        m_module->enumTypes.push_back(EnumType{ decl.Identifier(), decl.Entries() });
+        std::uint16_t global = DeclareGlobal(decl.Identifier(), std::nullopt, true);
+
+        // The enum object itself is a constant of the top level function. It is only needed when the enum
+        // is used as a value; `Enum.Entry` folds to the entry's index.
+        EnumObject* object = m_module->constantHeap.Allocate<EnumObject>(&m_module->enumTypes.back());
+
+        int mark = m_fs->freeReg;
+        std::uint8_t reg = AllocReg();
+        Emit(Instruction::ABx(OpCode::LOADK, reg, AddConstant(Value::Object(object))));
+        Emit(Instruction::ABx(OpCode::SETGLOBAL, reg, global));
+        FreeRegsTo(mark);
+    }
+
+    // Enum index and entry index of `Enum.Entry` when Enum names a declared enum that is not shadowed.
+    std::optional<std::pair<std::uint16_t, std::int32_t>> Compiler::EnumEntry(const Expr& expr)
+    {
+        if (expr.Kind() != NodeType::MEMBER_EXPR)
+            return std::nullopt;
+
+        const auto& member = static_cast<const MemberExpr&>(expr);
+        if (member.Object().Kind() != NodeType::IDENTIFIER || member.Property().Kind() != NodeType::IDENTIFIER)
+            return std::nullopt;
+
+        const std::string& name = static_cast<const Identifier&>(member.Object()).Symbol();
+        auto type = m_enumTypes.find(name);
+        auto ref = Resolve(name);
+        if (type == m_enumTypes.end() || !ref.has_value() || ref->kind != VarRef::GLOBAL)
+            return std::nullopt;
+
+        const std::string& key = static_cast<const Identifier&>(member.Property()).Symbol();
+        const auto& entries = m_module->enumTypes[type->second].entries;
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            if (entries[i] == key)
+                return std::make_pair(type->second, (std::int32_t) i);
+        }
+
+        Error("Enum '" + name + "' has no entry '" + key + "'.");
+    }
+
+    // `import std.collections;` makes the module's functions callable by name, after host functions and
+    // before the core ones; `import std.collections as c;` makes them callable as c.function instead.
+    void Compiler::DeclareImport(const ImportStmt& import)
+    {
+        std::string path = "";
+        for (const auto& part : import.Target())
+            path += (path.empty() ? "" : ".") + part;
+
+        const StandardLibrary::Module* module = StandardLibrary::FindModule(path);
+        if (module == nullptr)
+            Error("Cannot resolve import '" + path + "'.");
+
+        if (import.Alias().empty())
+        {
+            if (std::find(m_imports.begin(), m_imports.end(), module) == m_imports.end())
+                m_imports.push_back(module);
+        }
+        else if (!m_importAliases.emplace(import.Alias(), module).second)
+            Error("Import alias '" + import.Alias() + "' is already declared.");
+    }
+
+    std::optional<std::uint16_t> Compiler::ImportedMember(const Expr& expr)
+    {
+        const auto& member = static_cast<const MemberExpr&>(expr);
+        if (member.Object().Kind() != NodeType::IDENTIFIER || member.Property().Kind() != NodeType::IDENTIFIER)
+            return std::nullopt;
+
+        const std::string& alias = static_cast<const Identifier&>(member.Object()).Symbol();
+        auto import = m_importAliases.find(alias);
+        if (import == m_importAliases.end() || Resolve(alias).has_value())
+            return std::nullopt;
+
+        const std::string& name = static_cast<const Identifier&>(member.Property()).Symbol();
+        const auto* function = import->second->Find(name);
+        if (function == nullptr)
+            Error("Module '" + std::string(import->second->path) + "' has no function '" + name + "'.");
+
+        // Bound on first use like any other native; the dot keeps the global apart from script names.
+        std::string global = alias + "." + name;
+        if (auto bound = m_globals.find(global); bound != m_globals.end())
+            return bound->second;
+        std::uint16_t index = DeclareGlobal(global, std::nullopt, true);
+        m_module->nativeGlobals.push_back(NativeGlobal{ index, Value::Object(MakeNative(*m_module, *function)) });
+        return index;
+    }
+
+    std::optional<Compiler::VarRef> Compiler::Resolve(const std::string& name)
+    {
+        int local = FindLocal(*m_fs, name);
+        if (local >= 0)
+        {
+            const auto& var = m_fs->locals[local];
+            return VarRef{ VarRef::LOCAL, var.reg, &var.type, var.constant };
+        }
+
+        int upvalue = ResolveUpvalue(*m_fs, name);
+        if (upvalue >= 0)
+        {
+            const auto& var = m_fs->upvalues[upvalue];
+            return VarRef{ VarRef::UPVALUE, (std::uint16_t) upvalue, &var.type, var.constant };
+        }
+
+        auto global = m_globals.find(name);
+        if (global != m_globals.end())
+        {
+            const auto& var = m_globalVars[global->second];
+            return VarRef{ VarRef::GLOBAL, global->second, &var.type, var.constant };
+        }
+
+        return std::nullopt;
+    }
+
+    int Compiler::FindLocal(FunctionState& fs, const std::string& name)
+    {
+        for (int i = (int) fs.locals.size() - 1; i >= 0; i--)
+        {
+            if (fs.locals[i].name == name)
+                return i;
+        }
+        return -1;
+    }
+
+    int Compiler::ResolveUpvalue(FunctionState& fs, const std::string& name)
+    {
+        for (std::size_t i = 0; i < fs.upvalues.size(); i++)
+        {
+            if (fs.upvalues[i].name == name)
+                return (int) i;
+        }
+
+        if (fs.parent == nullptr)
+            return -1;
+
+        auto AddUpvalue = [&](UpvalueDesc desc, const std::optional<Types::Type>& type, bool constant)
+        {
+            if (fs.upvalues.size() >= 255)
+                Error("Function '" + fs.proto->name + "' captures too many variables.");
+
+            fs.upvalues.push_back(UpvalueVar{ name, desc, type, constant });
+            return (int) fs.upvalues.size() - 1;
+        };
+
+        int local = FindLocal(*fs.parent, name);
+        if (local >= 0)
+        {
+            auto& var = fs.parent->locals[local];
+            var.captured = true;
+            return AddUpvalue(UpvalueDesc{ true, var.reg }, var.type, var.constant);
+        }
+
+        int upvalue = ResolveUpvalue(*fs.parent, name);
+        if (upvalue >= 0)
+        {
+            const auto& var = fs.parent->upvalues[upvalue];
+            return AddUpvalue(UpvalueDesc{ false, (std::uint8_t) upvalue }, var.type, var.constant);
+        }
+
+        return -1;
+    }
+
+    bool Compiler::Shadowed(const std::string& name)
+    {
+        for (FunctionState* fs = m_fs; fs != nullptr; fs = fs->parent)
+        {
+            if (FindLocal(*fs, name) >= 0)
+                return true;
+        }
+        return false;
+    }
+
+    bool Compiler::IsLocalReg(std::uint8_t reg) const
+    {
+        for (const auto& local : m_fs->locals)
+        {
+            if (local.reg == reg)
+                return true;
+        }
+        return false;
+    }
+
+    void Compiler::EndScope()
+    {
+        m_fs->depth--;
+
+        int firstReg = -1;
+        bool captured = false;
+        while (!m_fs->locals.empty() && m_fs->locals.back().depth > m_fs->depth)
+        {
+            captured |= m_fs->locals.back().captured;
+            firstReg = m_fs->locals.back().reg;
+            m_fs->locals.pop_back();
+        }
+
+        if (firstReg < 0)
+            return;
+
+        if (captured)
+            Emit(Instruction::ABC(OpCode::CLOSE, (std::uint8_t) firstReg));
+        m_fs->freeReg = firstReg;
+    }
+
+    // ----- Emission -----
+
+    int Compiler::Emit(Instruction instruction)
+    {
+        m_fs->proto->code.push_back(instruction);
+        return CurrentPc() - 1;
+    }
+
+    void Compiler::BeginAsync()
+    {
+        m_fs->proto->isAsync = true;
+        m_fs->task = ReserveReg();
+        Emit(Instruction::ABC(OpCode::ASYNC, m_fs->task.value()));
+    }
+
+    void Compiler::EmitReturn(std::optional<std::uint8_t> reg)
+    {
+        if (!m_fs->task.has_value())
+        {
+            Emit(Instruction::ABC(OpCode::RETURN, reg.value_or(0), reg.has_value() ? 1 : 0));
+            return;
+        }
+
+        Emit(Instruction::ABC(OpCode::RESOLVE, m_fs->task.value(), reg.value_or(0), reg.has_value() ? 1 : 0));
+        Emit(Instruction::ABC(OpCode::RETURN, m_fs->task.value(), 1));
+    }
+
+    void Compiler::EmitClosure(std::uint8_t dst, std::uint16_t index)
+    {
+        const FunctionProto& proto = *m_module->functions[index];
+        if (!proto.upvalues.empty())
+        {
+            Emit(Instruction::ABx(OpCode::CLOSURE, dst, index));
+            return;
+        }
+
+        // Nothing to capture, so every evaluation may share one closure. Lives as long as the module.
+        ClosureObject* closure = m_module->constantHeap.AllocateClosure(&proto, 0);
+        Emit(Instruction::ABx(OpCode::LOADK, dst, AddConstant(Value::Object(closure))));
+    }
+
+    void Compiler::EmitField(OpCode op, std::uint8_t a, std::uint8_t b, std::uint8_t c)
+    {
+        if (m_fs->proto->numCaches == 0xFFFF)
+            Error("Function '" + m_fs->proto->name + "' accesses too many properties.");
+
+        Emit(Instruction::ABC(op, a, b, c));
+        Emit(Instruction::ABx(OpCode::EXTRAARG, 0, m_fs->proto->numCaches++));
+    }
+
+    int Compiler::EmitJump(OpCode op, std::uint8_t a)
+    {
+        return Emit(Instruction::AsBx(op, a, 0));
+    }
+
+    void Compiler::PatchJump(int at)
+    {
+        int offset = CurrentPc() - (at + 1);
+        if (offset > 0xFFFF - Instruction::SBxBias)
+            Error("Block too large to jump over.");
+
+        m_fs->proto->code[at].SetSBx(offset);
+    }
+
+    void Compiler::EmitLoop(int start)
+    {
+        int offset = start - (CurrentPc() + 1);
+        if (offset < -Instruction::SBxBias)
+            Error("Loop body too large.");
+
+        Emit(Instruction::AsBx(OpCode::JMP, 0, offset));
+    }
+
+    void Compiler::EmitLoadInt(std::uint8_t dst, std::int32_t value)
+    {
+        if (value >= -Instruction::SBxBias && value <= 0xFFFF - Instruction::SBxBias)
+            Emit(Instruction::AsBx(OpCode::LOADINT, dst, value));
+        else
+            Emit(Instruction::ABx(OpCode::LOADK, dst, AddConstant(Value::Int(value))));
+    }
+
+    void Compiler::EmitDefaultValue(std::uint8_t dst, const std::optional<Types::Type>& type)
+    {
+        if (!type.has_value() || !type->LambdaTypes().empty())
+        {
+            Emit(Instruction::ABC(OpCode::LOADNULL, dst));
+            return;
+        }
+
+        switch ((Types::Uid) type->Uid())
+        {
+        case Types::Uid::Bool:   Emit(Instruction::ABC(OpCode::LOADBOOL, dst, 0)); break;
+        case Types::Uid::Int:    Emit(Instruction::AsBx(OpCode::LOADINT, dst, 0)); break;
+        case Types::Uid::Float:  Emit(Instruction::ABx(OpCode::LOADK, dst, AddConstant(Value::Float(0.0f)))); break;
+        case Types::Uid::Double: Emit(Instruction::ABx(OpCode::LOADK, dst, AddConstant(Value::Double(0.0)))); break;
+        case Types::Uid::Char:   Emit(Instruction::ABx(OpCode::LOADK, dst, AddConstant(Value::Char('\0')))); break;
+        default:                 Emit(Instruction::ABC(OpCode::LOADNULL, dst)); break;
+        }
+    }
+
+    void Compiler::EmitConversion(std::uint8_t reg, const std::optional<Types::Type>& type)
+    {
+        auto uid = ConversionFor(type);
+        if (uid.has_value())
+            Emit(Instruction::ABC(OpCode::CONVERT, reg, reg, uid.value()));
+    }
+
+    void Compiler::EmitConversion(std::uint8_t reg, const std::optional<Types::Type>& type, const Expr& value)
+    {
+        auto known = StaticType(value);
+        if (!known.has_value() || ConversionFor(type) != (std::uint8_t) known.value())
+            EmitConversion(reg, type);
+    }
+
+    std::uint16_t Compiler::AddConstant(const Value& value)
+    {
+        auto& constants = m_fs->proto->constants;
+        for (std::size_t i = 0; i < constants.size(); i++)
+        {
+            if (constants[i].IsIdentical(value))
+                return (std::uint16_t) i;
+        }
+
+        if (constants.size() >= 0xFFFF)
+            Error("Function '" + m_fs->proto->name + "' has too many constants.");
+
+        constants.push_back(value);
+        return (std::uint16_t) (constants.size() - 1);
+    }
+
+    std::uint16_t Compiler::StringConstant(const std::string& value)
+    {
+        auto it = m_fs->stringConstants.find(value);
+        if (it != m_fs->stringConstants.end())
+            return it->second;
+
+        std::uint16_t index = AddConstant(Value::Object(Intern(value)));
+        m_fs->stringConstants.emplace(value, index);
+        return index;
+    }
+
+    // The hash is computed up front, so comparing against a literal can usually reject by hash alone.
+    StringObject* Compiler::Intern(const std::string& value)
+    {
+        auto it = m_strings.find(value);
+        if (it != m_strings.end())
+            return it->second;
+
+        StringObject* string = m_module->constantHeap.Allocate<StringObject>(String(value));
+        string->Hash();
+        m_strings.emplace(value, string);
+        return string;
+    }
+
+    std::uint8_t Compiler::FieldConstant(const std::string& key)
+    {
+        std::uint16_t index = StringConstant(key);
+        if (index > 0xFF)
+            Error("Function '" + m_fs->proto->name + "' has too many constants to address property '" + key + "'.");
+
+        return (std::uint8_t) index;
+    }
+
+    std::uint8_t Compiler::AllocReg()
+    {
+        if (m_fs->freeReg >= MaxRegisters)
+            Error("Function '" + m_fs->proto->name + "' needs too many registers.");
+
+        std::uint8_t reg = (std::uint8_t) m_fs->freeReg++;
+        if (m_fs->freeReg > m_fs->proto->numRegisters)
+            m_fs->proto->numRegisters = (std::uint8_t) m_fs->freeReg;
+        return reg;
+    }
+
+    std::uint8_t Compiler::ReserveReg()
+    {
+        std::uint8_t reg = AllocReg();
+        m_fs->locals.push_back(LocalVar{ "", reg, m_fs->depth, std::nullopt, true, false });
+        return reg;
+    }
+
+    std::optional<std::uint8_t> Compiler::ConversionFor(const std::optional<Types::Type>& type)
+    {
+        return Conversion::For(type);
+    }
+
+    void Compiler::Error(const std::string& description) const
+    {
+        throw SyntaxException(m_module->fileDir, Vector2i(0, 0), description);
+    }
+}
@@ -0,0 +1,221 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../Frontend/Ast.h"
+#include "../Frontend/SyntaxException.h"
+#include "Binding.h"
+#include "Bytecode.h"
+#include "InlineAnalysis.h"
+#include "LoopAnalysis.h"
+#include "StandardLibrary.h"
+
+using namespace JScr::Frontend;
+
+namespace JScr::Runtime
+{
+    // Lowers a parsed Program into register bytecode. Semantic errors (undeclared identifiers,
+    // assignments to constants, unknown object types...) are reported as SyntaxExceptions.
+    class Compiler
+    {
+    public:
+        // Names nothing in the script declares resolve to `hosts` first, then to the StandardLibrary.
+        static std::shared_ptr<Module> Compile(Program& program, const HostFunctions& hosts = {});
+
+    private:
+        struct LocalVar
+        {
+            std::string name;
+            std::uint8_t reg;
+            int depth;
+            std::optional<Types::Type> type;
+            bool constant;
+            bool captured;
+            // Set when the variable holds a lifted function: the registers every call passes after the arguments.
+            std::vector<std::uint8_t> liftedArgs = {};
+        };
+
+        struct UpvalueVar
+        {
+            std::string name;
+            UpvalueDesc desc;
+            std::optional<Types::Type> type;
+            bool constant;
+        };
+
+        struct GlobalVar
+        {
+            std::optional<Types::Type> type;
+            bool constant;
+        };
+
+        struct FunctionState
+        {
+            FunctionState* parent = nullptr;
+            FunctionProto* proto = nullptr;
+            std::vector<LocalVar> locals;
+            std::vector<UpvalueVar> upvalues;
+            int depth = 0;
+            int freeReg = 0;
+            std::optional<Types::Type> returnType;
+            // Holds the task of the call in async functions and async top level code.
+            std::optional<std::uint8_t> task;
+            std::unordered_map<std::string, std::uint16_t> stringConstants;
+
+            const std::vector<std::unique_ptr<Stmt>>* body = nullptr;
+            // The statement list being compiled and the position in it, for escape analysis.
+            const std::vector<std::unique_ptr<Stmt>>* statements = nullptr;
+            std::size_t statement = 0;
+            // Computed the first time a function declared in here is considered for lifting.
+            std::optional<std::unordered_set<std::string>> nestedAssignments;
+
+            // Expressions a loop computed ahead into a register, and index expressions it keeps within bounds.
+            std::unordered_map<const Expr*, std::uint8_t> precomputed;
+            std::unordered_set<const Expr*> inBounds;
+        };
+
+        struct VarRef
+        {
+            enum Kind { LOCAL, UPVALUE, GLOBAL };
+
+            Kind kind;
+            std::uint16_t index;
+            const std::optional<Types::Type>* type;
+            bool constant;
+        };
+
+        struct Param
+        {
+            std::string name;
+            std::optional<Types::Type> type;
+        };
+
+    private:
+        Compiler(Program& program, const HostFunctions& hosts);
+
+        void CompileProgram();
+        void HoistDeclarations();
+
+        // Statements
+        void CompileStmt(const Stmt& stmt);
+        void CompileBlock(const std::vector<std::unique_ptr<Stmt>>& body);
+        void CompileStatements(const std::vector<std::unique_ptr<Stmt>>& body);
+        void CompileVarDeclaration(const VarDeclaration& decl);
+        void CompileLocalFunction(const FunctionDeclaration& fn);
+        std::uint16_t CompileFunction(const std::string& name, const std::vector<Param>& params, const std::vector<std::unique_ptr<Stmt>>& body, bool instantReturn, const std::optional<Types::Type>& returnType, bool async = false);
+        std::vector<std::string> LiftedCaptures(const Stmt& decl, const std::string& name, const std::vector<Param>& params, const std::vector<std::unique_ptr<Stmt>>& body);
+        std::vector<std::uint8_t> AddLiftedParams(const std::vector<std::string>& captures, std::vector<Param>& params);
+        std::optional<std::span<const std::unique_ptr<Stmt>>> Following(const Stmt& stmt) const;
+        void CompileReturn(const Expr& value);
+        void CompileDelete(const DeleteDeclaration& del);
+        void CompileIfElse(const IfElseDeclaration& ifElse);
+        bool CompileEnumSwitch(const IfElseDeclaration& ifElse);
+        void CompileWhile(const WhileDeclaration& loop);
+        void CompileFor(const ForDeclaration& loop);
+        LoopAnalysis::Result AnalyzeLoop(const ForDeclaration* loop, const Expr& condition, const std::vector<std::unique_ptr<Stmt>>& body);
+        void Precompute(const Expr& expr);
+        void ForgetLoop(const LoopAnalysis::Result& analysis);
+        void CompileEffect(const Expr& expr);
+
+        // Expressions
+        void ExprTo(const Expr& expr, std::uint8_t dst);
+        std::uint8_t ExprAnyReg(const Expr& expr);
+        void CompileAssignment(const AssignmentExpr& assignment, std::optional<std::uint8_t> dst);
+        void CompileLogical(const EqualityCheckExpr& check, std::uint8_t dst);
+        void CompileCall(const CallExpr& call, std::uint8_t dst);
+        bool CompileInline(const CallExpr& call, std::uint8_t dst);
+        void CompileArray(const ArrayLiteral& array, std::uint8_t dst);
+        void CompileObjectConstructor(const ObjectConstructorExpr& ctor, std::uint8_t dst, const std::optional<Types::Type>* hint);
+        void LoadVariable(const std::string& name, std::uint8_t dst);
+        // The host, imported or StandardLibrary function `name` stands for, or null.
+        NativeFunctionObject* FindNative(const std::string& name);
+        static NativeFunctionObject* MakeNative(Module& module, const StandardLibrary::Function& function);
+
+        // Static types
+        // The type every value of `expr` has, as far as the declarations around it tell.
+        std::optional<Types::Uid> StaticType(const Expr& expr);
+        // The conversion a local or upvalue is guaranteed to have gone through on every store.
+        std::optional<std::uint8_t> TrustedConversion(const std::string& name);
+        // What to promote both operands of `op` to so a typed instruction can run it.
+        std::optional<Types::Uid> SpecializedType(OpCode op, const Expr& left, const Expr& right);
+        std::uint8_t PromotedOperand(const Expr& expr, Types::Uid uid);
+        const std::unordered_set<std::string>& NestedAssignments(FunctionState& fs);
+
+        // Declarations & scopes
+        std::uint16_t DeclareGlobal(const std::string& name, const std::optional<Types::Type>& type, bool constant);
+        void DeclareLocal(const std::string& name, std::uint8_t reg, const std::optional<Types::Type>& type, bool constant);
+        void DeclareObjectType(const ObjectDeclaration& decl);
+        std::optional<Value> ConstantDefault(const Property& property);
+        void DeclareEnum(const EnumDeclaration& decl);
+        std::optional<std::pair<std::uint16_t, std::int32_t>> EnumEntry(const Expr& expr);
+        void DeclareImport(const ImportStmt& import);
+        // Global holding the function of `alias.function` when alias names an imported module that is not shadowed.
+        std::optional<std::uint16_t> ImportedMember(const Expr& expr);
+        std::optional<VarRef> Resolve(const std::string& name);
+        int FindLocal(FunctionState& fs, const std::string& name);
+        int ResolveUpvalue(FunctionState& fs, const std::string& name);
+        // Whether a local of this or an enclosing function hides the global `name`.
+        bool Shadowed(const std::string& name);
+        bool IsTopLevel() const { return m_fs->parent == nullptr && m_fs->depth == 0; }
+        bool IsLocalReg(std::uint8_t reg) const;
+        void BeginScope() { m_fs->depth++; }
+        void EndScope();
+
+        // Emission
+        int Emit(Instruction instruction);
+        int CurrentPc() const { return (int) m_fs->proto->code.size(); }
+        int EmitJump(OpCode op, std::uint8_t a);
+        void PatchJump(int at);
+        void EmitLoop(int start);
+        // Turns the function being compiled into an async one: its calls return the task ASYNC creates.
+        void BeginAsync();
+        // RETURN, or RESOLVE and RETURN of the task in async code.
+        void EmitReturn(std::optional<std::uint8_t> reg);
+        // CLOSURE, or a constant closure for a function that captures nothing.
+        void EmitClosure(std::uint8_t dst, std::uint16_t index);
+        // GETFIELD or SETFIELD together with a fresh inline cache for the site.
+        void EmitField(OpCode op, std::uint8_t a, std::uint8_t b, std::uint8_t c);
+        void EmitLoadInt(std::uint8_t dst, std::int32_t value);
+        void EmitDefaultValue(std::uint8_t dst, const std::optional<Types::Type>& type);
+        void EmitConversion(std::uint8_t reg, const std::optional<Types::Type>& type);
+        // Leaves the conversion out when `value` is known to be of that type already.
+        void EmitConversion(std::uint8_t reg, const std::optional<Types::Type>& type, const Expr& value);
+        std::uint16_t AddConstant(const Value& value);
+        std::uint16_t StringConstant(const std::string& value);
+        StringObject* Intern(const std::string& value);
+        std::uint8_t FieldConstant(const std::string& key);
+        std::uint8_t AllocReg();
+        // A register that stays taken until the current scope ends.
+        std::uint8_t ReserveReg();
+        void FreeRegsTo(int mark) { m_fs->freeReg = mark; }
+
+        static std::optional<std::uint8_t> ConversionFor(const std::optional<Types::Type>& type);
+
+        [[noreturn]] void Error(const std::string& description) const;
+
+    private:
+        Program& m_program;
+        const HostFunctions& m_hosts;
+        std::shared_ptr<Module> m_module;
+        FunctionState* m_fs = nullptr;
+
+        std::unordered_map<std::string, std::uint16_t> m_globals;
+        std::vector<GlobalVar> m_globalVars;
+        std::unordered_map<std::string, std::uint16_t> m_objectTypes;
+        std::vector<const ObjectDeclaration*> m_objectDecls;
+        std::unordered_map<std::string, std::uint16_t> m_enumTypes;
+        // Modules imported without an alias; their functions go by their own names.
+        std::vector<const StandardLibrary::Module*> m_imports;
+        std::unordered_map<std::string, const StandardLibrary::Module*> m_importAliases;
+        std::unordered_map<std::string, InlineAnalysis::Candidate> m_inlinable;
+        // Functions whose body is being inlined right now, innermost last.
+        std::vector<const FunctionDeclaration*> m_inlining;
+        // One constant object per distinct string in the module, shared by every function's pool.
+        std::unordered_map<std::string, StringObject*> m_strings;
+    };
+}
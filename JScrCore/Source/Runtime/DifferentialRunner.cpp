@@ -0,0 +1,193 @@
+#include "DifferentialRunner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include "../JScr.h"
+#include "../Frontend/Parser.h"
+#include "../Frontend/SyntaxException.h"
+#include "Compiler.h"
+#include "Interpreter.h"
+#include "RuntimeException.h"
+#include "VM.h"
+
+namespace JScr::Runtime
+{
+    static std::string Canonical(const Value& value)
+    {
+        return VM::TypeName(value) + ":" + VM::ToString(value);
+    }
+
+    bool DifferentialRunner::ScriptReport::Matches() const
+    {
+        if (!parseError.empty())
+            return false;
+
+        for (const auto& result : results)
+        {
+            if (result.result != results[0].result)
+                return false;
+        }
+        return true;
+    }
+
+    double DifferentialRunner::ScriptReport::Speedup(std::size_t engineIndex) const
+    {
+        double time = results[engineIndex].milliseconds;
+        return time > 0.0 ? results[0].milliseconds / time : 0.0;
+    }
+
+    DifferentialRunner::DifferentialRunner(int repetitions) : DifferentialRunner(repetitions, {})
+    {
+    }
+
+    DifferentialRunner::DifferentialRunner(int repetitions, const std::vector<ExternalResource>& resources) : m_repetitions(std::max(repetitions, 1))
+    {
+        HostFunctions hosts;
+        for (const ExternalResource& resource : resources)
+            hosts.insert(hosts.end(), resource.GetFunctions().begin(), resource.GetFunctions().end());
+
+        AddEngine("interpreter", [resources](Program& program)
+        {
+            Interpreter interpreter;
+            return Canonical(interpreter.EvaluateProgram(program, resources));
+        });
+
+        // Compilation is part of the measured time, the same as it is for Script::Execute users.
+        AddEngine("bytecode", [hosts](Program& program)
+        {
+            VM vm(Compiler::Compile(program, hosts));
+            vm.SetJitEnabled(false);
+            return Canonical(vm.Run());
+        });
+
+        // A low threshold so that even short scripts run most of their code compiled.
+        if (Jit::IsSupported())
+        {
+            AddEngine("baseline-jit", [hosts](Program& program)
+            {
+                VM vm(Compiler::Compile(program, hosts));
+                vm.SetJitThreshold(2);
+                return Canonical(vm.Run());
+            });
+        }
+    }
+
+    void DifferentialRunner::AddEngine(const std::string& name, EngineFunction run)
+    {
+        m_engines.push_back(Engine{ name, std::move(run) });
+    }
+
+    DifferentialRunner::ScriptReport DifferentialRunner::RunProgram(const std::string& name, Program& program)
+    {
+        ScriptReport report{ name, {} };
+
+        for (const auto& engine : m_engines)
+        {
+            EngineResult result{ engine.name, "", "", 0.0 };
+            for (int i = 0; i < m_repetitions; i++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                std::string value;
+                try
+                {
+                    value = engine.run(program);
+                }
+                catch (const RuntimeException& e)
+                {
+                    // Engines word their errors differently, only the fact that one happened is compared.
+                    value = "error";
+                    result.error = e.Description();
+                }
+                catch (const SyntaxException& e)
+                {
+                    value = "error";
+                    result.error = e.Description();
+                    report.parseError = e.ToString();
+                }
+                double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                if (i == 0)
+                {
+                    result.result = value;
+                    result.milliseconds = elapsed;
+                }
+                else
+                    result.milliseconds = std::min(result.milliseconds, elapsed);
+            }
+            report.results.push_back(result);
+        }
+
+        return report;
+    }
+
+    DifferentialRunner::ScriptReport DifferentialRunner::RunScript(const std::string& filedir)
+    {
+        std::optional<Program> program = std::nullopt;
+        try
+        {
+            Parser parser{};
+            program.emplace(parser.ProduceAST(filedir));
+        }
+        catch (const SyntaxException& e)
+        {
+            // No engine gets to run it, so there are no results to compare.
+            return ScriptReport{ filedir, {}, e.ToString() };
+        }
+
+        return RunProgram(filedir, program.value());
+    }
+
+    std::vector<DifferentialRunner::ScriptReport> DifferentialRunner::RunCorpus(const std::string& directory)
+    {
+        std::vector<std::string> files;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(directory))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".jscr")
+                files.push_back(entry.path().string());
+        }
+        std::sort(files.begin(), files.end());
+
+        std::vector<ScriptReport> reports;
+        for (const auto& file : files)
+            reports.push_back(RunScript(file));
+        return reports;
+    }
+
+    std::string DifferentialRunner::FormatReport(const std::vector<ScriptReport>& reports)
+    {
+        std::string out = "";
+        int mismatches = 0;
+        char buffer[64];
+
+        for (const auto& report : reports)
+        {
+            bool matches = report.Matches();
+            if (!matches)
+                mismatches++;
+
+            out += (matches ? "[ OK ] " : "[FAIL] ") + report.file + "\n";
+            if (!report.parseError.empty())
+                out += "    " + report.parseError + "\n";
+            for (std::size_t i = 0; i < report.results.size(); i++)
+            {
+                const auto& result = report.results[i];
+                std::snprintf(buffer, sizeof(buffer), "%.3f ms", result.milliseconds);
+                out += "    " + result.engine + ": " + result.result + " (" + buffer;
+                if (i > 0)
+                {
+                    std::snprintf(buffer, sizeof(buffer), ", %.2fx", report.Speedup(i));
+                    out += buffer;
+                }
+                out += ")";
+                if (!result.error.empty())
+                    out += " \"" + result.error + "\"";
+                out += "\n";
+            }
+        }
+
+        out += std::to_string(reports.size() - mismatches) + "/" + std::to_string(reports.size()) + " scripts agree across engines.\n";
+        return out;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "../Frontend/Ast.h"
+
+using namespace JScr::Frontend;
+
+namespace JScr
+{
+    class ExternalResource;
+}
+
+namespace JScr::Runtime
+{
+    // Runs the same programs through every registered engine and compares their results against the
+    // first engine, which is the tree walking interpreter. New engines register themselves with AddEngine.
+    class DifferentialRunner
+    {
+    public:
+        // Runs the program and returns its result in canonical "type:value" form.
+        using EngineFunction = std::function<std::string(Program& program)>;
+
+        struct EngineResult
+        {
+            std::string engine;
+            std::string result;
+            std::string error;
+            double milliseconds;
+        };
+
+        struct ScriptReport
+        {
+            std::string file;
+            std::vector<EngineResult> results;
+            // Set when the script did not parse or an engine rejected it while compiling. Only runtime
+            // errors are compared, so such a report never matches.
+            std::string parseError;
+
+            bool Matches() const;
+            // Reference time divided by the engine's time.
+            double Speedup(std::size_t engineIndex) const;
+        };
+
+        DifferentialRunner(int repetitions = 3);
+        // Every engine gets the host functions the resources bind.
+        DifferentialRunner(int repetitions, const std::vector<ExternalResource>& resources);
+
+        void AddEngine(const std::string& name, EngineFunction run);
+
+        ScriptReport RunProgram(const std::string& name, Program& program);
+        ScriptReport RunScript(const std::string& filedir);
+        // Runs every `.jscr` file below the directory.
+        std::vector<ScriptReport> RunCorpus(const std::string& directory);
+
+        static std::string FormatReport(const std::vector<ScriptReport>& reports);
+
+    private:
+        struct Engine
+        {
+            std::string name;
+            EngineFunction run;
+        };
+
+        int m_repetitions;
+        std::vector<Engine> m_engines;
+    };
+}
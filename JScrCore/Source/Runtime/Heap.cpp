@@ -0,0 +1,460 @@
+#include "Heap.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace JScr::Runtime
+{
+    namespace
+    {
+        // Covers a gap so blocks can be walked object by object.
+        class FreeSpace : public HeapObject
+        {
+        public:
+            FreeSpace() : HeapObject(ObjectKind::Free) {}
+        };
+
+        constexpr std::size_t Unlimited = std::numeric_limits<std::size_t>::max();
+    }
+
+    Heap::Heap(Lifetime lifetime) : m_lifetime(lifetime)
+    {
+        if (m_lifetime == Lifetime::Permanent)
+            m_nextStep = Unlimited;
+    }
+
+    Heap::~Heap()
+    {
+        Seal();
+        for (Block* block : m_blocks)
+        {
+            for (unsigned char* at = block->data; at < block->data + BlockSize;)
+            {
+                auto* object = reinterpret_cast<HeapObject*>(at);
+                at += object->m_size;
+                if (object->m_kind != ObjectKind::Free)
+                    object->~HeapObject();
+            }
+            ::operator delete(block->data);
+            delete block;
+        }
+
+        for (HeapObject* object : m_large)
+        {
+            object->~HeapObject();
+            ::operator delete(object);
+        }
+    }
+
+    // ----- Allocation -----
+
+    void Heap::Track(HeapObject* object, std::size_t size)
+    {
+        size = (size + Granule - 1) & ~(Granule - 1);
+        object->m_size = (std::uint32_t) size;
+        m_objectCount++;
+        m_allocatedObjectsSinceStep++;
+        m_allocatedBytes += size;
+        m_usedBytes += size;
+
+        if (size > LargeObjectSize)
+        {
+            object->m_flags |= HeapObject::Large;
+            m_large.push_back(object);
+            m_largeBytes += size;
+        }
+
+        if (m_lifetime == Lifetime::Permanent)
+            object->m_flags |= HeapObject::Immortal;
+        else if (m_phase == Phase::Idle)
+        {
+            object->m_flags |= HeapObject::Young;
+            m_youngBytes += size;
+        }
+        else
+        {
+            // Allocated black during a major cycle. While marking it is still traced, since what it was
+            // built from may not be reachable from anywhere else by the time marking ends.
+            object->m_mark = m_tracer.m_epoch;
+            if (m_phase == Phase::Marking)
+                m_tracer.m_gray.push_back(object);
+        }
+    }
+
+    void* Heap::AllocateSlow(std::size_t size)
+    {
+        if (size > LargeObjectSize)
+            return ::operator new(size);
+
+        Retire();
+        for (;;)
+        {
+            while (m_block != nullptr && m_runIndex < m_block->runs.size())
+            {
+                Run run = m_block->runs[m_runIndex++];
+                if (run.size < size)
+                    continue;
+
+                if (m_phase == Phase::Idle)
+                    m_nursery.push_back(Extent{ m_block, m_block->data + run.offset, m_block->data + run.offset + run.size });
+                m_cursor = m_block->data + run.offset + size;
+                m_limit = m_block->data + run.offset + run.size;
+                return m_block->data + run.offset;
+            }
+
+            // Runs only ever list free memory.
+            if (m_block != nullptr)
+                m_block->runs.clear();
+            if (!m_recyclable.empty())
+            {
+                m_block = m_recyclable.back();
+                m_recyclable.pop_back();
+                m_block->queued = false;
+            }
+            else
+                m_block = NewBlock();
+            m_runIndex = 0;
+        }
+    }
+
+    void Heap::Abandon(void* memory, std::size_t size)
+    {
+        size = (size + Granule - 1) & ~(Granule - 1);
+        if (size > LargeObjectSize)
+            ::operator delete(memory);
+        else
+            Fill(static_cast<unsigned char*>(memory), size);
+    }
+
+    Heap::Block* Heap::NewBlock()
+    {
+        auto* block = new Block{ static_cast<unsigned char*>(::operator new(BlockSize)), {}, false };
+        Fill(block->data, BlockSize);
+        block->runs.push_back(Run{ 0, (std::uint32_t) BlockSize });
+        m_blocks.push_back(block);
+        return block;
+    }
+
+    void Heap::Retire()
+    {
+        if (m_cursor < m_limit)
+            Fill(m_cursor, m_limit - m_cursor);
+        m_cursor = nullptr;
+        m_limit = nullptr;
+    }
+
+    void Heap::Seal()
+    {
+        Retire();
+        if (m_block != nullptr)
+        {
+            m_block->runs.erase(m_block->runs.begin(), m_block->runs.begin() + m_runIndex);
+            if (!m_block->runs.empty() && !m_block->queued)
+            {
+                m_block->queued = true;
+                m_recyclable.push_back(m_block);
+            }
+        }
+        m_block = nullptr;
+    }
+
+    void Heap::Fill(unsigned char* at, std::size_t size)
+    {
+        auto* free = new (at) FreeSpace();
+        free->m_size = (std::uint32_t) size;
+    }
+
+    void Heap::Remember(HeapObject* object)
+    {
+        object->m_flags |= HeapObject::Remembered;
+        m_remembered.push_back(object);
+    }
+
+    // ----- Collection -----
+
+    void Heap::Step(RootSource& roots)
+    {
+        if (m_lifetime == Lifetime::Permanent)
+            return;
+
+        auto start = std::chrono::steady_clock::now();
+        switch (m_phase)
+        {
+        case Phase::Idle:
+            Minor(roots);
+            if (m_usedBytes >= m_majorThreshold)
+                BeginMajor(roots);
+            break;
+        case Phase::Marking:
+            // Marks faster than the mutator allocates, so the cycle always ends.
+            if (MarkSome(MarkBudget + 2 * m_allocatedObjectsSinceStep))
+                Remark(roots);
+            break;
+        case Phase::Sweeping:
+            if (SweepSome(SweepBudget))
+                FinishMajor();
+            break;
+        }
+
+        m_allocatedObjectsSinceStep = 0;
+        m_nextStep = m_allocatedBytes + (m_phase == Phase::Idle ? NurseryBytes : StepBytes);
+        RecordPause(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    void Heap::Collect(RootSource& roots)
+    {
+        if (m_lifetime == Lifetime::Permanent)
+            return;
+
+        auto start = std::chrono::steady_clock::now();
+        // A cycle already under way may have marked objects that died since.
+        if (m_phase != Phase::Idle)
+            FinishCycle(roots);
+        BeginMajor(roots);
+        FinishCycle(roots);
+
+        m_allocatedObjectsSinceStep = 0;
+        m_nextStep = m_allocatedBytes + NurseryBytes;
+        RecordPause(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    void Heap::FinishCycle(RootSource& roots)
+    {
+        if (m_phase == Phase::Marking)
+        {
+            MarkSome(Unlimited);
+            Remark(roots);
+        }
+        SweepSome(Unlimited);
+        FinishMajor();
+    }
+
+    // Stop the world, but only over the young objects: the cost follows what survives, not the heap size.
+    void Heap::Minor(RootSource& roots)
+    {
+        Seal();
+
+        m_tracer.m_youngOnly = true;
+        TraceRoots(roots);
+        for (HeapObject* object : m_remembered)
+        {
+            object->m_flags &= ~HeapObject::Remembered;
+            object->Trace(m_tracer);
+        }
+        m_remembered.clear();
+        MarkSome(Unlimited);
+        m_tracer.m_youngOnly = false;
+
+        for (const Extent& extent : m_nursery)
+        {
+            SweepRange(*extent.block, extent.start, extent.end);
+            if (!extent.block->runs.empty() && !extent.block->queued)
+            {
+                extent.block->queued = true;
+                m_recyclable.push_back(extent.block);
+            }
+        }
+        m_nursery.clear();
+        SweepLarge(true);
+
+        m_youngBytes = 0;
+        m_statistics.minorCollections++;
+    }
+
+    void Heap::BeginMajor(RootSource& roots)
+    {
+        for (HeapObject* object : m_remembered)
+            object->m_flags &= ~HeapObject::Remembered;
+        m_remembered.clear();
+
+        // Whatever carries the previous epoch turns white at once.
+        m_tracer.m_epoch = m_tracer.m_epoch == 1 ? 2 : 1;
+        m_phase = Phase::Marking;
+        TraceRoots(roots);
+    }
+
+    bool Heap::MarkSome(std::size_t budget)
+    {
+        while (!m_tracer.m_gray.empty() && budget-- > 0)
+        {
+            HeapObject* object = m_tracer.m_gray.back();
+            m_tracer.m_gray.pop_back();
+            object->Trace(m_tracer);
+        }
+        return m_tracer.m_gray.empty();
+    }
+
+    // Roots are not behind a write barrier, so they are scanned once more before sweeping.
+    void Heap::Remark(RootSource& roots)
+    {
+        TraceRoots(roots);
+        MarkSome(Unlimited);
+
+        m_phase = Phase::Sweeping;
+        m_sweepBlock = 0;
+        m_sweepBlockEnd = m_blocks.size();
+    }
+
+    // Blocks created from here on only hold objects allocated black, they need no sweeping.
+    bool Heap::SweepSome(std::size_t budget)
+    {
+        while (m_sweepBlock < m_sweepBlockEnd && budget-- > 0)
+        {
+            Block* block = m_blocks[m_sweepBlock++];
+            if (block == m_block)
+                Seal();
+
+            SweepBlock(*block);
+            if (!block->runs.empty() && !block->queued)
+            {
+                block->queued = true;
+                m_recyclable.push_back(block);
+            }
+        }
+        return m_sweepBlock == m_sweepBlockEnd;
+    }
+
+    void Heap::FinishMajor()
+    {
+        SweepLarge(false);
+
+        // Everything left is old now. Leaving the current run makes the next young object start a new
+        // nursery extent.
+        Seal();
+        m_nursery.clear();
+        ReleaseEmptyBlocks();
+
+        m_youngBytes = 0;
+        m_phase = Phase::Idle;
+        m_majorThreshold = std::max(MinMajorBytes, m_usedBytes * 2);
+        m_statistics.majorCollections++;
+    }
+
+    void Heap::TraceRoots(RootSource& roots)
+    {
+        roots.TraceRoots(m_tracer);
+        for (Handle* handle = m_handles; handle != nullptr; handle = handle->m_next)
+            m_tracer.Mark(handle->m_value);
+    }
+
+    void Heap::SweepBlock(Block& block)
+    {
+        block.runs.clear();
+        SweepRange(block, block.data, block.data + BlockSize);
+    }
+
+    // Frees the unmarked objects in [start, end), promotes the survivors and adds the gaps between them
+    // to the block's free runs.
+    void Heap::SweepRange(Block& block, unsigned char* start, unsigned char* end)
+    {
+        unsigned char* freeStart = nullptr;
+        for (unsigned char* at = start; at < end;)
+        {
+            auto* object = reinterpret_cast<HeapObject*>(at);
+            std::size_t size = object->m_size;
+
+            if (object->m_kind == ObjectKind::Free || object->m_mark != m_tracer.m_epoch)
+            {
+                if (object->m_kind != ObjectKind::Free)
+                    Destroy(object);
+                if (freeStart == nullptr)
+                    freeStart = at;
+            }
+            else
+            {
+                object->m_flags &= ~HeapObject::Young;
+                if (freeStart != nullptr)
+                {
+                    CloseRun(block, freeStart, at);
+                    freeStart = nullptr;
+                }
+            }
+            at += size;
+        }
+
+        if (freeStart != nullptr)
+            CloseRun(block, freeStart, end);
+    }
+
+    void Heap::CloseRun(Block& block, unsigned char* start, unsigned char* end)
+    {
+        std::size_t size = end - start;
+        Fill(start, size);
+        if (size >= MinRunSize)
+            block.runs.push_back(Run{ (std::uint32_t) (start - block.data), (std::uint32_t) size });
+    }
+
+    void Heap::SweepLarge(bool minor)
+    {
+        for (std::size_t i = 0; i < m_large.size();)
+        {
+            HeapObject* object = m_large[i];
+            if (object->m_mark == m_tracer.m_epoch || (minor && (object->m_flags & HeapObject::Young) == 0))
+            {
+                object->m_flags &= ~HeapObject::Young;
+                i++;
+                continue;
+            }
+
+            m_largeBytes -= object->m_size;
+            Destroy(object);
+            ::operator delete(object);
+            m_large[i] = m_large.back();
+            m_large.pop_back();
+        }
+    }
+
+    void Heap::Destroy(HeapObject* object)
+    {
+        m_objectCount--;
+        m_usedBytes -= object->m_size;
+        object->~HeapObject();
+    }
+
+    // Keeps one nursery worth of empty blocks around and gives the rest back, so memory follows the
+    // live size down again after a spike.
+    void Heap::ReleaseEmptyBlocks()
+    {
+        std::size_t reserve = NurseryBytes / BlockSize;
+        std::vector<Block*> kept;
+        kept.reserve(m_blocks.size());
+        m_recyclable.clear();
+
+        for (Block* block : m_blocks)
+        {
+            bool empty = block->runs.size() == 1 && block->runs[0].size == BlockSize;
+            if (empty && reserve == 0)
+            {
+                ::operator delete(block->data);
+                delete block;
+                continue;
+            }
+            if (empty)
+                reserve--;
+
+            kept.push_back(block);
+            block->queued = !block->runs.empty();
+            if (block->queued)
+                m_recyclable.push_back(block);
+        }
+        m_blocks = std::move(kept);
+    }
+
+    void Heap::RecordPause(double milliseconds)
+    {
+        m_statistics.pauses++;
+        m_statistics.lastPauseMs = milliseconds;
+        m_statistics.maxPauseMs = std::max(m_statistics.maxPauseMs, milliseconds);
+        m_statistics.totalPauseMs += milliseconds;
+    }
+
+    HeapStatistics Heap::Statistics() const
+    {
+        HeapStatistics statistics = m_statistics;
+        statistics.heapBytes = m_blocks.size() * BlockSize + m_largeBytes;
+        statistics.usedBytes = m_usedBytes;
+        statistics.allocatedBytes = m_allocatedBytes;
+        statistics.objectCount = m_objectCount;
+        return statistics;
+    }
+}
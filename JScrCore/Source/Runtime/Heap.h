@@ -0,0 +1,289 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+#include "Object.h"
+#include "Value.h"
+
+namespace JScr::Runtime
+{
+    struct HeapStatistics
+    {
+        // Memory taken from the system: every block plus large objects.
+        std::size_t heapBytes = 0;
+        // Bytes of objects not freed yet, live or not.
+        std::size_t usedBytes = 0;
+        std::size_t allocatedBytes = 0;
+        std::size_t objectCount = 0;
+
+        std::size_t minorCollections = 0;
+        std::size_t majorCollections = 0;
+
+        // Every stop of the mutator, a minor collection or one increment of a major one.
+        std::size_t pauses = 0;
+        double lastPauseMs = 0;
+        double maxPauseMs = 0;
+        double totalPauseMs = 0;
+    };
+
+    class Handle;
+
+    // Whatever holds values outside the heap: the VM's stack, globals and frames.
+    class RootSource
+    {
+    public:
+        virtual ~RootSource() = default;
+
+        virtual void TraceRoots(Tracer& tracer) = 0;
+    };
+
+    // Generational mark-region collector. Objects are bump allocated into free runs of fixed size
+    // blocks and never move, so natives and the host may keep raw pointers across allocations.
+    // New objects are young; a minor collection traces only those (from the roots and the remembered
+    // old objects) and promotes survivors in place. Old objects are collected by an incremental major
+    // cycle that marks and then sweeps a bounded amount of work per step.
+    //
+    // Collection only happens when the VM asks for it at a safe point, never inside Allocate, so
+    // anything reachable from the VM's roots or a Handle at that point survives.
+    class Heap
+    {
+    public:
+        enum class Lifetime : std::uint8_t
+        {
+            Collected,
+            // Objects are immortal and are only freed with the heap. Used for module constants,
+            // which any VM's collector must leave alone.
+            Permanent
+        };
+
+        static constexpr std::size_t BlockSize = 32 * 1024;
+        static constexpr std::size_t Granule = 16;
+        // Objects that do not fit in a block get an allocation of their own.
+        static constexpr std::size_t LargeObjectSize = BlockSize;
+        // Smaller gaps between live objects are not worth handing out.
+        static constexpr std::size_t MinRunSize = 128;
+        // A minor collection runs after this much was allocated.
+        static constexpr std::size_t NurseryBytes = 256 * 1024;
+        // Old generation size below which no major cycle is started.
+        static constexpr std::size_t MinMajorBytes = 8 << 20;
+        // Allocation between two increments of a major cycle.
+        static constexpr std::size_t StepBytes = 64 * 1024;
+        // Work done per increment: objects marked on top of twice the objects allocated since the last
+        // one, and blocks swept.
+        static constexpr std::size_t MarkBudget = 4096;
+        static constexpr std::size_t SweepBudget = 16;
+
+        explicit Heap(Lifetime lifetime = Lifetime::Collected);
+        Heap(const Heap&) = delete;
+        Heap& operator=(const Heap&) = delete;
+        ~Heap();
+
+        template <typename T, typename... Args>
+        T* Allocate(Args&&... args)
+        {
+            return Construct<T>(sizeof(T), std::forward<Args>(args)...);
+        }
+
+        // One block for the header and all fields of a declared object type.
+        StructObject* AllocateStruct(const Shape* shape)
+        {
+            return Construct<StructObject>(sizeof(StructObject) + shape->DataSize(), shape);
+        }
+
+        // One block for the closure and its upvalues, which start out null.
+        ClosureObject* AllocateClosure(const FunctionProto* proto, std::size_t upvalueCount)
+        {
+            return Construct<ClosureObject>(sizeof(ClosureObject) + upvalueCount * sizeof(UpvalueObject*), proto, upvalueCount);
+        }
+
+        // Must be called for every reference stored into an existing heap object. Keeps old objects
+        // that point at young ones visible to minor collections, and keeps the marker from missing
+        // objects moved behind its back during a major cycle.
+        void WriteBarrier(HeapObject* holder, const Value& value)
+        {
+            if (!value.IsObject())
+                return;
+
+            HeapObject* target = value.AsObject();
+            if (m_phase == Phase::Marking)
+                m_tracer.Mark(target);
+            // Minor collections only run while idle, and a major cycle promotes everything it keeps.
+            else if (m_phase == Phase::Idle && (target->m_flags & HeapObject::Young) != 0
+                && (holder->m_flags & (HeapObject::Young | HeapObject::Remembered | HeapObject::Immortal)) == 0)
+                Remember(holder);
+        }
+
+        // Cheap enough to check on every back edge and call.
+        bool WantsCollection() const { return m_allocatedBytes >= m_nextStep; }
+        // The two counters WantsCollection compares, for generated code that checks it inline.
+        const std::size_t* AllocatedBytesCounter() const { return &m_allocatedBytes; }
+        const std::size_t* NextStepCounter() const { return &m_nextStep; }
+
+        // Does the work that is due: a minor collection or one increment of a major cycle.
+        void Step(RootSource& roots);
+        // Finishes the current major cycle, if any, and runs a complete one.
+        void Collect(RootSource& roots);
+
+        std::size_t ObjectCount() const { return m_objectCount; }
+        HeapStatistics Statistics() const;
+
+    private:
+        friend class Handle;
+
+        enum class Phase : std::uint8_t
+        {
+            Idle, Marking, Sweeping
+        };
+
+        struct Run
+        {
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+
+        struct Block
+        {
+            unsigned char* data;
+            std::vector<Run> runs;
+            bool queued = false;
+        };
+
+        // Memory handed out since the last minor collection. Only young objects live there, so a minor
+        // collection sweeps these ranges instead of whole blocks.
+        struct Extent
+        {
+            Block* block;
+            unsigned char* start;
+            unsigned char* end;
+        };
+
+        void* AllocateRaw(std::size_t size)
+        {
+            size = (size + Granule - 1) & ~(Granule - 1);
+            if (size > (std::size_t) (m_limit - m_cursor))
+                return AllocateSlow(size);
+
+            void* memory = m_cursor;
+            m_cursor += size;
+            return memory;
+        }
+
+        template <typename T, typename... Args>
+        T* Construct(std::size_t size, Args&&... args)
+        {
+            void* memory = AllocateRaw(size);
+            T* object;
+            try
+            {
+                object = new (memory) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                Abandon(memory, size);
+                throw;
+            }
+            Track(object, size);
+            return object;
+        }
+
+        void Track(HeapObject* object, std::size_t size);
+        void* AllocateSlow(std::size_t size);
+        void Abandon(void* memory, std::size_t size);
+        Block* NewBlock();
+        // Gives up the rest of the current run.
+        void Retire();
+        // Retire, and leave the current block too. Blocks are only walkable while not allocated into.
+        void Seal();
+        static void Fill(unsigned char* at, std::size_t size);
+        void Remember(HeapObject* object);
+
+        void Minor(RootSource& roots);
+        void BeginMajor(RootSource& roots);
+        bool MarkSome(std::size_t budget);
+        void Remark(RootSource& roots);
+        bool SweepSome(std::size_t budget);
+        void FinishMajor();
+        void FinishCycle(RootSource& roots);
+        void TraceRoots(RootSource& roots);
+        void SweepBlock(Block& block);
+        void SweepRange(Block& block, unsigned char* start, unsigned char* end);
+        void CloseRun(Block& block, unsigned char* start, unsigned char* end);
+        void SweepLarge(bool minor);
+        void Destroy(HeapObject* object);
+        void ReleaseEmptyBlocks();
+        void RecordPause(double milliseconds);
+
+        Lifetime m_lifetime;
+        Phase m_phase = Phase::Idle;
+        Tracer m_tracer;
+
+        std::vector<Block*> m_blocks;
+        std::vector<HeapObject*> m_large;
+        // Blocks with free runs, waiting to be allocated into.
+        std::vector<Block*> m_recyclable;
+        std::vector<Extent> m_nursery;
+        std::vector<HeapObject*> m_remembered;
+
+        // The run being bump allocated into.
+        Block* m_block = nullptr;
+        std::size_t m_runIndex = 0;
+        unsigned char* m_cursor = nullptr;
+        unsigned char* m_limit = nullptr;
+
+        // Progress of a major sweep.
+        std::size_t m_sweepBlock = 0;
+        std::size_t m_sweepBlockEnd = 0;
+
+        std::size_t m_objectCount = 0;
+        std::size_t m_allocatedBytes = 0;
+        std::size_t m_usedBytes = 0;
+        std::size_t m_youngBytes = 0;
+        std::size_t m_largeBytes = 0;
+        std::size_t m_allocatedObjectsSinceStep = 0;
+        std::size_t m_nextStep = NurseryBytes;
+        std::size_t m_majorThreshold = MinMajorBytes;
+
+        HeapStatistics m_statistics;
+
+        Handle* m_handles = nullptr;
+    };
+
+    // Keeps a value alive while the host holds on to it somewhere the collector cannot see, such as a
+    // C++ local across a call back into a script. Must not outlive its heap.
+    class Handle
+    {
+    public:
+        Handle(Heap& heap, const Value& value = Value::Null()) : m_heap(&heap), m_value(value), m_next(heap.m_handles)
+        {
+            if (m_next != nullptr)
+                m_next->m_prev = this;
+            heap.m_handles = this;
+        }
+
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+        ~Handle()
+        {
+            if (m_prev != nullptr)
+                m_prev->m_next = m_next;
+            else
+                m_heap->m_handles = m_next;
+            if (m_next != nullptr)
+                m_next->m_prev = m_prev;
+        }
+
+        const Value& Get() const { return m_value; }
+        void Set(const Value& value) { m_value = value; }
+
+    private:
+        friend class Heap;
+
+        Heap* m_heap;
+        Value m_value;
+        Handle* m_prev = nullptr;
+        Handle* m_next;
+    };
+}
@@ -0,0 +1,66 @@
+#include "InlineAnalysis.h"
+#include <algorithm>
+#include "AstWalker.h"
+
+namespace JScr::Runtime
+{
+    namespace
+    {
+        class CostWalker : public AstWalker
+        {
+        public:
+            CostWalker(const std::string& name) : m_name(name) {}
+
+            std::size_t cost = 0;
+            bool inlinable = true;
+            std::vector<std::string> free;
+
+        protected:
+            void Visited(const Expr& expr) override
+            {
+                cost += expr.Kind() == NodeType::CALL_EXPR ? 4 : 1;
+
+                // A closure would capture the caller's frame instead of a fresh one per call.
+                if (expr.Kind() == NodeType::LAMBDA_EXPR)
+                    inlinable = false;
+            }
+
+            void Free(const std::string& name, Use, std::size_t) override
+            {
+                if (name == m_name)
+                    inlinable = false;
+                else if (std::find(free.begin(), free.end(), name) == free.end())
+                    free.push_back(name);
+            }
+
+        private:
+            const std::string& m_name;
+        };
+    }
+
+    std::optional<InlineAnalysis::Candidate> InlineAnalysis::Analyze(const FunctionDeclaration& fn)
+    {
+        // Calling an async function has to give the caller a task.
+        const auto& body = fn.Body();
+        if (body.size() != 1 || fn.Async())
+            return std::nullopt;
+
+        const Expr* value = nullptr;
+        if (fn.InstantReturn())
+            value = dynamic_cast<const Expr*>(body[0].get());
+        else if (body[0]->Kind() == NodeType::RETURN_DECLARATION)
+            value = &static_cast<const ReturnDeclaration&>(*body[0]).Value();
+        if (value == nullptr)
+            return std::nullopt;
+
+        std::vector<std::string> params;
+        for (const auto& param : fn.Parameters())
+            params.push_back(param.Identifier());
+
+        CostWalker walker{ fn.Identifier() };
+        walker.Function(params, body);
+        if (!walker.inlinable || walker.cost > Budget)
+            return std::nullopt;
+        return Candidate{ &fn, value, std::move(walker.free) };
+    }
+}
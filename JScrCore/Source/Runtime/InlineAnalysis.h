@@ -0,0 +1,30 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+#include "../Frontend/Ast.h"
+
+using namespace JScr::Frontend;
+
+namespace JScr::Runtime
+{
+    // Decides which top level functions the Compiler inlines: those whose body is a single returned
+    // expression, small enough that copying it into every caller costs less than the call it replaces.
+    class InlineAnalysis
+    {
+    public:
+        // Expression nodes, calls weighted as the code they may inline in turn.
+        static constexpr std::size_t Budget = 16;
+
+        struct Candidate
+        {
+            const FunctionDeclaration* fn;
+            const Expr* value;
+            // Names the body takes from outside its parameters. A caller declaring one of them would see
+            // its own variable instead, so the call stays a call there.
+            std::vector<std::string> free;
+        };
+
+        static std::optional<Candidate> Analyze(const FunctionDeclaration& fn);
+    };
+}
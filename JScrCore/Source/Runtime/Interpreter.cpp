@@ -0,0 +1,901 @@
+#include "Interpreter.h"
+#include <algorithm>
+#include <any>
+#include <cmath>
+#include <utility>
+#include "StandardLibrary.h"
+#include "VM.h"
+#include "../JScr.h"
+#include "../Utils/VectorUtils.h"
+using namespace JScr::Utils;
+
+namespace JScr::Runtime
+{
+    namespace
+    {
+        // Sets a flag for as long as it lives.
+        class FlagScope
+        {
+        public:
+            FlagScope(bool& flag, bool value) : m_flag(flag), m_previous(std::exchange(flag, value)) {}
+            ~FlagScope() { m_flag = m_previous; }
+
+        private:
+            bool& m_flag;
+            bool m_previous;
+        };
+    }
+
+    Value Interpreter::EvaluateProgram(Program& program, const std::vector<ExternalResource>& resources)
+    {
+        m_globals = std::make_shared<Environment>(nullptr);
+        m_inFunction = false;
+        m_tailCall.reset();
+        const Body& body = program.Body();
+
+        m_hosts.clear();
+        for (const ExternalResource& resource : resources)
+            m_hosts.insert(m_hosts.end(), resource.GetFunctions().begin(), resource.GetFunctions().end());
+        m_imports.clear();
+        m_importAliases.clear();
+
+        // Same hoisting rules as the compiler: imports, types, enums, functions and variables of the top
+        // level exist before the first statement runs.
+        for (const auto& stmt : body)
+        {
+            if (stmt->Kind() == NodeType::IMPORT_STMT)
+                DeclareImport(static_cast<const ImportStmt&>(*stmt));
+            else if (stmt->Kind() == NodeType::OBJECT_DECLARATION)
+            {
+                const auto& decl = static_cast<const ObjectDeclaration&>(*stmt);
+                auto type = std::make_unique<ObjectType>();
+                type->name = decl.Identifier();
+                for (const auto& property : decl.Properties())
+                {
+                    type->propertyNames.push_back(property.Key());
+                    type->propertyTypes.push_back(property.Type());
+                }
+                m_typeShapes[decl.Identifier()] = m_shapes.Declare(*type);
+                m_objectTypes.push_back(std::move(type));
+                m_objectDecls[decl.Identifier()] = &decl;
+            }
+            else if (stmt->Kind() == NodeType::ENUM_DECLARATION)
+            {
+                const auto& decl = static_cast<const EnumDeclaration&>(*stmt);
+                m_enumTypes.push_back(std::make_unique<EnumType>(EnumType{ decl.Identifier(), decl.Entries() }));
+
+                if (!m_globals->Declare(decl.Identifier(), Value::Object(m_heap.Allocate<EnumObject>(m_enumTypes.back().get())), std::nullopt, true))
+                    Error("Identifier '" + decl.Identifier() + "' is already declared.");
+            }
+            else if (stmt->Kind() == NodeType::VAR_DECLARATION)
+            {
+                const auto& decl = static_cast<const VarDeclaration&>(*stmt);
+                if (!m_globals->Declare(decl.Identifier(), Value::Null(), decl.Type(), decl.Constant()))
+                    Error("Identifier '" + decl.Identifier() + "' is already declared.");
+            }
+        }
+
+        for (const auto& stmt : body)
+        {
+            if (stmt->Kind() != NodeType::FUNCTION_DECLARATION)
+                continue;
+
+            const auto& fn = static_cast<const FunctionDeclaration&>(*stmt);
+            if (!m_globals->Declare(fn.Identifier(), MakeFunction(fn, m_globals), std::nullopt, true))
+                Error("Identifier '" + fn.Identifier() + "' is already declared.");
+        }
+
+        for (const auto& stmt : body)
+        {
+            switch (stmt->Kind())
+            {
+            case NodeType::FUNCTION_DECLARATION:
+            case NodeType::OBJECT_DECLARATION:
+            case NodeType::ENUM_DECLARATION:
+            case NodeType::IMPORT_STMT:
+                continue;
+            case NodeType::VAR_DECLARATION:
+                ExecVarDeclaration(static_cast<const VarDeclaration&>(*stmt), m_globals, true);
+                continue;
+            default:
+                break;
+            }
+
+            auto result = Exec(*stmt, m_globals);
+            if (result.has_value())
+                return result.value();
+        }
+
+        return Value::Null();
+    }
+
+    // ----- Statements -----
+
+    // Returns a value when a `return` statement was executed.
+    std::optional<Value> Interpreter::Exec(const Stmt& stmt, const EnvPtr& env)
+    {
+        switch (stmt.Kind())
+        {
+        case NodeType::IMPORT_STMT:
+            Error("Imports are only allowed at the top level of a script.");
+        case NodeType::VAR_DECLARATION:
+            ExecVarDeclaration(static_cast<const VarDeclaration&>(stmt), env, false);
+            return std::nullopt;
+        case NodeType::FUNCTION_DECLARATION:
+        {
+            const auto& fn = static_cast<const FunctionDeclaration&>(stmt);
+            if (!env->Declare(fn.Identifier(), Value::Null(), std::nullopt, true))
+                Error("Identifier '" + fn.Identifier() + "' is already declared in this scope.");
+            env->Find(fn.Identifier())->value = MakeFunction(fn, env);
+            return std::nullopt;
+        }
+        case NodeType::OBJECT_DECLARATION:
+            Error("Object declarations are only allowed at the top level of a script.");
+        case NodeType::ENUM_DECLARATION:
+            Error("Enum declarations are only allowed at the top level of a script.");
+        case NodeType::RETURN_DECLARATION:
+        {
+            const Expr& value = static_cast<const ReturnDeclaration&>(stmt).Value();
+            if (m_inFunction && value.Kind() == NodeType::CALL_EXPR)
+                return TailCall(static_cast<const CallExpr&>(value), env);
+            return Eval(value, env);
+        }
+        case NodeType::DELETE_DECLARATION:
+        {
+            const std::string& name = static_cast<const DeleteDeclaration&>(stmt).Value();
+            auto* var = env->Find(name);
+            if (var == nullptr)
+                Error("Cannot delete undeclared identifier '" + name + "'.");
+            if (var->constant)
+                Error("Cannot delete constant '" + name + "'.");
+
+            var->value = Value::Null();
+            if (env.get() != m_globals.get() || env->Find(name) != m_globals->Find(name))
+                env->Erase(name);
+            return std::nullopt;
+        }
+        case NodeType::IF_ELSE_DECLARATION:
+        {
+            const auto& ifElse = static_cast<const IfElseDeclaration&>(stmt);
+            for (const auto& block : ifElse.Blocks())
+            {
+                if (Eval(block.Condition(), env).IsTruthy())
+                    return ExecBlock(block.Body(), env);
+            }
+            return ExecBlock(ifElse.ElseBody(), env);
+        }
+        case NodeType::WHILE_DECLARATION:
+        {
+            const auto& loop = static_cast<const WhileDeclaration&>(stmt);
+            while (Eval(loop.Condition(), env).IsTruthy())
+            {
+                auto result = ExecBlock(loop.Body(), env);
+                if (result.has_value())
+                    return result;
+            }
+            return std::nullopt;
+        }
+        case NodeType::FOR_DECLARATION:
+        {
+            const auto& loop = static_cast<const ForDeclaration&>(stmt);
+            auto loopEnv = std::make_shared<Environment>(env);
+            Exec(loop.Declaration(), loopEnv);
+            while (Eval(loop.Condition(), loopEnv).IsTruthy())
+            {
+                auto result = ExecBlock(loop.Body(), loopEnv);
+                if (result.has_value())
+                    return result;
+                Eval(loop.Action(), loopEnv);
+            }
+            return std::nullopt;
+        }
+        default:
+        {
+            const auto* expr = dynamic_cast<const Expr*>(&stmt);
+            if (expr == nullptr)
+                Error("Unsupported statement.");
+
+            Eval(*expr, env);
+            return std::nullopt;
+        }
+        }
+    }
+
+    std::optional<Value> Interpreter::ExecBlock(const Body& body, const EnvPtr& parent)
+    {
+        auto env = std::make_shared<Environment>(parent);
+        for (const auto& stmt : body)
+        {
+            auto result = Exec(*stmt, env);
+            if (result.has_value())
+                return result;
+        }
+        return std::nullopt;
+    }
+
+    void Interpreter::ExecVarDeclaration(const VarDeclaration& decl, const EnvPtr& env, bool global)
+    {
+        Value value;
+        if (!decl.Value().has_value() || !decl.Value().value())
+            value = DefaultValue(decl.Type());
+        else if (decl.Value().value()->Kind() == NodeType::OBJECT_CONSTRUCTOR_EXPR)
+            value = Convert(EvalObjectConstructor(static_cast<const ObjectConstructorExpr&>(*decl.Value().value()), env, decl.Type()), decl.Type());
+        else
+            value = Convert(Eval(*decl.Value().value(), env), decl.Type());
+
+        if (global)
+        {
+            env->Find(decl.Identifier())->value = value;
+            return;
+        }
+
+        if (!env->Declare(decl.Identifier(), value, decl.Type(), decl.Constant()))
+            Error("Identifier '" + decl.Identifier() + "' is already declared in this scope.");
+    }
+
+    Deferred Interpreter::Defer()
+    {
+        Error("Async natives are not supported by the interpreter.");
+    }
+
+    Value Interpreter::MakeFunction(const FunctionDeclaration& fn, const EnvPtr& env)
+    {
+        if (fn.Async())
+            Error("Async functions are not supported by the interpreter.");
+
+        std::vector<AstFunctionObject::Param> params;
+        for (const auto& param : fn.Parameters())
+            params.push_back(AstFunctionObject::Param{ param.Identifier(), param.Type() });
+
+        std::optional<Types::Type> returnType = std::nullopt;
+        if (!fn.Type().Is(Types::Uid::Void))
+            returnType.emplace(fn.Type());
+
+        return Value::Object(m_heap.Allocate<AstFunctionObject>(fn.Identifier(), std::move(params), fn.Body(), fn.InstantReturn(), std::move(returnType), env));
+    }
+
+    void Interpreter::DeclareImport(const ImportStmt& import)
+    {
+        std::string path = "";
+        for (const auto& part : import.Target())
+            path += (path.empty() ? "" : ".") + part;
+
+        const StandardLibrary::Module* module = StandardLibrary::FindModule(path);
+        if (module == nullptr)
+            Error("Cannot resolve import '" + path + "'.");
+
+        if (import.Alias().empty())
+        {
+            if (std::find(m_imports.begin(), m_imports.end(), module) == m_imports.end())
+                m_imports.push_back(module);
+        }
+        else if (!m_importAliases.emplace(import.Alias(), module).second)
+            Error("Import alias '" + import.Alias() + "' is already declared.");
+    }
+
+    // `alias.name` names a module function unless a variable shadows the alias.
+    std::optional<Value> Interpreter::ImportedMember(const MemberExpr& member, const EnvPtr& env)
+    {
+        if (member.Object().Kind() != NodeType::IDENTIFIER)
+            return std::nullopt;
+
+        const std::string& alias = static_cast<const Identifier&>(member.Object()).Symbol();
+        auto import = m_importAliases.find(alias);
+        if (import == m_importAliases.end() || env->Find(alias) != nullptr)
+            return std::nullopt;
+
+        const std::string& name = static_cast<const Identifier&>(member.Property()).Symbol();
+        const auto* function = import->second->Find(name);
+        if (function == nullptr)
+            Error("Module '" + std::string(import->second->path) + "' has no function '" + name + "'.");
+
+        std::string global = alias + "." + name;
+        if (auto it = m_natives.find(global); it != m_natives.end())
+            return it->second;
+        return m_natives.emplace(global, Value::Object(m_heap.Allocate<NativeFunctionObject>(function->name, function->function, function->arity))).first->second;
+    }
+
+    // ----- Expressions -----
+
+    Value Interpreter::Eval(const Expr& expr, const EnvPtr& env)
+    {
+        switch (expr.Kind())
+        {
+        case NodeType::NUMERIC_LITERAL:
+            return Value::Int(static_cast<const NumericLiteral&>(expr).Value());
+        case NodeType::FLOAT_LITERAL:
+            return Value::Float(static_cast<const FloatLiteral&>(expr).Value());
+        case NodeType::DOUBLE_LITERAL:
+            return Value::Double(static_cast<const DoubleLiteral&>(expr).Value());
+        case NodeType::CHAR_LITERAL:
+            return Value::Char(static_cast<const CharLiteral&>(expr).Value());
+        case NodeType::STRING_LITERAL:
+            return Value::Object(m_heap.Allocate<StringObject>(String(static_cast<const StringLiteral&>(expr).Value())));
+        case NodeType::IDENTIFIER:
+        {
+            const std::string& name = static_cast<const Identifier&>(expr).Symbol();
+            if (auto* var = env->Find(name))
+                return var->value;
+            if (name == "true" || name == "false")
+                return Value::Bool(name == "true");
+            if (name == "null")
+                return Value::Null();
+            if (auto it = m_natives.find(name); it != m_natives.end())
+                return it->second;
+
+            // Host functions before the standard library, the same as in the compiler.
+            for (const auto& host : m_hosts)
+            {
+                if (host->name == name)
+                    return m_natives.emplace(name, Value::Object(m_heap.Allocate<NativeFunctionObject>(host->name, host->trampoline, host->arity, const_cast<HostFunction*>(host.get())))).first->second;
+            }
+            for (const StandardLibrary::Module* module : m_imports)
+            {
+                if (const auto* function = module->Find(name))
+                    return m_natives.emplace(name, Value::Object(m_heap.Allocate<NativeFunctionObject>(function->name, function->function, function->arity))).first->second;
+            }
+            if (const auto* function = StandardLibrary::Find(name))
+                return m_natives.emplace(name, Value::Object(m_heap.Allocate<NativeFunctionObject>(function->name, function->function, function->arity))).first->second;
+            Error("Undeclared identifier '" + name + "'.");
+        }
+        case NodeType::BINARY_EXPR:
+        {
+            const auto& binary = static_cast<const BinaryExpr&>(expr);
+            Value left = Eval(binary.Left(), env);
+            Value right = Eval(binary.Right(), env);
+            return Arithmetic(binary.Operator(), left, right);
+        }
+        case NodeType::EQUALITY_CHECK_EXPR:
+        {
+            const auto& check = static_cast<const EqualityCheckExpr&>(expr);
+            switch (check.Operator())
+            {
+            case EqualityCheckExpr::Type::AND:
+                return Value::Bool(Eval(check.Left(), env).IsTruthy() && Eval(check.Right(), env).IsTruthy());
+            case EqualityCheckExpr::Type::OR:
+                return Value::Bool(Eval(check.Left(), env).IsTruthy() || Eval(check.Right(), env).IsTruthy());
+            default:
+            {
+                Value left = Eval(check.Left(), env);
+                Value right = Eval(check.Right(), env);
+                return Value::Bool(Compare(check.Operator(), left, right));
+            }
+            }
+        }
+        case NodeType::UNARY_EXPR:
+        {
+            const auto& unary = static_cast<const UnaryExpr&>(expr);
+            Value value = Eval(unary.Object(), env);
+            if (unary.Operator() == "+")
+                return value;
+            if (unary.Operator() == "!")
+                return Value::Bool(!value.IsTruthy());
+            if (unary.Operator() != "-")
+                Error("Unknown unary operator '" + unary.Operator() + "'.");
+
+            switch (value.Type())
+            {
+            case ValueType::Int:    return Value::Int((std::int32_t) (0u - (std::uint32_t) value.AsInt()));
+            case ValueType::Char:   return Value::Int(-(std::int32_t) value.AsChar());
+            case ValueType::Float:  return Value::Float(-value.AsFloat());
+            case ValueType::Double: return Value::Double(-value.AsDouble());
+            default:                Error("Operator '-' cannot be applied to '" + VM::TypeName(value) + "'.");
+            }
+        }
+        case NodeType::ASSIGNMENT_EXPR:
+            return EvalAssignment(static_cast<const AssignmentExpr&>(expr), env);
+        case NodeType::MEMBER_EXPR:
+        {
+            const auto& member = static_cast<const MemberExpr&>(expr);
+            if (member.Property().Kind() != NodeType::IDENTIFIER)
+                Error("Member access requires an identifier after the dot.");
+            if (auto imported = ImportedMember(member, env); imported.has_value())
+                return imported.value();
+            return GetField(Eval(member.Object(), env), static_cast<const Identifier&>(member.Property()).Symbol());
+        }
+        case NodeType::INDEX_EXPR:
+        {
+            const auto& index = static_cast<const IndexExpr&>(expr);
+            Value object = Eval(index.Caller(), env);
+            Value key = Eval(index.Arg(), env);
+            if (!key.IsInt())
+                Error("Index must be of type 'int', got '" + VM::TypeName(key) + "'.");
+
+            std::int32_t i = key.AsInt();
+            if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Array)
+            {
+                const auto& items = static_cast<ArrayObject*>(object.AsObject())->Items();
+                if (i < 0 || (std::size_t) i >= items.size())
+                    Error("Index " + std::to_string(i) + " is out of bounds for array of length " + std::to_string(items.size()) + ".");
+                return items[i];
+            }
+            if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+            {
+                auto* array = static_cast<TypedArrayObject*>(object.AsObject());
+                if (i < 0 || (std::size_t) i >= array->Length())
+                    Error("Index " + std::to_string(i) + " is out of bounds for array of length " + std::to_string(array->Length()) + ".");
+                return array->Get(i);
+            }
+            if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::String)
+            {
+                const auto& data = static_cast<StringObject*>(object.AsObject())->Data();
+                if (i < 0 || (std::size_t) i >= data.size())
+                    Error("Index " + std::to_string(i) + " is out of bounds for string of length " + std::to_string(data.size()) + ".");
+                return Value::Char(data[i]);
+            }
+            Error("Cannot index into '" + VM::TypeName(object) + "'.");
+        }
+        case NodeType::CALL_EXPR:
+            return EvalCall(static_cast<const CallExpr&>(expr), env);
+        case NodeType::AWAIT_EXPR:
+            Error("Await is not supported by the interpreter.");
+        case NodeType::OBJECT_CONSTRUCTOR_EXPR:
+            return EvalObjectConstructor(static_cast<const ObjectConstructorExpr&>(expr), env, std::nullopt);
+        case NodeType::LAMBDA_EXPR:
+        {
+            const auto& lambda = static_cast<const LambdaExpr&>(expr);
+            std::vector<AstFunctionObject::Param> params;
+            for (const auto& ident : lambda.ParamIdents())
+                params.push_back(AstFunctionObject::Param{ ident.Symbol(), std::nullopt });
+            return Value::Object(m_heap.Allocate<AstFunctionObject>("lambda", std::move(params), lambda.Body(), lambda.InstantReturn(), std::nullopt, env));
+        }
+        case NodeType::ARRAY_LITERAL:
+        {
+            std::vector<Value> items;
+            for (const auto& element : static_cast<const ArrayLiteral&>(expr).Value())
+                items.push_back(Eval(*element, env));
+            return Value::Object(m_heap.Allocate<ArrayObject>(std::move(items)));
+        }
+        default:
+            Error("Unsupported expression.");
+        }
+    }
+
+    Value Interpreter::EvalAssignment(const AssignmentExpr& assignment, const EnvPtr& env)
+    {
+        const Expr& target = assignment.Assigne();
+
+        if (target.Kind() == NodeType::IDENTIFIER)
+        {
+            const std::string& name = static_cast<const Identifier&>(target).Symbol();
+            auto* var = env->Find(name);
+            if (var == nullptr)
+                Error("Cannot assign to undeclared identifier '" + name + "'.");
+            if (var->constant)
+                Error("Cannot assign to constant '" + name + "'.");
+
+            Value value = assignment.Value().Kind() == NodeType::OBJECT_CONSTRUCTOR_EXPR
+                ? EvalObjectConstructor(static_cast<const ObjectConstructorExpr&>(assignment.Value()), env, var->type)
+                : Eval(assignment.Value(), env);
+
+            // Evaluating the value may have declared or erased variables, look the target up again.
+            var = env->Find(name);
+            if (var == nullptr)
+                Error("Cannot assign to undeclared identifier '" + name + "'.");
+            var->value = Convert(value, var->type);
+            return var->value;
+        }
+
+        if (target.Kind() == NodeType::MEMBER_EXPR)
+        {
+            const auto& member = static_cast<const MemberExpr&>(target);
+            if (member.Property().Kind() != NodeType::IDENTIFIER)
+                Error("Member assignment requires an identifier after the dot.");
+
+            Value object = Eval(member.Object(), env);
+            Value value = Eval(assignment.Value(), env);
+            SetField(object, static_cast<const Identifier&>(member.Property()).Symbol(), value);
+            return value;
+        }
+
+        if (target.Kind() == NodeType::INDEX_EXPR)
+        {
+            const auto& index = static_cast<const IndexExpr&>(target);
+            Value object = Eval(index.Caller(), env);
+            Value key = Eval(index.Arg(), env);
+            Value value = Eval(assignment.Value(), env);
+
+            if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+            {
+                if (!key.IsInt())
+                    Error("Index must be of type 'int', got '" + VM::TypeName(key) + "'.");
+
+                auto* array = static_cast<TypedArrayObject*>(object.AsObject());
+                if (array->IsReadOnly())
+                    Error("Cannot assign index of read-only '" + VM::TypeName(object) + "'.");
+                if (key.AsInt() < 0 || (std::size_t) key.AsInt() >= array->Length())
+                    Error("Index " + std::to_string(key.AsInt()) + " is out of bounds for array of length " + std::to_string(array->Length()) + ".");
+                array->Set(key.AsInt(), ConvertElement(value, array->GetElementType()));
+                return value;
+            }
+            if (!object.IsObject() || object.AsObject()->Kind() != ObjectKind::Array)
+                Error("Cannot assign index of '" + VM::TypeName(object) + "'.");
+            if (!key.IsInt())
+                Error("Index must be of type 'int', got '" + VM::TypeName(key) + "'.");
+
+            auto& items = static_cast<ArrayObject*>(object.AsObject())->Items();
+            if (key.AsInt() < 0 || (std::size_t) key.AsInt() >= items.size())
+                Error("Index " + std::to_string(key.AsInt()) + " is out of bounds for array of length " + std::to_string(items.size()) + ".");
+            items[key.AsInt()] = value;
+            return value;
+        }
+
+        Error("Invalid assignment target.");
+    }
+
+    Value Interpreter::EvalCall(const CallExpr& call, const EnvPtr& env)
+    {
+        Value callee = Eval(call.Caller(), env);
+
+        std::vector<Value> args;
+        for (const auto& arg : call.Args())
+            args.push_back(Eval(*arg, env));
+
+        return CallFunction(callee, std::move(args));
+    }
+
+    Value Interpreter::TailCall(const CallExpr& call, const EnvPtr& env)
+    {
+        Value callee = Eval(call.Caller(), env);
+
+        std::vector<Value> args;
+        for (const auto& arg : call.Args())
+            args.push_back(Eval(*arg, env));
+
+        m_tailCall.emplace(callee, std::move(args));
+        return Value::Null();
+    }
+
+    // Tail calls run one after the other in the loop below instead of nesting, so that the reference
+    // engine keeps up with scripts that rely on them. The return types of the functions they left
+    // apply afterwards, innermost first.
+    Value Interpreter::CallFunction(Value callee, std::vector<Value> args)
+    {
+        FlagScope inFunction(m_inFunction, true);
+        std::vector<const AstFunctionObject*> returned;
+        Value result = Value::Null();
+
+        while (true)
+        {
+            if (callee.IsObject() && callee.AsObject()->Kind() == ObjectKind::Native)
+            {
+                auto* native = static_cast<NativeFunctionObject*>(callee.AsObject());
+                if (native->Arity() >= 0 && (std::size_t) native->Arity() != args.size())
+                    Error("Function '" + native->Name() + "' expects " + std::to_string(native->Arity()) + " argument(s) but got " + std::to_string(args.size()) + ".");
+                result = native->Function()(*this, args.data(), (int) args.size(), native->Userdata());
+                break;
+            }
+
+            if (!callee.IsObject() || callee.AsObject()->Kind() != ObjectKind::AstFunction)
+                Error("Value of type '" + VM::TypeName(callee) + "' is not callable.");
+
+            auto* fn = static_cast<AstFunctionObject*>(callee.AsObject());
+            if (fn->Params().size() != args.size())
+                Error("Function '" + fn->Name() + "' expects " + std::to_string(fn->Params().size()) + " argument(s) but got " + std::to_string(args.size()) + ".");
+
+            auto env = std::make_shared<Environment>(fn->Closure());
+            for (std::size_t i = 0; i < args.size(); i++)
+            {
+                const auto& param = fn->Params()[i];
+                if (!env->Declare(param.name, Convert(args[i], param.type), param.type, false))
+                    Error("Parameter '" + param.name + "' is declared twice.");
+            }
+
+            const Body& body = fn->Body();
+            const Expr* instantValue = fn->InstantReturn() && body.size() == 1 ? dynamic_cast<const Expr*>(body[0].get()) : nullptr;
+            std::optional<Value> value = std::nullopt;
+            if (instantValue != nullptr)
+                value = instantValue->Kind() == NodeType::CALL_EXPR ? TailCall(static_cast<const CallExpr&>(*instantValue), env) : Eval(*instantValue, env);
+            else
+            {
+                for (const auto& stmt : body)
+                {
+                    value = Exec(*stmt, env);
+                    if (value.has_value())
+                        break;
+                }
+            }
+
+            if (!m_tailCall.has_value())
+            {
+                result = value.has_value() ? Convert(value.value(), fn->ReturnType()) : Value::Null();
+                break;
+            }
+
+            // A function that calls itself needs its conversion only once.
+            if (fn->ReturnType().has_value() && (returned.empty() || returned.back() != fn))
+                returned.push_back(fn);
+            callee = m_tailCall->first;
+            args = std::move(m_tailCall->second);
+            m_tailCall.reset();
+        }
+
+        for (auto it = returned.rbegin(); it != returned.rend(); ++it)
+            result = Convert(result, (*it)->ReturnType());
+        return result;
+    }
+
+    Value Interpreter::EvalObjectConstructor(const ObjectConstructorExpr& ctor, const EnvPtr& env, const std::optional<Types::Type>& hint)
+    {
+        std::string typeName = "";
+        if (ctor.TargetVarIdentAsType())
+        {
+            if (const auto* type = std::any_cast<Types::Type>(&ctor.TargetVarIdent()); type != nullptr && type->Is(Types::Uid::Object))
+                typeName = type->Data();
+        }
+        if (typeName.empty() && hint.has_value() && hint->Is(Types::Uid::Object))
+            typeName = hint->Data();
+
+        if (typeName.empty())
+        {
+            Value object = Value::Object(m_heap.Allocate<InstanceObject>(m_shapes.Empty()));
+            for (const auto& property : ctor.Properties())
+            {
+                if (!property.Value().has_value())
+                    Error("Property '" + property.Key() + "' requires a value in object constructor.");
+                SetField(object, property.Key(), Eval(*property.Value().value(), env));
+            }
+            return object;
+        }
+
+        auto decl = m_objectDecls.find(typeName);
+        if (decl == m_objectDecls.end())
+            Error("Unknown object type '" + typeName + "'.");
+
+        Value object = Value::Object(m_heap.Allocate<InstanceObject>(m_typeShapes[typeName]));
+        std::vector<std::string> provided;
+        for (const auto& property : ctor.Properties())
+        {
+            if (!property.Value().has_value())
+                Error("Property '" + property.Key() + "' requires a value in object constructor.");
+            SetField(object, property.Key(), Eval(*property.Value().value(), env));
+            provided.push_back(property.Key());
+        }
+
+        for (const auto& property : decl->second->Properties())
+        {
+            if (!property.Value().has_value() || VectorUtils::Contains(provided, property.Key()))
+                continue;
+            SetField(object, property.Key(), Eval(*property.Value().value(), env));
+        }
+
+        return object;
+    }
+
+    // ----- Operators -----
+
+    Value Interpreter::Arithmetic(char op, const Value& a, const Value& b)
+    {
+        bool aIsString = a.IsObject() && a.AsObject()->Kind() == ObjectKind::String;
+        bool bIsString = b.IsObject() && b.AsObject()->Kind() == ObjectKind::String;
+        if (op == '+' && (aIsString || bIsString))
+            return Value::Object(m_heap.Allocate<StringObject>(String(VM::ToString(a) + VM::ToString(b))));
+
+        if (!a.IsNumber() || !b.IsNumber())
+            Error(std::string("Operator '") + op + "' cannot be applied to '" + VM::TypeName(a) + "' and '" + VM::TypeName(b) + "'.");
+
+        if (a.IsDouble() || b.IsDouble())
+        {
+            double l = a.ToDouble(), r = b.ToDouble();
+            switch (op)
+            {
+            case '+': return Value::Double(l + r);
+            case '-': return Value::Double(l - r);
+            case '*': return Value::Double(l * r);
+            case '/': return Value::Double(l / r);
+            case '%': return Value::Double(std::fmod(l, r));
+            }
+        }
+        else if (a.IsFloat() || b.IsFloat())
+        {
+            float l = (float) a.ToDouble(), r = (float) b.ToDouble();
+            switch (op)
+            {
+            case '+': return Value::Float(l + r);
+            case '-': return Value::Float(l - r);
+            case '*': return Value::Float(l * r);
+            case '/': return Value::Float(l / r);
+            case '%': return Value::Float(std::fmod(l, r));
+            }
+        }
+        else
+        {
+            std::int64_t l = a.ToInt(), r = b.ToInt();
+            switch (op)
+            {
+            case '+': return Value::Int((std::int32_t) (std::uint32_t) (l + r));
+            case '-': return Value::Int((std::int32_t) (std::uint32_t) (l - r));
+            case '*': return Value::Int((std::int32_t) (std::uint32_t) (std::uint64_t) (l * r));
+            case '/':
+                if (r == 0)
+                    Error("Integer division by zero.");
+                return Value::Int((std::int32_t) (std::uint32_t) (l / r));
+            case '%':
+                if (r == 0)
+                    Error("Integer division by zero.");
+                return Value::Int((std::int32_t) (l % r));
+            }
+        }
+
+        Error(std::string("Unknown binary operator '") + op + "'.");
+    }
+
+    bool Interpreter::Compare(EqualityCheckExpr::Type op, const Value& a, const Value& b)
+    {
+        if (op == EqualityCheckExpr::Type::EQUALS)
+            return Equals(a, b);
+        if (op == EqualityCheckExpr::Type::NOT_EQUALS)
+            return !Equals(a, b);
+
+        int order;
+        if (a.IsNumber() && b.IsNumber())
+        {
+            double l = a.ToDouble(), r = b.ToDouble();
+            if (std::isnan(l) || std::isnan(r))
+                return false;
+            order = l < r ? -1 : l > r ? 1 : 0;
+        }
+        else if (a.IsObject() && b.IsObject() && a.AsObject()->Kind() == ObjectKind::String && b.AsObject()->Kind() == ObjectKind::String)
+            order = static_cast<StringObject*>(a.AsObject())->Data().compare(static_cast<StringObject*>(b.AsObject())->Data());
+        else
+            Error("Cannot compare '" + VM::TypeName(a) + "' with '" + VM::TypeName(b) + "'.");
+
+        switch (op)
+        {
+        case EqualityCheckExpr::Type::LESS_THAN:           return order < 0;
+        case EqualityCheckExpr::Type::LESS_THAN_OR_EQUALS: return order <= 0;
+        case EqualityCheckExpr::Type::MORE_THAN:           return order > 0;
+        default:                                           return order >= 0;
+        }
+    }
+
+    bool Interpreter::Equals(const Value& a, const Value& b)
+    {
+        if (a.IsNumber() && b.IsNumber())
+        {
+            if (a.IsInt() && b.IsInt())
+                return a.AsInt() == b.AsInt();
+            return a.ToDouble() == b.ToDouble();
+        }
+
+        bool aIsString = a.IsObject() && a.AsObject()->Kind() == ObjectKind::String;
+        bool bIsString = b.IsObject() && b.AsObject()->Kind() == ObjectKind::String;
+        if (aIsString && bIsString)
+            return StringObject::Equal(static_cast<StringObject*>(a.AsObject()), static_cast<StringObject*>(b.AsObject()));
+
+        return a.IsIdentical(b);
+    }
+
+    Value Interpreter::Convert(const Value& value, const std::optional<Types::Type>& type)
+    {
+        if (!type.has_value() || !type->LambdaTypes().empty())
+            return value;
+
+        auto Fail = [&](const char* target)
+        {
+            Error("Cannot convert '" + VM::TypeName(value) + "' to '" + target + "'.");
+        };
+
+        auto conversion = Conversion::For(type);
+        if (conversion.has_value() && (conversion.value() & Conversion::TypedArray))
+        {
+            ElementType element = Conversion::ElementTypeOf(conversion.value()).value();
+            if (value.IsNull() || (value.IsObject() && value.AsObject()->Kind() == ObjectKind::TypedArray && static_cast<TypedArrayObject*>(value.AsObject())->GetElementType() == element))
+                return value;
+            if (!value.IsObject() || value.AsObject()->Kind() != ObjectKind::Array)
+                Error("Cannot convert '" + VM::TypeName(value) + "' to '" + TypedArrayObject::ElementName(element) + "[]'.");
+
+            const auto& items = static_cast<ArrayObject*>(value.AsObject())->Items();
+            auto* array = m_heap.Allocate<TypedArrayObject>(element, items.size());
+            for (std::size_t i = 0; i < items.size(); i++)
+                array->Set(i, ConvertElement(items[i], element));
+            return Value::Object(array);
+        }
+
+        switch ((Types::Uid) type->Uid())
+        {
+        case Types::Uid::Int:
+            if (!value.IsNumber()) Fail("int");
+            return Value::Int(value.ToInt());
+        case Types::Uid::Float:
+            if (!value.IsNumber()) Fail("float");
+            return Value::Float((float) value.ToDouble());
+        case Types::Uid::Double:
+            if (!value.IsNumber()) Fail("double");
+            return Value::Double(value.ToDouble());
+        case Types::Uid::Char:
+            if (value.IsChar()) return value;
+            if (!value.IsInt()) Fail("char");
+            return Value::Char((char) value.AsInt());
+        case Types::Uid::Bool:
+            if (!value.IsBool()) Fail("bool");
+            return value;
+        case Types::Uid::String:
+            if (!value.IsNull() && !(value.IsObject() && value.AsObject()->Kind() == ObjectKind::String)) Fail("string");
+            return value;
+        default:
+            return value;
+        }
+    }
+
+    Value Interpreter::ConvertElement(const Value& value, ElementType type)
+    {
+        switch (type)
+        {
+        case ElementType::Int:    return Convert(value, Types::Type::Int());
+        case ElementType::Float:  return Convert(value, Types::Type::Float());
+        case ElementType::Double: return Convert(value, Types::Type::Double());
+        default:                  return Convert(value, Types::Type::Char());
+        }
+    }
+
+    Value Interpreter::DefaultValue(const std::optional<Types::Type>& type)
+    {
+        if (!type.has_value() || !type->LambdaTypes().empty())
+            return Value::Null();
+
+        switch ((Types::Uid) type->Uid())
+        {
+        case Types::Uid::Bool:   return Value::Bool(false);
+        case Types::Uid::Int:    return Value::Int(0);
+        case Types::Uid::Float:  return Value::Float(0.0f);
+        case Types::Uid::Double: return Value::Double(0.0);
+        case Types::Uid::Char:   return Value::Char('\0');
+        default:                 return Value::Null();
+        }
+    }
+
+    Value Interpreter::GetField(const Value& object, const std::string& key)
+    {
+        if (object.IsObject())
+        {
+            HeapObject* heapObject = object.AsObject();
+            if (heapObject->Kind() == ObjectKind::Instance)
+            {
+                auto* instance = static_cast<InstanceObject*>(heapObject);
+                int slot = instance->GetShape()->Find(key);
+                if (slot >= 0)
+                    return instance->Slot(slot);
+            }
+            else if (heapObject->Kind() == ObjectKind::Enum)
+            {
+                const auto& entries = static_cast<EnumObject*>(heapObject)->Type()->entries;
+                for (std::size_t i = 0; i < entries.size(); i++)
+                {
+                    if (entries[i] == key)
+                        return Value::Int((std::int32_t) i);
+                }
+            }
+            else if (heapObject->Kind() == ObjectKind::Array && key == "length")
+                return Value::Int((std::int32_t) static_cast<ArrayObject*>(heapObject)->Items().size());
+            else if (heapObject->Kind() == ObjectKind::TypedArray && key == "length")
+                return Value::Int((std::int32_t) static_cast<TypedArrayObject*>(heapObject)->Length());
+            else if (heapObject->Kind() == ObjectKind::String && key == "length")
+                return Value::Int((std::int32_t) static_cast<StringObject*>(heapObject)->Length());
+        }
+
+        Error("'" + VM::TypeName(object) + "' has no property '" + key + "'.");
+    }
+
+    void Interpreter::SetField(const Value& object, const std::string& key, const Value& value)
+    {
+        if (!object.IsObject() || object.AsObject()->Kind() != ObjectKind::Instance)
+            Error("Cannot assign property '" + key + "' of '" + VM::TypeName(object) + "'.");
+
+        auto* instance = static_cast<InstanceObject*>(object.AsObject());
+        const ObjectType* type = instance->Type();
+        int slot = instance->GetShape()->Find(key);
+
+        if (slot >= 0)
+            instance->Slot(slot) = type != nullptr ? Convert(value, type->propertyTypes[slot]) : value;
+        else if (type == nullptr)
+            instance->AddSlot(m_shapes.AddProperty(instance->GetShape(), key), value);
+        else
+            Error("Object type '" + type->name + "' has no property '" + key + "'.");
+    }
+
+    void Interpreter::Error(const std::string& description) const
+    {
+        throw RuntimeException(description);
+    }
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../Frontend/Ast.h"
+#include "Binding.h"
+#include "Bytecode.h"
+#include "Heap.h"
+#include "Object.h"
+#include "RuntimeException.h"
+#include "StandardLibrary.h"
+#include "Value.h"
+
+using namespace JScr::Frontend;
+
+namespace JScr
+{
+    class ExternalResource;
+}
+
+namespace JScr::Runtime
+{
+    class Environment
+    {
+    public:
+        struct Variable
+        {
+            Value value;
+            std::optional<Types::Type> type;
+            bool constant;
+        };
+
+        Environment(std::shared_ptr<Environment> parent) : m_parent(std::move(parent)) {}
+
+        Variable* Find(const std::string& name)
+        {
+            for (Environment* env = this; env != nullptr; env = env->m_parent.get())
+            {
+                auto it = env->m_vars.find(name);
+                if (it != env->m_vars.end())
+                    return &it->second;
+            }
+            return nullptr;
+        }
+
+        bool Declare(const std::string& name, const Value& value, const std::optional<Types::Type>& type, bool constant)
+        {
+            return m_vars.emplace(name, Variable{ value, type, constant }).second;
+        }
+
+        bool Erase(const std::string& name)
+        {
+            for (Environment* env = this; env != nullptr; env = env->m_parent.get())
+            {
+                if (env->m_vars.erase(name) > 0)
+                    return true;
+            }
+            return false;
+        }
+    private:
+        std::shared_ptr<Environment> m_parent;
+        std::unordered_map<std::string, Variable> m_vars;
+    };
+
+    // A function or lambda as seen by the interpreter: the AST it came from plus the scope it closes over.
+    class AstFunctionObject : public HeapObject
+    {
+    public:
+        struct Param
+        {
+            std::string name;
+            std::optional<Types::Type> type;
+        };
+
+        AstFunctionObject(std::string name, std::vector<Param> params, const std::vector<std::unique_ptr<Stmt>>& body, bool instantReturn, std::optional<Types::Type> returnType, std::shared_ptr<Environment> closure)
+            : HeapObject(ObjectKind::AstFunction), m_name(std::move(name)), m_params(std::move(params)), m_body(body), m_instantReturn(instantReturn), m_returnType(std::move(returnType)), m_closure(std::move(closure))
+        {}
+
+        const std::string& Name() const { return m_name; }
+        const std::vector<Param>& Params() const { return m_params; }
+        const std::vector<std::unique_ptr<Stmt>>& Body() const { return m_body; }
+        bool InstantReturn() const { return m_instantReturn; }
+        const std::optional<Types::Type>& ReturnType() const { return m_returnType; }
+        const std::shared_ptr<Environment>& Closure() const { return m_closure; }
+    private:
+        std::string m_name;
+        std::vector<Param> m_params;
+        const std::vector<std::unique_ptr<Stmt>>& m_body;
+        bool m_instantReturn;
+        std::optional<Types::Type> m_returnType;
+        std::shared_ptr<Environment> m_closure;
+    };
+
+    // Straightforward tree walking evaluator. It is slow on purpose: it exists as the reference
+    // semantics the optimizing engines are checked against.
+    class Interpreter : public NativeHost
+    {
+    public:
+        Interpreter() {}
+        Interpreter(const Interpreter&) = delete;
+        Interpreter& operator=(const Interpreter&) = delete;
+
+        // Returns the value of a top level `return`, or null.
+        Value EvaluateProgram(Program& program, const std::vector<ExternalResource>& resources);
+
+        Heap& GetHeap() override { return m_heap; }
+        Value Call(const Value& callee, const std::vector<Value>& args) override { return CallFunction(callee, args); }
+        Deferred Defer() override;
+
+    private:
+        using Body = std::vector<std::unique_ptr<Stmt>>;
+        using EnvPtr = std::shared_ptr<Environment>;
+
+        std::optional<Value> Exec(const Stmt& stmt, const EnvPtr& env);
+        std::optional<Value> ExecBlock(const Body& body, const EnvPtr& parent);
+        void ExecVarDeclaration(const VarDeclaration& decl, const EnvPtr& env, bool global);
+        Value MakeFunction(const FunctionDeclaration& fn, const EnvPtr& env);
+        void DeclareImport(const ImportStmt& import);
+        std::optional<Value> ImportedMember(const MemberExpr& member, const EnvPtr& env);
+
+        Value Eval(const Expr& expr, const EnvPtr& env);
+        Value EvalAssignment(const AssignmentExpr& assignment, const EnvPtr& env);
+        Value EvalCall(const CallExpr& call, const EnvPtr& env);
+        Value EvalObjectConstructor(const ObjectConstructorExpr& ctor, const EnvPtr& env, const std::optional<Types::Type>& hint);
+        Value CallFunction(Value callee, std::vector<Value> args);
+        // Evaluates the call of a `return f(x)` and leaves it to CallFunction, the way the VM replaces
+        // the frame on TAILCALL.
+        Value TailCall(const CallExpr& call, const EnvPtr& env);
+
+        Value Arithmetic(char op, const Value& a, const Value& b);
+        bool Compare(EqualityCheckExpr::Type op, const Value& a, const Value& b);
+        static bool Equals(const Value& a, const Value& b);
+        Value Convert(const Value& value, const std::optional<Types::Type>& type);
+        Value ConvertElement(const Value& value, ElementType type);
+        Value DefaultValue(const std::optional<Types::Type>& type);
+        Value GetField(const Value& object, const std::string& key);
+        void SetField(const Value& object, const std::string& key, const Value& value);
+
+        [[noreturn]] void Error(const std::string& description) const;
+
+    private:
+        Heap m_heap;
+        EnvPtr m_globals;
+        // True while a function body runs, where a `return f(x)` is a tail call.
+        bool m_inFunction = false;
+        std::optional<std::pair<Value, std::vector<Value>>> m_tailCall;
+        ShapeTable m_shapes;
+        std::vector<std::unique_ptr<ObjectType>> m_objectTypes;
+        std::unordered_map<std::string, const Shape*> m_typeShapes;
+        std::unordered_map<std::string, const ObjectDeclaration*> m_objectDecls;
+        std::vector<std::unique_ptr<EnumType>> m_enumTypes;
+        std::unordered_map<std::string, Value> m_natives;
+        HostFunctions m_hosts;
+        std::vector<const StandardLibrary::Module*> m_imports;
+        std::unordered_map<std::string, const StandardLibrary::Module*> m_importAliases;
+    };
+}
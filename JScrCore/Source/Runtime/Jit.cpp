@@ -0,0 +1,1434 @@
+#include "Jit.h"
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include "Superinstructions.h"
+#include "VM.h"
+#include "X64Assembler.h"
+
+#ifdef JSCR_JIT_X64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace JScr::Runtime
+{
+    namespace
+    {
+        using Asm = X64Assembler;
+
+        // What is known about a register when an instruction starts.
+        enum class RegType : std::uint8_t
+        {
+            Unvisited, Int, Double, Bool, Dynamic
+        };
+
+        RegType Join(RegType a, RegType b)
+        {
+            if (a == RegType::Unvisited)
+                return b;
+            if (b == RegType::Unvisited)
+                return a;
+            return a == b ? a : RegType::Dynamic;
+        }
+
+        bool IsNumeric(RegType type) { return type == RegType::Int || type == RegType::Double; }
+        bool Maybe(RegType type, RegType wanted) { return type == wanted || type == RegType::Dynamic; }
+
+        RegType ArithType(RegType a, RegType b)
+        {
+            if (a == RegType::Int && b == RegType::Int)
+                return RegType::Int;
+            if (IsNumeric(a) && IsNumeric(b))
+                return RegType::Double;
+            return RegType::Dynamic;
+        }
+
+        // What a typed instruction's operands are known to be; Unvisited for Float and String, which
+        // always take the runtime helpers.
+        RegType OperandType(OpCode op)
+        {
+            switch (Specialization::OperandType(op))
+            {
+            case Types::Uid::Int:    return RegType::Int;
+            case Types::Uid::Double: return RegType::Double;
+            default:                 return RegType::Unvisited;
+            }
+        }
+
+        // The generic form of an instruction the helpers run, which may be fused or typed.
+        OpCode GenericOp(const Instruction* at)
+        {
+            OpCode op = Superinstructions::Unfuse(*at).Op();
+            return Specialization::Is(op) ? Specialization::Generic(op) : op;
+        }
+
+        std::size_t Width(OpCode op)
+        {
+            return op == OpCode::GETFIELD || op == OpCode::SETFIELD ? 2 : 1;
+        }
+
+        template <typename Visit>
+        void ForEachSuccessor(const FunctionProto& proto, std::size_t index, Visit&& visit)
+        {
+            const Instruction i = proto.code[index];
+            std::size_t next = index + 1;
+            switch (i.Op())
+            {
+            case OpCode::JMP:
+                visit(next + i.SBx());
+                break;
+            case OpCode::JMPIF:
+            case OpCode::JMPIFNOT:
+                visit(next);
+                visit(next + i.SBx());
+                break;
+            case OpCode::JMPTABLE:
+            {
+                const JumpTable& table = proto.jumpTables[i.Bx()];
+                for (std::int32_t target : table.targets)
+                    visit(next + target);
+                visit(next + table.fallback);
+                break;
+            }
+            case OpCode::RETURN:
+                break;
+            default:
+                visit(index + Width(i.Op()));
+                break;
+            }
+        }
+
+        // Forward data flow over the types of a function's registers. Declared primitive types show up
+        // in the bytecode as CONVERTs, whose result is known until the register is written again.
+        // Registers captured by a closure can change behind the function's back and stay dynamic.
+        class TypeInference
+        {
+        public:
+            // Functions bigger than this are compiled without type information.
+            static constexpr std::size_t MaxStates = 1 << 22;
+
+            TypeInference(const Module& module, const FunctionProto& proto)
+                : m_proto(proto), m_registers(proto.numRegisters), m_captured(proto.numRegisters, false)
+            {
+                std::size_t count = proto.code.size();
+                if (count == 0 || count * m_registers > MaxStates)
+                    return;
+
+                for (const Instruction& i : proto.code)
+                {
+                    if (i.Op() != OpCode::CLOSURE)
+                        continue;
+                    for (const auto& desc : module.functions[i.Bx()]->upvalues)
+                    {
+                        if (desc.fromParentLocal)
+                            m_captured[desc.index] = true;
+                    }
+                }
+
+                m_types.assign(count * m_registers, RegType::Unvisited);
+                std::vector<bool> visited(count, false), queued(count, false);
+                std::vector<std::size_t> work{ 0 };
+                std::vector<RegType> state(m_registers);
+
+                std::fill_n(m_types.begin(), m_registers, RegType::Dynamic);
+                visited[0] = queued[0] = true;
+
+                while (!work.empty())
+                {
+                    std::size_t index = work.back();
+                    work.pop_back();
+                    queued[index] = false;
+
+                    std::copy_n(m_types.begin() + index * m_registers, m_registers, state.begin());
+                    Transfer(Superinstructions::Unfuse(proto.code[index]), state);
+
+                    ForEachSuccessor(proto, index, [&](std::size_t successor)
+                    {
+                        if (successor >= count)
+                            return;
+
+                        bool changed = !visited[successor];
+                        visited[successor] = true;
+                        RegType* types = &m_types[successor * m_registers];
+                        for (std::size_t reg = 0; reg < m_registers; reg++)
+                        {
+                            RegType joined = Join(types[reg], state[reg]);
+                            changed |= joined != types[reg];
+                            types[reg] = joined;
+                        }
+
+                        if (changed && !queued[successor])
+                        {
+                            queued[successor] = true;
+                            work.push_back(successor);
+                        }
+                    });
+                }
+            }
+
+            RegType At(std::size_t index, std::uint8_t reg) const
+            {
+                if (m_types.empty())
+                    return RegType::Dynamic;
+                RegType type = m_types[index * m_registers + reg];
+                return type == RegType::Unvisited ? RegType::Dynamic : type;
+            }
+
+        private:
+            void Transfer(const Instruction i, std::vector<RegType>& r) const
+            {
+                switch (i.Op())
+                {
+                case OpCode::MOVE:
+                    r[i.A()] = r[i.B()];
+                    break;
+                case OpCode::LOADK:
+                {
+                    const Value& constant = m_proto.constants[i.Bx()];
+                    r[i.A()] = constant.IsInt() ? RegType::Int : constant.IsDouble() ? RegType::Double : constant.IsBool() ? RegType::Bool : RegType::Dynamic;
+                    break;
+                }
+                case OpCode::LOADINT:
+                    r[i.A()] = RegType::Int;
+                    break;
+                case OpCode::LOADBOOL:
+                case OpCode::NOT:
+                case OpCode::EQ:
+                case OpCode::NE:
+                case OpCode::LT:
+                case OpCode::LE:
+                case OpCode::GT:
+                case OpCode::GE:
+                    r[i.A()] = RegType::Bool;
+                    break;
+                case OpCode::ADD:
+                case OpCode::SUB:
+                case OpCode::MUL:
+                case OpCode::DIV:
+                case OpCode::MOD:
+                    r[i.A()] = ArithType(r[i.B()], r[i.C()]);
+                    break;
+                case OpCode::NEG:
+                    r[i.A()] = IsNumeric(r[i.B()]) ? r[i.B()] : RegType::Dynamic;
+                    break;
+                case OpCode::CONVERT:
+                    switch ((Types::Uid) i.C())
+                    {
+                    case Types::Uid::Int:    r[i.A()] = RegType::Int; break;
+                    case Types::Uid::Double: r[i.A()] = RegType::Double; break;
+                    case Types::Uid::Bool:   r[i.A()] = RegType::Bool; break;
+                    default:                 r[i.A()] = RegType::Dynamic; break;
+                    }
+                    break;
+                case OpCode::CALL:
+                case OpCode::TAILCALL:
+                    // The callee's frame starts right after the callee slot.
+                    std::fill(r.begin() + i.A(), r.end(), RegType::Dynamic);
+                    break;
+                case OpCode::LOADNULL:
+                case OpCode::GETGLOBAL:
+                case OpCode::GETUPVAL:
+                case OpCode::GETFIELD:
+                case OpCode::GETINDEX:
+                case OpCode::GETINBOUNDS:
+                case OpCode::NEWARRAY:
+                case OpCode::NEWOBJECT:
+                case OpCode::CLOSURE:
+                case OpCode::ASYNC:
+                case OpCode::AWAIT:
+                    r[i.A()] = RegType::Dynamic;
+                    break;
+                default:
+                    if (Specialization::IsArith(i.Op()))
+                        r[i.A()] = OperandType(i.Op()) == RegType::Unvisited ? RegType::Dynamic : OperandType(i.Op());
+                    else if (Specialization::Is(i.Op()))
+                        r[i.A()] = RegType::Bool;
+                    break;
+                }
+
+                for (std::size_t reg = 0; reg < m_registers; reg++)
+                {
+                    if (m_captured[reg])
+                        r[reg] = RegType::Dynamic;
+                }
+            }
+
+        private:
+            const FunctionProto& m_proto;
+            std::size_t m_registers;
+            std::vector<bool> m_captured;
+            // m_registers entries per instruction.
+            std::vector<RegType> m_types;
+        };
+    }
+
+    // Runtime entry points for generated code. They run one instruction with R12 as the frame's registers
+    // and return false if it threw.
+    struct Jit::Helpers
+    {
+        using Function = bool (*)(VM* vm, Value* base, const Instruction* at);
+
+        template <typename Body>
+        static bool Guard(VM& vm, const Instruction* at, Body&& body)
+        {
+            vm.m_frames.back().pc = at + 1;
+            try
+            {
+                body();
+                return true;
+            }
+            catch (...)
+            {
+                vm.m_jit.m_error = std::current_exception();
+                return false;
+            }
+        }
+
+        static bool Truthy(std::uint64_t bits)
+        {
+            return Value::FromBits(bits).IsTruthy();
+        }
+
+        static bool GetUpval(VM* vm, Value* base, const Instruction* at)
+        {
+            base[at->A()] = *vm->m_frames.back().closure->Upvalue(at->B())->Location();
+            return true;
+        }
+
+        static bool SetUpval(VM* vm, Value* base, const Instruction* at)
+        {
+            UpvalueObject* upvalue = vm->m_frames.back().closure->Upvalue(at->B());
+            *upvalue->Location() = base[at->A()];
+            vm->m_heap.WriteBarrier(upvalue, base[at->A()]);
+            return true;
+        }
+
+        static bool GetField(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&]
+            {
+                const VM::CallFrame& frame = vm->m_frames.back();
+                const Value& object = base[at->B()];
+                InlineCache& cache = frame.caches[at[1].Bx()];
+                if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Struct)
+                {
+                    auto* instance = static_cast<StructObject*>(object.AsObject());
+                    if (const auto* entry = cache.Find(instance->GetShape()))
+                    {
+                        base[at->A()] = instance->Load(entry->field);
+                        return;
+                    }
+                }
+                else if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Instance)
+                {
+                    auto* instance = static_cast<InstanceObject*>(object.AsObject());
+                    if (const auto* entry = cache.Find(instance->GetShape()))
+                    {
+                        base[at->A()] = instance->Slot(entry->slot);
+                        return;
+                    }
+                }
+                base[at->A()] = vm->GetField(object, static_cast<const StringObject*>(frame.proto->constants[at->C()].AsObject()), cache);
+            });
+        }
+
+        static bool SetField(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&]
+            {
+                const VM::CallFrame& frame = vm->m_frames.back();
+                const Value& object = base[at->A()];
+                InlineCache& cache = frame.caches[at[1].Bx()];
+                if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Struct)
+                {
+                    auto* instance = static_cast<StructObject*>(object.AsObject());
+                    if (const auto* entry = cache.Find(instance->GetShape()))
+                    {
+                        std::uint8_t conversion = instance->GetShape()->ConversionAt(entry->slot);
+                        Value value = conversion == Shape::NoConversion ? base[at->C()] : vm->Convert(base[at->C()], conversion);
+                        instance->Store(entry->field, value);
+                        vm->m_heap.WriteBarrier(instance, value);
+                        return;
+                    }
+                }
+                else if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Instance)
+                {
+                    auto* instance = static_cast<InstanceObject*>(object.AsObject());
+                    const auto* entry = cache.Find(instance->GetShape());
+                    if (entry != nullptr && entry->transition == nullptr)
+                    {
+                        std::uint8_t conversion = instance->GetShape()->ConversionAt(entry->slot);
+                        instance->Slot(entry->slot) = conversion == Shape::NoConversion ? base[at->C()] : vm->Convert(base[at->C()], conversion);
+                        vm->m_heap.WriteBarrier(instance, instance->Slot(entry->slot));
+                        return;
+                    }
+                    if (entry != nullptr)
+                    {
+                        instance->AddSlot(entry->transition, base[at->C()]);
+                        vm->m_heap.WriteBarrier(instance, base[at->C()]);
+                        return;
+                    }
+                }
+                vm->SetField(object, static_cast<const StringObject*>(frame.proto->constants[at->B()].AsObject()), base[at->C()], cache);
+            });
+        }
+
+        static bool GetIndex(VM* vm, Value* base, const Instruction* at)
+        {
+            const Value& object = base[at->B()];
+            const Value& index = base[at->C()];
+            if (object.IsObject() && index.IsInt() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+            {
+                auto* array = static_cast<TypedArrayObject*>(object.AsObject());
+                if ((std::uint32_t) index.AsInt() < array->Length())
+                {
+                    base[at->A()] = array->Get((std::uint32_t) index.AsInt());
+                    return true;
+                }
+            }
+            return Guard(*vm, at, [&] { base[at->A()] = vm->GetIndex(base[at->B()], base[at->C()]); });
+        }
+
+        static bool SetIndex(VM* vm, Value* base, const Instruction* at)
+        {
+            const Value& object = base[at->A()];
+            const Value& index = base[at->B()];
+            const Value& value = base[at->C()];
+            if (object.IsObject() && index.IsInt() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+            {
+                auto* array = static_cast<TypedArrayObject*>(object.AsObject());
+                bool exact = (array->GetElementType() == ElementType::Int && value.IsInt()) || (array->GetElementType() == ElementType::Double && value.IsDouble())
+                    || (array->GetElementType() == ElementType::Float && value.IsFloat());
+                if (exact && !array->IsReadOnly() && (std::uint32_t) index.AsInt() < array->Length())
+                {
+                    array->Set((std::uint32_t) index.AsInt(), value);
+                    return true;
+                }
+            }
+            return Guard(*vm, at, [&] { vm->SetIndex(object, index, value); });
+        }
+
+        static bool GetInBounds(VM* vm, Value* base, const Instruction* at)
+        {
+            const Value& object = base[at->B()];
+            std::uint32_t index = (std::uint32_t) base[at->C()].AsInt();
+            if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+            {
+                base[at->A()] = static_cast<TypedArrayObject*>(object.AsObject())->Get(index);
+                return true;
+            }
+            if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Array)
+            {
+                base[at->A()] = static_cast<ArrayObject*>(object.AsObject())->Items()[index];
+                return true;
+            }
+            return Guard(*vm, at, [&] { base[at->A()] = vm->GetIndex(base[at->B()], base[at->C()]); });
+        }
+
+        static bool SetInBounds(VM* vm, Value* base, const Instruction* at)
+        {
+            const Value& object = base[at->A()];
+            std::uint32_t index = (std::uint32_t) base[at->B()].AsInt();
+            const Value& value = base[at->C()];
+            if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+            {
+                auto* array = static_cast<TypedArrayObject*>(object.AsObject());
+                bool exact = (array->GetElementType() == ElementType::Int && value.IsInt()) || (array->GetElementType() == ElementType::Double && value.IsDouble())
+                    || (array->GetElementType() == ElementType::Float && value.IsFloat());
+                if (exact && !array->IsReadOnly())
+                {
+                    array->Set(index, value);
+                    return true;
+                }
+            }
+            else if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Array)
+            {
+                auto* array = static_cast<ArrayObject*>(object.AsObject());
+                array->Items()[index] = value;
+                vm->m_heap.WriteBarrier(array, value);
+                return true;
+            }
+            return Guard(*vm, at, [&] { vm->SetIndex(object, base[at->B()], value); });
+        }
+
+        static bool NewArray(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&]
+            {
+                base[at->A()] = Value::Object(vm->m_heap.Allocate<ArrayObject>(std::vector<Value>(base + at->B(), base + at->B() + at->C())));
+            });
+        }
+
+        static bool Append(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&]
+            {
+                auto* array = static_cast<ArrayObject*>(base[at->A()].AsObject());
+                array->Items().insert(array->Items().end(), base + at->B(), base + at->B() + at->C());
+                for (const Value* item = base + at->B(); item < base + at->B() + at->C(); item++)
+                    vm->m_heap.WriteBarrier(array, *item);
+            });
+        }
+
+        static bool NewObject(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&] { base[at->A()] = vm->NewObject(at->Bx()); });
+        }
+
+        static bool Closure(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&]
+            {
+                const FunctionProto* proto = vm->m_module->functions[at->Bx()].get();
+                const ClosureObject* enclosing = vm->m_frames.back().closure;
+                ClosureObject* closure = vm->m_heap.AllocateClosure(proto, proto->upvalues.size());
+                for (std::size_t n = 0; n < proto->upvalues.size(); n++)
+                {
+                    const UpvalueDesc& desc = proto->upvalues[n];
+                    closure->SetUpvalue(n, desc.fromParentLocal ? vm->CaptureUpvalue(base + desc.index) : enclosing->Upvalue(desc.index));
+                }
+
+                base[at->A()] = Value::Object(closure);
+            });
+        }
+
+        static bool Arith(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&] { base[at->A()] = vm->Arith(GenericOp(at), base[at->B()], base[at->C()]); });
+        }
+
+        static bool Neg(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&]
+            {
+                const Value& b = base[at->B()];
+                switch (b.Type())
+                {
+                case ValueType::Int:    base[at->A()] = Value::NegInt(b); break;
+                case ValueType::Char:   base[at->A()] = Value::Int(-(std::int32_t) b.AsChar()); break;
+                case ValueType::Float:  base[at->A()] = Value::Float(-b.AsFloat()); break;
+                case ValueType::Double: base[at->A()] = Value::Double(-b.AsDouble()); break;
+                default:
+                    vm->Error("Operator '-' cannot be applied to '" + VM::TypeName(b) + "'.");
+                }
+            });
+        }
+
+        static bool Equal(VM*, Value* base, const Instruction* at)
+        {
+            base[at->A()] = Value::Bool(VM::Equals(base[at->B()], base[at->C()]) == (GenericOp(at) == OpCode::EQ));
+            return true;
+        }
+
+        static bool Compare(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&] { base[at->A()] = Value::Bool(vm->Compare(GenericOp(at), base[at->B()], base[at->C()])); });
+        }
+
+        static bool Convert(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&] { base[at->A()] = vm->Convert(base[at->B()], at->C()); });
+        }
+
+        // A run that gives the thread back leaves the frame to the interpreter: before the call, or
+        // after it once the callee, which stays on the stack above, has returned.
+        static bool Call(VM* vm, Value* base, const Instruction* at)
+        {
+            return Guard(*vm, at, [&]
+            {
+                if (--vm->m_fuel < 0 && vm->OutOfFuel())
+                {
+                    vm->m_jit.m_preempted = at;
+                    return;
+                }
+                if (vm->m_heap.WantsCollection())
+                    vm->m_heap.Step(*vm);
+
+                std::size_t depth = vm->m_frames.size();
+                if (vm->PrepareCall(base + at->A(), at->B()) && (vm->Execute(depth), vm->m_frames.size() > depth))
+                    vm->m_jit.m_preempted = at + 1;
+            }) && vm->m_jit.m_preempted == nullptr;
+        }
+
+        static bool Close(VM* vm, Value* base, const Instruction* at)
+        {
+            vm->CloseUpvalues(base + at->A());
+            return true;
+        }
+
+        static bool Safepoint(VM* vm, Value*, const Instruction* at)
+        {
+            return Guard(*vm, at, [&]
+            {
+                if (vm->m_fuel < 0 && vm->OutOfFuel())
+                    vm->m_jit.m_preempted = at + 1 + at->SBx();
+                else if (vm->m_heap.WantsCollection())
+                    vm->m_heap.Step(*vm);
+            }) && vm->m_jit.m_preempted == nullptr;
+        }
+    };
+
+    // Emits one function. R12 holds the frame's registers, RBX the VM, R13 and R14 the Null and Int tags, R15 the fuel.
+    // The entry stub at offset 0 saves those and jumps to whichever instruction the frame continues at.
+    class Jit::CodeGen
+    {
+    public:
+        CodeGen(VM& vm, const FunctionProto& proto)
+            : m_vm(vm), m_proto(proto), m_types(vm.GetModule(), proto), m_targets(proto.code.size(), false)
+        {
+            for (std::size_t index = 0; index < proto.code.size(); index++)
+            {
+                OpCode op = proto.code[index].Op();
+                if (op == OpCode::JMP || op == OpCode::JMPIF || op == OpCode::JMPIFNOT || op == OpCode::JMPTABLE)
+                {
+                    ForEachSuccessor(proto, index, [&](std::size_t target)
+                    {
+                        if (target < m_targets.size())
+                            m_targets[target] = true;
+                    });
+                }
+            }
+        }
+
+        // Fills in the code offset of every instruction. Returns false if the code could not be linked.
+        bool Generate(std::vector<std::uint32_t>& offsets)
+        {
+            std::size_t count = m_proto.code.size();
+            offsets.assign(count, NoEntry);
+            for (std::size_t index = 0; index < count; index++)
+                m_labels.push_back(m_asm.NewLabel());
+            m_exit = m_asm.NewLabel();
+            m_error = m_asm.NewLabel();
+
+            m_asm.Push(Asm::RBX);
+            m_asm.Push(Asm::R12);
+            m_asm.Push(Asm::R13);
+            m_asm.Push(Asm::R14);
+            m_asm.Push(Asm::R15);
+            m_asm.Mov(Asm::RBX, Asm::RDI);
+            m_asm.Mov(Asm::R12, Asm::RSI);
+            m_asm.MovImm(Asm::R13, Value::TagNull);
+            m_asm.MovImm(Asm::R14, Value::TagInt);
+            LoadFuel();
+            m_asm.JmpReg(Asm::RDX);
+
+            for (std::size_t index = 0; index < count; index++)
+            {
+                m_asm.Bind(m_labels[index]);
+                offsets[index] = m_asm.Offset();
+                std::size_t width = Emit(index);
+                index += width - 1;
+            }
+
+            m_asm.Bind(m_error);
+            m_asm.MovImm(Asm::RAX, 0);
+            m_asm.Bind(m_exit);
+            StoreFuel();
+            m_asm.Pop(Asm::R15);
+            m_asm.Pop(Asm::R14);
+            m_asm.Pop(Asm::R13);
+            m_asm.Pop(Asm::R12);
+            m_asm.Pop(Asm::RBX);
+            m_asm.Ret();
+
+            return m_asm.Link();
+        }
+
+        const std::vector<std::uint8_t>& Code() const { return m_asm.Code(); }
+
+    private:
+        static Asm::Mem Slot(int reg) { return Asm::Mem{ Asm::R12, reg * (int) sizeof(Value) }; }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+        // Objects only use single inheritance, so their fields sit at fixed offsets even though they are
+        // not standard layout.
+        static constexpr int KindOffset = (int) offsetof(HeapObject, m_kind);
+        static constexpr int TypeOffset = (int) offsetof(TypedArrayObject, m_type);
+        static constexpr int LengthOffset = (int) offsetof(TypedArrayObject, m_length);
+        static constexpr int DataOffset = (int) offsetof(TypedArrayObject, m_data);
+        static constexpr int ReadOnlyOffset = (int) offsetof(TypedArrayObject, m_readOnly);
+#pragma GCC diagnostic pop
+
+        RegType Type(std::size_t index, std::uint8_t reg) const { return m_types.At(index, reg); }
+        const Instruction* At(std::size_t index) const { return m_proto.code.data() + index; }
+        Asm::Label Target(std::size_t index, const Instruction i) const { return m_labels[index + 1 + i.SBx()]; }
+
+        // Returns how many instructions were consumed.
+        std::size_t Emit(std::size_t index)
+        {
+            const Instruction i = Superinstructions::Unfuse(m_proto.code[index]);
+            switch (i.Op())
+            {
+            case OpCode::MOVE:
+                m_asm.Load(Asm::RAX, Slot(i.B()));
+                m_asm.Store(Slot(i.A()), Asm::RAX);
+                return 1;
+            case OpCode::LOADK:
+                m_asm.MovImm(Asm::RAX, m_proto.constants[i.Bx()].Bits());
+                m_asm.Store(Slot(i.A()), Asm::RAX);
+                return 1;
+            case OpCode::LOADNULL:
+                m_asm.Store(Slot(i.A()), Asm::R13);
+                return 1;
+            case OpCode::LOADBOOL:
+                m_asm.MovImm(Asm::RAX, Value::Bool(i.B() != 0).Bits());
+                m_asm.Store(Slot(i.A()), Asm::RAX);
+                return 1;
+            case OpCode::LOADINT:
+                m_asm.MovImm(Asm::RAX, Value::Int(i.SBx()).Bits());
+                m_asm.Store(Slot(i.A()), Asm::RAX);
+                return 1;
+            case OpCode::GETGLOBAL:
+                m_asm.MovImm(Asm::RAX, (std::uintptr_t) &m_vm.m_globals[i.Bx()]);
+                m_asm.Load(Asm::RAX, Asm::Mem{ Asm::RAX, 0 });
+                m_asm.Store(Slot(i.A()), Asm::RAX);
+                return 1;
+            case OpCode::SETGLOBAL:
+                m_asm.Load(Asm::RCX, Slot(i.A()));
+                m_asm.MovImm(Asm::RAX, (std::uintptr_t) &m_vm.m_globals[i.Bx()]);
+                m_asm.Store(Asm::Mem{ Asm::RAX, 0 }, Asm::RCX);
+                return 1;
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL:
+            case OpCode::DIV:
+            case OpCode::MOD:
+                EmitArith(index, i);
+                return 1;
+            case OpCode::NEG:
+                EmitNeg(index, i);
+                return 1;
+            case OpCode::NOT:
+                EmitTruthy(index, i.B());
+                m_asm.XorImm8(Asm::RAX, 1);
+                m_asm.MovImm(Asm::RCX, Value::TagBool);
+                m_asm.Or(Asm::RAX, Asm::RCX);
+                m_asm.Store(Slot(i.A()), Asm::RAX);
+                return 1;
+            case OpCode::EQ:
+            case OpCode::NE:
+            case OpCode::LT:
+            case OpCode::LE:
+            case OpCode::GT:
+            case OpCode::GE:
+                return EmitCompare(index, i);
+            case OpCode::CONVERT:
+                EmitConvert(index, i);
+                return 1;
+            case OpCode::JMP:
+                // Back edges are safe points, the same as in the interpreter.
+                if (i.SBx() < 0)
+                {
+                    Asm::Label slow = m_asm.NewLabel();
+                    m_asm.Dec(Asm::R15);
+                    m_asm.Jcc(Asm::Sign, slow);
+                    m_asm.MovImm(Asm::RAX, (std::uintptr_t) m_vm.m_heap.AllocatedBytesCounter());
+                    m_asm.Load(Asm::RAX, Asm::Mem{ Asm::RAX, 0 });
+                    m_asm.MovImm(Asm::RCX, (std::uintptr_t) m_vm.m_heap.NextStepCounter());
+                    m_asm.Load(Asm::RCX, Asm::Mem{ Asm::RCX, 0 });
+                    m_asm.Cmp(Asm::RAX, Asm::RCX);
+                    m_asm.Jcc(Asm::Below, Target(index, i));
+                    m_asm.Bind(slow);
+                    CallRuntime(&Helpers::Safepoint, index);
+                }
+                m_asm.Jmp(Target(index, i));
+                return 1;
+            case OpCode::JMPIF:
+            case OpCode::JMPIFNOT:
+                EmitTruthy(index, i.A());
+                m_asm.Test32(Asm::RAX, Asm::RAX);
+                m_asm.Jcc(i.Op() == OpCode::JMPIF ? Asm::NotEqual : Asm::Equal, Target(index, i));
+                return 1;
+            case OpCode::RETURN:
+                if (i.B() != 0)
+                    m_asm.Load(Asm::RAX, Slot(i.A()));
+                else
+                    m_asm.Mov(Asm::RAX, Asm::R13);
+                m_asm.Store(Asm::Mem{ Asm::R12, -(int) sizeof(Value) }, Asm::RAX);
+                m_asm.MovImm(Asm::RAX, 0);
+                m_asm.Jmp(m_exit);
+                return 1;
+            case OpCode::GETUPVAL:  CallRuntime(&Helpers::GetUpval, index); return 1;
+            case OpCode::SETUPVAL:  CallRuntime(&Helpers::SetUpval, index); return 1;
+            case OpCode::GETFIELD:  CallRuntime(&Helpers::GetField, index); return 2;
+            case OpCode::SETFIELD:  CallRuntime(&Helpers::SetField, index); return 2;
+            case OpCode::GETINDEX:
+            case OpCode::GETINBOUNDS:
+                EmitGetIndex(index, i);
+                return 1;
+            case OpCode::SETINDEX:
+            case OpCode::SETINBOUNDS:
+                EmitSetIndex(index, i);
+                return 1;
+            case OpCode::NEWARRAY:  CallRuntime(&Helpers::NewArray, index); return 1;
+            case OpCode::APPEND:    CallRuntime(&Helpers::Append, index); return 1;
+            case OpCode::NEWOBJECT: CallRuntime(&Helpers::NewObject, index); return 1;
+            case OpCode::CLOSURE:   CallRuntime(&Helpers::Closure, index); return 1;
+            case OpCode::CALL:      CallRuntime(&Helpers::Call, index); return 1;
+            case OpCode::CLOSE:     CallRuntime(&Helpers::Close, index); return 1;
+            default:
+                if (Specialization::Is(i.Op()))
+                    return EmitTyped(index, i);
+                // JMPTABLE, TAILCALL and anything else without a template: the interpreter takes over from
+                // here and comes back at the next loop back edge or call.
+                m_asm.MovImm(Asm::RAX, (std::uintptr_t) At(index));
+                m_asm.Jmp(m_exit);
+                return 1;
+            }
+        }
+
+        void CallRuntime(Helpers::Function function, std::size_t index)
+        {
+            m_asm.Mov(Asm::RDI, Asm::RBX);
+            m_asm.Mov(Asm::RSI, Asm::R12);
+            m_asm.MovImm(Asm::RDX, (std::uintptr_t) At(index));
+            m_asm.MovImm(Asm::RAX, (std::uintptr_t) function);
+            StoreFuel();
+            m_asm.CallReg(Asm::RAX);
+            LoadFuel();
+            m_asm.TestByte(Asm::RAX, Asm::RAX);
+            m_asm.Jcc(Asm::Equal, m_error);
+        }
+
+        // R15 holds the VM's fuel while the code runs, and m_fuel while the runtime does.
+        void LoadFuel()
+        {
+            m_asm.MovImm(Asm::RCX, (std::uintptr_t) &m_vm.m_fuel);
+            m_asm.Load(Asm::R15, Asm::Mem{ Asm::RCX, 0 });
+        }
+
+        void StoreFuel()
+        {
+            m_asm.MovImm(Asm::RCX, (std::uintptr_t) &m_vm.m_fuel);
+            m_asm.Store(Asm::Mem{ Asm::RCX, 0 }, Asm::R15);
+        }
+
+        void CheckInt(Asm::Reg value, Asm::Label fail)
+        {
+            m_asm.Mov(Asm::R8, value);
+            m_asm.Shr(Asm::R8, 48);
+            m_asm.Cmp32Imm(Asm::R8, (std::int32_t) (Value::TagInt >> 48));
+            m_asm.Jcc(Asm::NotEqual, fail);
+        }
+
+        void CheckDouble(Asm::Reg value, Asm::Label fail)
+        {
+            m_asm.Cmp(value, Asm::R13);
+            m_asm.Jcc(Asm::AboveEqual, fail);
+        }
+
+        // The result of a 32 bit operation, so the upper half is already clear.
+        void StoreInt(Asm::Reg value, std::uint8_t reg)
+        {
+            m_asm.Or(value, Asm::R14);
+            m_asm.Store(Slot(reg), value);
+        }
+
+        // Same as Value::Double: NaNs the hardware produces have the sign bit set and would read as a tag.
+        void StoreDoubleBits(std::uint8_t reg)
+        {
+            Asm::Label ok = m_asm.NewLabel();
+            m_asm.MovImm(Asm::RDX, Value::BoxedSpace);
+            m_asm.Cmp(Asm::RAX, Asm::RDX);
+            m_asm.Jcc(Asm::Below, ok);
+            m_asm.MovImm(Asm::RAX, Value::CanonicalNaN);
+            m_asm.Bind(ok);
+            m_asm.Store(Slot(reg), Asm::RAX);
+        }
+
+        void StoreDouble(Asm::Xmm value, std::uint8_t reg)
+        {
+            m_asm.MovqFromXmm(Asm::RAX, value);
+            StoreDoubleBits(reg);
+        }
+
+        void LoadNumber(Asm::Xmm dst, std::uint8_t reg, RegType type)
+        {
+            if (type == RegType::Int)
+                m_asm.IntToDouble(dst, Slot(reg));
+            else
+                m_asm.LoadDouble(dst, Slot(reg));
+        }
+
+        void DoubleArith(OpCode op)
+        {
+            switch (op)
+            {
+            case OpCode::ADD: m_asm.AddDouble(Asm::XMM0, Asm::XMM1); break;
+            case OpCode::SUB: m_asm.SubDouble(Asm::XMM0, Asm::XMM1); break;
+            case OpCode::MUL: m_asm.MulDouble(Asm::XMM0, Asm::XMM1); break;
+            default:          m_asm.DivDouble(Asm::XMM0, Asm::XMM1); break;
+            }
+        }
+
+        std::size_t EmitTyped(std::size_t index, const Instruction i)
+        {
+            RegType known = OperandType(i.Op());
+            OpCode generic = Specialization::Generic(i.Op());
+            bool arith = Specialization::IsArith(i.Op());
+            if (known != RegType::Unvisited && arith)
+            {
+                EmitArith(index, i.WithOp(generic), known);
+                return 1;
+            }
+            if (known != RegType::Unvisited)
+                return EmitCompare(index, i.WithOp(generic), known);
+
+            CallRuntime(arith ? &Helpers::Arith : generic == OpCode::EQ || generic == OpCode::NE ? &Helpers::Equal : &Helpers::Compare, index);
+            return 1;
+        }
+
+        // `known` is the type of both operands when the instruction is typed.
+        void EmitArith(std::size_t index, const Instruction i, RegType known = RegType::Unvisited)
+        {
+            OpCode op = i.Op();
+            RegType b = Type(index, i.B()), c = Type(index, i.C());
+            if (known != RegType::Unvisited)
+                b = c = known;
+            Asm::Label slow = m_asm.NewLabel(), done = m_asm.NewLabel();
+
+            // Known numbers with at least one double are computed as doubles, the same as Arith does.
+            if (IsNumeric(b) && IsNumeric(c) && (b == RegType::Double || c == RegType::Double) && op != OpCode::MOD)
+            {
+                LoadNumber(Asm::XMM0, i.B(), b);
+                LoadNumber(Asm::XMM1, i.C(), c);
+                DoubleArith(op);
+                StoreDouble(Asm::XMM0, i.A());
+                return;
+            }
+
+            m_asm.Load(Asm::RAX, Slot(i.B()));
+            m_asm.Load(Asm::RCX, Slot(i.C()));
+            if (Maybe(b, RegType::Int) && Maybe(c, RegType::Int))
+            {
+                Asm::Label notInt = m_asm.NewLabel();
+                if (b != RegType::Int)
+                    CheckInt(Asm::RAX, notInt);
+                if (c != RegType::Int)
+                    CheckInt(Asm::RCX, notInt);
+
+                Asm::Reg result = Asm::RAX;
+                switch (op)
+                {
+                case OpCode::ADD: m_asm.Add32(Asm::RAX, Asm::RCX); break;
+                case OpCode::SUB: m_asm.Sub32(Asm::RAX, Asm::RCX); break;
+                case OpCode::MUL: m_asm.Imul32(Asm::RAX, Asm::RCX); break;
+                default:
+                    // Division by zero throws and INT_MIN / -1 traps, Arith deals with both.
+                    m_asm.Test32(Asm::RCX, Asm::RCX);
+                    m_asm.Jcc(Asm::Equal, slow);
+                    m_asm.Cmp32Imm(Asm::RCX, -1);
+                    m_asm.Jcc(Asm::Equal, slow);
+                    m_asm.Cdq();
+                    m_asm.Idiv32(Asm::RCX);
+                    if (op == OpCode::MOD)
+                        result = Asm::RDX;
+                    break;
+                }
+                StoreInt(result, i.A());
+                m_asm.Jmp(done);
+                m_asm.Bind(notInt);
+            }
+
+            if (op != OpCode::MOD && Maybe(b, RegType::Double) && Maybe(c, RegType::Double))
+            {
+                if (b != RegType::Double)
+                    CheckDouble(Asm::RAX, slow);
+                if (c != RegType::Double)
+                    CheckDouble(Asm::RCX, slow);
+                m_asm.MovqToXmm(Asm::XMM0, Asm::RAX);
+                m_asm.MovqToXmm(Asm::XMM1, Asm::RCX);
+                DoubleArith(op);
+                StoreDouble(Asm::XMM0, i.A());
+                m_asm.Jmp(done);
+            }
+
+            m_asm.Bind(slow);
+            CallRuntime(&Helpers::Arith, index);
+            m_asm.Bind(done);
+        }
+
+        void EmitNeg(std::size_t index, const Instruction i)
+        {
+            RegType b = Type(index, i.B());
+            Asm::Label slow = m_asm.NewLabel(), done = m_asm.NewLabel();
+
+            m_asm.Load(Asm::RAX, Slot(i.B()));
+            if (Maybe(b, RegType::Int))
+            {
+                Asm::Label notInt = m_asm.NewLabel();
+                if (b != RegType::Int)
+                    CheckInt(Asm::RAX, notInt);
+                m_asm.Neg32(Asm::RAX);
+                StoreInt(Asm::RAX, i.A());
+                m_asm.Jmp(done);
+                m_asm.Bind(notInt);
+            }
+
+            if (Maybe(b, RegType::Double))
+            {
+                if (b != RegType::Double)
+                    CheckDouble(Asm::RAX, slow);
+                m_asm.Btc(Asm::RAX, 63);
+                StoreDoubleBits(i.A());
+                m_asm.Jmp(done);
+            }
+
+            m_asm.Bind(slow);
+            CallRuntime(&Helpers::Neg, index);
+            m_asm.Bind(done);
+        }
+
+        // Leaves the element address of typed array `object` at `reg` in RDX and its element type in R9, or
+        // goes to `slow` for anything else. Checks bounds unless the compiler proved them.
+        void EmitElement(std::size_t index, std::uint8_t object, std::uint8_t reg, bool inBounds, bool write, Asm::Label slow)
+        {
+            m_asm.Load(Asm::RAX, Slot(object));
+            m_asm.Load(Asm::RCX, Slot(reg));
+            if (!inBounds && Type(index, reg) != RegType::Int)
+                CheckInt(Asm::RCX, slow);
+            m_asm.Mov(Asm::RDX, Asm::RAX);
+            m_asm.Shr(Asm::RDX, 48);
+            m_asm.Cmp32Imm(Asm::RDX, (std::int32_t) (Value::TagObject >> 48));
+            m_asm.Jcc(Asm::NotEqual, slow);
+            m_asm.Shl(Asm::RAX, 16);
+            m_asm.Shr(Asm::RAX, 16);
+            m_asm.LoadByte(Asm::RDX, Asm::Mem{ Asm::RAX, KindOffset });
+            m_asm.Cmp32Imm(Asm::RDX, (std::int32_t) ObjectKind::TypedArray);
+            m_asm.Jcc(Asm::NotEqual, slow);
+            if (write)
+            {
+                m_asm.LoadByte(Asm::RDX, Asm::Mem{ Asm::RAX, ReadOnlyOffset });
+                m_asm.Test32(Asm::RDX, Asm::RDX);
+                m_asm.Jcc(Asm::NotEqual, slow);
+            }
+            m_asm.Mov32(Asm::RCX, Asm::RCX);
+            if (!inBounds)
+            {
+                m_asm.Load(Asm::RDX, Asm::Mem{ Asm::RAX, LengthOffset });
+                m_asm.Cmp(Asm::RCX, Asm::RDX);
+                m_asm.Jcc(Asm::AboveEqual, slow);
+            }
+            m_asm.LoadByte(Asm::R9, Asm::Mem{ Asm::RAX, TypeOffset });
+            m_asm.Load(Asm::RDX, Asm::Mem{ Asm::RAX, DataOffset });
+        }
+
+        // RDX += RCX << shift, when R9 holds `type`. Otherwise goes to `next`.
+        void EmitElementCase(ElementType type, std::uint8_t shift, Asm::Label next)
+        {
+            m_asm.Cmp32Imm(Asm::R9, (std::int32_t) type);
+            m_asm.Jcc(Asm::NotEqual, next);
+            m_asm.Shl(Asm::RCX, shift);
+            m_asm.Add(Asm::RDX, Asm::RCX);
+        }
+
+        // Int, float and double elements load straight from the array's memory, wherever it lives.
+        void EmitGetIndex(std::size_t index, const Instruction i)
+        {
+            bool inBounds = i.Op() == OpCode::GETINBOUNDS;
+            Asm::Label slow = m_asm.NewLabel(), done = m_asm.NewLabel(), notInt = m_asm.NewLabel(), notFloat = m_asm.NewLabel();
+            EmitElement(index, i.B(), i.C(), inBounds, false, slow);
+
+            EmitElementCase(ElementType::Int, 2, notInt);
+            m_asm.Load32(Asm::RAX, Asm::Mem{ Asm::RDX, 0 });
+            StoreInt(Asm::RAX, i.A());
+            m_asm.Jmp(done);
+
+            m_asm.Bind(notInt);
+            EmitElementCase(ElementType::Float, 2, notFloat);
+            m_asm.Load32(Asm::RAX, Asm::Mem{ Asm::RDX, 0 });
+            m_asm.MovImm(Asm::RCX, Value::TagFloat);
+            m_asm.Or(Asm::RAX, Asm::RCX);
+            m_asm.Store(Slot(i.A()), Asm::RAX);
+            m_asm.Jmp(done);
+
+            m_asm.Bind(notFloat);
+            EmitElementCase(ElementType::Double, 3, slow);
+            m_asm.Load(Asm::RAX, Asm::Mem{ Asm::RDX, 0 });
+            StoreDoubleBits(i.A());
+            m_asm.Jmp(done);
+
+            m_asm.Bind(slow);
+            CallRuntime(inBounds ? &Helpers::GetInBounds : &Helpers::GetIndex, index);
+            m_asm.Bind(done);
+        }
+
+        // Stores values that already have the element type; conversions and read-only arrays take the helper.
+        void EmitSetIndex(std::size_t index, const Instruction i)
+        {
+            bool inBounds = i.Op() == OpCode::SETINBOUNDS;
+            Asm::Label slow = m_asm.NewLabel(), done = m_asm.NewLabel(), notInt = m_asm.NewLabel(), notFloat = m_asm.NewLabel();
+            EmitElement(index, i.A(), i.B(), inBounds, true, slow);
+            m_asm.Load(Asm::R10, Slot(i.C()));
+            m_asm.Mov(Asm::R11, Asm::R10);
+            m_asm.Shr(Asm::R11, 48);
+
+            m_asm.Cmp32Imm(Asm::R9, (std::int32_t) ElementType::Int);
+            m_asm.Jcc(Asm::NotEqual, notInt);
+            m_asm.Cmp32Imm(Asm::R11, (std::int32_t) (Value::TagInt >> 48));
+            m_asm.Jcc(Asm::NotEqual, slow);
+            EmitElementCase(ElementType::Int, 2, slow);
+            m_asm.Store32(Asm::Mem{ Asm::RDX, 0 }, Asm::R10);
+            m_asm.Jmp(done);
+
+            m_asm.Bind(notInt);
+            m_asm.Cmp32Imm(Asm::R9, (std::int32_t) ElementType::Float);
+            m_asm.Jcc(Asm::NotEqual, notFloat);
+            m_asm.Cmp32Imm(Asm::R11, (std::int32_t) (Value::TagFloat >> 48));
+            m_asm.Jcc(Asm::NotEqual, slow);
+            EmitElementCase(ElementType::Float, 2, slow);
+            m_asm.Store32(Asm::Mem{ Asm::RDX, 0 }, Asm::R10);
+            m_asm.Jmp(done);
+
+            m_asm.Bind(notFloat);
+            CheckDouble(Asm::R10, slow);
+            EmitElementCase(ElementType::Double, 3, slow);
+            m_asm.Store(Asm::Mem{ Asm::RDX, 0 }, Asm::R10);
+            m_asm.Jmp(done);
+
+            m_asm.Bind(slow);
+            CallRuntime(inBounds ? &Helpers::SetInBounds : &Helpers::SetIndex, index);
+            m_asm.Bind(done);
+        }
+
+        // Leaves 0 or 1 in RAX.
+        void EmitTruthy(std::size_t index, std::uint8_t reg)
+        {
+            switch (Type(index, reg))
+            {
+            case RegType::Bool:
+                m_asm.Load32(Asm::RAX, Slot(reg));
+                m_asm.AndImm8(Asm::RAX, 1);
+                return;
+            case RegType::Int:
+                m_asm.Load32(Asm::RAX, Slot(reg));
+                m_asm.Test32(Asm::RAX, Asm::RAX);
+                m_asm.SetCC(Asm::NotEqual, Asm::RAX);
+                m_asm.MovzxByte(Asm::RAX, Asm::RAX);
+                return;
+            default:
+                break;
+            }
+
+            Asm::Label notFalse = m_asm.NewLabel(), notTrue = m_asm.NewLabel(), done = m_asm.NewLabel();
+            m_asm.Load(Asm::RAX, Slot(reg));
+            m_asm.MovImm(Asm::RCX, Value::Bool(false).Bits());
+            m_asm.Cmp(Asm::RAX, Asm::RCX);
+            m_asm.Jcc(Asm::NotEqual, notFalse);
+            m_asm.MovImm(Asm::RAX, 0);
+            m_asm.Jmp(done);
+            m_asm.Bind(notFalse);
+            m_asm.MovImm(Asm::RCX, Value::Bool(true).Bits());
+            m_asm.Cmp(Asm::RAX, Asm::RCX);
+            m_asm.Jcc(Asm::NotEqual, notTrue);
+            m_asm.MovImm(Asm::RAX, 1);
+            m_asm.Jmp(done);
+            m_asm.Bind(notTrue);
+            m_asm.Mov(Asm::RDI, Asm::RAX);
+            m_asm.MovImm(Asm::RAX, (std::uintptr_t) &Helpers::Truthy);
+            m_asm.CallReg(Asm::RAX);
+            m_asm.MovzxByte(Asm::RAX, Asm::RAX);
+            m_asm.Bind(done);
+        }
+
+        // XMM0 against XMM1 into DL. Every comparison with a NaN is false, except !=.
+        void DoubleCompare(OpCode op)
+        {
+            switch (op)
+            {
+            case OpCode::EQ:
+                m_asm.Ucomisd(Asm::XMM0, Asm::XMM1);
+                m_asm.SetCC(Asm::Equal, Asm::RDX);
+                m_asm.SetCC(Asm::NoParity, Asm::RCX);
+                m_asm.And32(Asm::RDX, Asm::RCX);
+                break;
+            case OpCode::NE:
+                m_asm.Ucomisd(Asm::XMM0, Asm::XMM1);
+                m_asm.SetCC(Asm::NotEqual, Asm::RDX);
+                m_asm.SetCC(Asm::Parity, Asm::RCX);
+                m_asm.Or(Asm::RDX, Asm::RCX);
+                break;
+            case OpCode::LT:
+                m_asm.Ucomisd(Asm::XMM1, Asm::XMM0);
+                m_asm.SetCC(Asm::Above, Asm::RDX);
+                break;
+            case OpCode::LE:
+                m_asm.Ucomisd(Asm::XMM1, Asm::XMM0);
+                m_asm.SetCC(Asm::AboveEqual, Asm::RDX);
+                break;
+            case OpCode::GT:
+                m_asm.Ucomisd(Asm::XMM0, Asm::XMM1);
+                m_asm.SetCC(Asm::Above, Asm::RDX);
+                break;
+            default:
+                m_asm.Ucomisd(Asm::XMM0, Asm::XMM1);
+                m_asm.SetCC(Asm::AboveEqual, Asm::RDX);
+                break;
+            }
+        }
+
+        static Asm::Cond IntCondition(OpCode op)
+        {
+            switch (op)
+            {
+            case OpCode::EQ: return Asm::Equal;
+            case OpCode::NE: return Asm::NotEqual;
+            case OpCode::LT: return Asm::Less;
+            case OpCode::LE: return Asm::LessEqual;
+            case OpCode::GT: return Asm::Greater;
+            default:         return Asm::GreaterEqual;
+            }
+        }
+
+        // A comparison directly followed by a branch on its result branches on the flags as well. The
+        // result is still stored, the interpreter may read it after an exit.
+        std::size_t EmitCompare(std::size_t index, const Instruction i, RegType known = RegType::Unvisited)
+        {
+            OpCode op = i.Op();
+            RegType b = Type(index, i.B()), c = Type(index, i.C());
+            if (known != RegType::Unvisited)
+                b = c = known;
+            Asm::Label slow = m_asm.NewLabel(), haveBool = m_asm.NewLabel(), stored = m_asm.NewLabel();
+
+            std::size_t next = index + 1;
+            bool fused = next < m_proto.code.size() && !m_targets[next] && m_proto.code[next].A() == i.A()
+                && (m_proto.code[next].Op() == OpCode::JMPIF || m_proto.code[next].Op() == OpCode::JMPIFNOT);
+
+            if (IsNumeric(b) && IsNumeric(c) && (b == RegType::Double || c == RegType::Double))
+            {
+                LoadNumber(Asm::XMM0, i.B(), b);
+                LoadNumber(Asm::XMM1, i.C(), c);
+                DoubleCompare(op);
+                m_asm.Jmp(haveBool);
+            }
+            else
+            {
+                m_asm.Load(Asm::RAX, Slot(i.B()));
+                m_asm.Load(Asm::RCX, Slot(i.C()));
+                if (Maybe(b, RegType::Int) && Maybe(c, RegType::Int))
+                {
+                    Asm::Label notInt = m_asm.NewLabel();
+                    if (b != RegType::Int)
+                        CheckInt(Asm::RAX, notInt);
+                    if (c != RegType::Int)
+                        CheckInt(Asm::RCX, notInt);
+                    m_asm.Cmp32(Asm::RAX, Asm::RCX);
+                    m_asm.SetCC(IntCondition(op), Asm::RDX);
+                    m_asm.Jmp(haveBool);
+                    m_asm.Bind(notInt);
+                }
+
+                if (Maybe(b, RegType::Double) && Maybe(c, RegType::Double))
+                {
+                    if (b != RegType::Double)
+                        CheckDouble(Asm::RAX, slow);
+                    if (c != RegType::Double)
+                        CheckDouble(Asm::RCX, slow);
+                    m_asm.MovqToXmm(Asm::XMM0, Asm::RAX);
+                    m_asm.MovqToXmm(Asm::XMM1, Asm::RCX);
+                    DoubleCompare(op);
+                    m_asm.Jmp(haveBool);
+                }
+
+                m_asm.Bind(slow);
+                CallRuntime(op == OpCode::EQ || op == OpCode::NE ? &Helpers::Equal : &Helpers::Compare, index);
+                if (fused)
+                {
+                    m_asm.Load32(Asm::RDX, Slot(i.A()));
+                    m_asm.AndImm8(Asm::RDX, 1);
+                }
+                m_asm.Jmp(stored);
+            }
+
+            m_asm.Bind(haveBool);
+            m_asm.MovzxByte(Asm::RDX, Asm::RDX);
+            m_asm.MovImm(Asm::RCX, Value::TagBool);
+            m_asm.Or(Asm::RCX, Asm::RDX);
+            m_asm.Store(Slot(i.A()), Asm::RCX);
+            m_asm.Bind(stored);
+
+            if (!fused)
+                return 1;
+
+            const Instruction branch = m_proto.code[next];
+            m_asm.Test32(Asm::RDX, Asm::RDX);
+            m_asm.Jcc(branch.Op() == OpCode::JMPIF ? Asm::NotEqual : Asm::Equal, Target(next, branch));
+            return 2;
+        }
+
+        void EmitConvert(std::size_t index, const Instruction i)
+        {
+            Types::Uid uid = (Types::Uid) i.C();
+            RegType b = Type(index, i.B());
+            if (uid != Types::Uid::Int && uid != Types::Uid::Double)
+            {
+                CallRuntime(&Helpers::Convert, index);
+                return;
+            }
+
+            bool toInt = uid == Types::Uid::Int;
+            if (b == (toInt ? RegType::Int : RegType::Double))
+            {
+                if (i.A() != i.B())
+                {
+                    m_asm.Load(Asm::RAX, Slot(i.B()));
+                    m_asm.Store(Slot(i.A()), Asm::RAX);
+                }
+                return;
+            }
+
+            Asm::Label slow = m_asm.NewLabel(), done = m_asm.NewLabel();
+            if (Maybe(b, RegType::Int))
+            {
+                Asm::Label notInt = m_asm.NewLabel();
+                m_asm.Load(Asm::RAX, Slot(i.B()));
+                if (b != RegType::Int)
+                    CheckInt(Asm::RAX, notInt);
+                if (!toInt)
+                {
+                    m_asm.IntToDouble(Asm::XMM0, Slot(i.B()));
+                    m_asm.MovqFromXmm(Asm::RAX, Asm::XMM0);
+                }
+                m_asm.Store(Slot(i.A()), Asm::RAX);
+                m_asm.Jmp(done);
+                m_asm.Bind(notInt);
+            }
+
+            if (Maybe(b, RegType::Double))
+            {
+                m_asm.Load(Asm::RAX, Slot(i.B()));
+                if (b != RegType::Double)
+                    CheckDouble(Asm::RAX, slow);
+                if (toInt)
+                {
+                    m_asm.MovqToXmm(Asm::XMM0, Asm::RAX);
+                    m_asm.DoubleToInt(Asm::RAX, Asm::XMM0);
+                    StoreInt(Asm::RAX, i.A());
+                }
+                else
+                {
+                    m_asm.Store(Slot(i.A()), Asm::RAX);
+                }
+                m_asm.Jmp(done);
+            }
+
+            m_asm.Bind(slow);
+            CallRuntime(&Helpers::Convert, index);
+            m_asm.Bind(done);
+        }
+
+    private:
+        VM& m_vm;
+        const FunctionProto& m_proto;
+        TypeInference m_types;
+        // Instructions something jumps to. Those always have code of their own.
+        std::vector<bool> m_targets;
+
+        Asm m_asm;
+        std::vector<Asm::Label> m_labels;
+        Asm::Label m_exit{};
+        Asm::Label m_error{};
+    };
+
+    Jit::Jit(VM& vm) : m_vm(vm), m_functions(vm.GetModule().functions.size())
+    {
+    }
+
+    Jit::~Jit()
+    {
+#ifdef JSCR_JIT_X64
+        for (const Function& function : m_functions)
+        {
+            if (function.code != nullptr)
+                munmap(function.code, function.size);
+        }
+#endif
+    }
+
+    std::size_t Jit::CompiledFunctions() const
+    {
+        std::size_t count = 0;
+        for (const Function& function : m_functions)
+            count += function.code != nullptr ? 1 : 0;
+        return count;
+    }
+
+    bool Jit::Run(const FunctionProto& proto, Function& function, const Instruction* pc)
+    {
+        if (function.code == nullptr && !Compile(proto, function))
+        {
+            function.failed = true;
+            return false;
+        }
+
+        std::uint32_t offset = function.offsets[pc - proto.code.data()];
+        if (offset == NoEntry || m_nesting >= MaxNesting)
+            return false;
+
+        auto& frames = m_vm.m_frames;
+        std::size_t depth = frames.size();
+        Value* base = frames.back().base;
+        const void* target = static_cast<const std::uint8_t*>(function.code) + offset;
+
+        m_nesting++;
+        const Instruction* resume = reinterpret_cast<Entry>(function.code)(&m_vm, base, target);
+        m_nesting--;
+
+        if (m_error != nullptr)
+            std::rethrow_exception(std::exchange(m_error, nullptr));
+
+        // The run gives the thread back; the frame goes on in the interpreter, after frames it called
+        // that are still running.
+        if (m_preempted != nullptr)
+        {
+            frames[depth - 1].pc = std::exchange(m_preempted, nullptr);
+            return true;
+        }
+
+        if (resume != nullptr)
+        {
+            frames.back().pc = resume;
+            return true;
+        }
+
+        if (frames.back().returnConversions[0] != Conversion::None)
+            base[-1] = m_vm.ConvertReturn(base[-1], frames.back().returnConversions);
+        m_vm.CloseUpvalues(base);
+        frames.pop_back();
+        return true;
+    }
+
+    bool Jit::Compile(const FunctionProto& proto, Function& function)
+    {
+#ifdef JSCR_JIT_X64
+        CodeGen codegen(m_vm, proto);
+        if (!codegen.Generate(function.offsets))
+            return false;
+
+        const auto& code = codegen.Code();
+        std::size_t page = (std::size_t) sysconf(_SC_PAGESIZE);
+        std::size_t size = (code.size() + page - 1) / page * page;
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            return false;
+
+        // Written once, so the pages never have to be writable and executable at the same time.
+        std::memcpy(memory, code.data(), code.size());
+        if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+        {
+            munmap(memory, size);
+            return false;
+        }
+
+        function.code = memory;
+        function.size = size;
+        return true;
+#else
+        (void) proto;
+        (void) function;
+        return false;
+#endif
+    }
+}
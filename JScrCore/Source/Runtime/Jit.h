@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <vector>
+#include "Bytecode.h"
+#include "Value.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JSCR_JIT_X64
+#endif
+
+namespace JScr::Runtime
+{
+    class VM;
+
+    // Baseline compiler from bytecode to x86-64 machine code for the functions of one VM that get hot.
+    // Every instruction becomes a fixed template working on the VM's registers in memory, so compiled
+    // code and the interpreter can hand a frame back and forth at any instruction boundary.
+    //
+    // Integer and double arithmetic, comparisons and branches run inline, specialised without tag
+    // checks where the declared types of the registers involved are known; everything else, and every
+    // dynamic value the inline paths do not cover, goes through the same runtime code the interpreter uses.
+    class Jit
+    {
+    public:
+        // Entries plus loop back edges before a function is compiled.
+        static constexpr std::uint32_t DefaultThreshold = 1000;
+        // Compiled frames call each other on the native stack, so deeper call chains stay in the interpreter.
+        static constexpr std::size_t MaxNesting = 512;
+
+        static constexpr bool IsSupported()
+        {
+#ifdef JSCR_JIT_X64
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        explicit Jit(VM& vm);
+        Jit(const Jit&) = delete;
+        Jit& operator=(const Jit&) = delete;
+        ~Jit();
+
+        void SetThreshold(std::uint32_t threshold) { m_threshold = threshold; }
+        std::uint32_t Threshold() const { return m_threshold; }
+
+        // Counts an entry into the VM's top frame, or a back edge to `pc` in it, and compiles its function
+        // once it is hot. Returns true if the frame ran as compiled code; it has then either returned, or
+        // its pc is where the interpreter has to continue.
+        bool Enter(const FunctionProto& proto, const Instruction* pc)
+        {
+            Function& function = m_functions[proto.index];
+            if (function.code == nullptr && (function.failed || ++function.hotness < m_threshold))
+                return false;
+            return Run(proto, function, pc);
+        }
+
+        std::size_t CompiledFunctions() const;
+
+    private:
+        struct Helpers;
+        class CodeGen;
+
+        // Takes the VM, the frame's registers and the code address to start at. Returns null when the
+        // frame returned, or the instruction the interpreter has to continue at.
+        using Entry = const Instruction* (*)(VM* vm, Value* base, const void* target);
+
+        static constexpr std::uint32_t NoEntry = 0xFFFFFFFF;
+
+        struct Function
+        {
+            std::uint32_t hotness = 0;
+            bool failed = false;
+            void* code = nullptr;
+            std::size_t size = 0;
+            // Code offset of every instruction, NoEntry for those folded into the one before.
+            std::vector<std::uint32_t> offsets;
+        };
+
+        bool Run(const FunctionProto& proto, Function& function, const Instruction* pc);
+        bool Compile(const FunctionProto& proto, Function& function);
+
+    private:
+        VM& m_vm;
+        std::vector<Function> m_functions;
+        std::uint32_t m_threshold = DefaultThreshold;
+        std::size_t m_nesting = 0;
+        // Generated code has no unwind information, so exceptions stop at the runtime call that threw and
+        // are rethrown once the code has returned.
+        std::exception_ptr m_error;
+        // Where the interpreter continues when a runtime call made the run give the thread back.
+        const Instruction* m_preempted = nullptr;
+    };
+}
@@ -0,0 +1,201 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "Kernels.h"
+
+// Kernel bodies written once against a "lanes" type that describes one SIMD register: its element
+// type T, vector type V, Width and the load/store/arithmetic primitives. Kernels.cpp instantiates
+// them for scalar and SSE2 lanes, KernelsAvx2.cpp (built with AVX2 enabled) for AVX2 lanes.
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JSCR_KERNELS_X86 1
+#else
+#define JSCR_KERNELS_X86 0
+#endif
+
+namespace JScr::Runtime
+{
+#if JSCR_KERNELS_X86
+    // Defined in KernelsAvx2.cpp; only call them after Kernels::HasAvx2().
+    namespace Avx2
+    {
+        void Fill(std::int32_t* dst, std::size_t count, std::int32_t value);
+        void Fill(float* dst, std::size_t count, float value);
+        void Fill(double* dst, std::size_t count, double value);
+        std::int32_t Sum(const std::int32_t* src, std::size_t count);
+        float Sum(const float* src, std::size_t count);
+        double Sum(const double* src, std::size_t count);
+        std::int32_t Min(const std::int32_t* src, std::size_t count);
+        float Min(const float* src, std::size_t count);
+        double Min(const double* src, std::size_t count);
+        std::int32_t Max(const std::int32_t* src, std::size_t count);
+        float Max(const float* src, std::size_t count);
+        double Max(const double* src, std::size_t count);
+        std::int32_t Dot(const std::int32_t* a, const std::int32_t* b, std::size_t count);
+        float Dot(const float* a, const float* b, std::size_t count);
+        double Dot(const double* a, const double* b, std::size_t count);
+        void Apply(Kernels::Op op, std::int32_t* dst, const std::int32_t* a, const std::int32_t* b, std::size_t count);
+        void Apply(Kernels::Op op, float* dst, const float* a, const float* b, std::size_t count);
+        void Apply(Kernels::Op op, double* dst, const double* a, const double* b, std::size_t count);
+    }
+#endif
+
+    // Internal linkage on purpose: both translation units compile these with different target flags,
+    // and the linker must never pick the AVX2 copy for the other one.
+    namespace
+    {
+        template <typename Element>
+        struct ScalarLanes
+        {
+            using T = Element;
+            using V = Element;
+            static constexpr std::size_t Width = 1;
+
+            static V Load(const T* src) { return *src; }
+            static void Store(T* dst, V v) { *dst = v; }
+            static V Broadcast(T value) { return value; }
+            static V Zero() { return T(0); }
+
+            static V Add(V a, V b) { if constexpr (std::is_same_v<T, std::int32_t>) return (T) ((std::uint32_t) a + (std::uint32_t) b); else return (T) (a + b); }
+            static V Sub(V a, V b) { if constexpr (std::is_same_v<T, std::int32_t>) return (T) ((std::uint32_t) a - (std::uint32_t) b); else return (T) (a - b); }
+            static V Mul(V a, V b) { if constexpr (std::is_same_v<T, std::int32_t>) return (T) ((std::uint32_t) a * (std::uint32_t) b); else return (T) (a * b); }
+            static V Min(V a, V b) { return a < b ? a : b; }
+            static V Max(V a, V b) { return a > b ? a : b; }
+
+            static V Div(V a, V b)
+            {
+                if constexpr (std::is_same_v<T, std::int32_t>)
+                    return b == -1 ? (T) (0u - (std::uint32_t) a) : a / b;
+                else
+                    return (T) (a / b);
+            }
+        };
+
+        template <typename L>
+        typename L::T ReduceLanes(typename L::V v, typename L::T (*fold)(typename L::T, typename L::T))
+        {
+            alignas(32) typename L::T lanes[L::Width];
+            L::Store(lanes, v);
+            typename L::T result = lanes[0];
+            for (std::size_t i = 1; i < L::Width; i++)
+                result = fold(result, lanes[i]);
+            return result;
+        }
+
+        // Integer lanes have no division instruction, they divide one element at a time.
+        template <typename L>
+        typename L::V DivideEach(typename L::V a, typename L::V b)
+        {
+            alignas(32) typename L::T x[L::Width], y[L::Width];
+            L::Store(x, a);
+            L::Store(y, b);
+            for (std::size_t i = 0; i < L::Width; i++)
+                x[i] = ScalarLanes<typename L::T>::Div(x[i], y[i]);
+            return L::Load(x);
+        }
+
+        template <typename L>
+        void FillLanes(typename L::T* dst, std::size_t count, typename L::T value)
+        {
+            typename L::V v = L::Broadcast(value);
+            std::size_t i = 0;
+            for (; i + L::Width <= count; i += L::Width)
+                L::Store(dst + i, v);
+            for (; i < count; i++)
+                dst[i] = value;
+        }
+
+        // Four independent accumulators keep the adder pipeline busy.
+        template <typename L>
+        typename L::T SumLanes(const typename L::T* src, std::size_t count)
+        {
+            using S = ScalarLanes<typename L::T>;
+            typename L::V acc0 = L::Zero(), acc1 = L::Zero(), acc2 = L::Zero(), acc3 = L::Zero();
+            std::size_t i = 0;
+            for (; i + 4 * L::Width <= count; i += 4 * L::Width)
+            {
+                acc0 = L::Add(acc0, L::Load(src + i));
+                acc1 = L::Add(acc1, L::Load(src + i + L::Width));
+                acc2 = L::Add(acc2, L::Load(src + i + 2 * L::Width));
+                acc3 = L::Add(acc3, L::Load(src + i + 3 * L::Width));
+            }
+            for (; i + L::Width <= count; i += L::Width)
+                acc0 = L::Add(acc0, L::Load(src + i));
+
+            typename L::T sum = ReduceLanes<L>(L::Add(L::Add(acc0, acc1), L::Add(acc2, acc3)), &S::Add);
+            for (; i < count; i++)
+                sum = S::Add(sum, src[i]);
+            return sum;
+        }
+
+        template <typename L>
+        typename L::T DotLanes(const typename L::T* a, const typename L::T* b, std::size_t count)
+        {
+            using S = ScalarLanes<typename L::T>;
+            typename L::V acc0 = L::Zero(), acc1 = L::Zero();
+            std::size_t i = 0;
+            for (; i + 2 * L::Width <= count; i += 2 * L::Width)
+            {
+                acc0 = L::Add(acc0, L::Mul(L::Load(a + i), L::Load(b + i)));
+                acc1 = L::Add(acc1, L::Mul(L::Load(a + i + L::Width), L::Load(b + i + L::Width)));
+            }
+            for (; i + L::Width <= count; i += L::Width)
+                acc0 = L::Add(acc0, L::Mul(L::Load(a + i), L::Load(b + i)));
+
+            typename L::T sum = ReduceLanes<L>(L::Add(acc0, acc1), &S::Add);
+            for (; i < count; i++)
+                sum = S::Add(sum, S::Mul(a[i], b[i]));
+            return sum;
+        }
+
+        template <typename L, bool IsMax>
+        typename L::T ExtremeLanes(const typename L::T* src, std::size_t count)
+        {
+            using S = ScalarLanes<typename L::T>;
+            typename L::T best = src[0];
+            std::size_t i = 0;
+            if (count >= L::Width)
+            {
+                typename L::V acc = L::Load(src);
+                for (i = L::Width; i + L::Width <= count; i += L::Width)
+                    acc = IsMax ? L::Max(acc, L::Load(src + i)) : L::Min(acc, L::Load(src + i));
+                best = ReduceLanes<L>(acc, IsMax ? &S::Max : &S::Min);
+            }
+            for (; i < count; i++)
+                best = IsMax ? S::Max(best, src[i]) : S::Min(best, src[i]);
+            return best;
+        }
+
+        template <typename L, Kernels::Op Op>
+        void ZipLanes(typename L::T* dst, const typename L::T* a, const typename L::T* b, std::size_t count)
+        {
+            auto Combine = [](auto x, auto y, auto lanes)
+            {
+                using Lanes = decltype(lanes);
+                if constexpr (Op == Kernels::Op::Add) return Lanes::Add(x, y);
+                else if constexpr (Op == Kernels::Op::Sub) return Lanes::Sub(x, y);
+                else if constexpr (Op == Kernels::Op::Mul) return Lanes::Mul(x, y);
+                else return Lanes::Div(x, y);
+            };
+
+            std::size_t i = 0;
+            for (; i + L::Width <= count; i += L::Width)
+                L::Store(dst + i, Combine(L::Load(a + i), L::Load(b + i), L{}));
+            for (; i < count; i++)
+                dst[i] = Combine(a[i], b[i], ScalarLanes<typename L::T>{});
+        }
+
+        template <typename L>
+        void ApplyLanes(Kernels::Op op, typename L::T* dst, const typename L::T* a, const typename L::T* b, std::size_t count)
+        {
+            switch (op)
+            {
+            case Kernels::Op::Add: ZipLanes<L, Kernels::Op::Add>(dst, a, b, count); break;
+            case Kernels::Op::Sub: ZipLanes<L, Kernels::Op::Sub>(dst, a, b, count); break;
+            case Kernels::Op::Mul: ZipLanes<L, Kernels::Op::Mul>(dst, a, b, count); break;
+            case Kernels::Op::Div: ZipLanes<L, Kernels::Op::Div>(dst, a, b, count); break;
+            }
+        }
+    }
+}
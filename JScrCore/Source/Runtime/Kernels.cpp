@@ -0,0 +1,186 @@
+#include "Kernels.h"
+#include <cstring>
+#include "KernelLanes.h"
+
+#if JSCR_KERNELS_X86
+#include <emmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+namespace JScr::Runtime
+{
+#if JSCR_KERNELS_X86
+    namespace
+    {
+        // SSE2 is part of x86-64, so these need no runtime check.
+        struct Sse2Float
+        {
+            using T = float;
+            using V = __m128;
+            static constexpr std::size_t Width = 4;
+
+            static V Load(const T* src) { return _mm_loadu_ps(src); }
+            static void Store(T* dst, V v) { _mm_storeu_ps(dst, v); }
+            static V Broadcast(T value) { return _mm_set1_ps(value); }
+            static V Zero() { return _mm_setzero_ps(); }
+            static V Add(V a, V b) { return _mm_add_ps(a, b); }
+            static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+            static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+            static V Div(V a, V b) { return _mm_div_ps(a, b); }
+            static V Min(V a, V b) { return _mm_min_ps(a, b); }
+            static V Max(V a, V b) { return _mm_max_ps(a, b); }
+        };
+
+        struct Sse2Double
+        {
+            using T = double;
+            using V = __m128d;
+            static constexpr std::size_t Width = 2;
+
+            static V Load(const T* src) { return _mm_loadu_pd(src); }
+            static void Store(T* dst, V v) { _mm_storeu_pd(dst, v); }
+            static V Broadcast(T value) { return _mm_set1_pd(value); }
+            static V Zero() { return _mm_setzero_pd(); }
+            static V Add(V a, V b) { return _mm_add_pd(a, b); }
+            static V Sub(V a, V b) { return _mm_sub_pd(a, b); }
+            static V Mul(V a, V b) { return _mm_mul_pd(a, b); }
+            static V Div(V a, V b) { return _mm_div_pd(a, b); }
+            static V Min(V a, V b) { return _mm_min_pd(a, b); }
+            static V Max(V a, V b) { return _mm_max_pd(a, b); }
+        };
+
+        // SSE2 lacks 32 bit multiplies and min/max, they are built from what it has.
+        struct Sse2Int
+        {
+            using T = std::int32_t;
+            using V = __m128i;
+            static constexpr std::size_t Width = 4;
+
+            static V Load(const T* src) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)); }
+            static void Store(T* dst, V v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), v); }
+            static V Broadcast(T value) { return _mm_set1_epi32(value); }
+            static V Zero() { return _mm_setzero_si128(); }
+            static V Add(V a, V b) { return _mm_add_epi32(a, b); }
+            static V Sub(V a, V b) { return _mm_sub_epi32(a, b); }
+            static V Div(V a, V b) { return DivideEach<Sse2Int>(a, b); }
+
+            static V Mul(V a, V b)
+            {
+                __m128i even = _mm_mul_epu32(a, b);
+                __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+                return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+            }
+
+            static V Min(V a, V b)
+            {
+                __m128i greater = _mm_cmpgt_epi32(a, b);
+                return _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+            }
+
+            static V Max(V a, V b)
+            {
+                __m128i greater = _mm_cmpgt_epi32(a, b);
+                return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+            }
+        };
+    }
+
+    using FloatLanes = Sse2Float;
+    using DoubleLanes = Sse2Double;
+    using IntLanes = Sse2Int;
+#define JSCR_DISPATCH(call) if (HasAvx2()) return Avx2::call
+#else
+    using FloatLanes = ScalarLanes<float>;
+    using DoubleLanes = ScalarLanes<double>;
+    using IntLanes = ScalarLanes<std::int32_t>;
+#define JSCR_DISPATCH(call)
+#endif
+
+    bool Kernels::HasAvx2()
+    {
+#if JSCR_KERNELS_X86 && defined(_MSC_VER) && !defined(__clang__)
+        static const bool supported = []()
+        {
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+                return false;
+
+            // The OS has to save the YMM registers too, not just the CPU support them.
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+                return false;
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+        }();
+        return supported;
+#elif JSCR_KERNELS_X86
+        static const bool supported = []()
+        {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+        }();
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    // ----- Fill & copy -----
+
+    void Kernels::Fill(std::int32_t* dst, std::size_t count, std::int32_t value) { JSCR_DISPATCH(Fill(dst, count, value)); FillLanes<IntLanes>(dst, count, value); }
+    void Kernels::Fill(float* dst, std::size_t count, float value) { JSCR_DISPATCH(Fill(dst, count, value)); FillLanes<FloatLanes>(dst, count, value); }
+    void Kernels::Fill(double* dst, std::size_t count, double value) { JSCR_DISPATCH(Fill(dst, count, value)); FillLanes<DoubleLanes>(dst, count, value); }
+    void Kernels::Fill(char* dst, std::size_t count, char value) { std::memset(dst, (unsigned char) value, count); }
+
+    // The C library's memmove is already vectorized and picks its width at load time.
+    void Kernels::Copy(void* dst, const void* src, std::size_t bytes) { std::memmove(dst, src, bytes); }
+
+    // ----- Reductions -----
+
+    std::int32_t Kernels::Sum(const std::int32_t* src, std::size_t count) { JSCR_DISPATCH(Sum(src, count)); return SumLanes<IntLanes>(src, count); }
+    float Kernels::Sum(const float* src, std::size_t count) { JSCR_DISPATCH(Sum(src, count)); return SumLanes<FloatLanes>(src, count); }
+    double Kernels::Sum(const double* src, std::size_t count) { JSCR_DISPATCH(Sum(src, count)); return SumLanes<DoubleLanes>(src, count); }
+
+    std::int32_t Kernels::Sum(const char* src, std::size_t count)
+    {
+        std::uint32_t sum = 0;
+        for (std::size_t i = 0; i < count; i++)
+            sum += (std::uint32_t) (std::int32_t) src[i];
+        return (std::int32_t) sum;
+    }
+
+    std::int32_t Kernels::Min(const std::int32_t* src, std::size_t count) { JSCR_DISPATCH(Min(src, count)); return ExtremeLanes<IntLanes, false>(src, count); }
+    float Kernels::Min(const float* src, std::size_t count) { JSCR_DISPATCH(Min(src, count)); return ExtremeLanes<FloatLanes, false>(src, count); }
+    double Kernels::Min(const double* src, std::size_t count) { JSCR_DISPATCH(Min(src, count)); return ExtremeLanes<DoubleLanes, false>(src, count); }
+    char Kernels::Min(const char* src, std::size_t count) { return ExtremeLanes<ScalarLanes<char>, false>(src, count); }
+
+    std::int32_t Kernels::Max(const std::int32_t* src, std::size_t count) { JSCR_DISPATCH(Max(src, count)); return ExtremeLanes<IntLanes, true>(src, count); }
+    float Kernels::Max(const float* src, std::size_t count) { JSCR_DISPATCH(Max(src, count)); return ExtremeLanes<FloatLanes, true>(src, count); }
+    double Kernels::Max(const double* src, std::size_t count) { JSCR_DISPATCH(Max(src, count)); return ExtremeLanes<DoubleLanes, true>(src, count); }
+    char Kernels::Max(const char* src, std::size_t count) { return ExtremeLanes<ScalarLanes<char>, true>(src, count); }
+
+    std::int32_t Kernels::Dot(const std::int32_t* a, const std::int32_t* b, std::size_t count) { JSCR_DISPATCH(Dot(a, b, count)); return DotLanes<IntLanes>(a, b, count); }
+    float Kernels::Dot(const float* a, const float* b, std::size_t count) { JSCR_DISPATCH(Dot(a, b, count)); return DotLanes<FloatLanes>(a, b, count); }
+    double Kernels::Dot(const double* a, const double* b, std::size_t count) { JSCR_DISPATCH(Dot(a, b, count)); return DotLanes<DoubleLanes>(a, b, count); }
+
+    std::int32_t Kernels::Dot(const char* a, const char* b, std::size_t count)
+    {
+        std::uint32_t sum = 0;
+        for (std::size_t i = 0; i < count; i++)
+            sum += (std::uint32_t) ((std::int32_t) a[i] * (std::int32_t) b[i]);
+        return (std::int32_t) sum;
+    }
+
+    // ----- Element-wise arithmetic -----
+
+    void Kernels::Apply(Op op, std::int32_t* dst, const std::int32_t* a, const std::int32_t* b, std::size_t count) { JSCR_DISPATCH(Apply(op, dst, a, b, count)); ApplyLanes<IntLanes>(op, dst, a, b, count); }
+    void Kernels::Apply(Op op, float* dst, const float* a, const float* b, std::size_t count) { JSCR_DISPATCH(Apply(op, dst, a, b, count)); ApplyLanes<FloatLanes>(op, dst, a, b, count); }
+    void Kernels::Apply(Op op, double* dst, const double* a, const double* b, std::size_t count) { JSCR_DISPATCH(Apply(op, dst, a, b, count)); ApplyLanes<DoubleLanes>(op, dst, a, b, count); }
+    void Kernels::Apply(Op op, char* dst, const char* a, const char* b, std::size_t count) { ApplyLanes<ScalarLanes<char>>(op, dst, a, b, count); }
+}
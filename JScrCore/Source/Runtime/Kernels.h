@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace JScr::Runtime
+{
+    // Bulk operations over unboxed element buffers, backing the typed array functions of the standard
+    // library. x86-64 builds pick AVX2 or SSE2 at runtime, everything else runs the scalar versions.
+    // Integer arithmetic wraps around, the same as it does in scripts.
+    class Kernels
+    {
+    public:
+        enum class Op : std::uint8_t
+        {
+            Add, Sub, Mul, Div
+        };
+
+        static void Fill(std::int32_t* dst, std::size_t count, std::int32_t value);
+        static void Fill(float* dst, std::size_t count, float value);
+        static void Fill(double* dst, std::size_t count, double value);
+        static void Fill(char* dst, std::size_t count, char value);
+
+        // Overlapping ranges are allowed.
+        static void Copy(void* dst, const void* src, std::size_t bytes);
+
+        // Chars are summed up as ints.
+        static std::int32_t Sum(const std::int32_t* src, std::size_t count);
+        static float Sum(const float* src, std::size_t count);
+        static double Sum(const double* src, std::size_t count);
+        static std::int32_t Sum(const char* src, std::size_t count);
+
+        // count must not be 0.
+        static std::int32_t Min(const std::int32_t* src, std::size_t count);
+        static float Min(const float* src, std::size_t count);
+        static double Min(const double* src, std::size_t count);
+        static char Min(const char* src, std::size_t count);
+        static std::int32_t Max(const std::int32_t* src, std::size_t count);
+        static float Max(const float* src, std::size_t count);
+        static double Max(const double* src, std::size_t count);
+        static char Max(const char* src, std::size_t count);
+
+        static std::int32_t Dot(const std::int32_t* a, const std::int32_t* b, std::size_t count);
+        static float Dot(const float* a, const float* b, std::size_t count);
+        static double Dot(const double* a, const double* b, std::size_t count);
+        static std::int32_t Dot(const char* a, const char* b, std::size_t count);
+
+        // dst[i] = a[i] op b[i]. dst may alias a or b. Integer and char division expect b to hold no zeros.
+        static void Apply(Op op, std::int32_t* dst, const std::int32_t* a, const std::int32_t* b, std::size_t count);
+        static void Apply(Op op, float* dst, const float* a, const float* b, std::size_t count);
+        static void Apply(Op op, double* dst, const double* a, const double* b, std::size_t count);
+        static void Apply(Op op, char* dst, const char* a, const char* b, std::size_t count);
+
+        static bool HasAvx2();
+    };
+}
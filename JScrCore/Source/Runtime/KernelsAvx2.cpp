@@ -0,0 +1,93 @@
+// Built with AVX2 code generation enabled (see Build.lua). Nothing in here may run before
+// Kernels::HasAvx2() said so.
+#include "KernelLanes.h"
+
+#if JSCR_KERNELS_X86
+#include <immintrin.h>
+
+namespace JScr::Runtime
+{
+    namespace
+    {
+        struct Avx2Float
+        {
+            using T = float;
+            using V = __m256;
+            static constexpr std::size_t Width = 8;
+
+            static V Load(const T* src) { return _mm256_loadu_ps(src); }
+            static void Store(T* dst, V v) { _mm256_storeu_ps(dst, v); }
+            static V Broadcast(T value) { return _mm256_set1_ps(value); }
+            static V Zero() { return _mm256_setzero_ps(); }
+            static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+            static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+            static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+            static V Div(V a, V b) { return _mm256_div_ps(a, b); }
+            static V Min(V a, V b) { return _mm256_min_ps(a, b); }
+            static V Max(V a, V b) { return _mm256_max_ps(a, b); }
+        };
+
+        struct Avx2Double
+        {
+            using T = double;
+            using V = __m256d;
+            static constexpr std::size_t Width = 4;
+
+            static V Load(const T* src) { return _mm256_loadu_pd(src); }
+            static void Store(T* dst, V v) { _mm256_storeu_pd(dst, v); }
+            static V Broadcast(T value) { return _mm256_set1_pd(value); }
+            static V Zero() { return _mm256_setzero_pd(); }
+            static V Add(V a, V b) { return _mm256_add_pd(a, b); }
+            static V Sub(V a, V b) { return _mm256_sub_pd(a, b); }
+            static V Mul(V a, V b) { return _mm256_mul_pd(a, b); }
+            static V Div(V a, V b) { return _mm256_div_pd(a, b); }
+            static V Min(V a, V b) { return _mm256_min_pd(a, b); }
+            static V Max(V a, V b) { return _mm256_max_pd(a, b); }
+        };
+
+        struct Avx2Int
+        {
+            using T = std::int32_t;
+            using V = __m256i;
+            static constexpr std::size_t Width = 8;
+
+            static V Load(const T* src) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)); }
+            static void Store(T* dst, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), v); }
+            static V Broadcast(T value) { return _mm256_set1_epi32(value); }
+            static V Zero() { return _mm256_setzero_si256(); }
+            static V Add(V a, V b) { return _mm256_add_epi32(a, b); }
+            static V Sub(V a, V b) { return _mm256_sub_epi32(a, b); }
+            static V Mul(V a, V b) { return _mm256_mullo_epi32(a, b); }
+            static V Div(V a, V b) { return DivideEach<Avx2Int>(a, b); }
+            static V Min(V a, V b) { return _mm256_min_epi32(a, b); }
+            static V Max(V a, V b) { return _mm256_max_epi32(a, b); }
+        };
+    }
+
+    namespace Avx2
+    {
+        void Fill(std::int32_t* dst, std::size_t count, std::int32_t value) { FillLanes<Avx2Int>(dst, count, value); }
+        void Fill(float* dst, std::size_t count, float value) { FillLanes<Avx2Float>(dst, count, value); }
+        void Fill(double* dst, std::size_t count, double value) { FillLanes<Avx2Double>(dst, count, value); }
+
+        std::int32_t Sum(const std::int32_t* src, std::size_t count) { return SumLanes<Avx2Int>(src, count); }
+        float Sum(const float* src, std::size_t count) { return SumLanes<Avx2Float>(src, count); }
+        double Sum(const double* src, std::size_t count) { return SumLanes<Avx2Double>(src, count); }
+
+        std::int32_t Min(const std::int32_t* src, std::size_t count) { return ExtremeLanes<Avx2Int, false>(src, count); }
+        float Min(const float* src, std::size_t count) { return ExtremeLanes<Avx2Float, false>(src, count); }
+        double Min(const double* src, std::size_t count) { return ExtremeLanes<Avx2Double, false>(src, count); }
+        std::int32_t Max(const std::int32_t* src, std::size_t count) { return ExtremeLanes<Avx2Int, true>(src, count); }
+        float Max(const float* src, std::size_t count) { return ExtremeLanes<Avx2Float, true>(src, count); }
+        double Max(const double* src, std::size_t count) { return ExtremeLanes<Avx2Double, true>(src, count); }
+
+        std::int32_t Dot(const std::int32_t* a, const std::int32_t* b, std::size_t count) { return DotLanes<Avx2Int>(a, b, count); }
+        float Dot(const float* a, const float* b, std::size_t count) { return DotLanes<Avx2Float>(a, b, count); }
+        double Dot(const double* a, const double* b, std::size_t count) { return DotLanes<Avx2Double>(a, b, count); }
+
+        void Apply(Kernels::Op op, std::int32_t* dst, const std::int32_t* a, const std::int32_t* b, std::size_t count) { ApplyLanes<Avx2Int>(op, dst, a, b, count); }
+        void Apply(Kernels::Op op, float* dst, const float* a, const float* b, std::size_t count) { ApplyLanes<Avx2Float>(op, dst, a, b, count); }
+        void Apply(Kernels::Op op, double* dst, const double* a, const double* b, std::size_t count) { ApplyLanes<Avx2Double>(op, dst, a, b, count); }
+    }
+}
+#endif
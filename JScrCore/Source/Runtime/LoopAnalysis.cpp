@@ -0,0 +1,331 @@
+#include "LoopAnalysis.h"
+#include <unordered_set>
+#include "AstWalker.h"
+
+namespace JScr::Runtime
+{
+    namespace
+    {
+        // What running the body (and the action of a for loop) may do.
+        class EffectWalker : public AstWalker
+        {
+        public:
+            std::unordered_set<std::string> written;
+            std::unordered_set<std::string> declared;
+            std::unordered_set<std::string> assignedMembers;
+            bool calls = false;
+
+            // Expressions run on every iteration, outside of nested functions.
+            std::vector<const IndexExpr*> indexes;
+            std::vector<const BinaryExpr*> products;
+
+        protected:
+            void Referenced(const std::string& name, Use use) override
+            {
+                if (use == Use::Write)
+                    written.insert(name);
+            }
+
+            void Declared(const std::string& name) override
+            {
+                if (Nesting() == 0)
+                    declared.insert(name);
+            }
+
+            void Visited(const Expr& expr) override
+            {
+                switch (expr.Kind())
+                {
+                case NodeType::ASSIGNMENT_EXPR:
+                {
+                    const Expr& target = static_cast<const AssignmentExpr&>(expr).Assigne();
+                    if (target.Kind() == NodeType::MEMBER_EXPR)
+                    {
+                        const Expr& property = static_cast<const MemberExpr&>(target).Property();
+                        if (property.Kind() == NodeType::IDENTIFIER)
+                            assignedMembers.insert(static_cast<const Identifier&>(property).Symbol());
+                    }
+                    break;
+                }
+                case NodeType::CALL_EXPR:
+                case NodeType::AWAIT_EXPR:
+                    // Other code runs while the loop waits, just as during a call.
+                    calls |= Nesting() == 0;
+                    break;
+                case NodeType::INDEX_EXPR:
+                    if (Nesting() == 0)
+                        indexes.push_back(static_cast<const IndexExpr*>(&expr));
+                    break;
+                case NodeType::BINARY_EXPR:
+                    if (Nesting() == 0 && static_cast<const BinaryExpr&>(expr).Operator() == '*')
+                        products.push_back(static_cast<const BinaryExpr*>(&expr));
+                    break;
+                default:
+                    break;
+                }
+            }
+        };
+
+        // Calls and assignments in the condition itself would make hoisting reorder side effects.
+        class ConditionWalker : public AstWalker
+        {
+        public:
+            bool pure = true;
+
+        protected:
+            void Visited(const Expr& expr) override
+            {
+                if (expr.Kind() == NodeType::CALL_EXPR || expr.Kind() == NodeType::ASSIGNMENT_EXPR || expr.Kind() == NodeType::LAMBDA_EXPR || expr.Kind() == NodeType::AWAIT_EXPR)
+                    pure = false;
+            }
+        };
+
+        class Analyzer
+        {
+        public:
+            Analyzer(const EffectWalker& effects, const LoopAnalysis::Query& stable, const LoopAnalysis::Query& fixedLength)
+                : m_effects(effects), m_stable(stable), m_fixedLength(fixedLength) {}
+
+            bool Invariant(const Expr& expr) const
+            {
+                switch (expr.Kind())
+                {
+                case NodeType::NUMERIC_LITERAL:
+                case NodeType::FLOAT_LITERAL:
+                case NodeType::DOUBLE_LITERAL:
+                case NodeType::CHAR_LITERAL:
+                case NodeType::STRING_LITERAL:
+                    return true;
+                case NodeType::IDENTIFIER:
+                    return InvariantVariable(static_cast<const Identifier&>(expr).Symbol());
+                case NodeType::BINARY_EXPR:
+                {
+                    const auto& binary = static_cast<const BinaryExpr&>(expr);
+                    return Invariant(binary.Left()) && Invariant(binary.Right());
+                }
+                case NodeType::EQUALITY_CHECK_EXPR:
+                {
+                    const auto& check = static_cast<const EqualityCheckExpr&>(expr);
+                    return !ShortCircuits(check) && Invariant(check.Left()) && Invariant(check.Right());
+                }
+                case NodeType::UNARY_EXPR:
+                    return Invariant(static_cast<const UnaryExpr&>(expr).Object());
+                case NodeType::MEMBER_EXPR:
+                {
+                    const auto& member = static_cast<const MemberExpr&>(expr);
+                    if (member.Property().Kind() != NodeType::IDENTIFIER || !Invariant(member.Object()))
+                        return false;
+
+                    // Strings and typed arrays never change length; any other field only through an assignment.
+                    const std::string& property = static_cast<const Identifier&>(member.Property()).Symbol();
+                    if (property == "length" && member.Object().Kind() == NodeType::IDENTIFIER && m_fixedLength(static_cast<const Identifier&>(member.Object()).Symbol()))
+                        return true;
+                    return !m_effects.calls && m_effects.assignedMembers.count(property) == 0;
+                }
+                default:
+                    return false;
+                }
+            }
+
+            bool InvariantVariable(const std::string& name) const
+            {
+                // Without calls in the body, nothing but the body runs between two iterations.
+                return m_effects.written.count(name) == 0 && (!m_effects.calls || m_stable(name));
+            }
+
+            // Collects the invariant subexpressions worth a register. Only those evaluated before anything
+            // that could fail are taken, so the first error the loop reports stays the same.
+            bool Collect(const Expr& expr, std::vector<const Expr*>& invariants) const
+            {
+                if (Trivial(expr))
+                    return true;
+                if (Invariant(expr))
+                {
+                    invariants.push_back(&expr);
+                    return true;
+                }
+
+                switch (expr.Kind())
+                {
+                case NodeType::BINARY_EXPR:
+                {
+                    const auto& binary = static_cast<const BinaryExpr&>(expr);
+                    if (Collect(binary.Left(), invariants))
+                        Collect(binary.Right(), invariants);
+                    return false;
+                }
+                case NodeType::EQUALITY_CHECK_EXPR:
+                {
+                    const auto& check = static_cast<const EqualityCheckExpr&>(expr);
+                    if (!ShortCircuits(check) && Collect(check.Left(), invariants))
+                        Collect(check.Right(), invariants);
+                    return false;
+                }
+                case NodeType::UNARY_EXPR:
+                    Collect(static_cast<const UnaryExpr&>(expr).Object(), invariants);
+                    return false;
+                default:
+                    return false;
+                }
+            }
+
+        private:
+            static bool Trivial(const Expr& expr)
+            {
+                switch (expr.Kind())
+                {
+                case NodeType::NUMERIC_LITERAL:
+                case NodeType::FLOAT_LITERAL:
+                case NodeType::DOUBLE_LITERAL:
+                case NodeType::CHAR_LITERAL:
+                case NodeType::STRING_LITERAL:
+                case NodeType::IDENTIFIER:
+                    return true;
+                default:
+                    return false;
+                }
+            }
+
+            static bool ShortCircuits(const EqualityCheckExpr& check)
+            {
+                return check.Operator() == EqualityCheckExpr::Type::AND || check.Operator() == EqualityCheckExpr::Type::OR;
+            }
+
+        private:
+            const EffectWalker& m_effects;
+            const LoopAnalysis::Query& m_stable;
+            const LoopAnalysis::Query& m_fixedLength;
+        };
+
+        bool IsIdentifier(const Expr& expr, const std::string& name)
+        {
+            return expr.Kind() == NodeType::IDENTIFIER && static_cast<const Identifier&>(expr).Symbol() == name;
+        }
+
+        const NumericLiteral* AsNumber(const Expr& expr)
+        {
+            return expr.Kind() == NodeType::NUMERIC_LITERAL ? static_cast<const NumericLiteral*>(&expr) : nullptr;
+        }
+
+        // `i = i + c`, `i = c + i` or `i = i - c`.
+        std::optional<std::int32_t> Step(const Expr& action, const std::string& name)
+        {
+            if (action.Kind() != NodeType::ASSIGNMENT_EXPR)
+                return std::nullopt;
+
+            const auto& assignment = static_cast<const AssignmentExpr&>(action);
+            if (!IsIdentifier(assignment.Assigne(), name) || assignment.Value().Kind() != NodeType::BINARY_EXPR)
+                return std::nullopt;
+
+            const auto& binary = static_cast<const BinaryExpr&>(assignment.Value());
+            const NumericLiteral* step = nullptr;
+            if (binary.Operator() == '+' && IsIdentifier(binary.Left(), name))
+                step = AsNumber(binary.Right());
+            else if (binary.Operator() == '+' && IsIdentifier(binary.Right(), name))
+                step = AsNumber(binary.Left());
+            else if (binary.Operator() == '-' && IsIdentifier(binary.Left(), name))
+                step = AsNumber(binary.Right());
+
+            // A negated INT_MIN would overflow, and counting down by it is of no interest.
+            if (step == nullptr || step->Value() == 0 || step->Value() == INT32_MIN)
+                return std::nullopt;
+            return binary.Operator() == '-' ? -step->Value() : step->Value();
+        }
+
+        // The array `x` of `i < x.length` or `x.length > i`.
+        const Identifier* BoundedArray(const Expr& condition, const std::string& name)
+        {
+            if (condition.Kind() != NodeType::EQUALITY_CHECK_EXPR)
+                return nullptr;
+
+            const auto& check = static_cast<const EqualityCheckExpr&>(condition);
+            const Expr* length = nullptr;
+            if (check.Operator() == EqualityCheckExpr::Type::LESS_THAN && IsIdentifier(check.Left(), name))
+                length = &check.Right();
+            else if (check.Operator() == EqualityCheckExpr::Type::MORE_THAN && IsIdentifier(check.Right(), name))
+                length = &check.Left();
+
+            if (length == nullptr || length->Kind() != NodeType::MEMBER_EXPR)
+                return nullptr;
+
+            const auto& member = static_cast<const MemberExpr&>(*length);
+            if (!IsIdentifier(member.Property(), "length") || member.Object().Kind() != NodeType::IDENTIFIER)
+                return nullptr;
+            return static_cast<const Identifier*>(&member.Object());
+        }
+    }
+
+    LoopAnalysis::Result LoopAnalysis::Analyze(const Expr& condition, const std::vector<std::unique_ptr<Stmt>>& body, const Query& stable, const Query& fixedLength)
+    {
+        EffectWalker effects{};
+        effects.Statements(body);
+
+        Result result{};
+        ConditionWalker pure{};
+        pure.Expression(condition);
+        if (pure.pure)
+            Analyzer(effects, stable, fixedLength).Collect(condition, result.invariants);
+        return result;
+    }
+
+    LoopAnalysis::Result LoopAnalysis::Analyze(const ForDeclaration& loop, const Query& stable, const Query& fixedLength)
+    {
+        EffectWalker effects{};
+        effects.Statements(loop.Body());
+        std::unordered_set<std::string> writtenByBody = effects.written;
+        effects.Expression(loop.Action());
+
+        Result result{};
+        Analyzer analyzer{ effects, stable, fixedLength };
+        ConditionWalker pure{};
+        pure.Expression(loop.Condition());
+        if (pure.pure)
+            analyzer.Collect(loop.Condition(), result.invariants);
+
+        if (loop.Declaration().Kind() != NodeType::VAR_DECLARATION)
+            return result;
+
+        const auto& decl = static_cast<const VarDeclaration&>(loop.Declaration());
+        const std::string& name = decl.Identifier();
+        const Expr* init = decl.Value().has_value() ? decl.Value().value().get() : nullptr;
+        if (init == nullptr || writtenByBody.count(name) != 0 || effects.declared.count(name) != 0 || !stable(name))
+            return result;
+
+        // Ints wrap, so `i * c` advances by exactly `step * c` whatever the values.
+        bool isInt = decl.Type().Is(Types::Uid::Int) || (decl.Type().Is(Types::Uid::Dynamic) && AsNumber(*init) != nullptr);
+        auto step = Step(loop.Action(), name);
+        if (!isInt || !step.has_value())
+            return result;
+        result.step = step;
+
+        for (const BinaryExpr* product : effects.products)
+        {
+            const NumericLiteral* factor = nullptr;
+            if (IsIdentifier(product->Left(), name))
+                factor = AsNumber(product->Right());
+            else if (IsIdentifier(product->Right(), name))
+                factor = AsNumber(product->Left());
+            if (factor != nullptr)
+                result.products.push_back(Product{ product, factor->Value() });
+        }
+
+        // Counting up by one from a non-negative start, `i` stays in [0, x.length) inside the body. A
+        // larger step could wrap past INT_MAX and come back negative.
+        const Identifier* array = BoundedArray(loop.Condition(), name);
+        const NumericLiteral* start = AsNumber(*init);
+        if (array == nullptr || start == nullptr || start->Value() < 0 || *step != 1 || !pure.pure)
+            return result;
+
+        // Natives such as pop and clear shrink plain arrays, so a body with calls keeps their checks.
+        const std::string& arrayName = array->Symbol();
+        if (!analyzer.InvariantVariable(arrayName) || effects.declared.count(arrayName) != 0 || (effects.calls && !fixedLength(arrayName)))
+            return result;
+
+        for (const IndexExpr* index : effects.indexes)
+        {
+            if (IsIdentifier(index->Caller(), arrayName) && IsIdentifier(index->Arg(), name))
+                result.inBounds.push_back(index);
+        }
+        return result;
+    }
+}
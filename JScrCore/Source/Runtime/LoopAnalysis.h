@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../Frontend/Ast.h"
+
+using namespace JScr::Frontend;
+
+namespace JScr::Runtime
+{
+    // Looks at a loop before the Compiler emits it. Parts of the condition that come out the same on
+    // every iteration are computed once in front of the loop. A counted for loop additionally has its
+    // induction variable recognized: index expressions it keeps within bounds need no check, and its
+    // multiples are carried along in registers instead of being multiplied on every iteration.
+    class LoopAnalysis
+    {
+    public:
+        // Tells whether a variable is a local of the function being compiled that no function nested
+        // in it assigns, so only the loop itself could change it.
+        using Query = std::function<bool(const std::string&)>;
+
+        struct Product
+        {
+            const BinaryExpr* expr;
+            std::int32_t factor;
+        };
+
+        struct Result
+        {
+            // Maximal invariant subexpressions of the condition, in evaluation order.
+            std::vector<const Expr*> invariants;
+            // The constant step of an induction variable that only ever holds ints.
+            std::optional<std::int32_t> step;
+            // `x[i]` reads and writes that run while `0 <= i < x.length`.
+            std::vector<const IndexExpr*> inBounds;
+            // `i * c` in the body.
+            std::vector<Product> products;
+        };
+
+        // `fixedLength` tells whether a variable's declared type makes `.length` a string or array length.
+        static Result Analyze(const Expr& condition, const std::vector<std::unique_ptr<Stmt>>& body, const Query& stable, const Query& fixedLength);
+        static Result Analyze(const ForDeclaration& loop, const Query& stable, const Query& fixedLength);
+    };
+}
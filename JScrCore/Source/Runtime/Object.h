@@ -0,0 +1,485 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include <utility>
+#include "Shape.h"
+#include "String.h"
+#include "Value.h"
+
+namespace JScr::Runtime
+{
+    class Heap;
+    class Jit;
+    struct FunctionProto;
+    struct ObjectType;
+    struct EnumType;
+
+    enum class ObjectKind : std::uint8_t
+    {
+        String, Array, TypedArray, Instance, Struct, Enum, Closure, Upvalue, Native, AstFunction, Task,
+        // The std.collections objects, see Collections.h.
+        Map, Set, Deque, PriorityQueue,
+        // Unused heap memory between objects. Never reachable from a Value.
+        Free
+    };
+
+    class Tracer;
+
+    class HeapObject
+    {
+    public:
+        virtual ~HeapObject() = default;
+
+        ObjectKind Kind() const { return m_kind; }
+        // Module constants, which every VM of the module shares and none writes to.
+        bool IsPermanent() const { return (m_flags & Immortal) != 0; }
+
+        // Marks every object this one refers to.
+        virtual void Trace(Tracer&) const {}
+
+    protected:
+        HeapObject(ObjectKind kind) : m_kind(kind) {}
+
+    private:
+        friend class Heap;
+        friend class Tracer;
+        friend class Jit;
+
+        enum Flags : std::uint8_t
+        {
+            Young = 1 << 0,
+            // Old object that was given a reference to a young one since the last minor collection.
+            Remembered = 1 << 1,
+            // Belongs to a permanent heap (module constants), never marked nor freed by a collector.
+            Immortal = 1 << 2,
+            Large = 1 << 3,
+        };
+
+        ObjectKind m_kind;
+        std::uint8_t m_flags = 0;
+        // Equal to the heap's current epoch once marked.
+        std::uint8_t m_mark = 0;
+        // Allocation size in bytes, header included.
+        std::uint32_t m_size = 0;
+    };
+
+    // Marks objects for the collector and keeps the ones still to be traced.
+    class Tracer
+    {
+    public:
+        void Mark(const Value& value)
+        {
+            if (value.IsObject())
+                Mark(value.AsObject());
+        }
+
+        void Mark(const HeapObject* object)
+        {
+            if (object == nullptr || object->m_mark == m_epoch || (object->m_flags & HeapObject::Immortal) != 0)
+                return;
+            // A minor collection takes every old object to be alive.
+            if (m_youngOnly && (object->m_flags & HeapObject::Young) == 0)
+                return;
+
+            auto* marked = const_cast<HeapObject*>(object);
+            marked->m_mark = m_epoch;
+            m_gray.push_back(marked);
+        }
+
+    private:
+        friend class Heap;
+
+        std::vector<HeapObject*> m_gray;
+        std::uint8_t m_epoch = 1;
+        bool m_youngOnly = false;
+    };
+
+    // Script string. Concatenating long strings only creates a rope node that refers to both halves;
+    // the characters are joined the first time someone reads them, which keeps `s = s + x` in a loop
+    // linear.
+    class StringObject : public HeapObject
+    {
+    public:
+        // Results shorter than this are copied right away, a rope node would not pay off.
+        static constexpr std::size_t RopeThreshold = 128;
+
+        StringObject(String text) : HeapObject(ObjectKind::String), m_text(std::move(text)), m_length(m_text.Length()) {}
+
+        static StringObject* Concat(Heap& heap, const StringObject* left, const StringObject* right);
+        static bool Equal(const StringObject* a, const StringObject* b);
+
+        std::size_t Length() const { return m_length; }
+        std::string_view Data() const { return Text().View(); }
+        const String& Text() const
+        {
+            if (m_left != nullptr)
+                Flatten();
+            return m_text;
+        }
+
+        // Cached after the first call.
+        std::uint32_t Hash() const
+        {
+            if (m_hash == 0)
+                m_hash = String::Hash(Data());
+            return m_hash;
+        }
+
+        // Both halves of a rope that was not flattened yet, null otherwise.
+        const StringObject* Left() const { return m_left; }
+        const StringObject* Right() const { return m_right; }
+
+        void Trace(Tracer& tracer) const override
+        {
+            tracer.Mark(m_left);
+            tracer.Mark(m_right);
+        }
+    private:
+        StringObject(const StringObject* left, const StringObject* right)
+            : HeapObject(ObjectKind::String), m_length(left->Length() + right->Length()), m_left(left), m_right(right)
+        {}
+
+        void Flatten() const;
+
+        mutable String m_text;
+        std::size_t m_length;
+        mutable std::uint32_t m_hash = 0;
+        mutable const StringObject* m_left = nullptr;
+        mutable const StringObject* m_right = nullptr;
+
+        friend class Heap;
+    };
+
+    class ArrayObject : public HeapObject
+    {
+    public:
+        ArrayObject(std::vector<Value> items = {}) : HeapObject(ObjectKind::Array), m_items(std::move(items)) {}
+
+        std::vector<Value>& Items() { return m_items; }
+        const std::vector<Value>& Items() const { return m_items; }
+
+        void Trace(Tracer& tracer) const override
+        {
+            for (const Value& item : m_items)
+                tracer.Mark(item);
+        }
+    private:
+        std::vector<Value> m_items;
+    };
+
+    enum class ElementType : std::uint8_t
+    {
+        Int, Float, Double, Char
+    };
+
+    // Array of a primitive element type, stored unboxed in one aligned block so the kernels in
+    // Kernels.h can stream over it. Its length is fixed at creation.
+    class TypedArrayObject : public HeapObject
+    {
+    public:
+        static constexpr std::size_t Alignment = 32;
+
+        TypedArrayObject(ElementType type, std::size_t length) : HeapObject(ObjectKind::TypedArray), m_type(type), m_length(length)
+        {
+            std::size_t bytes = (length * ElementSize(type) + Alignment - 1) & ~(Alignment - 1);
+            m_data = ::operator new(bytes > 0 ? bytes : Alignment, std::align_val_t(Alignment));
+            std::memset(m_data, 0, bytes);
+        }
+
+        // Wraps memory the host owns instead of allocating; see Binding::Share for the rules that come with it.
+        TypedArrayObject(ElementType type, void* data, std::size_t length, bool readOnly)
+            : HeapObject(ObjectKind::TypedArray), m_type(type), m_length(length), m_data(data), m_external(true), m_readOnly(readOnly)
+        {}
+
+        ~TypedArrayObject()
+        {
+            if (!m_external)
+                ::operator delete(m_data, std::align_val_t(Alignment));
+        }
+
+        static std::size_t ElementSize(ElementType type)
+        {
+            static constexpr std::size_t sizes[] = { sizeof(std::int32_t), sizeof(float), sizeof(double), sizeof(char) };
+            return sizes[(int) type];
+        }
+
+        static const char* ElementName(ElementType type)
+        {
+            static constexpr const char* names[] = { "int", "float", "double", "char" };
+            return names[(int) type];
+        }
+
+        ElementType GetElementType() const { return m_type; }
+        std::size_t Length() const { return m_length; }
+        bool IsExternal() const { return m_external; }
+        // Only external arrays are read-only. Set checks nothing, writers check this first.
+        bool IsReadOnly() const { return m_readOnly; }
+
+        template <typename T> T* Data() { return static_cast<T*>(m_data); }
+        template <typename T> const T* Data() const { return static_cast<const T*>(m_data); }
+        void* Bytes() { return m_data; }
+        const void* Bytes() const { return m_data; }
+
+        Value Get(std::size_t index) const
+        {
+            switch (m_type)
+            {
+            case ElementType::Int:    return Value::Int(Data<std::int32_t>()[index]);
+            case ElementType::Float:  return Value::Float(Data<float>()[index]);
+            case ElementType::Double: return Value::Double(Data<double>()[index]);
+            default:                  return Value::Char(Data<char>()[index]);
+            }
+        }
+
+        // The value must already be converted to the element type.
+        void Set(std::size_t index, const Value& value)
+        {
+            switch (m_type)
+            {
+            case ElementType::Int:    Data<std::int32_t>()[index] = value.AsInt(); break;
+            case ElementType::Float:  Data<float>()[index] = value.AsFloat(); break;
+            case ElementType::Double: Data<double>()[index] = value.AsDouble(); break;
+            default:                  Data<char>()[index] = value.AsChar(); break;
+            }
+        }
+    private:
+        // Indexes arrays in place.
+        friend class Jit;
+
+        ElementType m_type;
+        std::size_t m_length;
+        void* m_data;
+        bool m_external = false;
+        bool m_readOnly = false;
+    };
+
+    class InstanceObject : public HeapObject
+    {
+    public:
+        InstanceObject(const Shape* shape) : HeapObject(ObjectKind::Instance), m_shape(shape), m_slots(shape->Defaults()) {}
+
+        const Shape* GetShape() const { return m_shape; }
+        // Null for anonymous objects built without a declared object type.
+        const ObjectType* Type() const { return m_shape->Type(); }
+
+        Value& Slot(std::size_t index) { return m_slots[index]; }
+        const Value& Slot(std::size_t index) const { return m_slots[index]; }
+
+        // Moves an anonymous object to the shape that has one more property than its current one.
+        void AddSlot(const Shape* shape, const Value& value)
+        {
+            m_shape = shape;
+            m_slots.push_back(value);
+        }
+
+        void Trace(Tracer& tracer) const override
+        {
+            for (const Value& slot : m_slots)
+                tracer.Mark(slot);
+        }
+    private:
+        const Shape* m_shape;
+        std::vector<Value> m_slots;
+    };
+
+    // Instance of a declared object type. The fields follow the object header in the same allocation,
+    // laid out by the type's packed shape.
+    class StructObject : public HeapObject
+    {
+    public:
+        StructObject(const Shape* shape) : HeapObject(ObjectKind::Struct), m_shape(shape)
+        {
+            std::memcpy(Data(), shape->Template(), shape->DataSize());
+        }
+
+        const Shape* GetShape() const { return m_shape; }
+        const ObjectType* Type() const { return m_shape->Type(); }
+
+        unsigned char* Data() { return reinterpret_cast<unsigned char*>(this + 1); }
+        const unsigned char* Data() const { return reinterpret_cast<const unsigned char*>(this + 1); }
+
+        Value Load(const FieldLayout& field) const { return field.Load(Data()); }
+        void Store(const FieldLayout& field, const Value& value) { field.Store(Data(), value); }
+        Value Get(std::size_t slot) const { return Load(m_shape->LayoutAt(slot)); }
+        void Set(std::size_t slot, const Value& value) { Store(m_shape->LayoutAt(slot), value); }
+
+        void Trace(Tracer& tracer) const override
+        {
+            for (std::size_t slot = 0; slot < m_shape->SlotCount(); slot++)
+            {
+                if (m_shape->LayoutAt(slot).kind == FieldKind::Value)
+                    tracer.Mark(Load(m_shape->LayoutAt(slot)));
+            }
+        }
+    private:
+        const Shape* m_shape;
+    };
+
+    // The value an enum's name evaluates to. Its entries are plain ints: the entry's index in the declaration.
+    class EnumObject : public HeapObject
+    {
+    public:
+        EnumObject(const EnumType* type) : HeapObject(ObjectKind::Enum), m_type(type) {}
+
+        const EnumType* Type() const { return m_type; }
+    private:
+        const EnumType* m_type;
+    };
+
+    class UpvalueObject : public HeapObject
+    {
+    public:
+        UpvalueObject(Value* location) : HeapObject(ObjectKind::Upvalue), m_location(location) {}
+
+        Value* Location() const { return m_location; }
+        bool IsOpen() const { return m_location != &m_closed; }
+
+        void Close()
+        {
+            m_closed = *m_location;
+            m_location = &m_closed;
+        }
+
+        // Points a closed upvalue at a stack slot again, which takes over its value.
+        void Reopen(Value* slot)
+        {
+            *slot = m_closed;
+            m_location = slot;
+        }
+
+        UpvalueObject* NextOpen() const { return m_nextOpen; }
+        void SetNextOpen(UpvalueObject* next) { m_nextOpen = next; }
+
+        // While open, the value is a stack slot and the VM marks it as a root.
+        void Trace(Tracer& tracer) const override
+        {
+            if (!IsOpen())
+                tracer.Mark(m_closed);
+        }
+    private:
+        Value* m_location;
+        Value m_closed;
+        UpvalueObject* m_nextOpen = nullptr;
+    };
+
+    // Flat closure: the upvalues the function captured, and only those, follow the object in the same
+    // allocation, one per entry of FunctionProto::upvalues. Allocate it through Heap::AllocateClosure.
+    class ClosureObject : public HeapObject
+    {
+    public:
+        ClosureObject(const FunctionProto* proto, std::size_t upvalueCount) : HeapObject(ObjectKind::Closure), m_proto(proto), m_upvalueCount((std::uint32_t) upvalueCount)
+        {
+            std::fill_n(Upvalues(), upvalueCount, nullptr);
+        }
+
+        const FunctionProto* Proto() const { return m_proto; }
+        UpvalueObject* Upvalue(std::size_t index) const { return Upvalues()[index]; }
+        void SetUpvalue(std::size_t index, UpvalueObject* upvalue) { Upvalues()[index] = upvalue; }
+
+        void Trace(Tracer& tracer) const override
+        {
+            for (std::size_t i = 0; i < m_upvalueCount; i++)
+                tracer.Mark(Upvalues()[i]);
+        }
+    private:
+        UpvalueObject** Upvalues() { return reinterpret_cast<UpvalueObject**>(this + 1); }
+        UpvalueObject* const* Upvalues() const { return reinterpret_cast<UpvalueObject* const*>(this + 1); }
+
+        const FunctionProto* m_proto;
+        std::uint32_t m_upvalueCount;
+    };
+
+    // What a call to an async function, or host work a native started, evaluates to; `await` takes the
+    // result out. While a call waits, its registers and the upvalues that pointed at them are kept in
+    // here instead of on the stack.
+    class TaskObject : public HeapObject
+    {
+    public:
+        enum class State : std::uint8_t { Pending, Fulfilled, Rejected };
+
+        TaskObject() : HeapObject(ObjectKind::Task) {}
+
+        State GetState() const { return m_state; }
+        const Value& Result() const { return m_result; }
+        const std::string& Error() const { return m_error; }
+
+        void Trace(Tracer& tracer) const override
+        {
+            tracer.Mark(m_result);
+            tracer.Mark(m_closure);
+            tracer.Mark(m_awaited);
+            for (const TaskObject* waiter : m_waiters)
+                tracer.Mark(waiter);
+            for (const Value& reg : m_registers)
+                tracer.Mark(reg);
+            for (const auto& upvalue : m_upvalues)
+                tracer.Mark(upvalue.first);
+        }
+    private:
+        friend class VM;
+
+        State m_state = State::Pending;
+        Value m_result;
+        std::string m_error;
+        // Suspended calls to resume once this task settles.
+        std::vector<TaskObject*> m_waiters;
+
+        // The suspended call, when there is one: where it continues, the task it waits for, and the
+        // upvalues to reopen with the register they belong to.
+        const ClosureObject* m_closure = nullptr;
+        std::uint32_t m_pc = 0;
+        const TaskObject* m_awaited = nullptr;
+        std::vector<Value> m_registers;
+        std::vector<std::pair<UpvalueObject*, std::uint8_t>> m_upvalues;
+    };
+
+    struct Deferred;
+
+    // What a native function can reach of the engine that calls it. The VM and the reference
+    // interpreter both implement it, so natives behave the same on either.
+    class NativeHost
+    {
+    public:
+        virtual ~NativeHost() = default;
+
+        virtual Heap& GetHeap() = 0;
+        // Calls back into a script or native function.
+        virtual Value Call(const Value& callee, const std::vector<Value>& args) = 0;
+        // A pending task for the native to return, and the promise that settles it from any thread (see Async.h).
+        virtual Deferred Defer() = 0;
+        // A host running the same program on a heap of its own, from which `callee` can be called on
+        // another thread while this one waits; `callee` is replaced by its copy in there. Null when the
+        // function may have side effects or reaches values that cannot be copied, or this host cannot
+        // fork at all, and the caller has to stay on this thread.
+        virtual std::unique_ptr<NativeHost> Fork([[maybe_unused]] Value& callee) { return nullptr; }
+    };
+
+    // Host functions receive their arguments as a window into the caller's registers. Errors are
+    // reported by throwing a RuntimeException. Objects a native allocates are safe until it returns or
+    // calls back into a script; keep them in a Handle across such calls.
+    using NativeFunction = Value(*)(NativeHost& host, Value* args, int argc, void* userdata);
+
+    class NativeFunctionObject : public HeapObject
+    {
+    public:
+        NativeFunctionObject(std::string name, NativeFunction function, int arity, void* userdata = nullptr)
+            : HeapObject(ObjectKind::Native), m_name(std::move(name)), m_function(function), m_arity(arity), m_userdata(userdata)
+        {}
+
+        const std::string& Name() const { return m_name; }
+        NativeFunction Function() const { return m_function; }
+        // -1 accepts any amount of arguments.
+        int Arity() const { return m_arity; }
+        void* Userdata() const { return m_userdata; }
+    private:
+        std::string m_name;
+        NativeFunction m_function;
+        int m_arity;
+        void* m_userdata;
+    };
+}
@@ -0,0 +1,84 @@
+#include "Parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include "Scheduler.h"
+
+namespace JScr::Runtime::Parallel
+{
+    namespace
+    {
+        struct State
+        {
+            const std::function<void(std::size_t, std::size_t)>* work;
+            std::size_t count;
+            std::atomic<std::size_t> next = 0;
+            std::atomic<bool> failed = false;
+
+            std::mutex mutex;
+            std::condition_variable idle;
+            // Helper lanes inside RunLane. Once `closed` no more join, and `work` may be gone.
+            std::size_t running = 0;
+            bool closed = false;
+            std::exception_ptr error;
+        };
+
+        void RunLane(State& state, std::size_t lane)
+        {
+            while (!state.failed.load(std::memory_order_relaxed))
+            {
+                std::size_t index = state.next.fetch_add(1, std::memory_order_relaxed);
+                if (index >= state.count)
+                    return;
+
+                try
+                {
+                    (*state.work)(index, lane);
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(state.mutex);
+                    if (state.error == nullptr)
+                        state.error = std::current_exception();
+                    state.failed = true;
+                }
+            }
+        }
+    }
+
+    void For(std::size_t count, std::size_t lanes, const std::function<void(std::size_t, std::size_t)>& work)
+    {
+        auto state = std::make_shared<State>();
+        state->work = &work;
+        state->count = count;
+
+        for (std::size_t lane = 1; lane < lanes && lane < count; lane++)
+        {
+            Scheduler::Shared().Submit([state, lane]
+            {
+                {
+                    std::lock_guard lock(state->mutex);
+                    if (state->closed)
+                        return;
+                    state->running++;
+                }
+
+                RunLane(*state, lane);
+
+                std::lock_guard lock(state->mutex);
+                if (--state->running == 0)
+                    state->idle.notify_all();
+            });
+        }
+
+        RunLane(*state, 0);
+
+        std::unique_lock lock(state->mutex);
+        state->closed = true;
+        state->idle.wait(lock, [&] { return state->running == 0; });
+        if (state->error != nullptr)
+            std::rethrow_exception(state->error);
+    }
+}
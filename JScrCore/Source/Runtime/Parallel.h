@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+namespace JScr::Runtime::Parallel
+{
+    // Runs `work(index, lane)` for every index below `count` on up to `lanes` threads of the shared
+    // Scheduler and returns once all are done. The calling thread takes part as lane 0 and every lane
+    // runs one index at a time, so per lane state needs no locking. Lanes whose job the pool only
+    // starts after the calling thread ran out of indices drop out, which keeps a call from a job of
+    // the pool itself from waiting on workers that are all busy. The first exception thrown by `work`
+    // skips the indices not started yet and is rethrown here.
+    void For(std::size_t count, std::size_t lanes, const std::function<void(std::size_t index, std::size_t lane)>& work);
+}
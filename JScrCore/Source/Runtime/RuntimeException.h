@@ -0,0 +1,24 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+
+namespace JScr::Runtime
+{
+    class RuntimeException : public std::exception
+    {
+    public:
+        RuntimeException(const std::string& description) : m_description(description) {}
+
+    public:
+        const std::string& Description() const { return m_description; }
+
+        const char* what() const noexcept override { return m_description.c_str(); }
+
+        std::string ToString() const
+        {
+            return "Runtime error: \"" + Description() + "\"";
+        }
+    private:
+        std::string m_description;
+    };
+}
@@ -0,0 +1,128 @@
+#include "Scheduler.h"
+#include <algorithm>
+
+namespace JScr::Runtime
+{
+    namespace
+    {
+        std::atomic<std::size_t> s_sharedWorkers = 0;
+
+        // The worker running on this thread, if any, so jobs it submits stay in its own deque.
+        thread_local const Scheduler* t_scheduler = nullptr;
+        thread_local std::size_t t_worker = 0;
+    }
+
+    Scheduler::Scheduler(std::size_t workers)
+    {
+        if (workers == 0)
+            workers = std::max(1u, std::thread::hardware_concurrency());
+
+        for (std::size_t i = 0; i < workers; i++)
+            m_workers.push_back(std::make_unique<Worker>());
+        for (std::size_t i = 0; i < workers; i++)
+            m_workers[i]->thread = std::thread([this, i] { Run(i); });
+    }
+
+    Scheduler::~Scheduler()
+    {
+        {
+            std::lock_guard lock(m_sleepMutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+
+        for (auto& worker : m_workers)
+            worker->thread.join();
+    }
+
+    Scheduler& Scheduler::Shared()
+    {
+        static Scheduler shared{ s_sharedWorkers.load() };
+        return shared;
+    }
+
+    void Scheduler::SetSharedWorkerCount(std::size_t workers)
+    {
+        s_sharedWorkers = workers;
+    }
+
+    void Scheduler::Submit(Job job)
+    {
+        Push(std::move(job), false);
+    }
+
+    void Scheduler::Yield(Job job)
+    {
+        Push(std::move(job), true);
+    }
+
+    // The owner takes from the back, so the front is where a job waits longest on its own worker.
+    void Scheduler::Push(Job job, bool last)
+    {
+        std::size_t index = t_scheduler == this ? t_worker : m_next.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+        {
+            std::lock_guard lock(m_workers[index]->mutex);
+            if (last)
+                m_workers[index]->jobs.push_front(std::move(job));
+            else
+                m_workers[index]->jobs.push_back(std::move(job));
+        }
+
+        {
+            std::lock_guard lock(m_sleepMutex);
+            m_pending++;
+        }
+        m_wake.notify_one();
+    }
+
+    void Scheduler::Run(std::size_t index)
+    {
+        t_scheduler = this;
+        t_worker = index;
+
+        Job job;
+        for (;;)
+        {
+            if (Take(index, job))
+            {
+                m_pending--;
+                job();
+                job = nullptr;
+                continue;
+            }
+
+            std::unique_lock lock(m_sleepMutex);
+            m_wake.wait(lock, [&] { return m_pending > 0 || m_stopping; });
+            // Whatever was queued before stopping still runs.
+            if (m_stopping && m_pending == 0)
+                return;
+        }
+    }
+
+    bool Scheduler::Take(std::size_t index, Job& job)
+    {
+        {
+            Worker& own = *m_workers[index];
+            std::lock_guard lock(own.mutex);
+            if (!own.jobs.empty())
+            {
+                job = std::move(own.jobs.back());
+                own.jobs.pop_back();
+                return true;
+            }
+        }
+
+        for (std::size_t offset = 1; offset < m_workers.size(); offset++)
+        {
+            Worker& victim = *m_workers[(index + offset) % m_workers.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.jobs.empty())
+            {
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace JScr::Runtime
+{
+    // Engine wide pool of worker threads that Script::Execute hands its runs to, one worker per core
+    // unless configured otherwise. Every worker owns a deque: it pushes and pops its own jobs at the
+    // back, and a worker that runs dry steals from the front of another one's. Jobs submitted from
+    // outside the pool are dealt out round robin.
+    class Scheduler
+    {
+    public:
+        // Reports its own errors; an exception escaping a job ends the process.
+        using Job = std::function<void()>;
+
+        // 0 starts one worker per hardware thread.
+        explicit Scheduler(std::size_t workers = 0);
+        // Runs every job still queued, then joins the workers.
+        ~Scheduler();
+
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        // The pool every script runs on, started on first use.
+        static Scheduler& Shared();
+        // The number of workers Shared() starts with. Has no effect once it is running.
+        static void SetSharedWorkerCount(std::size_t workers);
+
+        void Submit(Job job);
+        // Queues `job` behind everything else waiting on the calling worker, for jobs that gave their
+        // worker back so others get a turn first.
+        void Yield(Job job);
+        std::size_t WorkerCount() const { return m_workers.size(); }
+
+    private:
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+            std::thread thread;
+        };
+
+        void Push(Job job, bool last);
+        void Run(std::size_t index);
+        // The newest job of worker `index`, or else the oldest one of any other worker.
+        bool Take(std::size_t index, Job& job);
+
+    private:
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::atomic<std::size_t> m_next = 0;
+
+        // Jobs queued and not taken yet. Only raised while holding m_sleepMutex, so a worker checking
+        // it before going to sleep cannot miss the notification.
+        std::atomic<std::size_t> m_pending = 0;
+        std::mutex m_sleepMutex;
+        std::condition_variable m_wake;
+        bool m_stopping = false;
+    };
+}
@@ -0,0 +1,92 @@
+#include "Shape.h"
+#include "Bytecode.h"
+
+namespace JScr::Runtime
+{
+    const Shape* ShapeTable::Declare(const ObjectType& type)
+    {
+        Shape* shape = Create(&type);
+        for (std::size_t i = 0; i < type.propertyNames.size(); i++)
+        {
+            const auto& propertyType = type.propertyTypes[i];
+            std::uint8_t conversion = Shape::NoConversion;
+            Value initial = Value::Null();
+
+            if (propertyType.has_value() && propertyType->LambdaTypes().empty())
+            {
+                conversion = Conversion::For(propertyType).value_or(Shape::NoConversion);
+                switch ((Types::Uid) propertyType->Uid())
+                {
+                case Types::Uid::Bool:   initial = Value::Bool(false); break;
+                case Types::Uid::Int:    initial = Value::Int(0); break;
+                case Types::Uid::Float:  initial = Value::Float(0.0f); break;
+                case Types::Uid::Double: initial = Value::Double(0.0); break;
+                case Types::Uid::Char:   initial = Value::Char('\0'); break;
+                default: break;
+                }
+            }
+
+            shape->AddSlot(type.propertyNames[i], conversion, initial);
+        }
+
+        static constexpr std::uint32_t sizes[] = { 8, 1, 1, 4, 4, 8 };
+        shape->m_layout.resize(shape->SlotCount());
+        for (std::size_t i = 0; i < shape->SlotCount(); i++)
+        {
+            FieldKind kind = FieldKind::Value;
+            switch (shape->m_defaults[i].Type())
+            {
+            case ValueType::Bool:   kind = FieldKind::Bool; break;
+            case ValueType::Char:   kind = FieldKind::Char; break;
+            case ValueType::Int:    kind = FieldKind::Int; break;
+            case ValueType::Float:  kind = FieldKind::Float; break;
+            case ValueType::Double: kind = FieldKind::Double; break;
+            default: break;
+            }
+            shape->m_layout[i].kind = kind;
+        }
+
+        // Widest fields first so nothing needs padding; the slot order stays the declared one.
+        std::uint32_t offset = 0;
+        for (std::uint32_t size : { 8u, 4u, 1u })
+        {
+            for (auto& field : shape->m_layout)
+            {
+                if (sizes[(int) field.kind] != size)
+                    continue;
+                field.offset = offset;
+                offset += size;
+            }
+        }
+
+        shape->m_template.resize((offset + 7) & ~7u);
+        for (std::size_t i = 0; i < shape->SlotCount(); i++)
+        {
+            bool hasConstant = i < type.propertyDefaults.size() && type.propertyDefaults[i].has_value();
+            shape->m_layout[i].Store(shape->m_template.data(), hasConstant ? type.propertyDefaults[i].value() : shape->m_defaults[i]);
+        }
+        return shape;
+    }
+
+    const Shape* ShapeTable::AddProperty(const Shape* shape, const std::string& name)
+    {
+        Shape* parent = const_cast<Shape*>(shape);
+        auto it = parent->m_transitions.find(name);
+        if (it != parent->m_transitions.end())
+            return it->second;
+
+        Shape* child = Create(nullptr);
+        for (std::size_t i = 0; i < parent->SlotCount(); i++)
+            child->AddSlot(parent->m_names[i], Shape::NoConversion, Value::Null());
+        child->AddSlot(name, Shape::NoConversion, Value::Null());
+
+        parent->m_transitions.emplace(name, child);
+        return child;
+    }
+
+    Shape* ShapeTable::Create(const ObjectType* type)
+    {
+        m_shapes.push_back(std::unique_ptr<Shape>(new Shape(type)));
+        return m_shapes.back().get();
+    }
+}
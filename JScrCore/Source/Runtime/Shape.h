@@ -0,0 +1,170 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "String.h"
+#include "Value.h"
+
+namespace JScr::Runtime
+{
+    struct ObjectType;
+
+    // How a property of a declared object type is stored inside a StructObject.
+    enum class FieldKind : std::uint8_t
+    {
+        Value, Bool, Char, Int, Float, Double
+    };
+
+    struct FieldLayout
+    {
+        std::uint32_t offset;
+        FieldKind kind;
+
+        Value Load(const unsigned char* data) const
+        {
+            const unsigned char* at = data + offset;
+            switch (kind)
+            {
+            case FieldKind::Bool:   return Value::Bool(*at != 0);
+            case FieldKind::Char:   return Value::Char((char) *at);
+            case FieldKind::Int:    { std::int32_t v; std::memcpy(&v, at, sizeof(v)); return Value::Int(v); }
+            case FieldKind::Float:  { float v; std::memcpy(&v, at, sizeof(v)); return Value::Float(v); }
+            case FieldKind::Double: { double v; std::memcpy(&v, at, sizeof(v)); return Value::Double(v); }
+            default:                { std::uint64_t v; std::memcpy(&v, at, sizeof(v)); return Value::FromBits(v); }
+            }
+        }
+
+        // The value must already be converted to the field's type.
+        void Store(unsigned char* data, const Value& value) const
+        {
+            unsigned char* at = data + offset;
+            switch (kind)
+            {
+            case FieldKind::Bool:   *at = value.AsBool() ? 1 : 0; break;
+            case FieldKind::Char:   *at = (unsigned char) value.AsChar(); break;
+            case FieldKind::Int:    { std::int32_t v = value.AsInt(); std::memcpy(at, &v, sizeof(v)); break; }
+            case FieldKind::Float:  { float v = value.AsFloat(); std::memcpy(at, &v, sizeof(v)); break; }
+            case FieldKind::Double: { double v = value.AsDouble(); std::memcpy(at, &v, sizeof(v)); break; }
+            default:                { std::uint64_t v = value.Bits(); std::memcpy(at, &v, sizeof(v)); break; }
+            }
+        }
+    };
+
+    // Hidden class of an instance: maps property names to fixed slot indices. Declared object types get
+    // one complete shape each; anonymous objects walk a transition tree, one step per added property,
+    // so objects built the same way end up sharing a shape.
+    class Shape
+    {
+    public:
+        static constexpr std::uint8_t NoConversion = 0xFF;
+
+        // Null for anonymous objects.
+        const ObjectType* Type() const { return m_type; }
+
+        std::size_t SlotCount() const { return m_names.size(); }
+        const std::string& NameAt(std::size_t slot) const { return m_names[slot]; }
+        // Conversion code (see Conversion in Bytecode.h) applied to assigned values, or NoConversion.
+        std::uint8_t ConversionAt(std::size_t slot) const { return m_conversions[slot]; }
+        // Initial slot values of a new instance.
+        const std::vector<Value>& Defaults() const { return m_defaults; }
+
+        // Declared object types are packed: primitives unboxed at fixed byte offsets, everything else
+        // as a boxed Value. New instances start as a copy of the template block.
+        bool IsPacked() const { return m_type != nullptr; }
+        const FieldLayout& LayoutAt(std::size_t slot) const { return m_layout[slot]; }
+        std::size_t DataSize() const { return m_template.size(); }
+        const unsigned char* Template() const { return m_template.data(); }
+
+        int Find(std::string_view name) const
+        {
+            auto it = m_slots.find(name);
+            return it != m_slots.end() ? (int) it->second : -1;
+        }
+
+    private:
+        friend class ShapeTable;
+
+        Shape(const ObjectType* type) : m_type(type) {}
+
+        void AddSlot(const std::string& name, std::uint8_t conversion, const Value& initial)
+        {
+            m_slots.emplace(name, (std::uint32_t) m_names.size());
+            m_names.push_back(name);
+            m_conversions.push_back(conversion);
+            m_defaults.push_back(initial);
+        }
+
+        const ObjectType* m_type;
+        std::vector<std::string> m_names;
+        std::vector<std::uint8_t> m_conversions;
+        std::vector<Value> m_defaults;
+        std::vector<FieldLayout> m_layout;
+        std::vector<unsigned char> m_template;
+        std::unordered_map<std::string, std::uint32_t, StringHash, std::equal_to<>> m_slots;
+        std::unordered_map<std::string, Shape*> m_transitions;
+    };
+
+    // Owns every shape of one engine instance.
+    class ShapeTable
+    {
+    public:
+        ShapeTable() : m_empty(Create(nullptr)) {}
+        ShapeTable(const ShapeTable&) = delete;
+        ShapeTable& operator=(const ShapeTable&) = delete;
+
+        const Shape* Empty() const { return m_empty; }
+
+        // Builds the complete, packed shape of a declared object type. Primitive properties default to
+        // zero unless the type carries a constant default for them.
+        const Shape* Declare(const ObjectType& type);
+        // The shape reached by adding a property to an anonymous object's shape.
+        const Shape* AddProperty(const Shape* shape, const std::string& name);
+
+    private:
+        Shape* Create(const ObjectType* type);
+
+        std::vector<std::unique_ptr<Shape>> m_shapes;
+        Shape* m_empty;
+    };
+
+    // Per site cache for GETFIELD and SETFIELD. Holds up to Capacity shapes (monomorphic with one entry,
+    // polymorphic above); once full the site is megamorphic and falls back to the shape lookup.
+    struct InlineCache
+    {
+        static constexpr std::size_t Capacity = 4;
+
+        struct Entry
+        {
+            const Shape* shape;
+            std::uint32_t slot;
+            // Only for packed shapes: where the slot lives inside the StructObject.
+            FieldLayout field;
+            // Only for SETFIELD on anonymous objects: the shape after the property got added.
+            const Shape* transition;
+        };
+
+        Entry entries[Capacity];
+        std::uint8_t count = 0;
+
+        const Entry* Find(const Shape* shape) const
+        {
+            for (std::uint8_t i = 0; i < count; i++)
+            {
+                if (entries[i].shape == shape)
+                    return &entries[i];
+            }
+            return nullptr;
+        }
+
+        void Add(const Shape* shape, std::uint32_t slot, const Shape* transition = nullptr)
+        {
+            if (count < Capacity)
+                entries[count++] = Entry{ shape, slot, shape->IsPacked() ? shape->LayoutAt(slot) : FieldLayout{ 0, FieldKind::Value }, transition };
+        }
+    };
+}
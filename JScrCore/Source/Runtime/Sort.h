@@ -0,0 +1,261 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <utility>
+
+namespace JScr::Runtime::Sorting
+{
+    // Pattern-defeating quicksort: quicksort with a median of three (ninther on large ranges) pivot,
+    // insertion sort on small ranges, a check for ranges a partition left already sorted, a separate
+    // partition for runs of equal elements, and heapsort once too many partitions come out lopsided,
+    // so it is O(n log n) on every input and O(n) on sorted and reversed ones. Not stable.
+    //
+    // `less` may be a script function, so it can be inconsistent or throw. Every loop checks its bounds
+    // instead of relying on the order being a strict weak one: a bad comparator gives a scrambled
+    // result but never reads or writes outside the range. If `less` throws, the range holds its
+    // original elements only when T is cheap to copy; callers sorting anything else sort indices.
+
+    constexpr std::size_t InsertionThreshold = 24;
+    constexpr std::size_t NintherThreshold = 128;
+    // Moves a partial insertion sort makes before deciding the range is not nearly sorted after all.
+    constexpr std::size_t PartialInsertionLimit = 8;
+
+    template <typename T, typename Less>
+    void InsertionSort(T* begin, T* end, Less& less)
+    {
+        if (begin == end)
+            return;
+
+        for (T* current = begin + 1; current != end; current++)
+        {
+            T* sift = current;
+            if (!less(*sift, *(sift - 1)))
+                continue;
+
+            T moved = std::move(*sift);
+            do
+            {
+                *sift = std::move(*(sift - 1));
+                sift--;
+            } while (sift != begin && less(moved, *(sift - 1)));
+            *sift = std::move(moved);
+        }
+    }
+
+    // Insertion sort that gives up once it had to move too much. Returns whether the range is sorted.
+    template <typename T, typename Less>
+    bool PartialInsertionSort(T* begin, T* end, Less& less)
+    {
+        if (begin == end)
+            return true;
+
+        std::size_t moves = 0;
+        for (T* current = begin + 1; current != end; current++)
+        {
+            T* sift = current;
+            if (!less(*sift, *(sift - 1)))
+                continue;
+
+            T moved = std::move(*sift);
+            do
+            {
+                *sift = std::move(*(sift - 1));
+                sift--;
+            } while (sift != begin && less(moved, *(sift - 1)));
+            *sift = std::move(moved);
+
+            moves += current - sift;
+            if (moves > PartialInsertionLimit)
+                return false;
+        }
+        return true;
+    }
+
+    template <typename T, typename Less>
+    void Sort2(T* a, T* b, Less& less)
+    {
+        if (less(*b, *a))
+            std::swap(*a, *b);
+    }
+
+    template <typename T, typename Less>
+    void Sort3(T* a, T* b, T* c, Less& less)
+    {
+        Sort2(a, b, less);
+        Sort2(b, c, less);
+        Sort2(a, b, less);
+    }
+
+    template <typename T, typename Less>
+    void SiftDown(T* heap, std::size_t size, std::size_t at, Less& less)
+    {
+        for (;;)
+        {
+            std::size_t child = 2 * at + 1;
+            if (child >= size)
+                return;
+            if (child + 1 < size && less(heap[child], heap[child + 1]))
+                child++;
+            if (!less(heap[at], heap[child]))
+                return;
+            std::swap(heap[at], heap[child]);
+            at = child;
+        }
+    }
+
+    template <typename T, typename Less>
+    void HeapSort(T* begin, T* end, Less& less)
+    {
+        std::size_t size = end - begin;
+        for (std::size_t i = size / 2; i-- > 0;)
+            SiftDown(begin, size, i, less);
+        for (std::size_t last = size; last-- > 1;)
+        {
+            std::swap(begin[0], begin[last]);
+            SiftDown(begin, last, 0, less);
+        }
+    }
+
+    // Partitions around the pivot in *begin, elements equal to it going right. Returns where the pivot
+    // ended up and whether no element had to be swapped.
+    template <typename T, typename Less>
+    std::pair<T*, bool> PartitionRight(T* begin, T* end, Less& less)
+    {
+        T pivot = std::move(*begin);
+        T* first = begin + 1;
+        T* last = end;
+        while (first < last && less(*first, pivot))
+            first++;
+        while (last > first && !less(*(last - 1), pivot))
+            last--;
+
+        bool partitioned = first >= last;
+        while (first < last)
+        {
+            std::swap(*first, *(last - 1));
+            first++;
+            last--;
+            while (first < last && less(*first, pivot))
+                first++;
+            while (last > first && !less(*(last - 1), pivot))
+                last--;
+        }
+
+        T* position = first - 1;
+        *begin = std::move(*position);
+        *position = std::move(pivot);
+        return { position, partitioned };
+    }
+
+    // Partitions around the pivot in *begin, elements equal to it going left. Used when the pivot
+    // equals the element before the range, so everything equal to it is in place afterwards.
+    template <typename T, typename Less>
+    T* PartitionLeft(T* begin, T* end, Less& less)
+    {
+        T pivot = std::move(*begin);
+        T* first = begin + 1;
+        T* last = end;
+        while (last > first && less(pivot, *(last - 1)))
+            last--;
+        while (first < last && !less(pivot, *first))
+            first++;
+
+        while (first < last)
+        {
+            std::swap(*first, *(last - 1));
+            first++;
+            last--;
+            while (last > first && less(pivot, *(last - 1)))
+                last--;
+            while (first < last && !less(pivot, *first))
+                first++;
+        }
+
+        T* position = first - 1;
+        *begin = std::move(*position);
+        *position = std::move(pivot);
+        return position;
+    }
+
+    // Swaps a few elements around a lopsided partition to break up the pattern that caused it.
+    template <typename T>
+    void Shuffle(T* begin, T* end)
+    {
+        std::size_t size = end - begin;
+        if (size < InsertionThreshold)
+            return;
+
+        std::size_t quarter = size / 4;
+        std::swap(begin[0], begin[quarter]);
+        std::swap(end[-1], end[-(std::ptrdiff_t) quarter]);
+        if (size > NintherThreshold)
+        {
+            std::swap(begin[1], begin[quarter + 1]);
+            std::swap(begin[2], begin[quarter + 2]);
+            std::swap(end[-2], end[-(std::ptrdiff_t) quarter - 1]);
+            std::swap(end[-3], end[-(std::ptrdiff_t) quarter - 2]);
+        }
+    }
+
+    // `leftmost` is false when the element before the range exists and is not greater than any in it.
+    template <typename T, typename Less>
+    void SortLoop(T* begin, T* end, Less& less, int badAllowed, bool leftmost)
+    {
+        for (;;)
+        {
+            std::size_t size = end - begin;
+            if (size < InsertionThreshold)
+            {
+                InsertionSort(begin, end, less);
+                return;
+            }
+
+            // Moves the pivot to *begin.
+            std::size_t half = size / 2;
+            if (size > NintherThreshold)
+            {
+                Sort3(begin, begin + half, end - 1, less);
+                Sort3(begin + 1, begin + (half - 1), end - 2, less);
+                Sort3(begin + 2, begin + (half + 1), end - 3, less);
+                Sort3(begin + (half - 1), begin + half, begin + (half + 1), less);
+                std::swap(*begin, *(begin + half));
+            }
+            else
+                Sort3(begin + half, begin, end - 1, less);
+
+            if (!leftmost && !less(*(begin - 1), *begin))
+            {
+                begin = PartitionLeft(begin, end, less) + 1;
+                continue;
+            }
+
+            auto [pivot, partitioned] = PartitionRight(begin, end, less);
+            std::size_t left = pivot - begin;
+            std::size_t right = end - (pivot + 1);
+            if (left < size / 8 || right < size / 8)
+            {
+                if (--badAllowed == 0)
+                {
+                    HeapSort(begin, end, less);
+                    return;
+                }
+                Shuffle(begin, pivot);
+                Shuffle(pivot + 1, end);
+            }
+            else if (partitioned && PartialInsertionSort(begin, pivot, less) && PartialInsertionSort(pivot + 1, end, less))
+                return;
+
+            SortLoop(begin, pivot, less, badAllowed, leftmost);
+            begin = pivot + 1;
+            leftmost = false;
+        }
+    }
+
+    template <typename T, typename Less>
+    void Sort(T* begin, T* end, Less less)
+    {
+        std::size_t size = end - begin;
+        if (size > 1)
+            SortLoop(begin, end, less, (int) std::bit_width(size), true);
+    }
+}
@@ -0,0 +1,1208 @@
+#include "StandardLibrary.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include "Collections.h"
+#include "Kernels.h"
+#include "Parallel.h"
+#include "RuntimeException.h"
+#include "Scheduler.h"
+#include "Sort.h"
+#include "VM.h"
+
+namespace JScr::Runtime
+{
+    // ----- Typed arrays -----
+
+    static TypedArrayObject* ExpectTypedArray(const char* function, const Value* args, int index)
+    {
+        const Value& value = args[index];
+        if (!value.IsObject() || value.AsObject()->Kind() != ObjectKind::TypedArray)
+            throw RuntimeException("Function '" + std::string(function) + "' expects a typed array as argument " + std::to_string(index + 1) + ", got '" + VM::TypeName(value) + "'.");
+        return static_cast<TypedArrayObject*>(value.AsObject());
+    }
+
+    // An array the function writes to.
+    static TypedArrayObject* ExpectWritable(const char* function, const Value* args, int index)
+    {
+        TypedArrayObject* array = ExpectTypedArray(function, args, index);
+        if (array->IsReadOnly())
+            throw RuntimeException("Function '" + std::string(function) + "' cannot write to the read-only '" + VM::TypeName(args[index]) + "' given as argument " + std::to_string(index + 1) + ".");
+        return array;
+    }
+
+    // The arrays a kernel combines must agree on element type and length.
+    static void ExpectMatching(const char* function, const TypedArrayObject* a, const TypedArrayObject* b)
+    {
+        if (a->GetElementType() != b->GetElementType())
+        {
+            throw RuntimeException("Function '" + std::string(function) + "' cannot combine '" + TypedArrayObject::ElementName(a->GetElementType())
+                + "[]' with '" + TypedArrayObject::ElementName(b->GetElementType()) + "[]'.");
+        }
+        if (a->Length() != b->Length())
+            throw RuntimeException("Function '" + std::string(function) + "' expects arrays of equal length, got " + std::to_string(a->Length()) + " and " + std::to_string(b->Length()) + ".");
+    }
+
+    // Calls f with the array's data pointer typed after its element type.
+    template <typename F>
+    static auto VisitElements(TypedArrayObject* array, F&& f)
+    {
+        switch (array->GetElementType())
+        {
+        case ElementType::Int:    return f(array->Data<std::int32_t>());
+        case ElementType::Float:  return f(array->Data<float>());
+        case ElementType::Double: return f(array->Data<double>());
+        default:                  return f(array->Data<char>());
+        }
+    }
+
+    static Value Box(std::int32_t value) { return Value::Int(value); }
+    static Value Box(float value)        { return Value::Float(value); }
+    static Value Box(double value)       { return Value::Double(value); }
+    static Value Box(char value)         { return Value::Char(value); }
+
+    template <typename T>
+    static T Unbox(const char* function, const Value& value)
+    {
+        bool valid = std::is_same_v<T, char> ? value.IsInt() || value.IsChar() : value.IsNumber();
+        if (!valid)
+            throw RuntimeException("Function '" + std::string(function) + "' cannot store '" + VM::TypeName(value) + "' in a typed array.");
+
+        if constexpr (std::is_same_v<T, std::int32_t>) return value.ToInt();
+        else if constexpr (std::is_same_v<T, float>)   return (float) value.ToDouble();
+        else if constexpr (std::is_same_v<T, double>)  return value.ToDouble();
+        else                                           return value.IsChar() ? value.AsChar() : (char) value.AsInt();
+    }
+
+    template <ElementType Type>
+    static Value NewTypedArray(NativeHost& host, Value* args, int, void*)
+    {
+        if (!args[0].IsInt() || args[0].AsInt() < 0)
+            throw RuntimeException("Typed array length must be a non-negative 'int', got '" + VM::ToString(args[0]) + "'.");
+        return Value::Object(host.GetHeap().Allocate<TypedArrayObject>(Type, (std::size_t) args[0].AsInt()));
+    }
+
+    static Value Fill(NativeHost&, Value* args, int, void*)
+    {
+        TypedArrayObject* array = ExpectWritable("fill", args, 0);
+        VisitElements(array, [&](auto* data)
+        {
+            using T = std::remove_pointer_t<decltype(data)>;
+            Kernels::Fill(data, array->Length(), Unbox<T>("fill", args[1]));
+        });
+        return args[0];
+    }
+
+    // Copies all of src to the start of dst.
+    static Value Copy(NativeHost&, Value* args, int, void*)
+    {
+        TypedArrayObject* dst = ExpectWritable("copy", args, 0);
+        TypedArrayObject* src = ExpectTypedArray("copy", args, 1);
+        if (dst->GetElementType() != src->GetElementType())
+            throw RuntimeException("Function 'copy' cannot copy '" + std::string(TypedArrayObject::ElementName(src->GetElementType())) + "[]' into '" + TypedArrayObject::ElementName(dst->GetElementType()) + "[]'.");
+        if (src->Length() > dst->Length())
+            throw RuntimeException("Function 'copy' cannot copy " + std::to_string(src->Length()) + " elements into an array of length " + std::to_string(dst->Length()) + ".");
+
+        Kernels::Copy(dst->Bytes(), src->Bytes(), src->Length() * TypedArrayObject::ElementSize(src->GetElementType()));
+        return args[0];
+    }
+
+    static Value Sum(NativeHost&, Value* args, int, void*)
+    {
+        TypedArrayObject* array = ExpectTypedArray("sum", args, 0);
+        return VisitElements(array, [&](auto* data) { return Box(Kernels::Sum(data, array->Length())); });
+    }
+
+    template <bool IsMax>
+    static Value Extreme(NativeHost&, Value* args, int, void*)
+    {
+        const char* name = IsMax ? "max" : "min";
+        TypedArrayObject* array = ExpectTypedArray(name, args, 0);
+        if (array->Length() == 0)
+            throw RuntimeException("Function '" + std::string(name) + "' expects a non-empty array.");
+
+        return VisitElements(array, [&](auto* data) { return Box(IsMax ? Kernels::Max(data, array->Length()) : Kernels::Min(data, array->Length())); });
+    }
+
+    static Value Dot(NativeHost&, Value* args, int, void*)
+    {
+        TypedArrayObject* a = ExpectTypedArray("dot", args, 0);
+        TypedArrayObject* b = ExpectTypedArray("dot", args, 1);
+        ExpectMatching("dot", a, b);
+
+        return VisitElements(a, [&](auto* data)
+        {
+            using T = std::remove_pointer_t<decltype(data)>;
+            return Box(Kernels::Dot(data, b->Data<T>(), a->Length()));
+        });
+    }
+
+    // dst = a op b, element by element. Returns dst.
+    template <Kernels::Op Op>
+    static Value Apply(NativeHost&, Value* args, int, void*)
+    {
+        static constexpr const char* names[] = { "add", "sub", "mul", "div" };
+        const char* name = names[(int) Op];
+        TypedArrayObject* dst = ExpectWritable(name, args, 0);
+        TypedArrayObject* a = ExpectTypedArray(name, args, 1);
+        TypedArrayObject* b = ExpectTypedArray(name, args, 2);
+        ExpectMatching(name, dst, a);
+        ExpectMatching(name, a, b);
+
+        VisitElements(dst, [&](auto* data)
+        {
+            using T = std::remove_pointer_t<decltype(data)>;
+            const T* right = b->Data<T>();
+            if constexpr (Op == Kernels::Op::Div && (std::is_same_v<T, std::int32_t> || std::is_same_v<T, char>))
+            {
+                for (std::size_t i = 0; i < b->Length(); i++)
+                {
+                    if (right[i] == 0)
+                        throw RuntimeException("Integer division by zero.");
+                }
+            }
+            Kernels::Apply(Op, data, a->Data<T>(), right, dst->Length());
+        });
+        return args[0];
+    }
+
+    // ----- std.collections -----
+
+    static void ExpectArgumentCount(const char* function, int argc, int min, int max)
+    {
+        if (argc < min || argc > max)
+            throw RuntimeException("Function '" + std::string(function) + "' expects " + std::to_string(min) + " or " + std::to_string(max) + " argument(s) but got " + std::to_string(argc) + ".");
+    }
+
+    // The object in args[index] when it is one of `kinds`; `expected` names them for the error.
+    static HeapObject* ExpectKind(const char* function, const Value* args, int index, std::initializer_list<ObjectKind> kinds, const char* expected)
+    {
+        const Value& value = args[index];
+        if (value.IsObject())
+        {
+            for (ObjectKind kind : kinds)
+            {
+                if (value.AsObject()->Kind() == kind)
+                    return value.AsObject();
+            }
+        }
+        throw RuntimeException("Function '" + std::string(function) + "' expects " + expected + " as argument " + std::to_string(index + 1) + ", got '" + VM::TypeName(value) + "'.");
+    }
+
+    // Callbacks go back through NativeHost::Call, so the interpreter's functions qualify too.
+    static Value ExpectFunction(const char* function, const Value* args, int index)
+    {
+        ExpectKind(function, args, index, { ObjectKind::Closure, ObjectKind::Native, ObjectKind::AstFunction }, "a function");
+        return args[index];
+    }
+
+    static HashTableObject* ExpectMap(const char* function, const Value* args, int index)
+    {
+        return static_cast<HashTableObject*>(ExpectKind(function, args, index, { ObjectKind::Map }, "a map"));
+    }
+
+    static HashTableObject* ExpectSet(const char* function, const Value* args, int index)
+    {
+        return static_cast<HashTableObject*>(ExpectKind(function, args, index, { ObjectKind::Set }, "a set"));
+    }
+
+    static HashTableObject* ExpectHashTable(const char* function, const Value* args, int index)
+    {
+        return static_cast<HashTableObject*>(ExpectKind(function, args, index, { ObjectKind::Map, ObjectKind::Set }, "a map or set"));
+    }
+
+    static DequeObject* ExpectDeque(const char* function, const Value* args, int index)
+    {
+        return static_cast<DequeObject*>(ExpectKind(function, args, index, { ObjectKind::Deque }, "a deque"));
+    }
+
+    static ArrayObject* ExpectArray(const char* function, const Value* args, int index)
+    {
+        return static_cast<ArrayObject*>(ExpectKind(function, args, index, { ObjectKind::Array }, "an array"));
+    }
+
+    static std::size_t ExpectIndex(const char* function, const Value& index, std::size_t length, const char* type)
+    {
+        if (!index.IsInt())
+            throw RuntimeException("Function '" + std::string(function) + "' expects an 'int' index, got '" + VM::TypeName(index) + "'.");
+        if (index.AsInt() < 0 || (std::size_t) index.AsInt() >= length)
+            throw RuntimeException("Index " + std::to_string(index.AsInt()) + " is out of bounds for " + type + " of length " + std::to_string(length) + ".");
+        return (std::size_t) index.AsInt();
+    }
+
+    static void ExpectNotEmpty(const char* function, const Value& collection, std::size_t size)
+    {
+        if (size == 0)
+            throw RuntimeException("Function '" + std::string(function) + "' cannot take from an empty '" + VM::TypeName(collection) + "'.");
+    }
+
+    template <ObjectKind Kind>
+    static Value NewHashTable(NativeHost& host, Value*, int, void*)
+    {
+        return Value::Object(host.GetHeap().Allocate<HashTableObject>(Kind));
+    }
+
+    static Value NewDeque(NativeHost& host, Value*, int, void*)
+    {
+        return Value::Object(host.GetHeap().Allocate<DequeObject>());
+    }
+
+    // priorityQueue() or priorityQueue(less).
+    static Value NewPriorityQueue(NativeHost& host, Value* args, int argc, void*)
+    {
+        if (argc > 1)
+            throw RuntimeException("Function 'priorityQueue' expects 0 or 1 argument(s) but got " + std::to_string(argc) + ".");
+        Value less = argc == 1 ? ExpectFunction("priorityQueue", args, 0) : Value::Null();
+        return Value::Object(host.GetHeap().Allocate<PriorityQueueObject>(less));
+    }
+
+    static Value Size(NativeHost&, Value* args, int, void*)
+    {
+        HeapObject* object = ExpectKind("size", args, 0, { ObjectKind::Array, ObjectKind::TypedArray, ObjectKind::String, ObjectKind::Map, ObjectKind::Set,
+            ObjectKind::Deque, ObjectKind::PriorityQueue }, "a collection");
+        switch (object->Kind())
+        {
+        case ObjectKind::Array:      return Value::Int((std::int32_t) static_cast<ArrayObject*>(object)->Items().size());
+        case ObjectKind::TypedArray: return Value::Int((std::int32_t) static_cast<TypedArrayObject*>(object)->Length());
+        case ObjectKind::String:     return Value::Int((std::int32_t) static_cast<StringObject*>(object)->Length());
+        case ObjectKind::Deque:      return Value::Int((std::int32_t) static_cast<DequeObject*>(object)->Size());
+        case ObjectKind::PriorityQueue: return Value::Int((std::int32_t) static_cast<PriorityQueueObject*>(object)->Size());
+        default:                     return Value::Int((std::int32_t) static_cast<HashTableObject*>(object)->Size());
+        }
+    }
+
+    static Value Clear(NativeHost&, Value* args, int, void*)
+    {
+        HeapObject* object = ExpectKind("clear", args, 0, { ObjectKind::Array, ObjectKind::Map, ObjectKind::Set, ObjectKind::Deque, ObjectKind::PriorityQueue }, "a collection");
+        switch (object->Kind())
+        {
+        case ObjectKind::Array:         static_cast<ArrayObject*>(object)->Items().clear(); break;
+        case ObjectKind::Deque:         static_cast<DequeObject*>(object)->Clear(); break;
+        case ObjectKind::PriorityQueue: static_cast<PriorityQueueObject*>(object)->Clear(); break;
+        default:                        static_cast<HashTableObject*>(object)->Clear(); break;
+        }
+        return args[0];
+    }
+
+    // The value of a key, null when the map does not have it.
+    static Value Get(NativeHost&, Value* args, int, void*)
+    {
+        const Value* value = ExpectMap("get", args, 0)->Find(args[1]);
+        return value != nullptr ? *value : Value::Null();
+    }
+
+    static Value GetOr(NativeHost&, Value* args, int, void*)
+    {
+        const Value* value = ExpectMap("getOr", args, 0)->Find(args[1]);
+        return value != nullptr ? *value : args[2];
+    }
+
+    static Value Put(NativeHost& host, Value* args, int, void*)
+    {
+        HashTableObject* map = ExpectMap("put", args, 0);
+        map->Insert(args[1], args[2]);
+        host.GetHeap().WriteBarrier(map, args[1]);
+        host.GetHeap().WriteBarrier(map, args[2]);
+        return args[0];
+    }
+
+    // Whether the key was new to the set.
+    static Value Insert(NativeHost& host, Value* args, int, void*)
+    {
+        HashTableObject* set = ExpectSet("insert", args, 0);
+        bool added = set->Insert(args[1]);
+        host.GetHeap().WriteBarrier(set, args[1]);
+        return Value::Bool(added);
+    }
+
+    static Value Has(NativeHost&, Value* args, int, void*)
+    {
+        return Value::Bool(ExpectHashTable("has", args, 0)->Find(args[1]) != nullptr);
+    }
+
+    // Whether the key was there.
+    static Value Remove(NativeHost&, Value* args, int, void*)
+    {
+        return Value::Bool(ExpectHashTable("remove", args, 0)->Erase(args[1]));
+    }
+
+    template <bool Keys>
+    static Value Entries(NativeHost& host, Value* args, int, void*)
+    {
+        HashTableObject* table = Keys ? ExpectHashTable("keys", args, 0) : ExpectMap("values", args, 0);
+        std::vector<Value> items;
+        items.reserve(table->Size());
+        table->ForEach([&](const Value& key, const Value& value) { items.push_back(Keys ? key : value); });
+        return Value::Object(host.GetHeap().Allocate<ArrayObject>(std::move(items)));
+    }
+
+    // Arrays are the growable vector: push and pop work at their end, in amortized constant time.
+    static Value Push(NativeHost& host, Value* args, int, void*)
+    {
+        HeapObject* object = ExpectKind("push", args, 0, { ObjectKind::Array, ObjectKind::Deque, ObjectKind::PriorityQueue }, "an array, deque or priority queue");
+        switch (object->Kind())
+        {
+        case ObjectKind::Array:
+            static_cast<ArrayObject*>(object)->Items().push_back(args[1]);
+            host.GetHeap().WriteBarrier(object, args[1]);
+            break;
+        case ObjectKind::Deque:
+            static_cast<DequeObject*>(object)->PushBack(args[1]);
+            host.GetHeap().WriteBarrier(object, args[1]);
+            break;
+        default:
+            static_cast<PriorityQueueObject*>(object)->Push(host, args[1]);
+            break;
+        }
+        return args[0];
+    }
+
+    // Takes the last item of an array or deque, or the least of a priority queue.
+    static Value Pop(NativeHost& host, Value* args, int, void*)
+    {
+        HeapObject* object = ExpectKind("pop", args, 0, { ObjectKind::Array, ObjectKind::Deque, ObjectKind::PriorityQueue }, "an array, deque or priority queue");
+        switch (object->Kind())
+        {
+        case ObjectKind::Array:
+        {
+            auto& items = static_cast<ArrayObject*>(object)->Items();
+            ExpectNotEmpty("pop", args[0], items.size());
+            Value last = items.back();
+            items.pop_back();
+            return last;
+        }
+        case ObjectKind::Deque:
+            ExpectNotEmpty("pop", args[0], static_cast<DequeObject*>(object)->Size());
+            return static_cast<DequeObject*>(object)->PopBack();
+        default:
+            ExpectNotEmpty("pop", args[0], static_cast<PriorityQueueObject*>(object)->Size());
+            return static_cast<PriorityQueueObject*>(object)->Pop(host);
+        }
+    }
+
+    static Value InsertAt(NativeHost& host, Value* args, int, void*)
+    {
+        ArrayObject* array = ExpectArray("insertAt", args, 0);
+        auto& items = array->Items();
+        std::size_t index = ExpectIndex("insertAt", args[1], items.size() + 1, "array");
+        items.insert(items.begin() + index, args[2]);
+        host.GetHeap().WriteBarrier(array, args[2]);
+        return args[0];
+    }
+
+    static Value RemoveAt(NativeHost&, Value* args, int, void*)
+    {
+        auto& items = ExpectArray("removeAt", args, 0)->Items();
+        std::size_t index = ExpectIndex("removeAt", args[1], items.size(), "array");
+        Value removed = items[index];
+        items.erase(items.begin() + index);
+        return removed;
+    }
+
+    static Value Reserve(NativeHost&, Value* args, int, void*)
+    {
+        auto& items = ExpectArray("reserve", args, 0)->Items();
+        if (!args[1].IsInt() || args[1].AsInt() < 0)
+            throw RuntimeException("Function 'reserve' expects a non-negative 'int' capacity, got '" + VM::ToString(args[1]) + "'.");
+        items.reserve((std::size_t) args[1].AsInt());
+        return args[0];
+    }
+
+    template <bool Front>
+    static Value DequePush(NativeHost& host, Value* args, int, void*)
+    {
+        DequeObject* deque = ExpectDeque(Front ? "pushFront" : "pushBack", args, 0);
+        if (Front)
+            deque->PushFront(args[1]);
+        else
+            deque->PushBack(args[1]);
+        host.GetHeap().WriteBarrier(deque, args[1]);
+        return args[0];
+    }
+
+    template <bool Front>
+    static Value DequePop(NativeHost&, Value* args, int, void*)
+    {
+        const char* name = Front ? "popFront" : "popBack";
+        DequeObject* deque = ExpectDeque(name, args, 0);
+        ExpectNotEmpty(name, args[0], deque->Size());
+        return Front ? deque->PopFront() : deque->PopBack();
+    }
+
+    template <bool Front>
+    static Value DequePeek(NativeHost&, Value* args, int, void*)
+    {
+        const char* name = Front ? "front" : "back";
+        DequeObject* deque = ExpectDeque(name, args, 0);
+        ExpectNotEmpty(name, args[0], deque->Size());
+        return deque->At(Front ? 0 : deque->Size() - 1);
+    }
+
+    static Value At(NativeHost&, Value* args, int, void*)
+    {
+        DequeObject* deque = ExpectDeque("at", args, 0);
+        return deque->At(ExpectIndex("at", args[1], deque->Size(), "deque"));
+    }
+
+    static Value Peek(NativeHost&, Value* args, int, void*)
+    {
+        auto* queue = static_cast<PriorityQueueObject*>(ExpectKind("peek", args, 0, { ObjectKind::PriorityQueue }, "a priority queue"));
+        ExpectNotEmpty("peek", args[0], queue->Size());
+        return queue->Peek();
+    }
+
+    // ----- std.algorithm -----
+
+    // A script comparator `less(a, b)`. One argument vector serves a whole sort or search.
+    class ScriptLess
+    {
+    public:
+        ScriptLess(NativeHost& host, const Value& less) : m_host(host), m_less(less), m_args(2) {}
+
+        bool operator()(const Value& a, const Value& b)
+        {
+            m_args[0] = a;
+            m_args[1] = b;
+            return m_host.Call(m_less, m_args).IsTruthy();
+        }
+    private:
+        NativeHost& m_host;
+        Value m_less;
+        std::vector<Value> m_args;
+    };
+
+    // Orders NaN after every other number, so sorting floating point data still ends up sorted.
+    template <typename T>
+    static bool NumberLess(T a, T b)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            return a < b || (std::isnan(b) && !std::isnan(a));
+        else
+            return a < b;
+    }
+
+    // Without a comparator, the items must all be numbers or all be strings.
+    static void SortValues(std::vector<Value>& items)
+    {
+        bool ints = true, numbers = true, strings = true;
+        for (const Value& item : items)
+        {
+            ints = ints && item.IsInt();
+            numbers = numbers && item.IsNumber();
+            strings = strings && item.IsObject() && item.AsObject()->Kind() == ObjectKind::String;
+            if (!numbers && !strings)
+                DefaultLess(items.front(), item);
+        }
+
+        if (ints)
+            Sorting::Sort(items.data(), items.data() + items.size(), [](const Value& a, const Value& b) { return a.AsInt() < b.AsInt(); });
+        else if (numbers)
+            Sorting::Sort(items.data(), items.data() + items.size(), [](const Value& a, const Value& b) { return NumberLess(a.ToDouble(), b.ToDouble()); });
+        else
+            Sorting::Sort(items.data(), items.data() + items.size(), [](const Value& a, const Value& b) { return DefaultLess(a, b); });
+    }
+
+    // Sorts the positions of `items` with the script comparator, so a comparator that throws or is
+    // inconsistent cannot lose or duplicate items.
+    static std::vector<std::uint32_t> SortOrder(NativeHost& host, const Value& less, const std::vector<Value>& items)
+    {
+        std::vector<std::uint32_t> order(items.size());
+        std::iota(order.begin(), order.end(), 0u);
+        ScriptLess compare(host, less);
+        Sorting::Sort(order.data(), order.data() + order.size(), [&](std::uint32_t a, std::uint32_t b) { return compare(items[a], items[b]); });
+        return order;
+    }
+
+    // What sort does once the arguments are checked, under the name of the function that does it.
+    static Value SortArray(const char* name, NativeHost& host, Value* args, const Value& less)
+    {
+        HeapObject* object = args[0].AsObject();
+        if (object->Kind() == ObjectKind::TypedArray)
+        {
+            TypedArrayObject* array = ExpectWritable(name, args, 0);
+            VisitElements(array, [&](auto* data)
+            {
+                using T = std::remove_pointer_t<decltype(data)>;
+                std::size_t length = array->Length();
+                if (less.IsNull())
+                {
+                    Sorting::Sort(data, data + length, [](T a, T b) { return NumberLess(a, b); });
+                    return;
+                }
+
+                std::vector<Value> boxed(length);
+                for (std::size_t i = 0; i < length; i++)
+                    boxed[i] = Box(data[i]);
+                std::vector<std::uint32_t> order = SortOrder(host, less, boxed);
+                std::vector<T> elements(data, data + length);
+                for (std::size_t i = 0; i < length; i++)
+                    data[i] = elements[order[i]];
+            });
+            return args[0];
+        }
+
+        auto* array = static_cast<ArrayObject*>(object);
+        if (less.IsNull())
+        {
+            SortValues(array->Items());
+            return args[0];
+        }
+
+        // The comparator may run the collector, or change the array, so it orders a rooted copy.
+        Heap& heap = host.GetHeap();
+        Handle scratch(heap, Value::Object(heap.Allocate<ArrayObject>(array->Items())));
+        const auto& items = static_cast<ArrayObject*>(scratch.Get().AsObject())->Items();
+        std::vector<std::uint32_t> order = SortOrder(host, less, items);
+
+        auto& sorted = array->Items();
+        if (sorted.size() != items.size())
+            throw RuntimeException("Function '" + std::string(name) + "' cannot sort an array its comparator changes the length of.");
+        for (std::size_t i = 0; i < sorted.size(); i++)
+        {
+            sorted[i] = items[order[i]];
+            heap.WriteBarrier(array, sorted[i]);
+        }
+        return args[0];
+    }
+
+    // sort(array) or sort(array, less). Sorts in place, not stable, and returns the array.
+    static Value Sort(NativeHost& host, Value* args, int argc, void*)
+    {
+        ExpectArgumentCount("sort", argc, 1, 2);
+        ExpectKind("sort", args, 0, { ObjectKind::Array, ObjectKind::TypedArray }, "an array");
+        Value less = argc == 2 ? ExpectFunction("sort", args, 1) : Value::Null();
+        return SortArray("sort", host, args, less);
+    }
+
+    enum class Search
+    {
+        Find, LowerBound, UpperBound
+    };
+
+    // The item a search looks at. A comparator may shrink an array while the search runs.
+    static Value SearchItem(const char* function, HeapObject* object, std::size_t index)
+    {
+        if (object->Kind() == ObjectKind::TypedArray)
+            return static_cast<TypedArrayObject*>(object)->Get(index);
+
+        const auto& items = static_cast<ArrayObject*>(object)->Items();
+        if (index >= items.size())
+            throw RuntimeException("Function '" + std::string(function) + "' cannot search an array its comparator shrinks.");
+        return items[index];
+    }
+
+    // lowerBound, or upperBound, of a number in a typed array sorted by <. Compares the raw elements
+    // without branching on the result, which random lookups would mispredict half the time.
+    template <Search Mode, typename T>
+    static std::size_t SearchElements(const T* data, std::size_t length, double value)
+    {
+        std::size_t low = 0;
+        while (length > 0)
+        {
+            std::size_t half = length / 2;
+            double item = (double) data[low + half];
+            bool before = Mode == Search::UpperBound ? !(value < item) : item < value;
+            low = before ? low + half + 1 : low;
+            length = before ? length - half - 1 : half;
+        }
+        return low;
+    }
+
+    // Binary search of an array sorted by `less`, or by < without one. binarySearch gives the index of an
+    // item equal to the value, or -(insertion point) - 1 when there is none; lowerBound the first item
+    // not less than the value and upperBound the first greater than it.
+    template <Search Mode>
+    static Value BinarySearch(NativeHost& host, Value* args, int argc, void*)
+    {
+        const char* name = Mode == Search::Find ? "binarySearch" : Mode == Search::LowerBound ? "lowerBound" : "upperBound";
+        ExpectArgumentCount(name, argc, 2, 3);
+        HeapObject* object = ExpectKind(name, args, 0, { ObjectKind::Array, ObjectKind::TypedArray }, "an array");
+        std::size_t length = object->Kind() == ObjectKind::Array ? static_cast<ArrayObject*>(object)->Items().size() : static_cast<TypedArrayObject*>(object)->Length();
+
+        std::optional<ScriptLess> script;
+        if (argc == 3)
+            script.emplace(host, ExpectFunction(name, args, 2));
+        auto less = [&](const Value& a, const Value& b) { return script ? (*script)(a, b) : DefaultLess(a, b); };
+
+        const Value& value = args[1];
+        std::size_t low = 0;
+        if (!script && object->Kind() == ObjectKind::TypedArray && value.IsNumber())
+        {
+            constexpr Search Bound = Mode == Search::UpperBound ? Search::UpperBound : Search::LowerBound;
+            low = VisitElements(static_cast<TypedArrayObject*>(object), [&](auto* data) { return SearchElements<Bound>(data, length, value.ToDouble()); });
+        }
+        else
+        {
+            std::size_t high = length;
+            while (low < high)
+            {
+                std::size_t middle = low + (high - low) / 2;
+                Value item = SearchItem(name, object, middle);
+                bool before = Mode == Search::UpperBound ? !less(value, item) : less(item, value);
+                if (before)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+        }
+
+        if constexpr (Mode == Search::Find)
+        {
+            if (low == length || less(value, SearchItem(name, object, low)))
+                return Value::Int(-(std::int32_t) low - 1);
+        }
+        return Value::Int((std::int32_t) low);
+    }
+
+    // ----- Parallel algorithms -----
+
+    // Elements per piece of work. Arrays of fewer than two pieces stay on the calling thread, where
+    // forking the callback would cost more than it saves.
+    static constexpr std::size_t ParallelGrain = 4096;
+
+    // Thrown by a lane for a result that would not mean the same on the calling thread.
+    struct Unshareable {};
+
+    // Anything but an object of one VM's heap means the same in all VMs of the module.
+    static bool IsShareable(const Value& value)
+    {
+        return !value.IsObject() || value.AsObject()->IsPermanent();
+    }
+
+    static const Value& Shared(const Value& value)
+    {
+        if (!IsShareable(value))
+            throw Unshareable();
+        return value;
+    }
+
+    static std::size_t Length(const HeapObject* array)
+    {
+        if (array->Kind() == ObjectKind::TypedArray)
+            return static_cast<const TypedArrayObject*>(array)->Length();
+        return static_cast<const ArrayObject*>(array)->Items().size();
+    }
+
+    static Value Element(const HeapObject* array, std::size_t index)
+    {
+        if (array->Kind() == ObjectKind::TypedArray)
+            return static_cast<const TypedArrayObject*>(array)->Get(index);
+        return static_cast<const ArrayObject*>(array)->Items()[index];
+    }
+
+    // One thread's share of a parallel call, with a fork of the callback of its own.
+    struct Lane
+    {
+        std::unique_ptr<NativeHost> host;
+        Value callee;
+        std::vector<Value> args;
+
+        Value Call(const Value& a)
+        {
+            args.assign(1, a);
+            return host->Call(callee, args);
+        }
+
+        Value Call(const Value& a, const Value& b)
+        {
+            args.assign({ a, b });
+            return host->Call(callee, args);
+        }
+    };
+
+    // A call split into pieces of an array that lanes on the shared Scheduler work through. The
+    // callback runs on forks (see NativeHost::Fork), which only take pure functions, so a lane that
+    // fails changed nothing the script can see: the caller then makes the whole call on its own
+    // thread, and fails the way that call would.
+    class ParallelRun
+    {
+    public:
+        // Forks `callee`, unless it is null, for every lane. False when the call is better kept on this
+        // thread: the array is small, there is one worker, the callback is not pure or the array
+        // holds objects the forks cannot read.
+        bool Prepare(NativeHost& host, const HeapObject* array, const Value& callee)
+        {
+            m_size = Length(array);
+            std::size_t lanes = Scheduler::Shared().WorkerCount();
+            m_pieces = std::min(m_size / ParallelGrain, lanes * 4);
+            if (lanes < 2 || m_pieces < 2)
+                return false;
+
+            if (array->Kind() == ObjectKind::Array && !callee.IsNull())
+            {
+                const auto& items = static_cast<const ArrayObject*>(array)->Items();
+                if (!std::all_of(items.begin(), items.end(), IsShareable))
+                    return false;
+            }
+
+            m_lanes.resize(std::min(lanes, m_pieces));
+            if (callee.IsNull())
+                return true;
+            for (Lane& lane : m_lanes)
+            {
+                lane.callee = callee;
+                lane.host = host.Fork(lane.callee);
+                if (lane.host == nullptr)
+                    return false;
+            }
+            return true;
+        }
+
+        std::size_t Pieces() const { return m_pieces; }
+        std::size_t Begin(std::size_t piece) const { return m_size * piece / m_pieces; }
+        std::size_t End(std::size_t piece) const { return Begin(piece + 1); }
+
+        // Runs work(lane, index) for every index below `count`. False when one of them failed.
+        template <typename F>
+        bool Run(std::size_t count, F&& work)
+        {
+            try
+            {
+                Parallel::For(count, m_lanes.size(), [&](std::size_t index, std::size_t lane) { work(m_lanes[lane], index); });
+                return true;
+            }
+            catch (const RuntimeException&)
+            {
+                return false;
+            }
+            catch (const Unshareable&)
+            {
+                return false;
+            }
+        }
+    private:
+        std::size_t m_size = 0;
+        std::size_t m_pieces = 0;
+        std::vector<Lane> m_lanes;
+    };
+
+    // parallelMap(array, f): a new array of f(item) for every item, in order.
+    static Value ParallelMap(NativeHost& host, Value* args, int, void*)
+    {
+        HeapObject* source = ExpectKind("parallelMap", args, 0, { ObjectKind::Array, ObjectKind::TypedArray }, "an array");
+        Value f = ExpectFunction("parallelMap", args, 1);
+        Heap& heap = host.GetHeap();
+
+        ParallelRun run;
+        if (run.Prepare(host, source, f))
+        {
+            std::vector<Value> results(Length(source));
+            bool done = run.Run(run.Pieces(), [&](Lane& lane, std::size_t piece)
+            {
+                for (std::size_t i = run.Begin(piece); i < run.End(piece); i++)
+                    results[i] = Shared(lane.Call(Element(source, i)));
+            });
+            if (done)
+                return Value::Object(heap.Allocate<ArrayObject>(std::move(results)));
+        }
+
+        // f may run the collector or change the array, so results go straight into a rooted one.
+        Handle mapped(heap, Value::Object(heap.Allocate<ArrayObject>()));
+        std::vector<Value> call(1);
+        for (std::size_t i = 0; i < Length(source); i++)
+        {
+            call[0] = Element(source, i);
+            Value result = host.Call(f, call);
+            auto* array = static_cast<ArrayObject*>(mapped.Get().AsObject());
+            array->Items().push_back(result);
+            heap.WriteBarrier(array, result);
+        }
+        return mapped.Get();
+    }
+
+    // parallelFilter(array, keep): a new array of the items keep(item) is true for, in order.
+    static Value ParallelFilter(NativeHost& host, Value* args, int, void*)
+    {
+        HeapObject* source = ExpectKind("parallelFilter", args, 0, { ObjectKind::Array, ObjectKind::TypedArray }, "an array");
+        Value keep = ExpectFunction("parallelFilter", args, 1);
+        Heap& heap = host.GetHeap();
+
+        ParallelRun run;
+        if (run.Prepare(host, source, keep))
+        {
+            std::vector<std::vector<Value>> kept(run.Pieces());
+            bool done = run.Run(run.Pieces(), [&](Lane& lane, std::size_t piece)
+            {
+                for (std::size_t i = run.Begin(piece); i < run.End(piece); i++)
+                {
+                    Value item = Element(source, i);
+                    if (lane.Call(item).IsTruthy())
+                        kept[piece].push_back(item);
+                }
+            });
+            if (done)
+            {
+                std::vector<Value> items;
+                for (const auto& part : kept)
+                    items.insert(items.end(), part.begin(), part.end());
+                return Value::Object(heap.Allocate<ArrayObject>(std::move(items)));
+            }
+        }
+
+        Handle filtered(heap, Value::Object(heap.Allocate<ArrayObject>()));
+        Handle item(heap);
+        std::vector<Value> call(1);
+        for (std::size_t i = 0; i < Length(source); i++)
+        {
+            item.Set(Element(source, i));
+            call[0] = item.Get();
+            if (!host.Call(keep, call).IsTruthy())
+                continue;
+
+            auto* array = static_cast<ArrayObject*>(filtered.Get().AsObject());
+            array->Items().push_back(item.Get());
+            heap.WriteBarrier(array, item.Get());
+        }
+        return filtered.Get();
+    }
+
+    // parallelReduce(array, f, initial): f(...f(f(initial, a0), a1)..., an). In parallel every piece is
+    // reduced on its own and the results are combined in order, so f must be associative; floating
+    // point results may round differently than a sequential run's.
+    static Value ParallelReduce(NativeHost& host, Value* args, int, void*)
+    {
+        HeapObject* source = ExpectKind("parallelReduce", args, 0, { ObjectKind::Array, ObjectKind::TypedArray }, "an array");
+        Value f = ExpectFunction("parallelReduce", args, 1);
+        Heap& heap = host.GetHeap();
+        Handle total(heap, args[2]);
+        std::vector<Value> call(2);
+
+        ParallelRun run;
+        if (run.Prepare(host, source, f))
+        {
+            std::vector<Value> partials(run.Pieces());
+            bool done = run.Run(run.Pieces(), [&](Lane& lane, std::size_t piece)
+            {
+                Value partial = Element(source, run.Begin(piece));
+                for (std::size_t i = run.Begin(piece) + 1; i < run.End(piece); i++)
+                    partial = Shared(lane.Call(partial, Element(source, i)));
+                partials[piece] = partial;
+            });
+            if (done)
+            {
+                for (const Value& partial : partials)
+                {
+                    call[0] = total.Get();
+                    call[1] = partial;
+                    total.Set(host.Call(f, call));
+                }
+                return total.Get();
+            }
+        }
+
+        for (std::size_t i = 0; i < Length(source); i++)
+        {
+            call[0] = total.Get();
+            call[1] = Element(source, i);
+            total.Set(host.Call(f, call));
+        }
+        return total.Get();
+    }
+
+    // How many of the first `count` items of the merge of a and b come from a, items of b going after
+    // equal ones of a.
+    template <typename T, typename Less>
+    static std::size_t MergeSplit(const T* a, std::size_t aSize, const T* b, std::size_t bSize, std::size_t count, Less& less)
+    {
+        std::size_t low = count > bSize ? count - bSize : 0;
+        std::size_t high = std::min(count, aSize);
+        while (low < high)
+        {
+            std::size_t middle = low + (high - low) / 2;
+            if (less(b[count - middle - 1], a[middle]))
+                high = middle;
+            else
+                low = middle + 1;
+        }
+        return low;
+    }
+
+    template <typename T, typename Less>
+    static void Merge(const T* a, const T* aEnd, const T* b, const T* bEnd, T* out, Less& less)
+    {
+        while (a != aEnd && b != bEnd)
+            *out++ = less(*b, *a) ? *b++ : *a++;
+        out = std::copy(a, aEnd, out);
+        std::copy(b, bEnd, out);
+    }
+
+    // Sorts every piece of data[0, size) at once, then merges neighbouring runs in rounds until one is
+    // left. Each merge is cut into slices of about a piece at output positions MergeSplit finds, so
+    // every round keeps all lanes busy. `order(lane)` makes the comparator a lane sorts with.
+    template <typename T, typename Order>
+    static bool MergeSort(ParallelRun& run, T* data, std::size_t size, Order&& order)
+    {
+        std::size_t pieces = run.Pieces();
+        bool sorted = run.Run(pieces, [&](Lane& lane, std::size_t piece)
+        {
+            Sorting::Sort(data + run.Begin(piece), data + run.End(piece), order(lane));
+        });
+        if (!sorted)
+            return false;
+
+        // Merges the runs [first, middle) and [middle, last) into output positions [begin, end), counted
+        // from first; split and splitEnd of those items come from the first run.
+        struct Slice
+        {
+            std::size_t first, middle, last;
+            std::size_t begin, end;
+            std::size_t split = 0, splitEnd = 0;
+        };
+
+        std::vector<T> buffer(size);
+        T* from = data;
+        T* to = buffer.data();
+        std::vector<std::size_t> bounds;
+        for (std::size_t piece = 0; piece <= pieces; piece++)
+            bounds.push_back(run.Begin(piece));
+
+        while (bounds.size() > 2)
+        {
+            std::vector<Slice> slices;
+            std::vector<std::size_t> merged;
+            for (std::size_t i = 0; i + 1 < bounds.size(); i += 2)
+            {
+                // An odd run out merges with an empty one.
+                std::size_t first = bounds[i], middle = bounds[i + 1], last = i + 2 < bounds.size() ? bounds[i + 2] : middle;
+                std::size_t length = last - first;
+                std::size_t count = std::max<std::size_t>(1, length * pieces / size);
+                for (std::size_t n = 0; n < count; n++)
+                    slices.push_back(Slice{ first, middle, last, length * n / count, length * (n + 1) / count });
+                merged.push_back(first);
+            }
+            merged.push_back(size);
+
+            bool split = run.Run(slices.size(), [&](Lane& lane, std::size_t index)
+            {
+                Slice& slice = slices[index];
+                auto less = order(lane);
+                slice.split = MergeSplit(from + slice.first, slice.middle - slice.first, from + slice.middle, slice.last - slice.middle, slice.begin, less);
+            });
+            if (!split)
+                return false;
+
+            // An inconsistent comparator can split a merge into slices that overlap; such a merge is
+            // done as one slice, which gives every item one place whatever the comparator says.
+            std::vector<Slice> checked;
+            for (std::size_t start = 0, next; start < slices.size(); start = next)
+            {
+                bool consistent = true;
+                for (next = start; next < slices.size() && slices[next].first == slices[start].first; next++)
+                {
+                    Slice& slice = slices[next];
+                    bool lastSlice = next + 1 == slices.size() || slices[next + 1].first != slice.first;
+                    slice.splitEnd = lastSlice ? slice.middle - slice.first : slices[next + 1].split;
+                    consistent = consistent && slice.split <= slice.splitEnd && slice.begin - slice.split <= slice.end - slice.splitEnd;
+                }
+
+                if (consistent)
+                    checked.insert(checked.end(), slices.begin() + start, slices.begin() + next);
+                else
+                {
+                    const Slice& slice = slices[start];
+                    checked.push_back(Slice{ slice.first, slice.middle, slice.last, 0, slice.last - slice.first, 0, slice.middle - slice.first });
+                }
+            }
+
+            bool done = run.Run(checked.size(), [&](Lane& lane, std::size_t index)
+            {
+                const Slice& slice = checked[index];
+                auto less = order(lane);
+                const T* a = from + slice.first;
+                const T* b = from + slice.middle;
+                Merge(a + slice.split, a + slice.splitEnd, b + (slice.begin - slice.split), b + (slice.end - slice.splitEnd), to + slice.first + slice.begin, less);
+            });
+            if (!done)
+                return false;
+
+            std::swap(from, to);
+            bounds = std::move(merged);
+        }
+
+        if (from != data)
+            std::copy(from, from + size, data);
+        return true;
+    }
+
+    // Without a comparator, like SortValues. False for items that are not all numbers or all strings,
+    // which SortValues reports.
+    static bool MergeSortValues(ParallelRun& run, std::vector<Value>& items)
+    {
+        bool ints = true, numbers = true, strings = true;
+        for (const Value& item : items)
+        {
+            ints = ints && item.IsInt();
+            numbers = numbers && item.IsNumber();
+            strings = strings && item.IsObject() && item.AsObject()->Kind() == ObjectKind::String;
+        }
+
+        if (ints)
+            return MergeSort(run, items.data(), items.size(), [](Lane&) { return [](const Value& a, const Value& b) { return a.AsInt() < b.AsInt(); }; });
+        if (numbers)
+            return MergeSort(run, items.data(), items.size(), [](Lane&) { return [](const Value& a, const Value& b) { return NumberLess(a.ToDouble(), b.ToDouble()); }; });
+        if (!strings)
+            return false;
+
+        // Flattens ropes here, as the lanes may only read the strings.
+        for (const Value& item : items)
+            static_cast<StringObject*>(item.AsObject())->Data();
+        return MergeSort(run, items.data(), items.size(), [](Lane&)
+        {
+            return [](const Value& a, const Value& b) { return static_cast<StringObject*>(a.AsObject())->Data() < static_cast<StringObject*>(b.AsObject())->Data(); };
+        });
+    }
+
+    // parallelSort(array) or parallelSort(array, less): sort, with pieces of the array sorted and then
+    // merged in parallel.
+    static Value ParallelSort(NativeHost& host, Value* args, int argc, void*)
+    {
+        ExpectArgumentCount("parallelSort", argc, 1, 2);
+        HeapObject* object = ExpectKind("parallelSort", args, 0, { ObjectKind::Array, ObjectKind::TypedArray }, "an array");
+        Value less = argc == 2 ? ExpectFunction("parallelSort", args, 1) : Value::Null();
+        auto script = [](Lane& lane) { return ScriptLess(*lane.host, lane.callee); };
+
+        ParallelRun run;
+        if (run.Prepare(host, object, less))
+        {
+            bool done;
+            if (object->Kind() == ObjectKind::TypedArray)
+            {
+                TypedArrayObject* array = ExpectWritable("parallelSort", args, 0);
+                done = VisitElements(array, [&](auto* data)
+                {
+                    using T = std::remove_pointer_t<decltype(data)>;
+                    std::size_t length = array->Length();
+                    if (less.IsNull())
+                        return MergeSort(run, data, length, [](Lane&) { return [](T a, T b) { return NumberLess(a, b); }; });
+
+                    std::vector<Value> boxed(length);
+                    for (std::size_t i = 0; i < length; i++)
+                        boxed[i] = Box(data[i]);
+                    if (!MergeSort(run, boxed.data(), length, script))
+                        return false;
+                    for (std::size_t i = 0; i < length; i++)
+                        data[i] = Unbox<T>("parallelSort", boxed[i]);
+                    return true;
+                });
+            }
+            else
+            {
+                // Only reorders what the array holds, so no write barriers.
+                auto& items = static_cast<ArrayObject*>(object)->Items();
+                if (less.IsNull())
+                    done = MergeSortValues(run, items);
+                else
+                {
+                    std::vector<Value> sorted = items;
+                    done = MergeSort(run, sorted.data(), sorted.size(), script);
+                    if (done)
+                        items = std::move(sorted);
+                }
+            }
+            if (done)
+                return args[0];
+        }
+
+        return SortArray("parallelSort", host, args, less);
+    }
+
+    // ----- Registry -----
+
+    const StandardLibrary::Function* StandardLibrary::Find(const std::string& name)
+    {
+        static const Function functions[] =
+        {
+            { "intArray",    &NewTypedArray<ElementType::Int>,    1 },
+            { "floatArray",  &NewTypedArray<ElementType::Float>,  1 },
+            { "doubleArray", &NewTypedArray<ElementType::Double>, 1 },
+            { "charArray",   &NewTypedArray<ElementType::Char>,   1 },
+            { "fill",        &Fill,                               2 },
+            { "copy",        &Copy,                               2 },
+            { "sum",         &Sum,                                1 },
+            { "min",         &Extreme<false>,                     1 },
+            { "max",         &Extreme<true>,                      1 },
+            { "dot",         &Dot,                                2 },
+            { "add",         &Apply<Kernels::Op::Add>,            3 },
+            { "sub",         &Apply<Kernels::Op::Sub>,            3 },
+            { "mul",         &Apply<Kernels::Op::Mul>,            3 },
+            { "div",         &Apply<Kernels::Op::Div>,            3 },
+        };
+
+        for (const auto& function : functions)
+        {
+            if (name == function.name)
+                return &function;
+        }
+        return nullptr;
+    }
+
+    const StandardLibrary::Function* StandardLibrary::Module::Find(const std::string& name) const
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (name == functions[i].name)
+                return &functions[i];
+        }
+        return nullptr;
+    }
+
+    const StandardLibrary::Module* StandardLibrary::FindModule(const std::string& path)
+    {
+        static const Function collections[] =
+        {
+            { "hashMap",       &NewHashTable<ObjectKind::Map>, 0 },
+            { "hashSet",       &NewHashTable<ObjectKind::Set>, 0 },
+            { "deque",         &NewDeque,                      0 },
+            { "priorityQueue", &NewPriorityQueue,              -1 },
+            { "size",          &Size,                          1 },
+            { "clear",         &Clear,                         1 },
+            { "get",           &Get,                           2 },
+            { "getOr",         &GetOr,                         3 },
+            { "put",           &Put,                           3 },
+            { "insert",        &Insert,                        2 },
+            { "has",           &Has,                           2 },
+            { "remove",        &Remove,                        2 },
+            { "keys",          &Entries<true>,                 1 },
+            { "values",        &Entries<false>,                1 },
+            { "push",          &Push,                          2 },
+            { "pop",           &Pop,                           1 },
+            { "insertAt",      &InsertAt,                      3 },
+            { "removeAt",      &RemoveAt,                      2 },
+            { "reserve",       &Reserve,                       2 },
+            { "pushFront",     &DequePush<true>,               2 },
+            { "pushBack",      &DequePush<false>,              2 },
+            { "popFront",      &DequePop<true>,                1 },
+            { "popBack",       &DequePop<false>,               1 },
+            { "front",         &DequePeek<true>,               1 },
+            { "back",          &DequePeek<false>,              1 },
+            { "at",            &At,                            2 },
+            { "peek",          &Peek,                          1 },
+        };
+        static const Function algorithm[] =
+        {
+            { "sort",           &Sort,                               -1 },
+            { "binarySearch",   &BinarySearch<Search::Find>,         -1 },
+            { "lowerBound",     &BinarySearch<Search::LowerBound>,   -1 },
+            { "upperBound",     &BinarySearch<Search::UpperBound>,   -1 },
+            { "parallelMap",    &ParallelMap,                        2 },
+            { "parallelFilter", &ParallelFilter,                     2 },
+            { "parallelReduce", &ParallelReduce,                     3 },
+            { "parallelSort",   &ParallelSort,                       -1 },
+        };
+        static const Module modules[] =
+        {
+            { "std.collections", collections, std::size(collections) },
+            { "std.algorithm",   algorithm,   std::size(algorithm) },
+        };
+
+        for (const auto& module : modules)
+        {
+            if (path == module.path)
+                return &module;
+        }
+        return nullptr;
+    }
+}
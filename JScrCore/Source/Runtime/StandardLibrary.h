@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "Object.h"
+
+namespace JScr::Runtime
+{
+    // Native functions every script can call without declaring them. The compiler only binds a name to
+    // one of these when nothing the script declared resolves it, so scripts can shadow them freely.
+    class StandardLibrary
+    {
+    public:
+        struct Function
+        {
+            const char* name;
+            NativeFunction function;
+            // -1 accepts any amount of arguments.
+            int arity;
+        };
+
+        // Functions a script only sees after importing them, such as `import std.collections;`.
+        struct Module
+        {
+            const char* path;
+            const Function* functions;
+            std::size_t count;
+
+            const Function* Find(const std::string& name) const;
+        };
+
+        // Null when there is no such function.
+        static const Function* Find(const std::string& name);
+        // Null when there is no such module. `path` is dotted, "std.collections".
+        static const Module* FindModule(const std::string& path);
+    };
+}
@@ -0,0 +1,59 @@
+#include "String.h"
+#include <vector>
+#include "Heap.h"
+
+namespace JScr::Runtime
+{
+    StringObject* StringObject::Concat(Heap& heap, const StringObject* left, const StringObject* right)
+    {
+        std::size_t length = left->Length() + right->Length();
+        if (length >= RopeThreshold)
+            return heap.Allocate<StringObject>(left, right);
+
+        return heap.Allocate<StringObject>(String(length, [&](char* out)
+        {
+            std::memcpy(out, left->Data().data(), left->Length());
+            std::memcpy(out + left->Length(), right->Data().data(), right->Length());
+        }));
+    }
+
+    bool StringObject::Equal(const StringObject* a, const StringObject* b)
+    {
+        if (a == b)
+            return true;
+        if (a->Length() != b->Length())
+            return false;
+        // Strings tend to be compared again and again (keys, states, log levels), so paying for the hash
+        // once turns every later mismatch into a single compare.
+        if (a->Hash() != b->Hash())
+            return false;
+        return a->Data() == b->Data();
+    }
+
+    void StringObject::Flatten() const
+    {
+        m_text = String(m_length, [&](char* out)
+        {
+            // Fills the buffer back to front with an explicit stack, so ropes of any depth are fine.
+            char* end = out + m_length;
+            std::vector<const StringObject*> pending{ m_left, m_right };
+            while (!pending.empty())
+            {
+                const StringObject* node = pending.back();
+                pending.pop_back();
+
+                if (node->m_left != nullptr)
+                {
+                    pending.push_back(node->m_left);
+                    pending.push_back(node->m_right);
+                    continue;
+                }
+                end -= node->m_length;
+                std::memcpy(end, node->m_text.Chars(), node->m_length);
+            }
+        });
+
+        m_left = nullptr;
+        m_right = nullptr;
+    }
+}
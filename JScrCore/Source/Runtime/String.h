@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <utility>
+
+namespace JScr::Runtime
+{
+    // Immutable text. Up to InlineCapacity bytes are stored inside the String itself; longer text lives
+    // in a shared, reference counted block, so copying a String never copies characters.
+    class String
+    {
+    public:
+        static constexpr std::size_t InlineCapacity = 15;
+
+        String() noexcept : m_length(0) { m_inline[0] = '\0'; }
+
+        explicit String(std::string_view text) : String(text.size(), [&](char* out) { std::memcpy(out, text.data(), text.size()); }) {}
+
+        // Allocates room for length bytes and lets fill write them.
+        template <typename Fill>
+        String(std::size_t length, Fill&& fill) : m_length((std::uint32_t) length)
+        {
+            char* out = m_inline;
+            if (!IsInline())
+            {
+                m_block = static_cast<Block*>(::operator new(offsetof(Block, chars) + length + 1));
+                new (&m_block->refs) std::atomic<std::uint32_t>(1);
+                out = m_block->chars;
+            }
+            fill(out);
+            out[length] = '\0';
+        }
+
+        String(const String& other) noexcept : m_length(other.m_length)
+        {
+            if (IsInline())
+                std::memcpy(m_inline, other.m_inline, sizeof(m_inline));
+            else
+            {
+                m_block = other.m_block;
+                m_block->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        String(String&& other) noexcept : m_length(other.m_length)
+        {
+            std::memcpy(m_inline, other.m_inline, sizeof(m_inline));
+            other.m_length = 0;
+            other.m_inline[0] = '\0';
+        }
+
+        String& operator=(String other) noexcept
+        {
+            Swap(other);
+            return *this;
+        }
+
+        ~String()
+        {
+            if (!IsInline() && m_block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                m_block->refs.~atomic();
+                ::operator delete(m_block);
+            }
+        }
+
+    public:
+        std::size_t Length() const { return m_length; }
+        bool IsInline() const { return m_length <= InlineCapacity; }
+
+        // Always null terminated.
+        const char* Chars() const { return IsInline() ? m_inline : m_block->chars; }
+        std::string_view View() const { return std::string_view(Chars(), m_length); }
+
+        // 32 bit FNV-1a. Never 0, so 0 can mean "not computed yet" wherever a hash is cached.
+        static std::uint32_t Hash(std::string_view text)
+        {
+            std::uint32_t hash = 2166136261u;
+            for (char c : text)
+                hash = (hash ^ (unsigned char) c) * 16777619u;
+            return hash != 0 ? hash : 1;
+        }
+
+    private:
+        struct Block
+        {
+            std::atomic<std::uint32_t> refs;
+            char chars[1];
+        };
+
+        void Swap(String& other) noexcept
+        {
+            char inlineChars[sizeof(m_inline)];
+            std::memcpy(inlineChars, m_inline, sizeof(m_inline));
+            std::memcpy(m_inline, other.m_inline, sizeof(m_inline));
+            std::memcpy(other.m_inline, inlineChars, sizeof(m_inline));
+            std::swap(m_length, other.m_length);
+        }
+
+        union
+        {
+            char m_inline[InlineCapacity + 1];
+            Block* m_block;
+        };
+        std::uint32_t m_length;
+    };
+
+    // Hashes text the same way StringObject::Hash does, and lets std::string keyed maps be searched
+    // with a string_view.
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view text) const { return String::Hash(text); }
+    };
+}
@@ -0,0 +1,96 @@
+#include "Superinstructions.h"
+
+namespace JScr::Runtime
+{
+    namespace
+    {
+        struct Fusion
+        {
+            OpCode first;
+            OpCode fused;
+        };
+
+        constexpr Fusion Fusions[] =
+        {
+            { OpCode::LOADINT, OpCode::ADDINT },
+            { OpCode::LOADINT, OpCode::SUBINT },
+            { OpCode::EQ,      OpCode::EQJMP },
+            { OpCode::NE,      OpCode::NEJMP },
+            { OpCode::LT,      OpCode::LTJMP },
+            { OpCode::LE,      OpCode::LEJMP },
+            { OpCode::GT,      OpCode::GTJMP },
+            { OpCode::GE,      OpCode::GEJMP },
+            { OpCode::CALL,    OpCode::CALLRET },
+            { OpCode::IEQ,     OpCode::IEQJMP },
+            { OpCode::INE,     OpCode::INEJMP },
+            { OpCode::ILT,     OpCode::ILTJMP },
+            { OpCode::ILE,     OpCode::ILEJMP },
+            { OpCode::DLT,     OpCode::DLTJMP },
+            { OpCode::DLE,     OpCode::DLEJMP },
+        };
+
+        bool IsComparison(OpCode op)
+        {
+            return op >= OpCode::EQ && op <= OpCode::GE;
+        }
+
+        // What the first instruction of a sequence becomes, or the instruction itself if it starts none.
+        OpCode Fused(const Instruction first, const Instruction second)
+        {
+            OpCode op = first.Op();
+            OpCode next = second.Op();
+
+            // `i = i + 1`: the constant goes into a temporary that only the arithmetic reads.
+            bool add = next == OpCode::ADD || next == OpCode::IADD, sub = next == OpCode::SUB || next == OpCode::ISUB;
+            if (op == OpCode::LOADINT && (add || sub) && second.C() == first.A() && second.B() != first.A())
+                return add ? OpCode::ADDINT : OpCode::SUBINT;
+
+            bool branch = (next == OpCode::JMPIF || next == OpCode::JMPIFNOT) && second.A() == first.A();
+            if (IsComparison(op) && branch)
+                return (OpCode) ((int) OpCode::EQJMP + ((int) op - (int) OpCode::EQ));
+
+            // Typed comparisons, those with a fused form.
+            for (const Fusion& fusion : Fusions)
+            {
+                if (branch && fusion.first == op && fusion.fused >= OpCode::IEQJMP)
+                    return fusion.fused;
+            }
+
+            if (op == OpCode::CALL && next == OpCode::RETURN)
+                return OpCode::CALLRET;
+
+            return op;
+        }
+    }
+
+    void Superinstructions::Fuse(FunctionProto& proto)
+    {
+        auto& code = proto.code;
+        for (std::size_t index = 0; index + 1 < code.size(); index++)
+        {
+            OpCode op = code[index].Op();
+            if (op == OpCode::GETFIELD || op == OpCode::SETFIELD)
+            {
+                index++; // <-- Skips the EXTRAARG.
+                continue;
+            }
+
+            OpCode fused = Fused(code[index], code[index + 1]);
+            if (fused == op)
+                continue;
+
+            code[index] = code[index].WithOp(fused);
+            index++; // <-- The rest of a sequence never starts another one.
+        }
+    }
+
+    Instruction Superinstructions::Unfuse(const Instruction i)
+    {
+        for (const Fusion& fusion : Fusions)
+        {
+            if (fusion.fused == i.Op())
+                return i.WithOp(fusion.first);
+        }
+        return i;
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "Bytecode.h"
+
+namespace JScr::Runtime
+{
+    // Peephole pass over finished bytecode that fuses the sequences the VM executes most often into
+    // superinstructions: counter updates by a small constant, comparisons feeding a branch and calls
+    // whose result is returned right away. Only the first instruction of a sequence is rewritten, so
+    // jumps into the middle of one and the Jit, which compiles such sequences as a whole anyway, keep
+    // seeing the original instructions.
+    class Superinstructions
+    {
+    public:
+        static void Fuse(FunctionProto& proto);
+
+        // The instruction a superinstruction was made from; any other instruction as it is.
+        static Instruction Unfuse(const Instruction i);
+    };
+}
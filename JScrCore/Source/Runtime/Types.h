@@ -2,6 +2,7 @@
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <vector>
 using std::vector;
 using std::string;
 
@@ -10,10 +11,16 @@ namespace JScr::Runtime
 	class Types
 	{
 	public:
+		enum class Uid : unsigned short
+		{
+			Array, Dynamic, Object, Void, Bool, Int, Float, Double, String, Char
+		};
+
 		class Type
 		{
 		public:
 			const unsigned short& Uid() const { return m_uid; }
+			bool Is(Types::Uid uid) const { return m_uid == (unsigned short) uid; }
 			const vector<Type>& LambdaTypes() const { return m_lambdaTypes; }
 			const std::shared_ptr<Type> Child() const { return m_child; }
 			const string& Data() const { return m_data; }
@@ -41,52 +48,52 @@ namespace JScr::Runtime
 		public:
 			static Type Array(Type of, vector<Type> lambdaTypes = {})
 			{
-				return Type(0, std::move(lambdaTypes), std::make_shared<Type>(std::move(of)));
+				return Type((unsigned short) Types::Uid::Array, std::move(lambdaTypes), std::make_shared<Type>(std::move(of)));
 			}
 
 			static Type Dynamic(vector<Type> lambdaTypes = {})
 			{
-				return Type(1, std::move(lambdaTypes));
+				return Type((unsigned short) Types::Uid::Dynamic, std::move(lambdaTypes));
 			}
 
 			static Type Object(string name, vector<Type> lambdaTypes = {})
 			{
-				return Type(2, std::move(lambdaTypes), nullptr, std::move(name));
+				return Type((unsigned short) Types::Uid::Object, std::move(lambdaTypes), nullptr, std::move(name));
 			}
 
 			static Type Void(vector<Type> lambdaTypes = {})
 			{
-				return Type(3, std::move(lambdaTypes));
+				return Type((unsigned short) Types::Uid::Void, std::move(lambdaTypes));
 			}
 
 			static Type Bool(vector<Type> lambdaTypes = {})
 			{
-				return Type(4, std::move(lambdaTypes));
+				return Type((unsigned short) Types::Uid::Bool, std::move(lambdaTypes));
 			}
 
 			static Type Int(vector<Type> lambdaTypes = {})
 			{
-				return Type(5, std::move(lambdaTypes));
+				return Type((unsigned short) Types::Uid::Int, std::move(lambdaTypes));
 			}
 
 			static Type Float(vector<Type> lambdaTypes = {})
 			{
-				return Type(6, std::move(lambdaTypes));
+				return Type((unsigned short) Types::Uid::Float, std::move(lambdaTypes));
 			}
 
 			static Type Double(vector<Type> lambdaTypes = {})
 			{
-				return Type(7, std::move(lambdaTypes));
+				return Type((unsigned short) Types::Uid::Double, std::move(lambdaTypes));
 			}
 
 			static Type String(vector<Type> lambdaTypes = {})
 			{
-				return Type(8, std::move(lambdaTypes));
+				return Type((unsigned short) Types::Uid::String, std::move(lambdaTypes));
 			}
 
 			static Type Char(vector<Type> lambdaTypes = {})
 			{
-				return Type(9, std::move(lambdaTypes));
+				return Type((unsigned short) Types::Uid::Char, std::move(lambdaTypes));
 			}
 
 		private:
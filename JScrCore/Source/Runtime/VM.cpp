@@ -0,0 +1,1880 @@
+#include "VM.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <utility>
+#include "Collections.h"
+#include "Superinstructions.h"
+
+// GCC and Clang can dispatch through a table of label addresses; MSVC uses the switch.
+#if !defined(JSCR_COMPUTED_GOTO)
+#if defined(__GNUC__) || defined(__clang__)
+#define JSCR_COMPUTED_GOTO 1
+#else
+#define JSCR_COMPUTED_GOTO 0
+#endif
+#endif
+
+namespace JScr::Runtime
+{
+    VM::VM(std::shared_ptr<const Module> module, std::size_t stackSize)
+        : m_module(std::move(module)), m_stack(static_cast<Value*>(std::malloc(stackSize * sizeof(Value)))), m_stackSize(stackSize),
+          m_caches(std::make_unique<InlineCache[]>(m_module->numCaches)), m_jit(*this)
+    {
+        // Left uninitialized, so the pages are only committed once calls get that deep. Every frame
+        // clears its registers on entry and nothing above the top frame is ever read.
+        if (m_stack == nullptr)
+            throw std::bad_alloc();
+
+        m_globals.resize(m_module->globalNames.size());
+        m_frames.reserve(64);
+
+        for (const auto& type : m_module->objectTypes)
+            m_typeShapes.push_back(m_shapes.Declare(type));
+
+        for (const NativeGlobal& native : m_module->nativeGlobals)
+            m_globals[native.global] = native.function;
+    }
+
+    VM::~VM()
+    {
+        m_inbox->Close();
+    }
+
+    namespace
+    {
+        // Sets a flag for as long as it lives.
+        class FlagScope
+        {
+        public:
+            FlagScope(bool& flag, bool value) : m_flag(flag), m_previous(std::exchange(flag, value)) {}
+            ~FlagScope() { m_flag = m_previous; }
+
+        private:
+            bool& m_flag;
+            bool m_previous;
+        };
+    }
+
+    Value VM::Run()
+    {
+        if (!Start())
+        {
+            do
+            {
+                if (!Preempted())
+                    m_inbox->Wait();
+            }
+            while (!Poll());
+        }
+        return Result();
+    }
+
+    bool VM::Start()
+    {
+        FlagScope preemptible(m_preemptible, true);
+        m_fuelCharged = 0;
+        m_fuelWindow = m_fuel = 0;
+        Refuel();
+
+        auto* main = m_heap.AllocateClosure(&m_module->Main(), 0);
+        std::size_t depth = m_frames.size();
+        Value* slot = StackTop();
+        if (slot + 1 > m_stack.get() + m_stackSize)
+            Error("Stack overflow.");
+
+        slot[0] = Value::Object(main);
+        PrepareCall(slot, 0);
+        if (!Continue(depth, nullptr))
+            return false;
+        return Drain();
+    }
+
+    bool VM::Poll()
+    {
+        FlagScope preemptible(m_preemptible, true);
+        Refuel();
+
+        if (m_preempted.has_value())
+        {
+            Preemption preempted = *m_preempted;
+            m_preempted.reset();
+            if (!Continue(preempted.depth, preempted.task))
+                return false;
+        }
+        return Drain();
+    }
+
+    bool VM::Continue(std::size_t depth, TaskObject* task)
+    {
+        Value* slot = m_frames[depth].base - 1;
+        try
+        {
+            Value result = Execute(depth);
+            if (m_frames.size() > depth)
+            {
+                m_preempted = Preemption{ depth, task };
+                return false;
+            }
+
+            if (task == nullptr)
+            {
+                m_result = result;
+                if (m_module->Main().isAsync)
+                    m_mainTask = static_cast<TaskObject*>(m_result.AsObject());
+            }
+            return true;
+        }
+        catch (const RuntimeException& e)
+        {
+            // Unwind whatever the failing call left behind so the VM stays usable.
+            CloseUpvalues(slot);
+            m_frames.resize(depth);
+            if (task == nullptr)
+                throw;
+            Settle(task, true, Value::Null(), e.Description());
+            return true;
+        }
+        catch (...)
+        {
+            CloseUpvalues(slot);
+            m_frames.resize(depth);
+            throw;
+        }
+    }
+
+    bool VM::Drain()
+    {
+        for (;;)
+        {
+            for (AsyncInbox::Completion& completion : m_inbox->Take())
+            {
+                if (completion.rejected)
+                {
+                    Settle(completion.task, true, Value::Null(), std::move(completion.error));
+                    continue;
+                }
+
+                try
+                {
+                    Settle(completion.task, false, completion.value(*this));
+                }
+                catch (const RuntimeException& e)
+                {
+                    Settle(completion.task, true, Value::Null(), e.Description());
+                }
+            }
+
+            while (!m_ready.empty())
+            {
+                TaskObject* task = m_ready.front();
+                m_ready.pop_front();
+                if (!Resume(task))
+                    return false;
+            }
+
+            if (m_mainTask == nullptr || m_mainTask->GetState() != TaskObject::State::Pending)
+                return true;
+            if (m_external.empty())
+                Error("The script waits for a task that can never finish.");
+            if (m_inbox->Arm())
+                return false;
+        }
+    }
+
+    Value VM::Result() const
+    {
+        if (m_mainTask == nullptr)
+            return m_result;
+        if (m_mainTask->GetState() == TaskObject::State::Rejected)
+            throw RuntimeException(m_mainTask->Error());
+        return m_mainTask->Result();
+    }
+
+    Deferred VM::Defer()
+    {
+        auto* task = m_heap.Allocate<TaskObject>();
+        m_external.insert(task);
+        return Deferred{ Value::Object(task), Promise(m_inbox, task) };
+    }
+
+    Value VM::Call(const Value& callee, const std::vector<Value>& args)
+    {
+        // The caller, host or native, needs the result before it can go on.
+        FlagScope preemptible(m_preemptible, false);
+        std::size_t depth = m_frames.size();
+        Value* slot = StackTop();
+
+        if (slot + args.size() + 1 > m_stack.get() + m_stackSize)
+            Error("Stack overflow.");
+
+        slot[0] = callee;
+        for (std::size_t i = 0; i < args.size(); i++)
+            slot[i + 1] = args[i];
+
+        try
+        {
+            if (!PrepareCall(slot, (int) args.size()))
+                return slot[0];
+
+            return Execute(depth);
+        }
+        catch (...)
+        {
+            // Unwind whatever the failing call left behind so the VM stays usable.
+            CloseUpvalues(slot);
+            m_frames.resize(depth);
+            throw;
+        }
+    }
+
+    void VM::SetGlobal(const std::string& name, const Value& value)
+    {
+        for (std::size_t i = 0; i < m_module->globalNames.size(); i++)
+        {
+            if (m_module->globalNames[i] == name)
+            {
+                m_globals[i] = value;
+                return;
+            }
+        }
+
+        Error("Unknown global '" + name + "'.");
+    }
+
+    Value VM::GetGlobal(const std::string& name) const
+    {
+        for (std::size_t i = 0; i < m_module->globalNames.size(); i++)
+        {
+            if (m_module->globalNames[i] == name)
+                return m_globals[i];
+        }
+
+        Error("Unknown global '" + name + "'.");
+    }
+
+    struct VM::ForkCopy
+    {
+        VM& fork;
+        std::unordered_set<const FunctionProto*> checked;
+        // Copies by original, so values reached twice, or from themselves, are copied once.
+        std::unordered_map<const HeapObject*, Value> objects;
+        std::vector<bool> globals;
+    };
+
+    std::unique_ptr<NativeHost> VM::Fork(Value& callee)
+    {
+        if (m_fuelLimit != 0 || !callee.IsObject() || callee.AsObject()->Kind() != ObjectKind::Closure)
+            return nullptr;
+
+        auto fork = std::make_unique<VM>(m_module);
+        fork->m_jitEnabled = m_jitEnabled;
+        ForkCopy copy{ *fork, {}, {}, std::vector<bool>(m_globals.size()) };
+        Value copied;
+        if (!CopyToFork(copy, callee, copied))
+            return nullptr;
+
+        // A fork never runs top level code, so its result keeps the copy alive.
+        fork->m_result = copied;
+        callee = copied;
+        return fork;
+    }
+
+    bool VM::CopyToFork(ForkCopy& copy, const Value& value, Value& result)
+    {
+        result = value;
+        if (!value.IsObject())
+            return true;
+
+        HeapObject* object = value.AsObject();
+        if (auto found = copy.objects.find(object); found != copy.objects.end())
+        {
+            result = found->second;
+            return true;
+        }
+
+        switch (object->Kind())
+        {
+        case ObjectKind::String:
+            if (!object->IsPermanent())
+                result = Value::Object(copy.fork.NewString(static_cast<StringObject*>(object)->Data()));
+            copy.objects.emplace(object, result);
+            return true;
+        case ObjectKind::Native:
+            // The standard library's natives only touch their arguments; host functions may not expect
+            // to be called from several threads at once.
+            return static_cast<NativeFunctionObject*>(object)->Userdata() == nullptr;
+        case ObjectKind::Closure:
+        {
+            auto* closure = static_cast<ClosureObject*>(object);
+            const FunctionProto* proto = closure->Proto();
+            if (object->IsPermanent())
+                return CheckPure(copy, *proto);
+
+            ClosureObject* forked = copy.fork.m_heap.AllocateClosure(proto, proto->upvalues.size());
+            result = Value::Object(forked);
+            copy.objects.emplace(object, result);
+            if (!CheckPure(copy, *proto))
+                return false;
+
+            // Pure functions never assign what they captured, so a closed copy of each value will do.
+            for (std::size_t i = 0; i < proto->upvalues.size(); i++)
+            {
+                Value captured;
+                if (!CopyToFork(copy, *closure->Upvalue(i)->Location(), captured))
+                    return false;
+
+                UpvalueObject* upvalue = copy.fork.m_heap.Allocate<UpvalueObject>(&captured);
+                upvalue->Close();
+                forked->SetUpvalue(i, upvalue);
+            }
+            return true;
+        }
+        default:
+            // Enum entries and other module constants are never written to.
+            return object->IsPermanent();
+        }
+    }
+
+    bool VM::CheckPure(ForkCopy& copy, const FunctionProto& proto)
+    {
+        if (proto.isAsync)
+            return false;
+        if (!copy.checked.insert(&proto).second)
+            return true;
+
+        for (const Instruction& i : proto.code)
+        {
+            switch (i.Op())
+            {
+            case OpCode::SETGLOBAL:
+            case OpCode::SETUPVAL:
+                return false;
+            case OpCode::GETGLOBAL:
+                if (!copy.globals[i.Bx()])
+                {
+                    copy.globals[i.Bx()] = true;
+                    if (!CopyToFork(copy, m_globals[i.Bx()], copy.fork.m_globals[i.Bx()]))
+                        return false;
+                }
+                break;
+            case OpCode::LOADK:
+            {
+                Value constant;
+                if (!CopyToFork(copy, proto.constants[i.Bx()], constant))
+                    return false;
+                break;
+            }
+            case OpCode::CLOSURE:
+                if (!CheckPure(copy, *m_module->functions[i.Bx()]))
+                    return false;
+                break;
+            default:
+                break;
+            }
+        }
+        return true;
+    }
+
+    Value* VM::StackTop() const
+    {
+        if (m_frames.empty())
+            return m_stack.get();
+
+        const CallFrame& top = m_frames.back();
+        return top.base + top.proto->numRegisters;
+    }
+
+    void VM::TraceRoots(Tracer& tracer)
+    {
+        for (const Value* slot = m_stack.get(); slot < StackTop(); slot++)
+            tracer.Mark(*slot);
+        for (const Value& global : m_globals)
+            tracer.Mark(global);
+        for (const CallFrame& frame : m_frames)
+            tracer.Mark(frame.closure);
+        for (const UpvalueObject* upvalue = m_openUpvalues; upvalue != nullptr; upvalue = upvalue->NextOpen())
+            tracer.Mark(upvalue);
+        for (const TaskObject* task : m_ready)
+            tracer.Mark(task);
+        for (const TaskObject* task : m_external)
+            tracer.Mark(task);
+        tracer.Mark(m_mainTask);
+        tracer.Mark(m_result);
+    }
+
+    // Pushes a frame for script functions and returns true. Natives run right away, leave their result
+    // in the callee slot and return false.
+    bool VM::PrepareCall(Value* callee, int argc)
+    {
+        if (!callee->IsObject())
+            Error("Value of type '" + TypeName(*callee) + "' is not callable.");
+
+        HeapObject* object = callee->AsObject();
+        if (object->Kind() == ObjectKind::Native)
+        {
+            auto* native = static_cast<NativeFunctionObject*>(object);
+            if (native->Arity() >= 0 && native->Arity() != argc)
+                Error("Function '" + native->Name() + "' expects " + std::to_string(native->Arity()) + " argument(s) but got " + std::to_string(argc) + ".");
+
+            *callee = native->Function()(*this, callee + 1, argc, native->Userdata());
+            return false;
+        }
+
+        if (object->Kind() != ObjectKind::Closure)
+            Error("Value of type '" + TypeName(*callee) + "' is not callable.");
+
+        auto* closure = static_cast<ClosureObject*>(object);
+        const FunctionProto* proto = closure->Proto();
+        if (proto->numParams != argc)
+            Error("Function '" + proto->name + "' expects " + std::to_string(proto->numParams) + " argument(s) but got " + std::to_string(argc) + ".");
+
+        Value* base = callee + 1;
+        if (base + proto->numRegisters > m_stack.get() + m_stackSize || m_frames.size() >= MaxCallDepth)
+            Error("Stack overflow.");
+
+        for (Value* reg = base + argc; reg < base + proto->numRegisters; reg++)
+            *reg = Value::Null();
+
+        m_frames.push_back(CallFrame{ closure, proto, proto->code.data(), base, m_caches.get() + proto->firstCache });
+        return true;
+    }
+
+    Value VM::Execute(std::size_t baseDepth)
+    {
+        CallFrame* frame = &m_frames.back();
+        const Instruction* pc = frame->pc;
+        Value* base = frame->base;
+        const Value* k = frame->proto->constants.data();
+
+        auto Reload = [&]()
+        {
+            frame = &m_frames.back();
+            pc = frame->pc;
+            base = frame->base;
+            k = frame->proto->constants.data();
+        };
+
+        if (m_jitEnabled && m_jit.Enter(*frame->proto, pc))
+        {
+            if (m_frames.size() == baseDepth)
+                return base[-1];
+            Reload();
+        }
+
+#if JSCR_COMPUTED_GOTO
+        // Indexed by opcode, in the order of the enum. The compiler only emits valid opcodes, so there
+        // is no bounds check.
+        static const void* const handlers[] =
+        {
+            &&op_MOVE, &&op_LOADK, &&op_LOADNULL, &&op_LOADBOOL, &&op_LOADINT, &&op_GETGLOBAL, &&op_SETGLOBAL,
+            &&op_GETUPVAL, &&op_SETUPVAL, &&op_GETFIELD, &&op_SETFIELD, &&op_GETINDEX, &&op_SETINDEX, &&op_NEWARRAY,
+            &&op_APPEND, &&op_NEWOBJECT, &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV, &&op_MOD, &&op_NEG, &&op_NOT,
+            &&op_EQ, &&op_NE, &&op_LT, &&op_LE, &&op_GT, &&op_GE, &&op_CONVERT, &&op_JMP, &&op_JMPIF, &&op_JMPIFNOT,
+            &&op_JMPTABLE, &&op_CLOSURE, &&op_CALL, &&op_TAILCALL, &&op_RETURN, &&op_CLOSE, &&op_GETINBOUNDS,
+            &&op_SETINBOUNDS, &&op_ASYNC, &&op_AWAIT, &&op_RESOLVE, &&op_IADD, &&op_ISUB, &&op_IMUL, &&op_IDIV,
+            &&op_IMOD, &&op_IEQ, &&op_INE, &&op_ILT, &&op_ILE, &&op_DADD, &&op_DSUB, &&op_DMUL, &&op_DDIV,
+            &&op_DMOD, &&op_DEQ, &&op_DNE, &&op_DLT, &&op_DLE, &&op_FADD, &&op_FSUB, &&op_FMUL, &&op_FDIV,
+            &&op_FMOD, &&op_FEQ, &&op_FNE, &&op_FLT, &&op_FLE, &&op_SEQ, &&op_SNE, &&op_SLT, &&op_SLE, &&op_ADDINT,
+            &&op_SUBINT, &&op_EQJMP, &&op_NEJMP, &&op_LTJMP, &&op_LEJMP, &&op_GTJMP, &&op_GEJMP, &&op_CALLRET,
+            &&op_IEQJMP, &&op_INEJMP, &&op_ILTJMP, &&op_ILEJMP, &&op_DLTJMP, &&op_DLEJMP, &&op_EXTRAARG,
+        };
+        static_assert(std::size(handlers) == (std::size_t) OpCode::EXTRAARG + 1, "Every opcode needs a handler.");
+
+        // Every handler ends in its own indirect jump to the next one, which predicts far better than
+        // the single jump of a switch.
+#define JSCR_CASE(op) case OpCode::op: op_##op
+#define JSCR_NEXT() do { i = *pc++; goto *handlers[(std::size_t) i.Op()]; } while (false)
+#else
+#define JSCR_CASE(op) case OpCode::op
+#define JSCR_NEXT() continue
+#endif
+
+        Instruction i;
+        for (;;)
+        {
+            i = *pc++;
+
+#if JSCR_COMPUTED_GOTO
+            goto *handlers[(std::size_t) i.Op()];
+#endif
+            switch (i.Op())
+            {
+            JSCR_CASE(MOVE):
+                base[i.A()] = base[i.B()];
+                JSCR_NEXT();
+            JSCR_CASE(LOADK):
+                base[i.A()] = k[i.Bx()];
+                JSCR_NEXT();
+            JSCR_CASE(LOADNULL):
+                base[i.A()] = Value::Null();
+                JSCR_NEXT();
+            JSCR_CASE(LOADBOOL):
+                base[i.A()] = Value::Bool(i.B() != 0);
+                JSCR_NEXT();
+            JSCR_CASE(LOADINT):
+                base[i.A()] = Value::Int(i.SBx());
+                JSCR_NEXT();
+            JSCR_CASE(GETGLOBAL):
+                base[i.A()] = m_globals[i.Bx()];
+                JSCR_NEXT();
+            JSCR_CASE(SETGLOBAL):
+                m_globals[i.Bx()] = base[i.A()];
+                JSCR_NEXT();
+            JSCR_CASE(GETUPVAL):
+                base[i.A()] = *frame->closure->Upvalue(i.B())->Location();
+                JSCR_NEXT();
+            JSCR_CASE(SETUPVAL):
+            {
+                UpvalueObject* upvalue = frame->closure->Upvalue(i.B());
+                *upvalue->Location() = base[i.A()];
+                m_heap.WriteBarrier(upvalue, base[i.A()]);
+                JSCR_NEXT();
+            }
+            JSCR_CASE(GETFIELD):
+            {
+                const Value& object = base[i.B()];
+                InlineCache& cache = frame->caches[(pc++)->Bx()];
+                if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Struct)
+                {
+                    auto* instance = static_cast<StructObject*>(object.AsObject());
+                    if (const auto* entry = cache.Find(instance->GetShape()))
+                    {
+                        base[i.A()] = instance->Load(entry->field);
+                        JSCR_NEXT();
+                    }
+                }
+                else if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Instance)
+                {
+                    auto* instance = static_cast<InstanceObject*>(object.AsObject());
+                    if (const auto* entry = cache.Find(instance->GetShape()))
+                    {
+                        base[i.A()] = instance->Slot(entry->slot);
+                        JSCR_NEXT();
+                    }
+                }
+                frame->pc = pc;
+                base[i.A()] = GetField(object, static_cast<const StringObject*>(k[i.C()].AsObject()), cache);
+                JSCR_NEXT();
+            }
+            JSCR_CASE(SETFIELD):
+            {
+                const Value& object = base[i.A()];
+                InlineCache& cache = frame->caches[(pc++)->Bx()];
+                frame->pc = pc;
+                if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Struct)
+                {
+                    auto* instance = static_cast<StructObject*>(object.AsObject());
+                    if (const auto* entry = cache.Find(instance->GetShape()))
+                    {
+                        std::uint8_t conversion = instance->GetShape()->ConversionAt(entry->slot);
+                        Value value = conversion == Shape::NoConversion ? base[i.C()] : Convert(base[i.C()], conversion);
+                        instance->Store(entry->field, value);
+                        m_heap.WriteBarrier(instance, value);
+                        JSCR_NEXT();
+                    }
+                }
+                else if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Instance)
+                {
+                    auto* instance = static_cast<InstanceObject*>(object.AsObject());
+                    const auto* entry = cache.Find(instance->GetShape());
+                    if (entry != nullptr && entry->transition == nullptr)
+                    {
+                        std::uint8_t conversion = instance->GetShape()->ConversionAt(entry->slot);
+                        instance->Slot(entry->slot) = conversion == Shape::NoConversion ? base[i.C()] : Convert(base[i.C()], conversion);
+                        m_heap.WriteBarrier(instance, instance->Slot(entry->slot));
+                        JSCR_NEXT();
+                    }
+                    if (entry != nullptr)
+                    {
+                        instance->AddSlot(entry->transition, base[i.C()]);
+                        m_heap.WriteBarrier(instance, base[i.C()]);
+                        JSCR_NEXT();
+                    }
+                }
+                SetField(object, static_cast<const StringObject*>(k[i.B()].AsObject()), base[i.C()], cache);
+                JSCR_NEXT();
+            }
+            JSCR_CASE(GETINDEX):
+            {
+                const Value& object = base[i.B()];
+                const Value& index = base[i.C()];
+                if (object.IsObject() && index.IsInt() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+                {
+                    auto* array = static_cast<TypedArrayObject*>(object.AsObject());
+                    if ((std::uint32_t) index.AsInt() < array->Length())
+                    {
+                        base[i.A()] = array->Get((std::uint32_t) index.AsInt());
+                        JSCR_NEXT();
+                    }
+                }
+                frame->pc = pc;
+                base[i.A()] = GetIndex(object, index);
+                JSCR_NEXT();
+            }
+            JSCR_CASE(SETINDEX):
+            {
+                const Value& object = base[i.A()];
+                const Value& index = base[i.B()];
+                if (object.IsObject() && index.IsInt() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+                {
+                    auto* array = static_cast<TypedArrayObject*>(object.AsObject());
+                    const Value& value = base[i.C()];
+                    bool exact = (array->GetElementType() == ElementType::Int && value.IsInt()) || (array->GetElementType() == ElementType::Double && value.IsDouble())
+                        || (array->GetElementType() == ElementType::Float && value.IsFloat());
+                    if (exact && !array->IsReadOnly() && (std::uint32_t) index.AsInt() < array->Length())
+                    {
+                        array->Set((std::uint32_t) index.AsInt(), value);
+                        JSCR_NEXT();
+                    }
+                }
+                frame->pc = pc;
+                SetIndex(object, index, base[i.C()]);
+                JSCR_NEXT();
+            }
+            JSCR_CASE(GETINBOUNDS):
+            {
+                const Value& object = base[i.B()];
+                std::uint32_t index = (std::uint32_t) base[i.C()].AsInt();
+                if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+                {
+                    base[i.A()] = static_cast<TypedArrayObject*>(object.AsObject())->Get(index);
+                    JSCR_NEXT();
+                }
+                if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Array)
+                {
+                    base[i.A()] = static_cast<ArrayObject*>(object.AsObject())->Items()[index];
+                    JSCR_NEXT();
+                }
+                frame->pc = pc;
+                base[i.A()] = GetIndex(object, base[i.C()]);
+                JSCR_NEXT();
+            }
+            JSCR_CASE(SETINBOUNDS):
+            {
+                const Value& object = base[i.A()];
+                std::uint32_t index = (std::uint32_t) base[i.B()].AsInt();
+                const Value& value = base[i.C()];
+                if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+                {
+                    auto* array = static_cast<TypedArrayObject*>(object.AsObject());
+                    bool exact = (array->GetElementType() == ElementType::Int && value.IsInt()) || (array->GetElementType() == ElementType::Double && value.IsDouble())
+                        || (array->GetElementType() == ElementType::Float && value.IsFloat());
+                    if (exact && !array->IsReadOnly())
+                    {
+                        array->Set(index, value);
+                        JSCR_NEXT();
+                    }
+                }
+                else if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Array)
+                {
+                    auto* array = static_cast<ArrayObject*>(object.AsObject());
+                    array->Items()[index] = value;
+                    m_heap.WriteBarrier(array, value);
+                    JSCR_NEXT();
+                }
+                frame->pc = pc;
+                SetIndex(object, base[i.B()], value);
+                JSCR_NEXT();
+            }
+            JSCR_CASE(NEWARRAY):
+                base[i.A()] = Value::Object(m_heap.Allocate<ArrayObject>(std::vector<Value>(base + i.B(), base + i.B() + i.C())));
+                JSCR_NEXT();
+            JSCR_CASE(APPEND):
+            {
+                auto* array = static_cast<ArrayObject*>(base[i.A()].AsObject());
+                array->Items().insert(array->Items().end(), base + i.B(), base + i.B() + i.C());
+                // Elements that contain calls can leave the array promoted before the last batch.
+                for (const Value* item = base + i.B(); item < base + i.B() + i.C(); item++)
+                    m_heap.WriteBarrier(array, *item);
+                JSCR_NEXT();
+            }
+            JSCR_CASE(NEWOBJECT):
+                base[i.A()] = NewObject(i.Bx());
+                JSCR_NEXT();
+            JSCR_CASE(ADD):
+            {
+                const Value& b = base[i.B()];
+                const Value& c = base[i.C()];
+                if (Value::BothInt(b, c))
+                    base[i.A()] = Value::AddInt(b, c);
+                else if (Value::BothDouble(b, c))
+                    base[i.A()] = Value::AddDouble(b, c);
+                else
+                {
+                    frame->pc = pc;
+                    base[i.A()] = Arith(OpCode::ADD, b, c);
+                }
+                JSCR_NEXT();
+            }
+            JSCR_CASE(SUB):
+            {
+                const Value& b = base[i.B()];
+                const Value& c = base[i.C()];
+                if (Value::BothInt(b, c))
+                    base[i.A()] = Value::SubInt(b, c);
+                else if (Value::BothDouble(b, c))
+                    base[i.A()] = Value::SubDouble(b, c);
+                else
+                {
+                    frame->pc = pc;
+                    base[i.A()] = Arith(OpCode::SUB, b, c);
+                }
+                JSCR_NEXT();
+            }
+            JSCR_CASE(MUL):
+            {
+                const Value& b = base[i.B()];
+                const Value& c = base[i.C()];
+                if (Value::BothInt(b, c))
+                    base[i.A()] = Value::MulInt(b, c);
+                else if (Value::BothDouble(b, c))
+                    base[i.A()] = Value::MulDouble(b, c);
+                else
+                {
+                    frame->pc = pc;
+                    base[i.A()] = Arith(OpCode::MUL, b, c);
+                }
+                JSCR_NEXT();
+            }
+            JSCR_CASE(DIV):
+                if (Value::BothDouble(base[i.B()], base[i.C()]))
+                {
+                    base[i.A()] = Value::DivDouble(base[i.B()], base[i.C()]);
+                    JSCR_NEXT();
+                }
+                [[fallthrough]];
+            JSCR_CASE(MOD):
+                frame->pc = pc;
+                base[i.A()] = Arith(i.Op(), base[i.B()], base[i.C()]);
+                JSCR_NEXT();
+            JSCR_CASE(NEG):
+            {
+                const Value& b = base[i.B()];
+                switch (b.Type())
+                {
+                case ValueType::Int:    base[i.A()] = Value::NegInt(b); break;
+                case ValueType::Char:   base[i.A()] = Value::Int(-(std::int32_t) b.AsChar()); break;
+                case ValueType::Float:  base[i.A()] = Value::Float(-b.AsFloat()); break;
+                case ValueType::Double: base[i.A()] = Value::Double(-b.AsDouble()); break;
+                default:
+                    frame->pc = pc;
+                    Error("Operator '-' cannot be applied to '" + TypeName(b) + "'.");
+                }
+                JSCR_NEXT();
+            }
+            JSCR_CASE(NOT):
+                base[i.A()] = Value::Bool(!base[i.B()].IsTruthy());
+                JSCR_NEXT();
+            JSCR_CASE(EQ):
+                base[i.A()] = Value::Bool(Equals(base[i.B()], base[i.C()]));
+                JSCR_NEXT();
+            JSCR_CASE(NE):
+                base[i.A()] = Value::Bool(!Equals(base[i.B()], base[i.C()]));
+                JSCR_NEXT();
+            JSCR_CASE(LT):
+            JSCR_CASE(LE):
+            JSCR_CASE(GT):
+            JSCR_CASE(GE):
+            {
+                const Value& b = base[i.B()];
+                const Value& c = base[i.C()];
+                if (Value::BothInt(b, c))
+                {
+                    std::int32_t l = b.AsInt(), r = c.AsInt();
+                    bool result = i.Op() == OpCode::LT ? l < r : i.Op() == OpCode::LE ? l <= r : i.Op() == OpCode::GT ? l > r : l >= r;
+                    base[i.A()] = Value::Bool(result);
+                }
+                else if (Value::BothDouble(b, c))
+                {
+                    double l = b.AsDouble(), r = c.AsDouble();
+                    bool result = i.Op() == OpCode::LT ? l < r : i.Op() == OpCode::LE ? l <= r : i.Op() == OpCode::GT ? l > r : l >= r;
+                    base[i.A()] = Value::Bool(result);
+                }
+                else
+                {
+                    frame->pc = pc;
+                    base[i.A()] = Value::Bool(Compare(i.Op(), b, c));
+                }
+                JSCR_NEXT();
+            }
+            JSCR_CASE(CONVERT):
+                frame->pc = pc;
+                base[i.A()] = Convert(base[i.B()], i.C());
+                JSCR_NEXT();
+            JSCR_CASE(JMP):
+                pc += i.SBx();
+                // Loops always end in a backward jump, so checking here bounds the time between collections
+                // and lets long running loops move on to compiled code.
+                if (i.SBx() < 0)
+                {
+                    frame->pc = pc;
+                    if (--m_fuel < 0 && OutOfFuel())
+                        return Value::Null();
+                    if (m_heap.WantsCollection())
+                        m_heap.Step(*this);
+                    if (m_jitEnabled && m_jit.Enter(*frame->proto, pc))
+                    {
+                        if (m_frames.size() == baseDepth)
+                            return base[-1];
+                        Reload();
+                    }
+                }
+                JSCR_NEXT();
+            JSCR_CASE(JMPIF):
+                if (base[i.A()].IsTruthy())
+                    pc += i.SBx();
+                JSCR_NEXT();
+            JSCR_CASE(JMPIFNOT):
+                if (!base[i.A()].IsTruthy())
+                    pc += i.SBx();
+                JSCR_NEXT();
+            JSCR_CASE(JMPTABLE):
+            {
+                const JumpTable& table = frame->proto->jumpTables[i.Bx()];
+                const Value& value = base[i.A()];
+                std::int64_t index = -1;
+                if (value.IsInt())
+                    index = (std::int64_t) value.AsInt() - table.low;
+                else if (value.IsNumber() && value.ToDouble() == std::floor(value.ToDouble()) && std::abs(value.ToDouble()) < 2147483648.0)
+                    index = (std::int64_t) value.ToDouble() - table.low;
+
+                pc += index >= 0 && index < (std::int64_t) table.targets.size() ? table.targets[index] : table.fallback;
+                JSCR_NEXT();
+            }
+            JSCR_CASE(CLOSURE):
+            {
+                const FunctionProto* proto = m_module->functions[i.Bx()].get();
+                ClosureObject* closure = m_heap.AllocateClosure(proto, proto->upvalues.size());
+                for (std::size_t n = 0; n < proto->upvalues.size(); n++)
+                {
+                    const UpvalueDesc& desc = proto->upvalues[n];
+                    closure->SetUpvalue(n, desc.fromParentLocal ? CaptureUpvalue(base + desc.index) : frame->closure->Upvalue(desc.index));
+                }
+
+                base[i.A()] = Value::Object(closure);
+                JSCR_NEXT();
+            }
+            JSCR_CASE(CALL):
+            callFunction:
+                frame->pc = pc;
+                // Giving the thread back runs the call again once the run goes on.
+                if (--m_fuel < 0 && OutOfFuel())
+                {
+                    frame->pc = pc - 1;
+                    return Value::Null();
+                }
+                if (m_heap.WantsCollection())
+                    m_heap.Step(*this);
+                if (PrepareCall(base + i.A(), i.B()))
+                {
+                    Reload();
+                    if (m_jitEnabled && m_jit.Enter(*frame->proto, pc))
+                        Reload();
+                }
+                JSCR_NEXT();
+            JSCR_CASE(TAILCALL):
+            {
+                // Natives return right away, and conversions that no longer fit need a frame of their own.
+                ReturnConversions pending = frame->returnConversions;
+                const Value& callee = base[i.A()];
+                if (!callee.IsObject() || callee.AsObject()->Kind() != ObjectKind::Closure || !PendConversion(pending, i.C()))
+                    goto callFunction;
+
+                frame->pc = pc;
+                if (--m_fuel < 0 && OutOfFuel())
+                {
+                    frame->pc = pc - 1;
+                    return Value::Null();
+                }
+                if (m_heap.WantsCollection())
+                    m_heap.Step(*this);
+
+                // The callee and its arguments move down to where this frame's callee and arguments are.
+                CloseUpvalues(base);
+                std::copy(base + i.A(), base + i.A() + i.B() + 1, base - 1);
+                m_frames.pop_back();
+                PrepareCall(base - 1, i.B());
+                m_frames.back().returnConversions = pending;
+
+                Reload();
+                if (m_jitEnabled && m_jit.Enter(*frame->proto, pc))
+                {
+                    if (m_frames.size() == baseDepth)
+                        return base[-1];
+                    Reload();
+                }
+                JSCR_NEXT();
+            }
+            JSCR_CASE(RETURN):
+            returnFromFrame:
+            {
+                Value result = i.B() != 0 ? base[i.A()] : Value::Null();
+                if (frame->returnConversions[0] != Conversion::None)
+                {
+                    frame->pc = pc;
+                    result = ConvertReturn(result, frame->returnConversions);
+                }
+                CloseUpvalues(base);
+                m_frames.pop_back();
+                base[-1] = result; // <-- The callee slot of the caller receives the result.
+
+                if (m_frames.size() == baseDepth)
+                    return result;
+
+                Reload();
+                // A caller that called through CALLRET returns the result right away as well.
+                if (pc[-1].Op() == OpCode::CALLRET)
+                {
+                    i = *pc++;
+                    goto returnFromFrame;
+                }
+                JSCR_NEXT();
+            }
+            JSCR_CASE(CLOSE):
+                CloseUpvalues(base + i.A());
+                JSCR_NEXT();
+            JSCR_CASE(ASYNC):
+                base[i.A()] = Value::Object(m_heap.Allocate<TaskObject>());
+                JSCR_NEXT();
+            JSCR_CASE(AWAIT):
+            {
+                // Anything but a task is its own result.
+                const Value& awaited = base[i.B()];
+                if (!awaited.IsObject() || awaited.AsObject()->Kind() != ObjectKind::Task)
+                {
+                    base[i.A()] = awaited;
+                    JSCR_NEXT();
+                }
+
+                auto* task = static_cast<TaskObject*>(awaited.AsObject());
+                if (task->GetState() == TaskObject::State::Fulfilled)
+                {
+                    base[i.A()] = task->Result();
+                    JSCR_NEXT();
+                }
+
+                frame->pc = pc;
+                if (task->GetState() == TaskObject::State::Rejected)
+                    throw RuntimeException(task->Error());
+
+                // The call returns its own task until it is resumed.
+                Suspend(static_cast<TaskObject*>(base[i.C()].AsObject()), task);
+                i = Instruction::ABC(OpCode::RETURN, i.C(), 1);
+                goto returnFromFrame;
+            }
+            JSCR_CASE(RESOLVE):
+                Settle(static_cast<TaskObject*>(base[i.A()].AsObject()), false, i.C() != 0 ? base[i.B()] : Value::Null());
+                JSCR_NEXT();
+            JSCR_CASE(IADD):
+                base[i.A()] = Value::AddInt(base[i.B()], base[i.C()]);
+                JSCR_NEXT();
+            JSCR_CASE(ISUB):
+                base[i.A()] = Value::SubInt(base[i.B()], base[i.C()]);
+                JSCR_NEXT();
+            JSCR_CASE(IMUL):
+                base[i.A()] = Value::MulInt(base[i.B()], base[i.C()]);
+                JSCR_NEXT();
+            JSCR_CASE(IDIV):
+            JSCR_CASE(IMOD):
+            {
+                std::int32_t l = base[i.B()].AsInt(), r = base[i.C()].AsInt();
+                // Division by zero raises the error and INT_MIN / -1 wraps, both in Arith.
+                if (r != 0 && r != -1)
+                    base[i.A()] = Value::Int(i.Op() == OpCode::IDIV ? l / r : l % r);
+                else
+                {
+                    frame->pc = pc;
+                    base[i.A()] = Arith(Specialization::Generic(i.Op()), base[i.B()], base[i.C()]);
+                }
+                JSCR_NEXT();
+            }
+            JSCR_CASE(IEQ):
+                base[i.A()] = Value::Bool(base[i.B()].AsInt() == base[i.C()].AsInt());
+                JSCR_NEXT();
+            JSCR_CASE(INE):
+                base[i.A()] = Value::Bool(base[i.B()].AsInt() != base[i.C()].AsInt());
+                JSCR_NEXT();
+            JSCR_CASE(ILT):
+                base[i.A()] = Value::Bool(base[i.B()].AsInt() < base[i.C()].AsInt());
+                JSCR_NEXT();
+            JSCR_CASE(ILE):
+                base[i.A()] = Value::Bool(base[i.B()].AsInt() <= base[i.C()].AsInt());
+                JSCR_NEXT();
+            JSCR_CASE(DADD):
+                base[i.A()] = Value::AddDouble(base[i.B()], base[i.C()]);
+                JSCR_NEXT();
+            JSCR_CASE(DSUB):
+                base[i.A()] = Value::SubDouble(base[i.B()], base[i.C()]);
+                JSCR_NEXT();
+            JSCR_CASE(DMUL):
+                base[i.A()] = Value::MulDouble(base[i.B()], base[i.C()]);
+                JSCR_NEXT();
+            JSCR_CASE(DDIV):
+                base[i.A()] = Value::DivDouble(base[i.B()], base[i.C()]);
+                JSCR_NEXT();
+            JSCR_CASE(DMOD):
+                base[i.A()] = Value::Double(std::fmod(base[i.B()].AsDouble(), base[i.C()].AsDouble()));
+                JSCR_NEXT();
+            JSCR_CASE(DEQ):
+                base[i.A()] = Value::Bool(base[i.B()].AsDouble() == base[i.C()].AsDouble());
+                JSCR_NEXT();
+            JSCR_CASE(DNE):
+                base[i.A()] = Value::Bool(base[i.B()].AsDouble() != base[i.C()].AsDouble());
+                JSCR_NEXT();
+            JSCR_CASE(DLT):
+                base[i.A()] = Value::Bool(base[i.B()].AsDouble() < base[i.C()].AsDouble());
+                JSCR_NEXT();
+            JSCR_CASE(DLE):
+                base[i.A()] = Value::Bool(base[i.B()].AsDouble() <= base[i.C()].AsDouble());
+                JSCR_NEXT();
+            JSCR_CASE(FADD):
+                base[i.A()] = Value::Float(base[i.B()].AsFloat() + base[i.C()].AsFloat());
+                JSCR_NEXT();
+            JSCR_CASE(FSUB):
+                base[i.A()] = Value::Float(base[i.B()].AsFloat() - base[i.C()].AsFloat());
+                JSCR_NEXT();
+            JSCR_CASE(FMUL):
+                base[i.A()] = Value::Float(base[i.B()].AsFloat() * base[i.C()].AsFloat());
+                JSCR_NEXT();
+            JSCR_CASE(FDIV):
+                base[i.A()] = Value::Float(base[i.B()].AsFloat() / base[i.C()].AsFloat());
+                JSCR_NEXT();
+            JSCR_CASE(FMOD):
+                base[i.A()] = Value::Float(std::fmod(base[i.B()].AsFloat(), base[i.C()].AsFloat()));
+                JSCR_NEXT();
+            JSCR_CASE(FEQ):
+                base[i.A()] = Value::Bool(base[i.B()].AsFloat() == base[i.C()].AsFloat());
+                JSCR_NEXT();
+            JSCR_CASE(FNE):
+                base[i.A()] = Value::Bool(base[i.B()].AsFloat() != base[i.C()].AsFloat());
+                JSCR_NEXT();
+            JSCR_CASE(FLT):
+                base[i.A()] = Value::Bool(base[i.B()].AsFloat() < base[i.C()].AsFloat());
+                JSCR_NEXT();
+            JSCR_CASE(FLE):
+                base[i.A()] = Value::Bool(base[i.B()].AsFloat() <= base[i.C()].AsFloat());
+                JSCR_NEXT();
+            JSCR_CASE(SEQ):
+            JSCR_CASE(SNE):
+            JSCR_CASE(SLT):
+            JSCR_CASE(SLE):
+            {
+                // Strings may still be null.
+                const Value& b = base[i.B()];
+                const Value& c = base[i.C()];
+                bool result;
+                if (b.IsObject() && c.IsObject())
+                {
+                    auto* l = static_cast<StringObject*>(b.AsObject());
+                    auto* r = static_cast<StringObject*>(c.AsObject());
+                    result = i.Op() == OpCode::SEQ ? StringObject::Equal(l, r) : i.Op() == OpCode::SNE ? !StringObject::Equal(l, r)
+                        : i.Op() == OpCode::SLT ? l->Data() < r->Data() : l->Data() <= r->Data();
+                }
+                else if (i.Op() == OpCode::SEQ || i.Op() == OpCode::SNE)
+                    result = Equals(b, c) == (i.Op() == OpCode::SEQ);
+                else
+                {
+                    frame->pc = pc;
+                    result = Compare(Specialization::Generic(i.Op()), b, c);
+                }
+                base[i.A()] = Value::Bool(result);
+                JSCR_NEXT();
+            }
+            JSCR_CASE(ADDINT):
+            JSCR_CASE(SUBINT):
+            {
+                base[i.A()] = Value::Int(i.SBx());
+                const Instruction arith = *pc;
+                const Value& b = base[arith.B()];
+                if (b.IsInt())
+                {
+                    base[arith.A()] = i.Op() == OpCode::ADDINT ? Value::AddInt(b, base[i.A()]) : Value::SubInt(b, base[i.A()]);
+                    pc++;
+                    // Storing the result in an `int` variable converts it to what it already is.
+                    if (pc->Op() == OpCode::CONVERT && pc->A() == arith.A() && pc->B() == arith.A() && pc->C() == (std::uint8_t) Types::Uid::Int)
+                        pc++;
+                }
+                JSCR_NEXT();
+            }
+            JSCR_CASE(EQJMP):
+            JSCR_CASE(NEJMP):
+            {
+                bool result = Equals(base[i.B()], base[i.C()]) == (i.Op() == OpCode::EQJMP);
+                base[i.A()] = Value::Bool(result);
+                const Instruction jump = *pc++;
+                if (result == (jump.Op() == OpCode::JMPIF))
+                    pc += jump.SBx();
+                JSCR_NEXT();
+            }
+            JSCR_CASE(LTJMP):
+            JSCR_CASE(LEJMP):
+            JSCR_CASE(GTJMP):
+            JSCR_CASE(GEJMP):
+            {
+                const Value& b = base[i.B()];
+                const Value& c = base[i.C()];
+                bool result;
+                if (Value::BothInt(b, c))
+                {
+                    std::int32_t l = b.AsInt(), r = c.AsInt();
+                    result = i.Op() == OpCode::LTJMP ? l < r : i.Op() == OpCode::LEJMP ? l <= r : i.Op() == OpCode::GTJMP ? l > r : l >= r;
+                }
+                else if (Value::BothDouble(b, c))
+                {
+                    double l = b.AsDouble(), r = c.AsDouble();
+                    result = i.Op() == OpCode::LTJMP ? l < r : i.Op() == OpCode::LEJMP ? l <= r : i.Op() == OpCode::GTJMP ? l > r : l >= r;
+                }
+                else
+                {
+                    frame->pc = pc;
+                    result = Compare(Superinstructions::Unfuse(i).Op(), b, c);
+                }
+                base[i.A()] = Value::Bool(result);
+                const Instruction jump = *pc++;
+                if (result == (jump.Op() == OpCode::JMPIF))
+                    pc += jump.SBx();
+                JSCR_NEXT();
+            }
+            JSCR_CASE(CALLRET):
+                frame->pc = pc;
+                if (--m_fuel < 0 && OutOfFuel())
+                {
+                    frame->pc = pc - 1;
+                    return Value::Null();
+                }
+                if (m_heap.WantsCollection())
+                    m_heap.Step(*this);
+                if (PrepareCall(base + i.A(), i.B()))
+                {
+                    Reload();
+                    if (m_jitEnabled && m_jit.Enter(*frame->proto, pc))
+                        Reload();
+                    JSCR_NEXT();
+                }
+                // Natives have returned already.
+                i = *pc++;
+                goto returnFromFrame;
+            JSCR_CASE(IEQJMP):
+            JSCR_CASE(INEJMP):
+            JSCR_CASE(ILTJMP):
+            JSCR_CASE(ILEJMP):
+            {
+                std::int32_t l = base[i.B()].AsInt(), r = base[i.C()].AsInt();
+                bool result = i.Op() == OpCode::IEQJMP ? l == r : i.Op() == OpCode::INEJMP ? l != r : i.Op() == OpCode::ILTJMP ? l < r : l <= r;
+                base[i.A()] = Value::Bool(result);
+                const Instruction jump = *pc++;
+                if (result == (jump.Op() == OpCode::JMPIF))
+                    pc += jump.SBx();
+                JSCR_NEXT();
+            }
+            JSCR_CASE(DLTJMP):
+            JSCR_CASE(DLEJMP):
+            {
+                double l = base[i.B()].AsDouble(), r = base[i.C()].AsDouble();
+                bool result = i.Op() == OpCode::DLTJMP ? l < r : l <= r;
+                base[i.A()] = Value::Bool(result);
+                const Instruction jump = *pc++;
+                if (result == (jump.Op() == OpCode::JMPIF))
+                    pc += jump.SBx();
+                JSCR_NEXT();
+            }
+            JSCR_CASE(EXTRAARG):
+            default:
+                frame->pc = pc;
+                Error("Invalid instruction.");
+            }
+        }
+#undef JSCR_CASE
+#undef JSCR_NEXT
+    }
+
+    // ----- Upvalues -----
+
+    UpvalueObject* VM::CaptureUpvalue(Value* slot)
+    {
+        UpvalueObject* prev = nullptr;
+        UpvalueObject* upvalue = m_openUpvalues;
+
+        // The open list is sorted by stack slot, highest first.
+        while (upvalue != nullptr && upvalue->Location() > slot)
+        {
+            prev = upvalue;
+            upvalue = upvalue->NextOpen();
+        }
+
+        if (upvalue != nullptr && upvalue->Location() == slot)
+            return upvalue;
+
+        UpvalueObject* created = m_heap.Allocate<UpvalueObject>(slot);
+        created->SetNextOpen(upvalue);
+        if (prev == nullptr)
+            m_openUpvalues = created;
+        else
+            prev->SetNextOpen(created);
+
+        return created;
+    }
+
+    void VM::CloseUpvalues(Value* level)
+    {
+        while (m_openUpvalues != nullptr && m_openUpvalues->Location() >= level)
+        {
+            UpvalueObject* upvalue = m_openUpvalues;
+            m_openUpvalues = upvalue->NextOpen();
+            upvalue->Close();
+            m_heap.WriteBarrier(upvalue, *upvalue->Location());
+        }
+    }
+
+    // ----- Tasks -----
+
+    void VM::Suspend(TaskObject* task, TaskObject* awaited)
+    {
+        const CallFrame& frame = m_frames.back();
+        task->m_closure = frame.closure;
+        task->m_pc = (std::uint32_t) (frame.pc - frame.proto->code.data());
+        task->m_awaited = awaited;
+        task->m_registers.assign(frame.base, frame.base + frame.proto->numRegisters);
+
+        // Closed by the return that follows, and reopened on the new stack slots on resume.
+        task->m_upvalues.clear();
+        for (UpvalueObject* upvalue = m_openUpvalues; upvalue != nullptr && upvalue->Location() >= frame.base; upvalue = upvalue->NextOpen())
+        {
+            task->m_upvalues.emplace_back(upvalue, (std::uint8_t) (upvalue->Location() - frame.base));
+            m_heap.WriteBarrier(task, Value::Object(upvalue));
+        }
+
+        awaited->m_waiters.push_back(task);
+        m_heap.WriteBarrier(awaited, Value::Object(task));
+        m_heap.WriteBarrier(task, Value::Object(const_cast<ClosureObject*>(frame.closure)));
+        for (const Value& reg : task->m_registers)
+            m_heap.WriteBarrier(task, reg);
+    }
+
+    bool VM::Resume(TaskObject* task)
+    {
+        const TaskObject* awaited = task->m_awaited;
+        task->m_awaited = nullptr;
+        if (awaited->GetState() == TaskObject::State::Rejected)
+        {
+            task->m_registers.clear();
+            task->m_upvalues.clear();
+            Settle(task, true, Value::Null(), awaited->Error());
+            return true;
+        }
+
+        const FunctionProto* proto = task->m_closure->Proto();
+        std::size_t depth = m_frames.size();
+        Value* slot = StackTop();
+        if (slot + proto->numRegisters + 1 > m_stack.get() + m_stackSize)
+            Error("Stack overflow.");
+
+        // The frame goes back on top of the stack, which is not where it was before.
+        Value* base = slot + 1;
+        slot[0] = Value::Object(task);
+        std::copy(task->m_registers.begin(), task->m_registers.end(), base);
+        for (auto it = task->m_upvalues.rbegin(); it != task->m_upvalues.rend(); ++it)
+        {
+            it->first->Reopen(base + it->second);
+            it->first->SetNextOpen(m_openUpvalues);
+            m_openUpvalues = it->first;
+        }
+        task->m_registers.clear();
+        task->m_upvalues.clear();
+
+        const Instruction* pc = proto->code.data() + task->m_pc;
+        m_frames.push_back(CallFrame{ task->m_closure, proto, pc, base, m_caches.get() + proto->firstCache });
+        base[pc[-1].A()] = awaited->Result();
+
+        return Continue(depth, task);
+    }
+
+    void VM::Settle(TaskObject* task, bool rejected, const Value& result, std::string error)
+    {
+        task->m_state = rejected ? TaskObject::State::Rejected : TaskObject::State::Fulfilled;
+        task->m_result = result;
+        task->m_error = std::move(error);
+        m_heap.WriteBarrier(task, result);
+
+        m_ready.insert(m_ready.end(), task->m_waiters.begin(), task->m_waiters.end());
+        task->m_waiters = {};
+        m_external.erase(task);
+    }
+
+    // ----- Fuel -----
+
+    void VM::SetFuel(std::uint64_t slice, std::uint64_t limit)
+    {
+        m_fuelSlice = slice;
+        m_fuelLimit = limit;
+        Refuel();
+    }
+
+    bool VM::OutOfFuel()
+    {
+        if (m_fuelLimit != 0 && FuelUsed() > m_fuelLimit)
+        {
+            Refuel();
+            Error("The script used up its fuel limit of " + std::to_string(m_fuelLimit) + ".");
+        }
+
+        // Short of the limit, only the slice can have ended.
+        if (m_preemptible && m_fuelSlice != 0)
+            return true;
+        Refuel();
+        return false;
+    }
+
+    void VM::Refuel()
+    {
+        std::uint64_t used = FuelUsed();
+        std::uint64_t window = m_fuelSlice != 0 ? m_fuelSlice : INT64_MAX;
+        if (m_fuelLimit != 0)
+            window = std::min(window, m_fuelLimit > used ? m_fuelLimit - used : 0);
+
+        m_fuelCharged = used;
+        m_fuelWindow = m_fuel = (std::int64_t) std::min<std::uint64_t>(window, INT64_MAX);
+    }
+
+    // ----- Operators -----
+
+    Value VM::Arith(OpCode op, const Value& a, const Value& b)
+    {
+        static const char* symbols[] = { "+", "-", "*", "/", "%" };
+        const char* symbol = symbols[(int) op - (int) OpCode::ADD];
+
+        if (a.IsNumber() && b.IsNumber())
+        {
+            if (a.IsDouble() || b.IsDouble())
+            {
+                double l = a.ToDouble(), r = b.ToDouble();
+                switch (op)
+                {
+                case OpCode::ADD: return Value::Double(l + r);
+                case OpCode::SUB: return Value::Double(l - r);
+                case OpCode::MUL: return Value::Double(l * r);
+                case OpCode::DIV: return Value::Double(l / r);
+                default:          return Value::Double(std::fmod(l, r));
+                }
+            }
+
+            if (a.IsFloat() || b.IsFloat())
+            {
+                float l = (float) a.ToDouble(), r = (float) b.ToDouble();
+                switch (op)
+                {
+                case OpCode::ADD: return Value::Float(l + r);
+                case OpCode::SUB: return Value::Float(l - r);
+                case OpCode::MUL: return Value::Float(l * r);
+                case OpCode::DIV: return Value::Float(l / r);
+                default:          return Value::Float(std::fmod(l, r));
+                }
+            }
+
+            // Integer arithmetic wraps around instead of being undefined.
+            std::uint32_t l = (std::uint32_t) a.ToInt(), r = (std::uint32_t) b.ToInt();
+            switch (op)
+            {
+            case OpCode::ADD: return Value::Int((std::int32_t) (l + r));
+            case OpCode::SUB: return Value::Int((std::int32_t) (l - r));
+            case OpCode::MUL: return Value::Int((std::int32_t) (l * r));
+            default:
+                if (r == 0)
+                    Error("Integer division by zero.");
+                if ((std::int32_t) r == -1)
+                    return Value::Int(op == OpCode::DIV ? (std::int32_t) (0u - l) : 0);
+                return Value::Int(op == OpCode::DIV ? (std::int32_t) l / (std::int32_t) r : (std::int32_t) l % (std::int32_t) r);
+            }
+        }
+
+        bool aIsString = a.IsObject() && a.AsObject()->Kind() == ObjectKind::String;
+        bool bIsString = b.IsObject() && b.AsObject()->Kind() == ObjectKind::String;
+        if (op == OpCode::ADD && (aIsString || bIsString))
+        {
+            const StringObject* left = aIsString ? static_cast<StringObject*>(a.AsObject()) : NewString(ToString(a));
+            const StringObject* right = bIsString ? static_cast<StringObject*>(b.AsObject()) : NewString(ToString(b));
+            return Value::Object(StringObject::Concat(m_heap, left, right));
+        }
+
+        Error(std::string("Operator '") + symbol + "' cannot be applied to '" + TypeName(a) + "' and '" + TypeName(b) + "'.");
+    }
+
+    bool VM::Compare(OpCode op, const Value& a, const Value& b)
+    {
+        int order;
+        if (a.IsNumber() && b.IsNumber())
+        {
+            double l = a.ToDouble(), r = b.ToDouble();
+            if (std::isnan(l) || std::isnan(r))
+                return false;
+            order = l < r ? -1 : l > r ? 1 : 0;
+        }
+        else if (a.IsObject() && b.IsObject() && a.AsObject()->Kind() == ObjectKind::String && b.AsObject()->Kind() == ObjectKind::String)
+        {
+            order = static_cast<StringObject*>(a.AsObject())->Data().compare(static_cast<StringObject*>(b.AsObject())->Data());
+        }
+        else
+        {
+            Error("Cannot compare '" + TypeName(a) + "' with '" + TypeName(b) + "'.");
+        }
+
+        switch (op)
+        {
+        case OpCode::LT: return order < 0;
+        case OpCode::LE: return order <= 0;
+        case OpCode::GT: return order > 0;
+        default:         return order >= 0;
+        }
+    }
+
+    bool VM::Equals(const Value& a, const Value& b)
+    {
+        if (a.IsNumber() && b.IsNumber())
+        {
+            if (Value::BothInt(a, b))
+                return a.AsInt() == b.AsInt();
+            return a.ToDouble() == b.ToDouble();
+        }
+
+        if (a.IsObject() && b.IsObject() && a.AsObject()->Kind() == ObjectKind::String && b.AsObject()->Kind() == ObjectKind::String)
+            return StringObject::Equal(static_cast<StringObject*>(a.AsObject()), static_cast<StringObject*>(b.AsObject()));
+
+        return a.IsIdentical(b);
+    }
+
+    Value VM::Convert(const Value& value, std::uint8_t conversion)
+    {
+        auto Fail = [&](const char* target)
+        {
+            Error("Cannot convert '" + TypeName(value) + "' to '" + target + "'.");
+        };
+
+        if (conversion & Conversion::TypedArray)
+            return ConvertToTypedArray(value, conversion & ~Conversion::TypedArray);
+
+        switch ((Types::Uid) conversion)
+        {
+        case Types::Uid::Int:
+            if (value.IsInt()) return value;
+            if (!value.IsNumber()) Fail("int");
+            return Value::Int(value.ToInt());
+        case Types::Uid::Float:
+            if (value.IsFloat()) return value;
+            if (!value.IsNumber()) Fail("float");
+            return Value::Float((float) value.ToDouble());
+        case Types::Uid::Double:
+            if (value.IsDouble()) return value;
+            if (!value.IsNumber()) Fail("double");
+            return Value::Double(value.ToDouble());
+        case Types::Uid::Char:
+            if (value.IsChar()) return value;
+            if (!value.IsInt()) Fail("char");
+            return Value::Char((char) value.AsInt());
+        case Types::Uid::Bool:
+            if (!value.IsBool()) Fail("bool");
+            return value;
+        case Types::Uid::String:
+            if (!value.IsNull() && !(value.IsObject() && value.AsObject()->Kind() == ObjectKind::String)) Fail("string");
+            return value;
+        default:
+            return value;
+        }
+    }
+
+    Value VM::ConvertReturn(Value value, const ReturnConversions& conversions)
+    {
+        for (std::uint8_t conversion : conversions)
+        {
+            if (conversion == Conversion::None)
+                break;
+            value = Convert(value, conversion);
+        }
+        return value;
+    }
+
+    // Converting twice to the same type is converting once. Converting to X, to Y and back to X is
+    // converting to X when Y holds every X exactly: int and float in double, char in int. That keeps
+    // the conversions of two typed functions that tail call each other from piling up.
+    bool VM::PendConversion(ReturnConversions& conversions, std::uint8_t conversion)
+    {
+        auto Holds = [](std::uint8_t outer, std::uint8_t inner)
+        {
+            if (outer == (std::uint8_t) Types::Uid::Double)
+                return inner == (std::uint8_t) Types::Uid::Int || inner == (std::uint8_t) Types::Uid::Float;
+            return outer == (std::uint8_t) Types::Uid::Int && inner == (std::uint8_t) Types::Uid::Char;
+        };
+
+        if (conversion == Conversion::None || conversions[0] == conversion)
+            return true;
+        if (conversions[1] == conversion && Holds(conversions[0], conversion))
+        {
+            std::copy(conversions.begin() + 1, conversions.end(), conversions.begin());
+            conversions.back() = Conversion::None;
+            return true;
+        }
+        if (conversions.back() != Conversion::None)
+            return false;
+
+        std::copy_backward(conversions.begin(), conversions.end() - 1, conversions.end());
+        conversions[0] = conversion;
+        return true;
+    }
+
+    // Generic arrays are copied into an unboxed array, converting every element. Typed arrays of the
+    // right element type pass through as they are.
+    Value VM::ConvertToTypedArray(const Value& value, std::uint8_t elementUid)
+    {
+        ElementType type = Conversion::ElementTypeOf(elementUid).value();
+        if (value.IsNull())
+            return value;
+
+        if (value.IsObject() && value.AsObject()->Kind() == ObjectKind::TypedArray)
+        {
+            if (static_cast<TypedArrayObject*>(value.AsObject())->GetElementType() == type)
+                return value;
+        }
+        else if (value.IsObject() && value.AsObject()->Kind() == ObjectKind::Array)
+        {
+            const auto& items = static_cast<ArrayObject*>(value.AsObject())->Items();
+            auto* array = m_heap.Allocate<TypedArrayObject>(type, items.size());
+            for (std::size_t i = 0; i < items.size(); i++)
+                array->Set(i, Convert(items[i], elementUid));
+            return Value::Object(array);
+        }
+
+        Error("Cannot convert '" + TypeName(value) + "' to '" + TypedArrayObject::ElementName(type) + "[]'.");
+    }
+
+    // ----- Objects, arrays and strings -----
+
+    Value VM::NewObject(std::uint16_t typeIndex)
+    {
+        if (typeIndex == Module::AnonymousObjectType)
+            return Value::Object(m_heap.Allocate<InstanceObject>(m_shapes.Empty()));
+        return Value::Object(m_heap.AllocateStruct(m_typeShapes[typeIndex]));
+    }
+
+    Value VM::GetField(const Value& object, const StringObject* key, InlineCache& cache)
+    {
+        if (!object.IsObject())
+            Error("Cannot read property '" + std::string(key->Data()) + "' of '" + TypeName(object) + "'.");
+
+        HeapObject* heapObject = object.AsObject();
+        switch (heapObject->Kind())
+        {
+        case ObjectKind::Instance:
+        {
+            auto* instance = static_cast<InstanceObject*>(heapObject);
+            int slot = instance->GetShape()->Find(key->Data());
+            if (slot < 0)
+                break;
+            cache.Add(instance->GetShape(), (std::uint32_t) slot);
+            return instance->Slot(slot);
+        }
+        case ObjectKind::Struct:
+        {
+            auto* instance = static_cast<StructObject*>(heapObject);
+            int slot = instance->GetShape()->Find(key->Data());
+            if (slot < 0)
+                break;
+            cache.Add(instance->GetShape(), (std::uint32_t) slot);
+            return instance->Get(slot);
+        }
+        case ObjectKind::Enum:
+        {
+            const auto& entries = static_cast<EnumObject*>(heapObject)->Type()->entries;
+            for (std::size_t i = 0; i < entries.size(); i++)
+            {
+                if (entries[i] == key->Data())
+                    return Value::Int((std::int32_t) i);
+            }
+            break;
+        }
+        case ObjectKind::Array:
+            if (key->Data() == "length")
+                return Value::Int((std::int32_t) static_cast<ArrayObject*>(heapObject)->Items().size());
+            break;
+        case ObjectKind::TypedArray:
+            if (key->Data() == "length")
+                return Value::Int((std::int32_t) static_cast<TypedArrayObject*>(heapObject)->Length());
+            break;
+        case ObjectKind::String:
+            if (key->Data() == "length")
+                return Value::Int((std::int32_t) static_cast<StringObject*>(heapObject)->Length());
+            break;
+        case ObjectKind::Map:
+        case ObjectKind::Set:
+            if (key->Data() == "length")
+                return Value::Int((std::int32_t) static_cast<HashTableObject*>(heapObject)->Size());
+            break;
+        case ObjectKind::Deque:
+            if (key->Data() == "length")
+                return Value::Int((std::int32_t) static_cast<DequeObject*>(heapObject)->Size());
+            break;
+        case ObjectKind::PriorityQueue:
+            if (key->Data() == "length")
+                return Value::Int((std::int32_t) static_cast<PriorityQueueObject*>(heapObject)->Size());
+            break;
+        default:
+            break;
+        }
+
+        Error("'" + TypeName(object) + "' has no property '" + std::string(key->Data()) + "'.");
+    }
+
+    void VM::SetField(const Value& object, const StringObject* key, const Value& value, InlineCache& cache)
+    {
+        if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Struct)
+        {
+            auto* instance = static_cast<StructObject*>(object.AsObject());
+            const Shape* shape = instance->GetShape();
+            int slot = shape->Find(key->Data());
+            if (slot < 0)
+                Error("Object type '" + shape->Type()->name + "' has no property '" + std::string(key->Data()) + "'.");
+
+            cache.Add(shape, (std::uint32_t) slot);
+            std::uint8_t conversion = shape->ConversionAt(slot);
+            Value converted = conversion == Shape::NoConversion ? value : Convert(value, conversion);
+            instance->Set(slot, converted);
+            m_heap.WriteBarrier(instance, converted);
+            return;
+        }
+
+        if (!object.IsObject() || object.AsObject()->Kind() != ObjectKind::Instance)
+            Error("Cannot assign property '" + std::string(key->Data()) + "' of '" + TypeName(object) + "'.");
+
+        // Anonymous objects only: declared types are always structs.
+        auto* instance = static_cast<InstanceObject*>(object.AsObject());
+        const Shape* shape = instance->GetShape();
+        int slot = shape->Find(key->Data());
+
+        if (slot >= 0)
+        {
+            cache.Add(shape, (std::uint32_t) slot);
+            instance->Slot(slot) = value;
+            m_heap.WriteBarrier(instance, value);
+            return;
+        }
+
+        const Shape* next = m_shapes.AddProperty(shape, std::string(key->Data()));
+        cache.Add(shape, (std::uint32_t) shape->SlotCount(), next);
+        instance->AddSlot(next, value);
+        m_heap.WriteBarrier(instance, value);
+    }
+
+    Value VM::GetIndex(const Value& object, const Value& index)
+    {
+        if (!index.IsInt())
+            Error("Index must be of type 'int', got '" + TypeName(index) + "'.");
+
+        std::int32_t i = index.AsInt();
+        if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::Array)
+        {
+            const auto& items = static_cast<ArrayObject*>(object.AsObject())->Items();
+            if (i < 0 || (std::size_t) i >= items.size())
+                Error("Index " + std::to_string(i) + " is out of bounds for array of length " + std::to_string(items.size()) + ".");
+            return items[i];
+        }
+
+        if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+        {
+            auto* array = static_cast<TypedArrayObject*>(object.AsObject());
+            if (i < 0 || (std::size_t) i >= array->Length())
+                Error("Index " + std::to_string(i) + " is out of bounds for array of length " + std::to_string(array->Length()) + ".");
+            return array->Get(i);
+        }
+
+        if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::String)
+        {
+            const auto& data = static_cast<StringObject*>(object.AsObject())->Data();
+            if (i < 0 || (std::size_t) i >= data.size())
+                Error("Index " + std::to_string(i) + " is out of bounds for string of length " + std::to_string(data.size()) + ".");
+            return Value::Char(data[i]);
+        }
+
+        Error("Cannot index into '" + TypeName(object) + "'.");
+    }
+
+    void VM::SetIndex(const Value& object, const Value& index, const Value& value)
+    {
+        if (object.IsObject() && object.AsObject()->Kind() == ObjectKind::TypedArray)
+        {
+            if (!index.IsInt())
+                Error("Index must be of type 'int', got '" + TypeName(index) + "'.");
+
+            auto* array = static_cast<TypedArrayObject*>(object.AsObject());
+            if (array->IsReadOnly())
+                Error("Cannot assign index of read-only '" + TypeName(object) + "'.");
+            std::int32_t i = index.AsInt();
+            if (i < 0 || (std::size_t) i >= array->Length())
+                Error("Index " + std::to_string(i) + " is out of bounds for array of length " + std::to_string(array->Length()) + ".");
+            array->Set(i, Convert(value, Conversion::ElementUid(array->GetElementType())));
+            return;
+        }
+
+        if (!object.IsObject() || object.AsObject()->Kind() != ObjectKind::Array)
+            Error("Cannot assign index of '" + TypeName(object) + "'.");
+        if (!index.IsInt())
+            Error("Index must be of type 'int', got '" + TypeName(index) + "'.");
+
+        auto* array = static_cast<ArrayObject*>(object.AsObject());
+        auto& items = array->Items();
+        std::int32_t i = index.AsInt();
+        if (i < 0 || (std::size_t) i >= items.size())
+            Error("Index " + std::to_string(i) + " is out of bounds for array of length " + std::to_string(items.size()) + ".");
+        items[i] = value;
+        m_heap.WriteBarrier(array, value);
+    }
+
+    // ----- Helpers -----
+
+    std::string VM::ToString(const Value& value)
+    {
+        switch (value.Type())
+        {
+        case ValueType::Null:   return "null";
+        case ValueType::Bool:   return value.AsBool() ? "true" : "false";
+        case ValueType::Int:    return std::to_string(value.AsInt());
+        case ValueType::Char:   return std::string(1, value.AsChar());
+        case ValueType::Float:
+        case ValueType::Double:
+        {
+            char buffer[32];
+            auto result = value.IsFloat() ? std::to_chars(buffer, buffer + sizeof(buffer), value.AsFloat()) : std::to_chars(buffer, buffer + sizeof(buffer), value.AsDouble());
+            return std::string(buffer, result.ptr);
+        }
+        default:
+            break;
+        }
+
+        HeapObject* object = value.AsObject();
+        switch (object->Kind())
+        {
+        case ObjectKind::String:
+            return std::string(static_cast<StringObject*>(object)->Data());
+        case ObjectKind::Array:
+        {
+            std::string result = "{ ";
+            const auto& items = static_cast<ArrayObject*>(object)->Items();
+            for (std::size_t i = 0; i < items.size(); i++)
+                result += (i > 0 ? ", " : "") + ToString(items[i]);
+            return result + " }";
+        }
+        case ObjectKind::TypedArray:
+        {
+            std::string result = "{ ";
+            auto* array = static_cast<TypedArrayObject*>(object);
+            for (std::size_t i = 0; i < array->Length(); i++)
+                result += (i > 0 ? ", " : "") + ToString(array->Get(i));
+            return result + " }";
+        }
+        case ObjectKind::Instance:
+        {
+            auto* instance = static_cast<InstanceObject*>(object);
+            std::string result = instance->Type() != nullptr ? instance->Type()->name + " { " : "{ ";
+            bool first = true;
+            for (std::size_t i = 0; i < instance->GetShape()->SlotCount(); i++)
+            {
+                result += (first ? "" : ", ") + instance->GetShape()->NameAt(i) + ": " + ToString(instance->Slot(i));
+                first = false;
+            }
+            return result + " }";
+        }
+        case ObjectKind::Struct:
+        {
+            auto* instance = static_cast<StructObject*>(object);
+            std::string result = instance->Type()->name + " { ";
+            for (std::size_t i = 0; i < instance->GetShape()->SlotCount(); i++)
+                result += (i > 0 ? ", " : "") + instance->GetShape()->NameAt(i) + ": " + ToString(instance->Get(i));
+            return result + " }";
+        }
+        case ObjectKind::Enum:
+            return static_cast<EnumObject*>(object)->Type()->name;
+        case ObjectKind::Closure:
+            return "function " + static_cast<ClosureObject*>(object)->Proto()->name;
+        case ObjectKind::Native:
+            return "function " + static_cast<NativeFunctionObject*>(object)->Name();
+        case ObjectKind::AstFunction:
+            return "function";
+        case ObjectKind::Task:
+            return "task";
+        case ObjectKind::Map:
+        case ObjectKind::Set:
+        {
+            auto* table = static_cast<HashTableObject*>(object);
+            std::string result = "{ ";
+            bool first = true;
+            table->ForEach([&](const Value& key, const Value& item)
+            {
+                result += (first ? "" : ", ") + ToString(key) + (table->IsSet() ? "" : ": " + ToString(item));
+                first = false;
+            });
+            return result + " }";
+        }
+        case ObjectKind::Deque:
+        {
+            std::string result = "{ ";
+            auto* deque = static_cast<DequeObject*>(object);
+            for (std::size_t i = 0; i < deque->Size(); i++)
+                result += (i > 0 ? ", " : "") + ToString(deque->At(i));
+            return result + " }";
+        }
+        case ObjectKind::PriorityQueue:
+            return "priorityQueue";
+        default:
+            return "object";
+        }
+    }
+
+    std::string VM::TypeName(const Value& value)
+    {
+        switch (value.Type())
+        {
+        case ValueType::Null:   return "null";
+        case ValueType::Bool:   return "bool";
+        case ValueType::Int:    return "int";
+        case ValueType::Float:  return "float";
+        case ValueType::Double: return "double";
+        case ValueType::Char:   return "char";
+        default:
+            break;
+        }
+
+        switch (value.AsObject()->Kind())
+        {
+        case ObjectKind::String:   return "string";
+        case ObjectKind::Array:    return "array";
+        case ObjectKind::TypedArray:
+            return std::string(TypedArrayObject::ElementName(static_cast<TypedArrayObject*>(value.AsObject())->GetElementType())) + "[]";
+        case ObjectKind::Instance:
+        {
+            const ObjectType* type = static_cast<InstanceObject*>(value.AsObject())->Type();
+            return type != nullptr ? type->name : "object";
+        }
+        case ObjectKind::Struct:   return static_cast<StructObject*>(value.AsObject())->Type()->name;
+        case ObjectKind::Enum:     return static_cast<EnumObject*>(value.AsObject())->Type()->name;
+        case ObjectKind::Closure:
+        case ObjectKind::Native:
+        case ObjectKind::AstFunction: return "function";
+        case ObjectKind::Task:     return "task";
+        case ObjectKind::Map:      return "map";
+        case ObjectKind::Set:      return "set";
+        case ObjectKind::Deque:    return "deque";
+        case ObjectKind::PriorityQueue: return "priorityQueue";
+        default:                   return "object";
+        }
+    }
+
+    void VM::Error(const std::string& description) const
+    {
+        if (m_frames.empty())
+            throw RuntimeException(description);
+
+        const CallFrame& frame = m_frames.back();
+        std::size_t pc = frame.pc - frame.proto->code.data();
+        throw RuntimeException(description + " (in function '" + frame.proto->name + "' at instruction " + std::to_string(pc == 0 ? 0 : pc - 1) + ")");
+    }
+}
@@ -0,0 +1,222 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Async.h"
+#include "Bytecode.h"
+#include "Heap.h"
+#include "Jit.h"
+#include "Object.h"
+#include "RuntimeException.h"
+#include "Shape.h"
+#include "Value.h"
+
+namespace JScr::Runtime
+{
+    // Executes a compiled Module. A VM holds all state of one run (globals, heap, stack, shapes, inline
+    // caches and jitted code) and is used by one thread at a time; the module it runs is shared, so
+    // creating another VM for it costs a few allocations and copies none of the code.
+    //
+    // All frames live on one contiguous value stack; a frame is just a window of registers into it, so
+    // calls never allocate.
+    //
+    // The heap is collected at back edges and calls. Values the host keeps from Run, Call or
+    // GetGlobal must be held in a Handle to survive later calls.
+    //
+    // Async functions and top level code that awaits suspend without holding the thread: the waiting
+    // call's registers move into its task and the VM goes on with whatever else is ready. Start and
+    // Poll drive such a run in steps for hosts that share threads between many scripts; Run blocks
+    // until it is done. An error before a call first waits reaches its caller like any other, later
+    // ones reject its task and reach whoever awaits it.
+    //
+    // Runs are metered in fuel, one unit per loop iteration and call. A run driven by Start and Poll
+    // that used up its time slice gives the thread back at the next back edge or call, where no
+    // native is running, and goes on with the next Poll; a run past its fuel limit fails.
+    //
+    // Execution is tiered: functions start out interpreted and are compiled by the Jit once they were
+    // entered or looped often enough, where the platform supports it. The interpreter dispatches through
+    // computed gotos on GCC and Clang (JSCR_COMPUTED_GOTO=0 selects the portable switch).
+    class VM : public NativeHost, private RootSource
+    {
+    public:
+        static constexpr std::size_t DefaultStackSize = 1 << 18;
+        static constexpr std::size_t MaxCallDepth = 1 << 14;
+
+        VM(std::shared_ptr<const Module> module, std::size_t stackSize = DefaultStackSize);
+        VM(const VM&) = delete;
+        VM& operator=(const VM&) = delete;
+        ~VM();
+
+        // Runs the top level code and returns the value of its `return` statement, if any. Waits for
+        // host work the script awaits.
+        Value Run();
+
+        // Runs the top level code until it is done or waits for host work; true once it is done.
+        bool Start();
+        // Continues with whatever host work completed since; true once the top level code is done.
+        bool Poll();
+        // What Run returns, once Start or Poll reported the run done. Rethrows the error of async top level code.
+        Value Result() const;
+        // Called on the thread that completes host work the run waits for, once per Start or Poll that
+        // returned false. It should arrange for Poll to be called.
+        void SetWakeHandler(std::function<void()> handler) { m_inbox->SetWakeHandler(std::move(handler)); }
+        // Whether the last Start or Poll returned because the run used up its time slice. No wake
+        // handler is called for that; Poll again once others had their turn.
+        bool Preempted() const { return m_preempted.has_value(); }
+
+        // How much fuel one Start or Poll may use before it gives the thread back, and how much a
+        // whole run may use before it fails with a RuntimeException. 0 stands for no bound.
+        void SetFuel(std::uint64_t slice, std::uint64_t limit);
+        // Fuel used since the run started.
+        std::uint64_t FuelUsed() const { return m_fuelCharged + (std::uint64_t) (m_fuelWindow - m_fuel); }
+
+        // Calls a script or native function from the host.
+        Value Call(const Value& callee, const std::vector<Value>& args) override;
+
+        void SetGlobal(const std::string& name, const Value& value);
+        Value GetGlobal(const std::string& name) const;
+
+        const Module& GetModule() const { return *m_module; }
+        Heap& GetHeap() override { return m_heap; }
+        Deferred Defer() override;
+        // Forks share the module and copy the globals and captured variables the function reads. It
+        // has to be pure: no assigning globals or captured variables, no awaiting, and no reading
+        // objects other than strings, module constants, standard library functions and other pure
+        // functions. Not while a fuel limit applies, which the fork would escape.
+        std::unique_ptr<NativeHost> Fork(Value& callee) override;
+
+        // Can be switched at any time; frames already running as machine code finish there.
+        void SetJitEnabled(bool enabled) { m_jitEnabled = enabled && Jit::IsSupported(); }
+        bool IsJitEnabled() const { return m_jitEnabled; }
+        void SetJitThreshold(std::uint32_t threshold) { m_jit.SetThreshold(threshold); }
+        const Jit& GetJit() const { return m_jit; }
+
+        // Runs a complete collection right away. Scripts never need this, it is for hosts that know
+        // they just dropped a lot.
+        void CollectGarbage() { m_heap.Collect(*this); }
+
+        StringObject* NewString(std::string_view data) { return m_heap.Allocate<StringObject>(String(data)); }
+
+        static std::string ToString(const Value& value);
+        static std::string TypeName(const Value& value);
+
+    private:
+        friend class Jit;
+
+        using ReturnConversions = std::array<std::uint8_t, 4>;
+
+        struct CallFrame
+        {
+            const ClosureObject* closure;
+            const FunctionProto* proto;
+            const Instruction* pc;
+            Value* base;
+            InlineCache* caches;
+            // Applied to the result on return, first to last; set when the frame took the place of typed
+            // functions in tail calls.
+            ReturnConversions returnConversions = { Conversion::None, Conversion::None, Conversion::None, Conversion::None };
+        };
+
+        Value Execute(std::size_t baseDepth);
+        // Runs the frames above `depth` for `task`, or for the top level code when it is null. False
+        // when the run gave the thread back before they returned.
+        bool Continue(std::size_t depth, TaskObject* task);
+        // Resumes ready tasks and takes in completions until the top level code is done or waits.
+        bool Drain();
+        bool PrepareCall(Value* callee, int argc);
+        Value* StackTop() const;
+        void TraceRoots(Tracer& tracer) override;
+
+        // What Fork copied into its fork so far.
+        struct ForkCopy;
+        // False when `value` cannot be copied into the fork.
+        bool CopyToFork(ForkCopy& copy, const Value& value, Value& result);
+        bool CheckPure(ForkCopy& copy, const FunctionProto& proto);
+
+        UpvalueObject* CaptureUpvalue(Value* slot);
+        void CloseUpvalues(Value* level);
+
+        // Saves the top frame in `task` to continue once `awaited` settles. It is popped by the caller.
+        void Suspend(TaskObject* task, TaskObject* awaited);
+        bool Resume(TaskObject* task);
+        void Settle(TaskObject* task, bool rejected, const Value& result, std::string error = {});
+
+        Value Arith(OpCode op, const Value& a, const Value& b);
+        bool Compare(OpCode op, const Value& a, const Value& b);
+        static bool Equals(const Value& a, const Value& b);
+        Value Convert(const Value& value, std::uint8_t conversion);
+        Value ConvertToTypedArray(const Value& value, std::uint8_t elementUid);
+        Value ConvertReturn(Value value, const ReturnConversions& conversions);
+        // Puts `conversion` in front of the pending ones. False when they have no room left for it.
+        static bool PendConversion(ReturnConversions& conversions, std::uint8_t conversion);
+        Value GetField(const Value& object, const StringObject* key, InlineCache& cache);
+        void SetField(const Value& object, const StringObject* key, const Value& value, InlineCache& cache);
+        Value GetIndex(const Value& object, const Value& index);
+        void SetIndex(const Value& object, const Value& index, const Value& value);
+        Value NewObject(std::uint16_t typeIndex);
+
+        // Called once m_fuel went below zero. Fails past the fuel limit, returns true if the run has
+        // to give the thread back and otherwise refills m_fuel.
+        bool OutOfFuel();
+        // Counts down to the end of the slice or the limit, whichever comes first.
+        void Refuel();
+
+        [[noreturn]] void Error(const std::string& description) const;
+
+    private:
+        std::shared_ptr<const Module> m_module;
+
+        struct StackDeleter
+        {
+            void operator()(Value* stack) const { std::free(stack); }
+        };
+
+        std::unique_ptr<Value[], StackDeleter> m_stack;
+        std::size_t m_stackSize;
+        std::vector<CallFrame> m_frames;
+        std::vector<Value> m_globals;
+        UpvalueObject* m_openUpvalues = nullptr;
+
+        // Suspended calls whose task settled, in that order.
+        std::deque<TaskObject*> m_ready;
+        // Tasks handed out by Defer and not settled yet.
+        std::unordered_set<TaskObject*> m_external;
+        std::shared_ptr<AsyncInbox> m_inbox = std::make_shared<AsyncInbox>();
+        TaskObject* m_mainTask = nullptr;
+        Value m_result;
+
+        struct Preemption
+        {
+            std::size_t depth;
+            TaskObject* task;
+        };
+
+        // Counted down at back edges and calls; what it started from is m_fuelWindow.
+        std::int64_t m_fuel = INT64_MAX;
+        std::int64_t m_fuelWindow = INT64_MAX;
+        std::uint64_t m_fuelCharged = 0;
+        std::uint64_t m_fuelSlice = 0;
+        std::uint64_t m_fuelLimit = 0;
+        // Only under Start and Poll; a native below a run could not be left halfway.
+        bool m_preemptible = false;
+        std::optional<Preemption> m_preempted;
+
+        ShapeTable m_shapes;
+        std::vector<const Shape*> m_typeShapes;
+        // Inline caches of every function, from FunctionProto::firstCache on.
+        std::unique_ptr<InlineCache[]> m_caches;
+
+        Heap m_heap;
+
+        Jit m_jit;
+        bool m_jitEnabled = Jit::IsSupported();
+    };
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+
+namespace JScr::Runtime
+{
+    class HeapObject;
+
+    enum class ValueType : std::uint8_t
+    {
+        Null, Bool, Int, Float, Double, Char, Object
+    };
+
+    // A NaN-boxed 64 bit word. Doubles are stored as they are; every other type lives inside the
+    // negative quiet NaN space, with a tag in the top 16 bits and the payload in the low 48 bits.
+    // Real NaNs are canonicalised to a positive quiet NaN so they never collide with a tag.
+    class Value
+    {
+    public:
+        static constexpr std::uint64_t TagNull   = 0xFFF9000000000000ull;
+        static constexpr std::uint64_t TagBool   = 0xFFFA000000000000ull;
+        static constexpr std::uint64_t TagInt    = 0xFFFB000000000000ull;
+        static constexpr std::uint64_t TagFloat  = 0xFFFC000000000000ull;
+        static constexpr std::uint64_t TagChar   = 0xFFFD000000000000ull;
+        static constexpr std::uint64_t TagObject = 0xFFFE000000000000ull;
+        static constexpr std::uint64_t TagMask   = 0xFFFF000000000000ull;
+        static constexpr std::uint64_t PayloadMask = 0x0000FFFFFFFFFFFFull;
+        static constexpr std::uint64_t BoxedSpace = 0xFFF8000000000000ull;
+        static constexpr std::uint64_t CanonicalNaN = 0x7FF8000000000000ull;
+
+        Value() : m_bits(TagNull) {}
+
+        static Value Null()                    { return FromBits(TagNull); }
+        static Value Bool(bool value)          { return FromBits(TagBool | (std::uint64_t) value); }
+        static Value Int(std::int32_t value)   { return FromBits(TagInt | (std::uint32_t) value); }
+        static Value Float(float value)        { return FromBits(TagFloat | std::bit_cast<std::uint32_t>(value)); }
+        static Value Char(char value)          { return FromBits(TagChar | (std::uint8_t) value); }
+        static Value Object(HeapObject* value) { return FromBits(TagObject | ((std::uint64_t) (std::uintptr_t) value & PayloadMask)); }
+
+        static Value Double(double value)
+        {
+            std::uint64_t bits = std::bit_cast<std::uint64_t>(value);
+            return FromBits(bits >= BoxedSpace ? CanonicalNaN : bits);
+        }
+
+        static Value FromBits(std::uint64_t bits) { Value v; v.m_bits = bits; return v; }
+
+    public:
+        std::uint64_t Bits() const { return m_bits; }
+
+        ValueType Type() const
+        {
+            static constexpr ValueType tags[] = { ValueType::Null, ValueType::Bool, ValueType::Int, ValueType::Float, ValueType::Char, ValueType::Object };
+            return IsDouble() ? ValueType::Double : tags[(m_bits >> 48) - (TagNull >> 48)];
+        }
+
+        bool IsNull() const   { return m_bits == TagNull; }
+        bool IsBool() const   { return (m_bits & TagMask) == TagBool; }
+        bool IsInt() const    { return (m_bits & TagMask) == TagInt; }
+        bool IsFloat() const  { return (m_bits & TagMask) == TagFloat; }
+        bool IsDouble() const { return m_bits < TagNull; }
+        bool IsChar() const   { return (m_bits & TagMask) == TagChar; }
+        bool IsObject() const { return (m_bits & TagMask) == TagObject; }
+
+        // Chars take part in arithmetic as small integers.
+        bool IsNumber() const { return m_bits < TagNull || (m_bits >= TagInt && m_bits < TagObject); }
+
+        bool AsBool() const           { return (m_bits & 1) != 0; }
+        std::int32_t AsInt() const    { return (std::int32_t) (std::uint32_t) m_bits; }
+        float AsFloat() const         { return std::bit_cast<float>((std::uint32_t) m_bits); }
+        double AsDouble() const       { return std::bit_cast<double>(m_bits); }
+        char AsChar() const           { return (char) (std::uint8_t) m_bits; }
+        HeapObject* AsObject() const  { return (HeapObject*) (std::uintptr_t) (m_bits & PayloadMask); }
+
+        std::int32_t ToInt() const
+        {
+            switch (Type())
+            {
+            case ValueType::Int:    return AsInt();
+            case ValueType::Char:   return (std::int32_t) AsChar();
+            case ValueType::Float:  return (std::int32_t) AsFloat();
+            case ValueType::Double: return (std::int32_t) AsDouble();
+            default:                return 0;
+            }
+        }
+
+        double ToDouble() const
+        {
+            switch (Type())
+            {
+            case ValueType::Int:    return (double) AsInt();
+            case ValueType::Char:   return (double) AsChar();
+            case ValueType::Float:  return (double) AsFloat();
+            case ValueType::Double: return AsDouble();
+            default:                return 0.0;
+            }
+        }
+
+        bool IsTruthy() const
+        {
+            switch (Type())
+            {
+            case ValueType::Null:   return false;
+            case ValueType::Bool:   return AsBool();
+            case ValueType::Object: return AsObject() != nullptr;
+            default:                return ToDouble() != 0.0;
+            }
+        }
+
+        // Same type and same bits. Unlike ==, 0.0 and -0.0 differ and a NaN is identical to itself.
+        bool IsIdentical(const Value& other) const { return m_bits == other.m_bits; }
+
+    public:
+        // Fast paths for the interpreter loop: one mask and compare for both operands.
+        static bool BothInt(const Value& a, const Value& b)    { return (((a.m_bits ^ TagInt) | (b.m_bits ^ TagInt)) & TagMask) == 0; }
+        static bool BothDouble(const Value& a, const Value& b) { return (a.m_bits < TagNull) & (b.m_bits < TagNull); }
+
+        // Integer arithmetic wraps around instead of being undefined.
+        static Value AddInt(const Value& a, const Value& b) { return Int((std::int32_t) ((std::uint32_t) a.m_bits + (std::uint32_t) b.m_bits)); }
+        static Value SubInt(const Value& a, const Value& b) { return Int((std::int32_t) ((std::uint32_t) a.m_bits - (std::uint32_t) b.m_bits)); }
+        static Value MulInt(const Value& a, const Value& b) { return Int((std::int32_t) ((std::uint32_t) a.m_bits * (std::uint32_t) b.m_bits)); }
+        static Value NegInt(const Value& a)                 { return Int((std::int32_t) (0u - (std::uint32_t) a.m_bits)); }
+
+        static Value AddDouble(const Value& a, const Value& b) { return Double(a.AsDouble() + b.AsDouble()); }
+        static Value SubDouble(const Value& a, const Value& b) { return Double(a.AsDouble() - b.AsDouble()); }
+        static Value MulDouble(const Value& a, const Value& b) { return Double(a.AsDouble() * b.AsDouble()); }
+        static Value DivDouble(const Value& a, const Value& b) { return Double(a.AsDouble() / b.AsDouble()); }
+
+    private:
+        std::uint64_t m_bits;
+    };
+
+    static_assert(sizeof(Value) == 8, "Value must fit in a single register.");
+}
@@ -0,0 +1,244 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace JScr::Runtime
+{
+    // Just enough of an x86-64 encoder for the baseline JIT. Memory operands are always [base + disp32]
+    // and jumps always take a rel32, so labels can be resolved in one pass once the code is complete.
+    class X64Assembler
+    {
+    public:
+        enum Reg : std::uint8_t
+        {
+            RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15
+        };
+
+        enum Xmm : std::uint8_t
+        {
+            XMM0, XMM1, XMM2
+        };
+
+        // Condition codes as encoded in Jcc and SETcc.
+        enum Cond : std::uint8_t
+        {
+            Overflow = 0x0, Below = 0x2, AboveEqual = 0x3, Equal = 0x4, NotEqual = 0x5, BelowEqual = 0x6, Above = 0x7, Sign = 0x8,
+            Parity = 0xA, NoParity = 0xB, Less = 0xC, GreaterEqual = 0xD, LessEqual = 0xE, Greater = 0xF
+        };
+
+        struct Label
+        {
+            std::uint32_t id;
+        };
+
+        struct Mem
+        {
+            Reg base;
+            std::int32_t disp;
+        };
+
+    public:
+        const std::vector<std::uint8_t>& Code() const { return m_code; }
+        std::uint32_t Offset() const { return (std::uint32_t) m_code.size(); }
+
+        Label NewLabel()
+        {
+            m_labels.push_back(Unbound);
+            return Label{ (std::uint32_t) m_labels.size() - 1 };
+        }
+
+        void Bind(Label label)
+        {
+            m_labels[label.id] = Offset();
+        }
+
+        // Resolves every jump once all labels are bound. Returns false if one never was.
+        bool Link()
+        {
+            for (const auto& fixup : m_fixups)
+            {
+                std::uint32_t target = m_labels[fixup.label];
+                if (target == Unbound)
+                    return false;
+                std::int32_t rel = (std::int32_t) target - (std::int32_t) (fixup.at + 4);
+                std::memcpy(&m_code[fixup.at], &rel, 4);
+            }
+            return true;
+        }
+
+        // ----- Moves -----
+
+        void MovImm(Reg dst, std::uint64_t imm)
+        {
+            if (imm <= 0xFFFFFFFFull)
+            {
+                // A 32 bit move clears the upper half.
+                if (dst >= R8)
+                    Byte(0x41);
+                Byte(0xB8 + (dst & 7));
+                Imm32((std::uint32_t) imm);
+                return;
+            }
+            Byte(0x48 | ((dst >> 3) & 1));
+            Byte(0xB8 + (dst & 7));
+            Imm64(imm);
+        }
+
+        void Mov(Reg dst, Reg src)           { Rex(true, src, dst); Byte(0x89); ModRM(3, src, dst); }
+        void Load(Reg dst, Mem src)          { Rex(true, dst, src.base); Byte(0x8B); Address(dst, src); }
+        void Load32(Reg dst, Mem src)        { Rex(false, dst, src.base); Byte(0x8B); Address(dst, src); }
+        void Store(Mem dst, Reg src)         { Rex(true, src, dst.base); Byte(0x89); Address(src, dst); }
+        void Store32(Mem dst, Reg src)       { Rex(false, src, dst.base); Byte(0x89); Address(src, dst); }
+        void LoadByte(Reg dst, Mem src)      { Rex(false, dst, src.base); Byte(0x0F); Byte(0xB6); Address(dst, src); }
+        void Mov32(Reg dst, Reg src)         { Alu(0x89, false, dst, src); }
+        void MovzxByte(Reg dst, Reg src)     { Rex(false, dst, src, src >= RSP); Byte(0x0F); Byte(0xB6); ModRM(3, dst, src); }
+
+        // ----- Integer arithmetic. The 32 bit forms clear the upper half of the destination. -----
+
+        void Add32(Reg dst, Reg src)  { Alu(0x01, false, dst, src); }
+        void Sub32(Reg dst, Reg src)  { Alu(0x29, false, dst, src); }
+        void And32(Reg dst, Reg src)  { Alu(0x21, false, dst, src); }
+        void Cmp32(Reg a, Reg b)      { Alu(0x39, false, a, b); }
+        void Test32(Reg a, Reg b)     { Alu(0x85, false, a, b); }
+        void Or(Reg dst, Reg src)     { Alu(0x09, true, dst, src); }
+        void Add(Reg dst, Reg src)    { Alu(0x01, true, dst, src); }
+        void Cmp(Reg a, Reg b)        { Alu(0x39, true, a, b); }
+        void Imul32(Reg dst, Reg src) { Rex(false, dst, src); Byte(0x0F); Byte(0xAF); ModRM(3, dst, src); }
+        void Neg32(Reg reg)           { Rex(false, RAX, reg); Byte(0xF7); ModRM(3, 3, reg); }
+        void Dec(Reg reg)             { Rex(true, RAX, reg); Byte(0xFF); ModRM(3, 1, reg); }
+        void Cdq()                    { Byte(0x99); }
+        void Idiv32(Reg divisor)      { Rex(false, RAX, divisor); Byte(0xF7); ModRM(3, 7, divisor); }
+
+        void Cmp32Imm(Reg reg, std::int32_t imm) { Rex(false, RAX, reg); Byte(0x81); ModRM(3, 7, reg); Imm32((std::uint32_t) imm); }
+        void Shr(Reg reg, std::uint8_t amount)   { Rex(true, RAX, reg); Byte(0xC1); ModRM(3, 5, reg); Byte(amount); }
+        void Shl(Reg reg, std::uint8_t amount)   { Rex(true, RAX, reg); Byte(0xC1); ModRM(3, 4, reg); Byte(amount); }
+        void XorImm8(Reg reg, std::int8_t imm)   { Rex(true, RAX, reg); Byte(0x83); ModRM(3, 6, reg); Byte((std::uint8_t) imm); }
+        void AndImm8(Reg reg, std::int8_t imm)   { Rex(false, RAX, reg); Byte(0x83); ModRM(3, 4, reg); Byte((std::uint8_t) imm); }
+        void Btc(Reg reg, std::uint8_t bit)      { Rex(true, RAX, reg); Byte(0x0F); Byte(0xBA); ModRM(3, 7, reg); Byte(bit); }
+        void TestByte(Reg a, Reg b)              { Rex(false, b, a, a >= RSP || b >= RSP); Byte(0x84); ModRM(3, b, a); }
+
+        void SetCC(Cond cond, Reg dst)
+        {
+            Rex(false, RAX, dst, dst >= RSP);
+            Byte(0x0F);
+            Byte(0x90 + cond);
+            ModRM(3, 0, dst);
+        }
+
+        // ----- SSE2 doubles -----
+
+        void MovqToXmm(Xmm dst, Reg src)   { Byte(0x66); Rex(true, (Reg) dst, src); Byte(0x0F); Byte(0x6E); ModRM(3, dst, src); }
+        void MovqFromXmm(Reg dst, Xmm src) { Byte(0x66); Rex(true, (Reg) src, dst); Byte(0x0F); Byte(0x7E); ModRM(3, src, dst); }
+        void LoadDouble(Xmm dst, Mem src)  { Sse(0xF2, 0x10, dst, src); }
+        void IntToDouble(Xmm dst, Mem src) { Sse(0xF2, 0x2A, dst, src); }
+        void DoubleToInt(Reg dst, Xmm src) { Byte(0xF2); Rex(false, dst, (Reg) src); Byte(0x0F); Byte(0x2C); ModRM(3, dst, src); }
+        void AddDouble(Xmm dst, Xmm src)   { SseRR(0xF2, 0x58, dst, src); }
+        void SubDouble(Xmm dst, Xmm src)   { SseRR(0xF2, 0x5C, dst, src); }
+        void MulDouble(Xmm dst, Xmm src)   { SseRR(0xF2, 0x59, dst, src); }
+        void DivDouble(Xmm dst, Xmm src)   { SseRR(0xF2, 0x5E, dst, src); }
+        void Ucomisd(Xmm a, Xmm b)         { SseRR(0x66, 0x2E, a, b); }
+
+        // ----- Control flow -----
+
+        void Jmp(Label label)            { Byte(0xE9); Fixup(label); }
+        void Jcc(Cond cond, Label label) { Byte(0x0F); Byte(0x80 + cond); Fixup(label); }
+        void JmpReg(Reg target)          { Rex(false, RAX, target); Byte(0xFF); ModRM(3, 4, target); }
+        void CallReg(Reg target)         { Rex(false, RAX, target); Byte(0xFF); ModRM(3, 2, target); }
+        void Ret()                       { Byte(0xC3); }
+
+        void Push(Reg reg)
+        {
+            if (reg >= R8)
+                Byte(0x41);
+            Byte(0x50 + (reg & 7));
+        }
+
+        void Pop(Reg reg)
+        {
+            if (reg >= R8)
+                Byte(0x41);
+            Byte(0x58 + (reg & 7));
+        }
+
+        void AddRsp(std::int8_t imm) { Byte(0x48); Byte(0x83); ModRM(3, 0, RSP); Byte((std::uint8_t) imm); }
+        void SubRsp(std::int8_t imm) { Byte(0x48); Byte(0x83); ModRM(3, 5, RSP); Byte((std::uint8_t) imm); }
+
+    private:
+        static constexpr std::uint32_t Unbound = 0xFFFFFFFF;
+
+        struct JumpFixup
+        {
+            std::uint32_t at;
+            std::uint32_t label;
+        };
+
+        void Byte(std::uint8_t value) { m_code.push_back(value); }
+
+        void Imm32(std::uint32_t value)
+        {
+            for (int i = 0; i < 4; i++)
+                Byte((std::uint8_t) (value >> (i * 8)));
+        }
+
+        void Imm64(std::uint64_t value)
+        {
+            for (int i = 0; i < 8; i++)
+                Byte((std::uint8_t) (value >> (i * 8)));
+        }
+
+        void Fixup(Label label)
+        {
+            m_fixups.push_back(JumpFixup{ Offset(), label.id });
+            Imm32(0);
+        }
+
+        // `force` emits an empty REX so the byte registers 4-7 mean SPL..DIL instead of AH..BH.
+        void Rex(bool wide, int reg, int rm, bool force = false)
+        {
+            std::uint8_t rex = 0x40 | (wide ? 8 : 0) | ((reg >> 3) & 1) << 2 | ((rm >> 3) & 1);
+            if (rex != 0x40 || force)
+                Byte(rex);
+        }
+
+        void ModRM(int mod, int reg, int rm) { Byte((std::uint8_t) ((mod << 6) | ((reg & 7) << 3) | (rm & 7))); }
+
+        void Address(int reg, Mem mem)
+        {
+            ModRM(2, reg, mem.base);
+            // RSP and R12 as a base need a SIB byte.
+            if ((mem.base & 7) == RSP)
+                Byte(0x24);
+            Imm32((std::uint32_t) mem.disp);
+        }
+
+        void Alu(std::uint8_t opcode, bool wide, Reg dst, Reg src)
+        {
+            Rex(wide, src, dst);
+            Byte(opcode);
+            ModRM(3, src, dst);
+        }
+
+        void Sse(std::uint8_t prefix, std::uint8_t opcode, Xmm dst, Mem src)
+        {
+            Byte(prefix);
+            Rex(false, dst, src.base);
+            Byte(0x0F);
+            Byte(opcode);
+            Address(dst, src);
+        }
+
+        void SseRR(std::uint8_t prefix, std::uint8_t opcode, Xmm dst, Xmm src)
+        {
+            Byte(prefix);
+            Byte(0x0F);
+            Byte(opcode);
+            ModRM(3, dst, src);
+        }
+
+    private:
+        std::vector<std::uint8_t> m_code;
+        std::vector<std::uint32_t> m_labels;
+        std::vector<JumpFixup> m_fixups;
+    };
+}
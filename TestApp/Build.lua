@@ -27,6 +27,10 @@ project "TestApp"
         systemversion "latest"
         defines { "JSCR_PLATFORM_WINDOWS" }
  
+    -- Script::Execute runs scripts on the worker threads of Runtime::Scheduler.
+    filter "system:linux"
+        links { "pthread" }
+
     filter "configurations:Debug"
         defines { "DEBUG" }
         runtime "Debug"
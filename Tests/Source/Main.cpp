@@ -0,0 +1,312 @@
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include "JScr.h"
+#include "Runtime/Async.h"
+#include "Runtime/Binding.h"
+#include "Runtime/DifferentialRunner.h"
+#include "Runtime/Scheduler.h"
+#include "Runtime/VM.h"
+using namespace JScr;
+using namespace JScr::Runtime;
+
+// Runs every script of the corpus through each engine and fails when any of them disagree with the
+// interpreter, then checks what the corpus cannot: how hosts drive runs. Usage: Tests [corpus directory] [repetitions]
+
+namespace
+{
+    int Square(int x) { return x * x; }
+
+    std::string Repeat(std::string_view text, int count)
+    {
+        std::string out = "";
+        for (int i = 0; i < count; i++)
+            out += text;
+        return out;
+    }
+
+    // Host memory scripts may read but not write. Not const itself, so a write that gets through shows
+    // up in the checks instead of crashing.
+    double readings[] = { 1.5, 2.5, 3.5, 4.5 };
+
+    Value Readings(NativeHost& host)
+    {
+        return Binding::Share(host.GetHeap(), std::span<const double>(readings));
+    }
+
+    // Promises of the `later` calls scripts made, for the checks to settle.
+    std::mutex laterMutex;
+    std::condition_variable laterCalled;
+    std::vector<Promise> later;
+
+    // Host work that is done once a check settles it.
+    Value Later(NativeHost& host)
+    {
+        Deferred deferred = host.Defer();
+        std::lock_guard lock(laterMutex);
+        later.push_back(std::move(deferred.promise));
+        laterCalled.notify_all();
+        return deferred.task;
+    }
+
+    // Waits for `count` calls of `later` and takes their promises.
+    std::vector<Promise> TakeLater(std::size_t count)
+    {
+        std::unique_lock lock(laterMutex);
+        laterCalled.wait(lock, [count]() { return later.size() >= count; });
+        return std::exchange(later, {});
+    }
+
+    int failures = 0;
+
+    void Check(bool passed, const std::string& what)
+    {
+        std::printf("%s %s\n", passed ? "[ OK ]" : "[FAIL]", what.c_str());
+        if (!passed)
+            failures++;
+    }
+
+    // Script only loads files, so the checks write theirs to the temporary directory first.
+    std::unique_ptr<Script> Load(const std::string& name, const std::string& source, const ExternalResource& hosts)
+    {
+        auto path = std::filesystem::temp_directory_path() / (name + ".jscr");
+        std::ofstream(path) << source;
+
+        auto result = Script::FromFile(path.string(), { hosts });
+        for (const auto& error : result.errors)
+            std::fprintf(stderr, "%s\n", error.ToString().c_str());
+        return std::unique_ptr<Script>(result.script);
+    }
+
+    // Steps the context until it is done, settling the `later` call it waits for with `settle` each
+    // time. What the run threw ends up in `error`.
+    template <typename Settle>
+    int RunSettling(ScriptContext& context, Settle settle, std::string& error)
+    {
+        try
+        {
+            bool done = context.Start();
+            while (!done)
+            {
+                for (Promise& promise : TakeLater(1))
+                    settle(promise);
+                done = context.Poll();
+            }
+            return context.ExitCode();
+        }
+        catch (const RuntimeException& e)
+        {
+            error = e.Description();
+            return 0;
+        }
+    }
+
+    // Async scripts are not in the corpus: the reference interpreter has no async functions to compare them with.
+    void CheckAsync(const ExternalResource& hosts)
+    {
+        std::string error = "";
+        auto awaiting = Load("awaiting",
+            "async int twice()\n{\n    int value = await later();\n    return value * 2;\n}\n\n"
+            "int a = await twice();\nint b = await later();\nreturn a + b;\n", hosts);
+        ScriptContext context(*awaiting);
+        int settled = 0;
+        int exitCode = RunSettling(context, [&settled](Promise& promise) { promise.Resolve(Value::Int(++settled == 1 ? 20 : 2)); }, error);
+        Check(exitCode == 42 && settled == 2 && error.empty(), "await takes the results of async functions and host work");
+
+        auto rejecting = Load("rejecting",
+            "async int inner()\n{\n    int value = await later();\n    return value;\n}\n\n"
+            "async int outer()\n{\n    int value = await inner();\n    return value + 1;\n}\n\n"
+            "return await outer();\n", hosts);
+        ScriptContext rejected(*rejecting);
+        RunSettling(rejected, [](Promise& promise) { promise.Reject("The disk is gone."); }, error);
+        Check(error == "The disk is gone.", "a rejection propagates through every await up to the host");
+
+        error = "";
+        ScriptContext dropped(*rejecting);
+        RunSettling(dropped, [](Promise&) {}, error);
+        Check(error.find("dropped") != std::string::npos, "a promise the host drops rejects its task");
+    }
+
+    // Steps a run that waits for nothing but its turn, counting how often it gave the thread back.
+    int RunPreempted(ScriptContext& context, int& preemptions)
+    {
+        bool done = context.Start();
+        while (!done && context.Preempted())
+        {
+            preemptions++;
+            done = context.Poll();
+        }
+        return context.ExitCode();
+    }
+
+    void CheckFuel(const ExternalResource& hosts)
+    {
+        auto spinning = Load("spinning", "int total = 0;\nfor (int i = 0; i < 200000; i = i + 1)\n{\n    total = total + 1;\n}\nreturn total / 1000;\n", hosts);
+        ScriptContext context(*spinning);
+
+        int preemptions = 0;
+        context.SetFuel(1000, 0);
+        int exitCode = RunPreempted(context, preemptions);
+        Check(exitCode == 200 && preemptions >= 100, "a run that used up its fuel slice gives the thread back and goes on with Poll");
+
+        std::string error = "";
+        context.SetFuel(1000, 50000);
+        try
+        {
+            RunPreempted(context, preemptions);
+        }
+        catch (const RuntimeException& e)
+        {
+            error = e.Description();
+        }
+        Check(error.find("fuel limit") != std::string::npos, "a run past its fuel limit fails with a RuntimeException");
+
+        preemptions = 0;
+        context.SetFuel(1000, 0);
+        exitCode = RunPreempted(context, preemptions);
+        context.SetFuel(0, 0);
+        Check(exitCode == 200 && preemptions >= 100 && context.Run() == 200, "a context that ran out of fuel runs again");
+    }
+
+    // Every engine has to refuse the script, and with an error about the read-only array.
+    bool RefusedEverywhere(const DifferentialRunner::ScriptReport& report)
+    {
+        bool refused = report.parseError.empty() && !report.results.empty();
+        for (const auto& result : report.results)
+            refused = refused && result.result == "error" && result.error.find("read-only") != std::string::npos;
+        return refused;
+    }
+
+    void CheckSharing(const ExternalResource& hosts)
+    {
+        DifferentialRunner runner(1, { hosts });
+        auto Report = [&runner, &hosts](const std::string& name, const std::string& source)
+        {
+            auto path = std::filesystem::temp_directory_path() / (name + ".jscr");
+            std::ofstream(path) << source;
+            return runner.RunScript(path.string());
+        };
+
+        auto reading = Report("shared_read", "double[] values = readings();\nreturn sum(values) + values[3];\n");
+        Check(reading.Matches() && !reading.results.empty() && reading.results[0].result == "double:16.5", "scripts read host memory shared as a const span");
+
+        // Called often enough on a writable array first that the JIT compiled the store before it meets the shared one.
+        Check(RefusedEverywhere(Report("shared_store",
+            "int store(double[] values, int i, double value)\n{\n    values[i] = value;\n    return i;\n}\n\n"
+            "double[] scratch = doubleArray(4);\nfor (int i = 0; i < 20; i = i + 1)\n{\n    store(scratch, i % 4, 1.0);\n}\n"
+            "store(readings(), 0, 9.0);\nreturn 0;\n")), "index stores into a const span fail on every engine");
+        Check(RefusedEverywhere(Report("shared_fill", "fill(readings(), 0.0);\nreturn 0;\n")), "fill refuses a const span");
+        Check(RefusedEverywhere(Report("shared_add", "double[] ones = doubleArray(4);\nfill(ones, 1.0);\nadd(readings(), ones, ones);\nreturn 0;\n")),
+            "element-wise kernels refuse a const span as their destination");
+        Check(readings[0] == 1.5 && readings[1] == 2.5 && readings[2] == 3.5 && readings[3] == 4.5, "the host memory behind a const span is unchanged");
+    }
+
+    // Corpus/parallel.jscr compares the parallel algorithms with plain loops. That only covers the
+    // parallel path if its callbacks can be forked, and the fallback if the impure one cannot.
+    void CheckParallel(const ExternalResource& hosts)
+    {
+        Check(Scheduler::Shared().WorkerCount() == 4, "the shared scheduler runs four workers");
+
+        auto callbacks = Load("callbacks",
+            "int square(int x)\n{\n    return x * x % 1000;\n}\n\n"
+            "int calls = 0;\nint counted(int x)\n{\n    calls = calls + 1;\n    return x + 1;\n}\n", hosts);
+        ScriptContext context(*callbacks);
+        context.Run();
+
+        VM& vm = *context.GetVM();
+        Value pure = vm.GetGlobal("square");
+        Value impure = vm.GetGlobal("counted");
+        Check(vm.Fork(pure) != nullptr && vm.Fork(impure) == nullptr, "pure callbacks run on forks and impure ones stay on the calling thread");
+    }
+
+    void CheckScheduling(const ExternalResource& hosts)
+    {
+        Scheduler scheduler(4);
+
+        auto counting = Load("counting", "int total = 0;\nfor (int i = 0; i < 100000; i = i + 1)\n{\n    total = total + i % 7;\n}\nreturn total;\n", hosts);
+        std::vector<std::future<int>> runs;
+        for (int i = 0; i < 8; i++)
+            runs.push_back(ScriptContext::Submit(std::make_shared<ScriptContext>(*counting), scheduler));
+
+        int expected = 0;
+        for (int i = 0; i < 100000; i++)
+            expected += i % 7;
+        bool same = true;
+        for (auto& run : runs)
+            same = run.get() == expected && same;
+        Check(same, "contexts of one script queued side by side finish with the same result");
+
+        auto waiting = Load("waiting", "int value = await later();\nreturn value + 1;\n", hosts);
+        std::future<int> executed = waiting->Execute([](int) {}, true);
+        auto context = std::make_shared<ScriptContext>(*waiting);
+        std::future<int> submitted = ScriptContext::Submit(context, scheduler);
+
+        bool rejected = false;
+        try
+        {
+            waiting->Execute([](int) {}, true);
+        }
+        catch (const RuntimeException&)
+        {
+            rejected = true;
+        }
+        Check(rejected, "executing a script that is still running throws a RuntimeException");
+
+        rejected = false;
+        try
+        {
+            ScriptContext::Submit(context, scheduler);
+        }
+        catch (const RuntimeException&)
+        {
+            rejected = true;
+        }
+        Check(rejected, "queueing a context that is queued already throws a RuntimeException");
+
+        for (Promise& promise : TakeLater(2))
+            promise.Resolve(Value::Int(41));
+        Check(executed.get() == 42 && submitted.get() == 42, "waiting runs hold no worker and go on once the host work is done");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string corpus = argc > 1 ? argv[1] : "Corpus";
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 1;
+
+    // The parallel algorithms split work only with two workers or more, whatever the machine has.
+    Scheduler::SetSharedWorkerCount(4);
+
+    ExternalResource hosts;
+    hosts.Bind("square", &Square).Bind("repeat", &Repeat).Bind("later", &Later).Bind("readings", &Readings);
+
+    DifferentialRunner runner(repetitions, { hosts });
+    auto reports = runner.RunCorpus(corpus);
+    std::fputs(DifferentialRunner::FormatReport(reports).c_str(), stdout);
+
+    if (reports.empty())
+    {
+        std::fprintf(stderr, "No scripts found in \"%s\".\n", corpus.c_str());
+        return 1;
+    }
+
+    for (const auto& report : reports)
+    {
+        if (!report.Matches())
+            failures++;
+    }
+
+    CheckScheduling(hosts);
+    CheckAsync(hosts);
+    CheckFuel(hosts);
+    CheckSharing(hosts);
+    CheckParallel(hosts);
+    return failures == 0 ? 0 : 1;
+}